@@ -0,0 +1,102 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "adv_parser.hpp"
+
+#include <cstring>
+
+// AD and EIR data types (Bluetooth Assigned Numbers, section 2.3), identical for both
+static constexpr uint8_t TYPE_FLAGS            = 0x01;
+static constexpr uint8_t TYPE_UUID16_PARTIAL   = 0x02;
+static constexpr uint8_t TYPE_UUID16_COMPLETE  = 0x03;
+static constexpr uint8_t TYPE_UUID32_PARTIAL   = 0x04;
+static constexpr uint8_t TYPE_UUID32_COMPLETE  = 0x05;
+static constexpr uint8_t TYPE_UUID128_PARTIAL  = 0x06;
+static constexpr uint8_t TYPE_UUID128_COMPLETE = 0x07;
+static constexpr uint8_t TYPE_NAME_SHORT       = 0x08;
+static constexpr uint8_t TYPE_NAME_COMPLETE    = 0x09;
+static constexpr uint8_t TYPE_TX_POWER         = 0x0A;
+static constexpr uint8_t TYPE_APPEARANCE       = 0x19;
+
+/**
+ * @brief Walk the length-type-value structures of advertising or EIR data once
+ *
+ * Each structure is a length byte (covering the type and value), a type byte and the value.
+ * Every byte is read at most once, and only after checking it is within `length`, so that
+ * corrupted or hostile payloads can't make the parser read past the buffer.
+ */
+bool AdvParser::parse(const uint8_t *data, size_t length, AdvFields &fields) {
+  memset(&fields, 0, sizeof(AdvFields));
+  return merge(data, length, fields);
+}
+
+bool AdvParser::merge(const uint8_t *data, size_t length, AdvFields &fields) {
+  size_t pos = 0;
+  while (pos < length) {
+    uint8_t len = data[pos];
+    if (len == 0) break;                      // End of the significant part
+    if (len > length - pos - 1) return false; // Truncated structure
+
+    uint8_t        type      = data[pos + 1];
+    const uint8_t *value     = &data[pos + 2];
+    uint8_t        value_len = len - 1;
+    pos += len + 1;
+
+    switch (type) {
+      case TYPE_FLAGS:
+        if ((value_len >= 1) && !fields.has(AdvFields::FLAGS)) {
+          fields.flags = value[0];
+          fields.present |= AdvFields::FLAGS;
+        }
+        break;
+      case TYPE_UUID16_PARTIAL:
+      case TYPE_UUID16_COMPLETE:
+        for (uint8_t i = 0; i + 2 <= value_len; i += 2) {
+          if (fields.uuid16_count >= AdvFields::MAX_UUID16) break;
+          fields.uuid16[fields.uuid16_count++] = value[i] | (value[i + 1] << 8);
+          fields.present |= AdvFields::UUID16;
+        }
+        break;
+      case TYPE_UUID32_PARTIAL:
+      case TYPE_UUID32_COMPLETE:
+        if ((value_len >= 4) && !fields.has(AdvFields::UUID32)) {
+          fields.uuid32 =
+              value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t)value[3] << 24);
+          fields.present |= AdvFields::UUID32;
+        }
+        break;
+      case TYPE_UUID128_PARTIAL:
+      case TYPE_UUID128_COMPLETE:
+        if ((value_len >= 16) && !fields.has(AdvFields::UUID128)) {
+          fields.uuid128 = value;
+          fields.present |= AdvFields::UUID128;
+        }
+        break;
+      case TYPE_NAME_SHORT:
+      case TYPE_NAME_COMPLETE:
+        if ((value_len > 0) && !fields.name_complete) {
+          fields.name          = value;
+          fields.name_len      = value_len;
+          fields.name_complete = (type == TYPE_NAME_COMPLETE);
+          fields.present |= AdvFields::NAME;
+        }
+        break;
+      case TYPE_TX_POWER:
+        if ((value_len >= 1) && !fields.has(AdvFields::TX_POWER)) {
+          fields.tx_power = (int8_t)value[0];
+          fields.present |= AdvFields::TX_POWER;
+        }
+        break;
+      case TYPE_APPEARANCE:
+        if ((value_len >= 2) && !fields.has(AdvFields::APPEARANCE)) {
+          fields.appearance = value[0] | (value[1] << 8);
+          fields.present |= AdvFields::APPEARANCE;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fields of interest of a BLE advertisement or of a BT Classic EIR record
+ *
+ * Pointers refer to the parsed buffer: they are only valid as long as it is.
+ */
+struct AdvFields {
+  static constexpr uint8_t MAX_UUID16 = 8;
+
+  /// Bits of `present`
+  enum : uint8_t {
+    FLAGS      = 0x01,
+    UUID16     = 0x02,
+    UUID32     = 0x04,
+    UUID128    = 0x08,
+    NAME       = 0x10,
+    TX_POWER   = 0x20,
+    APPEARANCE = 0x40,
+  };
+
+  uint8_t        present; ///< Fields found, FLAGS | UUID16 | ...
+  uint8_t        flags;
+  int8_t         tx_power;
+  uint16_t       appearance;
+  uint8_t        uuid16_count;       ///< 16-bit UUIDs kept, complete and incomplete lists
+  uint16_t       uuid16[MAX_UUID16]; ///< In advertised order, the ones past MAX_UUID16 dropped
+  uint32_t       uuid32;             ///< First 32-bit UUID advertised
+  const uint8_t *uuid128;            ///< First 128-bit UUID advertised, little endian
+  const uint8_t *name;               ///< Not NUL terminated
+  uint8_t        name_len;
+  bool           name_complete;      ///< false for a shortened name
+
+  inline bool has(uint8_t fields) const { return (present & fields) == fields; }
+
+  /// True if the UUID is in one of the 16-bit service lists
+  inline bool has_uuid16(uint16_t uuid) const {
+    for (uint8_t i = 0; i < uuid16_count; i++) {
+      if (uuid16[i] == uuid) return true;
+    }
+    return false;
+  }
+};
+
+/**
+ * @brief Single-pass parser of the length-type-value structures of BLE advertising data (Core
+ *        Specification Vol 3, Part C, section 11) and BT Classic EIR data, which share the
+ *        format
+ */
+class AdvParser {
+public:
+  /**
+   * @brief Walk the data once, filling the fields recognized
+   *
+   * A structure of length 0 ends the significant part of the data, as does the end of the
+   * buffer. The complete name is preferred to the shortened one whatever their order; for the
+   * other fields, the first structure seen is kept. Structures too short for their type are
+   * skipped.
+   *
+   * @param data Advertising data, scan response or EIR record
+   * @param length Bytes available in data: nothing past it is read
+   * @param fields Receives the fields found, cleared first
+   * @return false if a structure extends past `length`. The fields found before it are kept.
+   */
+  static bool parse(const uint8_t *data, size_t length, AdvFields &fields);
+
+  /**
+   * @brief Walk more data into fields already parsed, as parse() does but without clearing
+   *        them
+   *
+   * The scan response of a BLE advertisement is merged this way: the advertising data may end
+   * early with a structure of length 0, padding included, which must not hide the scan
+   * response behind it. The fields already found are kept, except for a shortened name when a
+   * complete one comes.
+   */
+  static bool merge(const uint8_t *data, size_t length, AdvFields &fields);
+};
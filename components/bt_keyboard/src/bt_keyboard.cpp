@@ -23,12 +23,14 @@
 #define __BT_KEYBOARD__ 1
 #include "bt_keyboard.hpp"
 
+#include <cinttypes>
+#include <cstdio>
 #include <cstring>
-#include <iomanip>
-#include <iostream>
-#include <list>
 #include <memory>
-#include <ostream>
+#include <new>
+
+#include "adv_parser.hpp"
+#include "text_format.hpp"
 
 #define SCAN            1
 
@@ -42,8 +44,9 @@
 
 SemaphoreHandle_t BTKeyboard::bt_hidh_cb_semaphore_  = nullptr;
 SemaphoreHandle_t BTKeyboard::ble_hidh_cb_semaphore_ = nullptr;
+StaticSemaphore_t BTKeyboard::bt_hidh_cb_semaphore_buffer_;
+StaticSemaphore_t BTKeyboard::ble_hidh_cb_semaphore_buffer_;
 
-const char *BTKeyboard::gap_bt_prop_type_names_[]    = {"", "BDNAME", "COD", "RSSI", "EIR"};
 
 const char *BTKeyboard::ble_gap_evt_names_[]         = {"ADV_DATA_SET_COMPLETE",
                                                         "SCAN_RSP_DATA_SET_COMPLETE",
@@ -101,95 +104,11 @@ const char *BTKeyboard::bt_gap_evt_names_[]          = {"DISC_RES",
 
 const char *BTKeyboard::ble_addr_type_names_[] = {"PUBLIC", "RANDOM", "RPA_PUBLIC", "RPA_RANDOM"};
 
-const char BTKeyboard::shift_trans_dict_[] =
-    "aAbBcCdDeEfFgGhHiIjJkKlLmMnNoOpPqQrRsStTuUvVwWxXyYzZ1!2@3#4$5%6^7&8*9(0)"
-    "\r\r\033\033\b\b\t\t  -_=+[{]}\\|??;:'\"`~,<.>/?"
-    "\200\200"                                          // CAPS LOC
-    "\201\201\202\202\203\203\204\204\205\205\206\206"  // F1..F6
-    "\207\207\210\210\211\211\212\212\213\213\214\214"  // F7..F12
-    "\215\215\216\216\217\217"                          // PrintScreen ScrollLock Pause
-    "\220\220\221\221\222\222\177\177"                  // Insert Home PageUp Delete
-    "\223\223\224\224\225\225\226\226\227\227\230\230"; // End PageDown Right Left Dow Up
-
 BTKeyboard                        *BTKeyboard::bt_keyboard_             = nullptr;
 BTKeyboard::PairingHandler        *BTKeyboard::pairing_handler_         = nullptr;
 BTKeyboard::GotConnectionHandler  *BTKeyboard::got_connection_handler_  = nullptr;
 BTKeyboard::LostConnectionHandler *BTKeyboard::lost_connection_handler_ = nullptr;
 
-bool BTKeyboard::connected_                                             = false;
-
-/**
- * @brief Overloads the output stream operator for esp_bd_addr_t (Bluetooth address)
- *
- * Formats and outputs a Bluetooth address in the standard XX:XX:XX:XX:XX:XX format,
- * where XX represents two hexadecimal digits. The original stream formatting flags
- * are preserved after the operation.
- *
- * @param os Output stream to write to
- * @param addr Bluetooth address to format and output
- * @return std::ostream& Reference to the output stream
- */
-std::ostream &operator<<(std::ostream &os, const esp_bd_addr_t &addr) {
-  std::ios_base::fmtflags oldFlags = os.flags();
-  char                    oldFill  = os.fill('0');
-  char                    oldWidth = os.width();
-
-  os << std::hex << std::setw(2) << +addr[0];
-  for (uint i = 1; i < 6; ++i) {
-    os << ':' << std::hex << std::setw(2) << +addr[i];
-  }
-
-  os.fill(oldFill);
-  os.flags(oldFlags);
-  os.width(oldWidth);
-
-  os << std::dec;
-
-  return os;
-}
-
-/**
- * @brief Stream operator overload for esp_bt_uuid_t to enable UUID printing
- *
- * Formats and outputs Bluetooth UUIDs in human-readable format:
- * - 16-bit UUID as "UUID16: 0xXXXX"
- * - 32-bit UUID as "UUID32: 0xXXXXXXXX"
- * - 128-bit UUID in standard format "UUID128: XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"
- *
- * Preserves stream formatting state by saving and restoring flags, fill character and width.
- *
- * @param os Output stream to write to
- * @param uuid Bluetooth UUID structure to format
- * @return Reference to the output stream
- */
-std::ostream &operator<<(std::ostream &os, const esp_bt_uuid_t &uuid) {
-  std::ios_base::fmtflags oldFlags = os.flags();
-  char                    oldFill  = os.fill('0');
-  char                    oldWidth = os.width();
-
-  if (uuid.len == ESP_UUID_LEN_16) {
-    os << "UUID16: 0x" << std::hex << std::setw(4) << uuid.uuid.uuid16;
-  } else if (uuid.len == ESP_UUID_LEN_32) {
-    os << "UUID32: 0x" << std::hex << std::setw(8) << uuid.uuid.uuid32;
-  } else if (uuid.len == ESP_UUID_LEN_128) {
-    os << "UUID128: ";
-    for (uint i = 0; i < 16; ++i) {
-      if (i == 4 || i == 6 || i == 8 || i == 10) {
-        os << '-';
-      }
-      os << std::setw(2) << std::hex << +uuid.uuid.uuid128[i];
-    }
-  }
-
-  os.fill(oldFill);
-  os.flags(oldFlags);
-  os.width(oldWidth);
-
-  os << std::dec;
-
-  return os;
-}
-
 /**
  * @brief Converts BLE address type to a human-readable string
  *
@@ -297,13 +216,54 @@ const char *BTKeyboard::ble_key_type_str(esp_ble_key_type_t key_type) {
   return key_str;
 }
 
+/**
+ * @brief Allocate the key event ring, the scan store and, if enabled, the report pool and
+ *        ring, sized from the constructor arguments
+ */
+bool BTKeyboard::allocate_buffers() {
+  uint32_t depth = 1;
+  while ((depth < queue_depth_) && (depth < MAX_QUEUE_DEPTH)) depth <<= 1;
+
+  event_storage_ = std::make_unique<KeyEvent[]>(depth);
+  if ((event_storage_ == nullptr) || !event_ring_.init(event_storage_.get(), depth)) {
+    ESP_LOGE(TAG, "Unable to allocate the key event ring of %" PRIu32 " entries!", depth);
+    return false;
+  }
+  account_heap(depth * sizeof(KeyEvent));
+
+  if (!scan_store_.init(MAX_SCAN_RESULTS, SCAN_NAMES_SIZE)) {
+    ESP_LOGE(TAG, "Unable to allocate the scan results store!");
+    return false;
+  }
+  account_heap(scan_store_.memory_size());
+
+  if (report_queue_depth_ > 0) {
+    depth = 1;
+    while ((depth < report_queue_depth_) && (depth < MAX_QUEUE_DEPTH)) depth <<= 1;
+
+    // Ring entries, the coalescing slot, the report being filled and the ones held by the app
+    if (!report_pool_.init(depth + 2 + HELD_REPORTS)) {
+      ESP_LOGE(TAG, "Unable to allocate the report pool!");
+      return false;
+    }
+
+    report_storage_ = std::make_unique<ReportPool::Index[]>(depth);
+    if ((report_storage_ == nullptr) || !report_ring_.init(report_storage_.get(), depth)) {
+      ESP_LOGE(TAG, "Unable to allocate the input report ring of %" PRIu32 " entries!", depth);
+      return false;
+    }
+    account_heap(report_pool_.memory_size() + depth * sizeof(ReportPool::Index));
+  }
+  return true;
+}
+
 /**
  * @brief Initializes the Bluetooth keyboard functionality.
  *
  * This function sets up both Classic Bluetooth and BLE (Bluetooth Low Energy) for HID host mode.
  * It initializes the Bluetooth controller, Bluedroid stack, and configures security parameters
- * for device pairing. The function also creates necessary queues and semaphores for handling
- * keyboard events.
+ * for device pairing. The function also allocates the key event ring buffer, the scan results
+ * store and the semaphores used to synchronize with the Bluetooth stack callbacks.
  *
  * @param pairing_handler Callback handler for pairing events
  * @param got_connection_handler Callback handler for successful connection events
@@ -311,10 +271,12 @@ const char *BTKeyboard::ble_key_type_str(esp_ble_key_type_t key_type) {
  *
  * @return true if setup was successful, false if any initialization step fails
  *
- * @note Only one instance of BTKeyboard is allowed
+ * @note Only one instance of BTKeyboard is allowed. It handles up to MAX_DEVICES keyboards.
  * @note The function configures both Classic Bluetooth and BLE GAP parameters
- * @note Creates an event queue of size 10 for handling KeyInfo events
- * @note Initializes key availability array and resets last character and battery level
+ * @note The event ring holds queue_depth_ entries, rounded up to a power of two. The report
+ *       pool gets enough buffers to fill the ring plus HELD_REPORTS held by the application.
+ * @note Restores the slots of the keyboards connected before the reboot and clears the key
+ *       repeat state
  *
  * @warning This function should be called only once
  */
@@ -336,27 +298,46 @@ bool BTKeyboard::setup(PairingHandler        *pairing_handler,
   got_connection_handler_  = got_connection_handler;
   lost_connection_handler_ = lost_connection_handler;
 
-  event_queue_             = xQueueCreate(10, sizeof(KeyInfo));
+  for (Device &device : devices_) {
+    device.decode_plan.clear();
+    device.key_engine.clear();
+  }
 
-  if (HID_HOST_MODE == HIDH_IDLE_MODE) {
-    ESP_LOGE(TAG, "Please turn on BT HID host or BLE!");
-    return false;
+  // BTKeyboardT gave its own buffers to the rings, pool and scan store
+  if (!static_storage_ && !allocate_buffers()) return false;
+
+  // Keyboards connected before the reboot get their slot back
+  if (device_cache_.load()) {
+    for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+      memcpy(devices_[i].bda, device_cache_.get(i).bda, ESP_BD_ADDR_LEN);
+    }
   }
 
-  bt_hidh_cb_semaphore_ = xSemaphoreCreateBinary();
-  if (bt_hidh_cb_semaphore_ == nullptr) {
-    ESP_LOGE(TAG, "xSemaphoreCreateMutex failed!");
+  // Created in memory of the object, they cannot fail
+  handler_lock_ = xSemaphoreCreateMutexStatic(&handler_lock_buffer_);
+  connect_lock_ = xSemaphoreCreateMutexStatic(&connect_lock_buffer_);
+  link_lock_    = xSemaphoreCreateMutexStatic(&link_lock_buffer_);
+  record_lock_  = xSemaphoreCreateMutexStatic(&record_lock_buffer_);
+  open_done_    = xSemaphoreCreateBinaryStatic(&open_done_buffer_);
+
+  esp_timer_create_args_t timer_args = {.callback              = repeat_timer_callback,
+                                        .arg                   = this,
+                                        .dispatch_method       = ESP_TIMER_TASK,
+                                        .name                  = "key_repeat",
+                                        .skip_unhandled_events = true};
+  if ((ret = esp_timer_create(&timer_args, &repeat_timer_)) != ESP_OK) {
+    ESP_LOGE(TAG, "esp_timer_create failed: %d", ret);
     return false;
   }
 
-  ble_hidh_cb_semaphore_ = xSemaphoreCreateBinary();
-  if (ble_hidh_cb_semaphore_ == nullptr) {
-    ESP_LOGE(TAG, "xSemaphoreCreateMutex failed!");
-    vSemaphoreDelete(bt_hidh_cb_semaphore_);
-    bt_hidh_cb_semaphore_ = nullptr;
+  if (HID_HOST_MODE == HIDH_IDLE_MODE) {
+    ESP_LOGE(TAG, "Please turn on BT HID host or BLE!");
     return false;
   }
 
+  bt_hidh_cb_semaphore_  = xSemaphoreCreateBinaryStatic(&bt_hidh_cb_semaphore_buffer_);
+  ble_hidh_cb_semaphore_ = xSemaphoreCreateBinaryStatic(&ble_hidh_cb_semaphore_buffer_);
+
   esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
 
   bt_cfg.mode                       = mode;
@@ -415,44 +396,20 @@ bool BTKeyboard::setup(PairingHandler        *pairing_handler,
 
   ESP_ERROR_CHECK(esp_ble_gattc_register_callback(esp_hidh_gattc_event_handler));
   esp_hidh_config_t config = {
-      .callback = hidh_callback, .event_stack_size = 4 * 1024, .callback_arg = nullptr};
+      .callback = hidh_callback, .event_stack_size = 4 * 1024, .callback_arg = this};
   ESP_ERROR_CHECK(esp_hidh_init(&config));
 
-  for (int i = 0; i < MAX_KEY_DATA_SIZE; i++) {
-    key_avail_[i] = true;
-  }
-
-  last_ch_       = 0;
-  battery_level_ = -1;
+  repeat_key_.store(RepeatKey{}, std::memory_order_relaxed);
+  repeat_modifiers_.store(0, std::memory_order_relaxed);
   return true;
 }
 
-/**
- * @brief Searches for a specific Bluetooth device in scan results
- *
- * @param bda Bluetooth device address to search for
- * @param results Reference to scan results container
- * @return BTKeyboard::esp_hid_scan_result_t* Pointer to scan result if found, nullptr otherwise
- *
- * Iterates through scan results looking for a device matching the provided
- * Bluetooth address. Returns the matching scan result or nullptr if not found.
- */
-BTKeyboard::esp_hid_scan_result_t *BTKeyboard::find_scan_result(esp_bd_addr_t bda,
-                                                                ScanResult   &results) {
-  for (auto &res : results) {
-    if (memcmp(bda, res->bda, sizeof(esp_bd_addr_t)) == 0) {
-      return res.get();
-    }
-  }
-  return nullptr;
-}
-
 /**
  * @brief Adds or updates a Bluetooth HID device scan result
  *
- * This method processes scan results from Bluetooth HID device discovery. If a device with
- * the same address already exists in the scan results, it updates the existing entry with
- * any new information. Otherwise, it creates a new scan result entry.
+ * If a device with the same address already exists in the scan results, the existing entry is
+ * updated with any new information. Otherwise, a new entry is created. The name is copied to
+ * the scan store arena: nothing is allocated.
  *
  * @param bda Bluetooth device address
  * @param cod Class of Device information
@@ -460,60 +417,21 @@ BTKeyboard::esp_hid_scan_result_t *BTKeyboard::find_scan_result(esp_bd_addr_t bd
  * @param name Device name
  * @param name_len Length of the device name
  * @param rssi Received Signal Strength Indicator
- *
- * @note The scan results are stored in bt_scan_results_ list, with the most recent
- *       results being added to the front of the list.
- *
- * @note The method maintains a count of total scan results in num_bt_scan_results_
  */
 void BTKeyboard::add_bt_scan_result(esp_bd_addr_t bda, esp_bt_cod_t *cod, esp_bt_uuid_t *uuid,
                                     uint8_t *name, uint8_t name_len, int rssi) {
-  esp_hid_scan_result_t *r = find_scan_result(bda, bt_scan_results_);
-  if (r) {
-    // Some info may come later
-    if (r->name.empty() && name && name_len) {
-      r->name.assign(reinterpret_cast<const char *>(name), name_len);
-    }
-    if (r->bt.uuid.len == 0 && uuid->len) {
-      memcpy(&r->bt.uuid, uuid, sizeof(esp_bt_uuid_t));
-    }
-    if (rssi != 0) {
-      r->rssi = rssi;
-    }
-    return;
-  }
-
-  auto res = std::make_unique<esp_hid_scan_result_t>();
-
-  if (res == nullptr) {
-    ESP_LOGE(TAG, "make_unique of bt_hidh_scan_result_t failed!");
-    return;
-  }
-
-  r->transport = ESP_HID_TRANSPORT_BT;
-
-  memcpy(res->bda, bda, sizeof(esp_bd_addr_t));
-  memcpy(&res->bt.cod, cod, sizeof(esp_bt_cod_t));
-  memcpy(&res->bt.uuid, uuid, sizeof(esp_bt_uuid_t));
-
-  res->usage = esp_hid_usage_from_cod((uint32_t)cod);
-  res->rssi  = rssi;
-  res->name.clear();
-
-  if (name_len && name) {
-    res->name.assign(reinterpret_cast<const char *>(name), name_len);
+  ScanResult *result = scan_store_.add_bt(bda, *cod, *uuid, name, name_len, rssi);
+  if (result == nullptr) {
+    ESP_LOGW(TAG, "Scan results full, " ESP_BD_ADDR_STR " ignored.", ESP_BD_ADDR_HEX(bda));
   }
-
-  bt_scan_results_.push_front(std::move(res));
-
-  num_bt_scan_results_++;
+  check_scan_match(result);
 }
 
 /**
- * @brief Adds a new BLE scan result to the scan results list
+ * @brief Adds a new BLE scan result to the scan results
  *
- * This method stores information about a discovered BLE device in the scan results list.
- * If the device is already in the list, the method returns without adding a duplicate entry.
+ * If the device is already known, the method returns without adding a duplicate entry. The
+ * name is copied to the scan store arena: nothing is allocated.
  *
  * @param bda The Bluetooth device address
  * @param addr_type The BLE address type
@@ -521,56 +439,52 @@ void BTKeyboard::add_bt_scan_result(esp_bd_addr_t bda, esp_bt_cod_t *cod, esp_bt
  * @param name Pointer to the device name buffer
  * @param name_len Length of the device name
  * @param rssi Received Signal Strength Indicator value
- *
- * @note The scan result is stored in a unique_ptr and moved to the front of the list
- * @note The method increments num_ble_scan_results_ counter when a new result is added
  */
 void BTKeyboard::add_ble_scan_result(esp_bd_addr_t bda, esp_ble_addr_type_t addr_type,
                                      uint16_t appearance, uint8_t *name, uint8_t name_len,
                                      int rssi) {
-  if (find_scan_result(bda, ble_scan_results_)) {
-    ESP_LOGW(TAG, "Result already exists!");
-    return;
-  }
-
-  auto r = std::make_unique<esp_hid_scan_result_t>();
-
-  if (r == nullptr) {
-    ESP_LOGE(TAG, "make_unique of ble_hidh_scan_result_t failed!");
+  if (scan_store_.find(bda, ESP_HID_TRANSPORT_BLE) != nullptr) {
+    ESP_LOGD(TAG, "Result already exists!");
     return;
   }
-
-  r->transport = ESP_HID_TRANSPORT_BLE;
-
-  memcpy(r->bda, bda, sizeof(esp_bd_addr_t));
-
-  r->ble.appearance = appearance;
-  r->ble.addr_type  = addr_type;
-  r->usage          = esp_hid_usage_from_appearance(appearance);
-  r->rssi           = rssi;
-  r->name.clear();
-
-  if (name_len && name) {
-    r->name.assign(reinterpret_cast<const char *>(name), name_len);
+  ScanResult *result = scan_store_.add_ble(bda, addr_type, appearance, name, name_len, rssi);
+  if (result == nullptr) {
+    ESP_LOGW(TAG, "Scan results full, " ESP_BD_ADDR_STR " ignored.", ESP_BD_ADDR_HEX(bda));
   }
+  check_scan_match(result);
+}
 
-  ble_scan_results_.push_front(std::move(r));
-  num_ble_scan_results_++;
+/**
+ * @brief Stop the BLE scan and the BT inquiry as soon as a result passes the scan filter
+ *
+ * Called from the Bluetooth stack task, for each result added or updated. The stop requests
+ * complete with ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT and ESP_BT_GAP_DISC_STATE_CHANGED_EVT,
+ * which release esp_hid_scan(). A scan that already ended refuses the request, and has
+ * already released it.
+ */
+void BTKeyboard::check_scan_match(const ScanResult *result) {
+  if ((result == nullptr) || (scan_match_ == nullptr) || scan_stopped_) return;
+  if (!(*scan_match_)(*result)) return;
+
+  ESP_LOGD(TAG, ESP_BD_ADDR_STR " matches, stopping the scan", ESP_BD_ADDR_HEX(result->bda));
+  scan_stopped_ = true;
+  esp_ble_gap_stop_scanning();
+  esp_bt_gap_cancel_discovery();
 }
 
 /**
  * @brief Handles Bluetooth device discovery results.
  *
- * This method processes the callback parameters received during Bluetooth device discovery.
- * It extracts and logs various device properties including:
+ * This method processes the callback parameters received during Bluetooth device discovery,
+ * in the Bluetooth stack task. It extracts the device properties, printing nothing:
  * - Device address
  * - Device name
  * - RSSI (signal strength)
  * - Class of Device (COD) information including major class, minor class, and services
  * - UUID information (16-bit, 32-bit, and 128-bit UUIDs)
  *
- * The method also attempts to find device names in EIR (Extended Inquiry Response) data
- * if not found in the primary device properties.
+ * The EIR (Extended Inquiry Response) data is parsed in a single pass for the UUIDs and the
+ * device name, the latter being used when the remote name property is missing.
  *
  * After processing, if the device is a peripheral or already exists in scan results,
  * it is added/updated in the scan results list.
@@ -579,108 +493,62 @@ void BTKeyboard::add_ble_scan_result(esp_bd_addr_t bda, esp_ble_addr_type_t addr
  *              the discovery result information
  */
 void BTKeyboard::handle_bt_device_result(esp_bt_gap_cb_param_t *param) {
-  std::cout << "BT: " << param->disc_res.bda;
-
-  uint32_t      codv     = 0;
-  esp_bt_cod_t *cod      = (esp_bt_cod_t *)&codv;
-  int8_t        rssi     = 0;
-  uint8_t      *name     = nullptr;
-  uint8_t       name_len = 0;
-  esp_bt_uuid_t uuid;
+  uint32_t       codv         = 0;
+  esp_bt_cod_t  *cod          = (esp_bt_cod_t *)&codv;
+  int8_t         rssi         = 0;
+  uint8_t       *name         = nullptr;
+  uint8_t        name_len     = 0;
+  const uint8_t *eir_name     = nullptr;
+  uint8_t        eir_name_len = 0;
+  esp_bt_uuid_t  uuid;
 
   uuid.len         = ESP_UUID_LEN_16;
   uuid.uuid.uuid16 = 0;
 
   for (int i = 0; i < param->disc_res.num_prop; i++) {
     esp_bt_gap_dev_prop_t *prop = &param->disc_res.prop[i];
-    if (prop->type != ESP_BT_GAP_DEV_PROP_EIR) {
-      std::cout << ", " << gap_bt_prop_type_names_[prop->type] << ": ";
-    }
     if (prop->type == ESP_BT_GAP_DEV_PROP_BDNAME) {
       name     = (uint8_t *)prop->val;
       name_len = strlen((const char *)name);
-      std::cout << name;
     } else if (prop->type == ESP_BT_GAP_DEV_PROP_RSSI) {
       rssi = *((int8_t *)prop->val);
-      std::cout << std::dec << +rssi;
     } else if (prop->type == ESP_BT_GAP_DEV_PROP_COD) {
       memcpy(&codv, prop->val, sizeof(uint32_t));
-      std::cout << "major: " << esp_hid_cod_major_str(cod->major) << ", minor: " << cod->minor
-                << ", service: 0x" << std::hex << std::setw(3) << std::setfill('0') << cod->service;
     } else if (prop->type == ESP_BT_GAP_DEV_PROP_EIR) {
-      uint8_t  len  = 0;
-      uint8_t *data = 0;
-
-      data =
-          esp_bt_gap_resolve_eir_data((uint8_t *)prop->val, ESP_BT_EIR_TYPE_CMPL_16BITS_UUID, &len);
+      AdvFields eir;
+      AdvParser::parse((const uint8_t *)prop->val, prop->len, eir);
 
-      if (data == nullptr) {
-        data = esp_bt_gap_resolve_eir_data((uint8_t *)prop->val, ESP_BT_EIR_TYPE_INCMPL_16BITS_UUID,
-                                           &len);
-      }
-
-      if (data && len == ESP_UUID_LEN_16) {
+      if (eir.has(AdvFields::UUID16)) {
         uuid.len         = ESP_UUID_LEN_16;
-        uuid.uuid.uuid16 = data[0] + (data[1] << 8);
-        std::cout << ", " << uuid;
-        continue;
-      }
-
-      data =
-          esp_bt_gap_resolve_eir_data((uint8_t *)prop->val, ESP_BT_EIR_TYPE_CMPL_32BITS_UUID, &len);
-
-      if (data == nullptr) {
-        data = esp_bt_gap_resolve_eir_data((uint8_t *)prop->val, ESP_BT_EIR_TYPE_INCMPL_32BITS_UUID,
-                                           &len);
-      }
-
-      if (data && len == ESP_UUID_LEN_32) {
-        uuid.len = len;
-        memcpy(&uuid.uuid.uuid32, data, sizeof(uint32_t));
-        std::cout << ", " << uuid;
-        continue;
-      }
-
-      data = esp_bt_gap_resolve_eir_data((uint8_t *)prop->val, ESP_BT_EIR_TYPE_CMPL_128BITS_UUID,
-                                         &len);
-
-      if (data == nullptr) {
-        data = esp_bt_gap_resolve_eir_data((uint8_t *)prop->val,
-                                           ESP_BT_EIR_TYPE_INCMPL_128BITS_UUID, &len);
-      }
-
-      if (data && len == ESP_UUID_LEN_128) {
-        uuid.len = len;
-        memcpy(uuid.uuid.uuid128, (uint8_t *)data, len);
-        std::cout << ", " << uuid;
-        continue;
+        uuid.uuid.uuid16 = eir.uuid16[0];
+      } else if (eir.has(AdvFields::UUID32)) {
+        uuid.len         = ESP_UUID_LEN_32;
+        uuid.uuid.uuid32 = eir.uuid32;
+      } else if (eir.has(AdvFields::UUID128)) {
+        uuid.len = ESP_UUID_LEN_128;
+        memcpy(uuid.uuid.uuid128, eir.uuid128, ESP_UUID_LEN_128);
       }
 
-      // try to find a name
-      if (name == nullptr) {
-        data = esp_bt_gap_resolve_eir_data((uint8_t *)prop->val, ESP_BT_EIR_TYPE_CMPL_LOCAL_NAME,
-                                           &len);
-
-        if (data == nullptr) {
-          data = esp_bt_gap_resolve_eir_data((uint8_t *)prop->val, ESP_BT_EIR_TYPE_SHORT_LOCAL_NAME,
-                                             &len);
-        }
-
-        if (data && len) {
-          name     = data;
-          name_len = len;
-          std::cout << ", NAME: ";
-          for (int x = 0; x < len; x++) {
-            std::cout << (char)data[x];
-          }
-        }
+      if (eir.has(AdvFields::NAME)) {
+        eir_name     = eir.name;
+        eir_name_len = eir.name_len;
       }
     }
   }
-  std::cout << std::dec << std::endl;
+
+  // The remote name property is preferred to the EIR one
+  if (name == nullptr) {
+    name     = (uint8_t *)eir_name;
+    name_len = eir_name_len;
+  }
+
+  ESP_LOGV(TAG, "BT: " ESP_BD_ADDR_STR ", COD 0x%06" PRIx32 ", RSSI %d",
+           ESP_BD_ADDR_HEX(param->disc_res.bda), codv, rssi);
+  count(metrics_.advertisements);
+  metrics_.last_rssi.store(rssi, std::memory_order_relaxed);
 
   if ((cod->major == ESP_BT_COD_MAJOR_DEV_PERIPHERAL) ||
-      (find_scan_result(param->disc_res.bda, bt_scan_results_) != nullptr)) {
+      (scan_store_.find(param->disc_res.bda, ESP_HID_TRANSPORT_BT) != nullptr)) {
     add_bt_scan_result(param->disc_res.bda, cod, &uuid, name, name_len, rssi);
   }
 }
@@ -703,7 +571,8 @@ void BTKeyboard::handle_bt_device_result(esp_bt_gap_cb_param_t *param) {
  * - ESP_BT_GAP_KEY_NOTIF_EVT: Passkey notification
  * - ESP_BT_GAP_CFM_REQ_EVT: Confirmation request
  * - ESP_BT_GAP_KEY_REQ_EVT: Passkey request
- * - ESP_BT_GAP_MODE_CHG_EVT: Mode change
+ * - ESP_BT_GAP_MODE_CHG_EVT: Mode change, tracking the sniff mode of the keyboards
+ * - ESP_BT_GAP_QOS_CMPL_EVT: Poll interval set, following the latency policy
  * - ESP_BT_GAP_PIN_REQ_EVT: PIN code request
  */
 void BTKeyboard::bt_gap_event_handler(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *param) {
@@ -737,8 +606,26 @@ void BTKeyboard::bt_gap_event_handler(esp_bt_gap_cb_event_t event, esp_bt_gap_cb
       ESP_LOGD(TAG, "BT GAP KEY_REQ_EVT Please enter passkey!");
       break;
     case ESP_BT_GAP_MODE_CHG_EVT:
-      ESP_LOGD(TAG, "BT GAP MODE_CHG_EVT mode:%d", param->mode_chg.mode);
-      break;
+      {
+        ESP_LOGD(TAG, "BT GAP MODE_CHG_EVT mode:%d", param->mode_chg.mode);
+        uint8_t index = bt_keyboard_->find_connected(param->mode_chg.bda);
+        if (index != DeviceTable<MAX_DEVICES>::NO_DEVICE) {
+          bt_keyboard_->devices_[index].sniff = (param->mode_chg.mode == ESP_BT_PM_MD_SNIFF);
+        }
+        break;
+      }
+    case ESP_BT_GAP_QOS_CMPL_EVT:
+      {
+        ESP_LOGV(TAG, "BT GAP QOS_CMPL_EVT stat:%d t_poll:%" PRIu32, param->qos_cmpl.stat,
+                 param->qos_cmpl.t_poll);
+        uint8_t index   = bt_keyboard_->find_connected(param->qos_cmpl.bda);
+        bool    success = (param->qos_cmpl.stat == ESP_BT_STATUS_SUCCESS);
+        if (index != DeviceTable<MAX_DEVICES>::NO_DEVICE) {
+          if (success) bt_keyboard_->devices_[index].interval_us = param->qos_cmpl.t_poll * 625;
+          bt_keyboard_->link_timing_updated(index, success);
+        }
+        break;
+      }
     case ESP_BT_GAP_PIN_REQ_EVT:
       {
         ESP_LOGD(TAG, "BT GAP PIN_REQ_EVT min_16_digit:%d", param->pin_req.min_16_digit);
@@ -763,60 +650,31 @@ void BTKeyboard::bt_gap_event_handler(esp_bt_gap_cb_event_t event, esp_bt_gap_cb
   }
 }
 
+/**
+ * @brief Handles a BLE scan result, in the Bluetooth stack task
+ *
+ * The advertising data and the scan response are parsed in a single pass each, the fields
+ * of the second merged into the first: the advertising data may end early, with a structure
+ * of length 0. Advertisers listing the HID service among their 16-bit service UUIDs are added
+ * to the scan results.
+ *
+ * @param param Pointer to the ESP BLE GAP callback parameters containing the scan result
+ */
 void BTKeyboard::handle_ble_device_result(esp_ble_gap_cb_param_t *param) {
-  uint16_t uuid       = 0;
-  uint16_t appearance = 0;
-  char     name[64]   = {0};
-
-  auto &scan_rst      = param->scan_rst;
-
-  uint8_t  uuid_len   = 0;
-  uint8_t *uuid_d     = esp_ble_resolve_adv_data_by_type(scan_rst.ble_adv,
-                                                         scan_rst.adv_data_len + scan_rst.scan_rsp_len,
-                                                         ESP_BLE_AD_TYPE_16SRV_CMPL, &uuid_len);
-
-  if (uuid_d != nullptr && uuid_len) {
-    uuid = uuid_d[0] + (uuid_d[1] << 8);
-  }
-
-  uint8_t  appearance_len = 0;
-  uint8_t *appearance_d   = esp_ble_resolve_adv_data_by_type(
-      scan_rst.ble_adv, scan_rst.adv_data_len + scan_rst.scan_rsp_len, ESP_BLE_AD_TYPE_APPEARANCE,
-      &appearance_len);
-
-  if (appearance_d != nullptr && appearance_len) {
-    appearance = appearance_d[0] + (appearance_d[1] << 8);
-  }
+  auto     &scan_rst = param->scan_rst;
+  AdvFields adv;
 
-  uint8_t  adv_name_len = 0;
-  uint8_t *adv_name     = esp_ble_resolve_adv_data_by_type(
-      scan_rst.ble_adv, scan_rst.adv_data_len + scan_rst.scan_rsp_len, ESP_BLE_AD_TYPE_NAME_CMPL,
-      &adv_name_len);
+  AdvParser::parse(scan_rst.ble_adv, scan_rst.adv_data_len, adv);
+  AdvParser::merge(&scan_rst.ble_adv[scan_rst.adv_data_len], scan_rst.scan_rsp_len, adv);
 
-  if (adv_name == nullptr) {
-    adv_name = esp_ble_resolve_adv_data_by_type(scan_rst.ble_adv,
-                                                scan_rst.adv_data_len + scan_rst.scan_rsp_len,
-                                                ESP_BLE_AD_TYPE_NAME_SHORT, &adv_name_len);
-  }
-
-  if (adv_name != nullptr && adv_name_len) {
-    memcpy(name, adv_name, adv_name_len);
-    name[adv_name_len] = 0;
-  }
-
-  std::cout << "BLE: " << scan_rst.bda << ", " << "RSSI: " << std::dec << scan_rst.rssi << ", "
-            << "UUID: 0x" << std::hex << std::setw(4) << std::setfill('0') << uuid << ", "
-            << "APPEARANCE: 0x" << std::hex << std::setw(4) << std::setfill('0') << appearance
-            << ", " << "ADDR_TYPE: " << ble_addr_type_str(scan_rst.ble_addr_type);
+  ESP_LOGV(TAG, "BLE: " ESP_BD_ADDR_STR ", %u UUID16, APPEARANCE 0x%04x, RSSI %d",
+           ESP_BD_ADDR_HEX(scan_rst.bda), adv.uuid16_count, adv.appearance, scan_rst.rssi);
+  count(metrics_.advertisements);
+  metrics_.last_rssi.store(scan_rst.rssi, std::memory_order_relaxed);
 
-  if (adv_name_len) {
-    std::cout << ", NAME: '" << name << "'";
-  }
-  std::cout << std::dec << std::endl;
-
-  if (uuid == ESP_GATT_UUID_HID_SVC) {
-    add_ble_scan_result(scan_rst.bda, scan_rst.ble_addr_type, appearance, adv_name, adv_name_len,
-                        scan_rst.rssi);
+  if (adv.has_uuid16(ESP_GATT_UUID_HID_SVC)) {
+    add_ble_scan_result(scan_rst.bda, scan_rst.ble_addr_type, adv.appearance,
+                        (uint8_t *)adv.name, adv.name_len, scan_rst.rssi);
   }
 }
 
@@ -827,6 +685,7 @@ void BTKeyboard::handle_ble_device_result(esp_ble_gap_cb_param_t *param) {
  * - Scanning related events (param set, results, stop)
  * - Advertisement events (data set, start)
  * - Authentication events (completion, key exchange, passkey handling)
+ * - Connection parameter updates, checked against the latency policy of the keyboard
  *
  * For authentication, it handles different IO capability scenarios:
  * - ESP_IO_CAP_OUT: Displays passkey to user
@@ -868,6 +727,7 @@ void BTKeyboard::ble_gap_event_handler(esp_gap_ble_cb_event_t  event,
     case ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT:
       {
         ESP_LOGD(TAG, "BLE GAP EVENT SCAN CANCELED");
+        SEND_BLE_CB();
         break;
       }
 
@@ -881,6 +741,27 @@ void BTKeyboard::ble_gap_event_handler(esp_gap_ble_cb_event_t  event,
       ESP_LOGD(TAG, "BLE GAP ADV_START_COMPLETE");
       break;
 
+      // CONNECTION PARAMETERS
+
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+      {
+        auto &update = param->update_conn_params;
+        ESP_LOGV(TAG, "BLE GAP UPDATE_CONN_PARAMS status:%d interval:%u latency:%u timeout:%u",
+                 update.status, update.conn_int, update.latency, update.timeout);
+        uint8_t index   = bt_keyboard_->find_connected(update.bda);
+        bool    success = (update.status == ESP_BT_STATUS_SUCCESS);
+        if (index != DeviceTable<MAX_DEVICES>::NO_DEVICE) {
+          Device &device = bt_keyboard_->devices_[index];
+          if (success) {
+            device.interval_us = update.conn_int * 1250;
+            device.latency     = update.latency;
+            device.timeout_ms  = update.timeout * 10;
+          }
+          bt_keyboard_->link_timing_updated(index, success);
+        }
+        break;
+      }
+
       // AUTHENTICATION
 
     case ESP_GAP_BLE_AUTH_CMPL_EVT:
@@ -944,8 +825,13 @@ void BTKeyboard::ble_gap_event_handler(esp_gap_ble_cb_event_t  event,
  */
 esp_err_t BTKeyboard::start_bt_scan(uint32_t seconds) {
   esp_err_t ret = ESP_OK;
-  if ((ret = esp_bt_gap_start_discovery(ESP_BT_INQ_MODE_GENERAL_INQUIRY, (int)(seconds / 1.28),
-                                        0)) != ESP_OK) {
+
+  // Inquiry length in 1.28 s units, 1 to 0x30. Rounded up: 1 second must not become 0.
+  uint32_t inq_len = (seconds * 100 + 127) / 128;
+  if (inq_len < 1) inq_len = 1;
+  if (inq_len > 0x30) inq_len = 0x30;
+
+  if ((ret = esp_bt_gap_start_discovery(ESP_BT_INQ_MODE_GENERAL_INQUIRY, inq_len, 0)) != ESP_OK) {
     ESP_LOGE(TAG, "esp_bt_gap_start_discovery failed: %d", ret);
     return ret;
   }
@@ -990,56 +876,38 @@ esp_err_t BTKeyboard::start_ble_scan(uint32_t seconds) {
 /**
  * @brief Performs a scan for both Bluetooth Classic and BLE HID devices
  *
- * This method initiates concurrent scans for both Bluetooth Classic and BLE HID devices.
- * It first checks if there are any pending scan results that need to be cleared.
- * Then it initiates both BLE and BT Classic scans and waits for their completion.
- * Finally, it combines the results from both scans into a single result list.
+ * The scan store is emptied, then a BLE scan and a BT Classic inquiry are run at the same time,
+ * so the whole scan lasts `seconds` (rounded up to 1.28 s units for the inquiry). The devices
+ * found by both are recorded in the scan store, in arrival order. Both are stopped as soon as
+ * a device passes `match`.
  *
  * @param seconds Duration of the scan in seconds
- * @param num_results Pointer to store the total number of devices found
- * @param results Reference to a ScanResult container to store the found devices
+ * @param match Filter ending the scan early, nullptr to scan for the whole duration
+ * @param with_bt false to run the BLE scan only
  *
  * @return ESP_OK if scan completed successfully
- *         ESP_FAIL if there are pending results or if either scan fails to start
- *
- * @note The method will clear any previous scan results before starting a new scan
- * @note Both BT Classic and BLE scan results are combined in the results container
+ *         ESP_FAIL if either scan fails to start
  */
-esp_err_t BTKeyboard::esp_hid_scan(uint32_t seconds, size_t *num_results, ScanResult &results) {
-  if (num_bt_scan_results_ || !bt_scan_results_.empty() || num_ble_scan_results_ ||
-      !ble_scan_results_.empty()) {
-    ESP_LOGE(TAG, "There are old scan results. Free them first!");
-    return ESP_FAIL;
-  }
-
-  if (start_ble_scan(seconds) == ESP_OK) {
-    WAIT_BLE_CB();
-  } else {
-    return ESP_FAIL;
-  }
-
-  if (start_bt_scan(seconds) == ESP_OK) {
-    WAIT_BT_CB();
-  } else {
-    return ESP_FAIL;
-  }
-
-  *num_results = num_bt_scan_results_ + num_ble_scan_results_;
-
-  for (auto &r : bt_scan_results_) {
-    results.push_front(std::move(r));
-  }
-  for (auto &r : ble_scan_results_) {
-    results.push_front(std::move(r));
-  }
-
-  num_bt_scan_results_ = 0;
-  bt_scan_results_.clear();
-
-  num_ble_scan_results_ = 0;
-  ble_scan_results_.clear();
-
-  return ESP_OK;
+esp_err_t BTKeyboard::esp_hid_scan(uint32_t seconds, ScanMatch *match, bool with_bt) {
+  scan_store_.clear();
+  scan_match_   = match;
+  scan_stopped_ = false;
+
+  // A stop request racing with the end of a previous scan may have left a completion behind
+  xSemaphoreTake(ble_hidh_cb_semaphore_, 0);
+  xSemaphoreTake(bt_hidh_cb_semaphore_, 0);
+
+  int64_t start_us    = esp_timer_get_time();
+  bool    ble_started = start_ble_scan(seconds) == ESP_OK;
+  bool    bt_started  = with_bt && (start_bt_scan(seconds) == ESP_OK);
+
+  if (ble_started) WAIT_BLE_CB();
+  if (bt_started) WAIT_BT_CB();
+
+  scan_match_ = nullptr;
+  count(metrics_.scans);
+  metrics_.last_scan_ms.store((esp_timer_get_time() - start_us) / 1000, std::memory_order_relaxed);
+  return (ble_started && (bt_started || !with_bt)) ? ESP_OK : ESP_FAIL;
 }
 
 /**
@@ -1080,83 +948,69 @@ auto BTKeyboard::retrieve_bonded_devices()
 }
 
 /**
- * @brief Scan for HID devices and attempt to connect to the first keyboard found
+ * @brief Scan for HID devices and attempt to connect to the keyboards found
  *
- * This method scans for both Bluetooth Classic and BLE HID devices. For each device found,
- * it displays detailed information including:
- * - Transport type (BLE or BT Classic)
- * - Device address
- * - RSSI signal strength
- * - HID usage type
- * - For BLE: appearance value and address type
- * - For BT Classic: Class of Device (COD) information
- * - Device name (if available)
+ * This method scans for both Bluetooth Classic and BLE HID devices. Nothing is printed: the
+ * devices found are kept until the next scan, for visit_scan_results() and
+ * show_scan_results().
  *
- * The scan will automatically connect to the first device that matches either:
+ * The BLE scan and the BT Classic inquiry run at the same time. Without a `match` filter, they
+ * last for the whole duration and the scan then connects to all the keyboards found
+ * (is_keyboard()), as long as device slots are free:
  * - For BLE: Has an appearance value matching ESP_BLE_APPEARANCE_HID_KEYBOARD
  * - For BT Classic: Has major class PERIPHERAL (5) and minor class includes keyboard
  *
+ * With a `match` filter, both are stopped as soon as a device passes it, and the devices that
+ * pass it are connected instead. `devices_scan(5, BTKeyboard::is_keyboard)` connects the first
+ * keyboard found without waiting for the end of the scan.
+ *
  * @param seconds_wait_time Duration of the scan in seconds
+ * @param match Filter of the devices to connect, called from the Bluetooth stack task for each
+ *              device found or updated. nullptr for is_keyboard() with no early stop.
  *
- * @note The method will return immediately if the keyboard is already connected
+ * @note The method will return immediately if MAX_DEVICES keyboards are already connected
  */
-void BTKeyboard::devices_scan(int seconds_wait_time) {
+void BTKeyboard::devices_scan(int seconds_wait_time, ScanMatch *match) {
 
-  if (connected_) return;
+  xSemaphoreTake(connect_lock_, portMAX_DELAY);
+
+  uint8_t free_slots = MAX_DEVICES - get_connected_count();
+  if (free_slots == 0) {
+    xSemaphoreGive(connect_lock_);
+    return;
+  }
 
-  size_t     results_len = 0;
-  ScanResult results;
   ESP_LOGD(TAG, "SCAN...");
 
   // start scan for HID devices
 
-  esp_hid_scan(seconds_wait_time, &results_len, results);
-  ESP_LOGD(TAG, "SCAN: %u results", results_len);
-
-  if (results_len) {
-    esp_hid_scan_result_t *cr = nullptr;
-    for (auto &r : results) {
-      uint16_t appearance = r->ble.appearance;
-      std::cout << "  " << (r->transport == ESP_HID_TRANSPORT_BLE ? "BLE: " : "BT: ") << r->bda
-                << std::dec << ", RSSI: " << +r->rssi << ", USAGE: " << esp_hid_usage_str(r->usage);
-      if (r->transport == ESP_HID_TRANSPORT_BLE) {
-        std::cout << ", APPEARANCE: 0x" << std::hex << std::setw(4) << std::setfill('0')
-                  << appearance << ", ADDR_TYPE: '" << ble_addr_type_str(r->ble.addr_type) << "'";
-        if (appearance == ESP_BLE_APPEARANCE_HID_KEYBOARD) {
-          cr = r.get();
-        }
-      }
-      if (r->transport == ESP_HID_TRANSPORT_BT) {
-        std::cout << ", COD: " << esp_hid_cod_major_str(r->bt.cod.major) << "[";
-        esp_hid_cod_minor_print(r->bt.cod.minor, stdout);
-        std::cout << "] srv 0x" << std::hex << std::setw(3) << std::setfill('0')
-                  << r->bt.cod.service << ", " << r->bt.uuid;
-
-        if ((r->bt.cod.major == 5 /* PERIPHERAL */) &&
-            (r->bt.cod.minor & ESP_HID_COD_MIN_KEYBOARD)) {
-          cr = r.get();
-        }
-      }
-
-      std::cout << std::dec;
-
-      if (!r->name.empty()) {
-        std::cout << ", NAME: " << r->name << std::endl;
-      } else {
-        std::cout << std::endl;
-      }
+  esp_hid_scan(seconds_wait_time, match);
+  ESP_LOGD(TAG, "SCAN: %u results", scan_store_.size());
 
-      if (cr) break;
+  if (scan_store_.size() > 0) {
+    ScanResult *selected[MAX_DEVICES];
+    uint8_t     selected_count = 0;
+    for (ScanResult &r : scan_store_) {
+      bool chosen = (match != nullptr) ? (*match)(r) : is_keyboard(r);
+      if (chosen && (selected_count < free_slots)) selected[selected_count++] = &r;
     }
 
-    if (cr) {
-      // open the selected entry
-      esp_hidh_dev_open(cr->bda, cr->transport, cr->ble.addr_type);
+    // open the selected entries. Each call blocks until the connection is established.
+    for (uint8_t i = 0; i < selected_count; i++) {
+      esp_hidh_dev_open(selected[i]->bda, selected[i]->transport, selected[i]->ble.addr_type);
     }
+  }
+
+  xSemaphoreGive(connect_lock_);
+}
 
-    // free the results
-    results.clear();
+bool BTKeyboard::is_keyboard(const ScanResult &result) {
+  if (result.transport == ESP_HID_TRANSPORT_BLE) {
+    return result.ble.appearance == ESP_BLE_APPEARANCE_HID_KEYBOARD;
   }
+  return (result.transport == ESP_HID_TRANSPORT_BT) &&
+         (result.bt.cod.major == 5 /* PERIPHERAL */) &&
+         (result.bt.cod.minor & ESP_HID_COD_MIN_KEYBOARD);
 }
 
 /**
@@ -1170,14 +1024,16 @@ void BTKeyboard::devices_scan(int seconds_wait_time) {
  * - ESP_HIDH_CLOSE_EVENT: Device connection closed
  *
  * For each event, it logs relevant information and updates the BTKeyboard state accordingly.
+ * Events of devices that did not get a device slot are ignored.
  *
- * @param handler_args Pointer to handler-specific arguments
+ * @param handler_args The BTKeyboard instance
  * @param base Event base (unused)
  * @param id Event ID (esp_hidh_event_t)
  * @param event_data Pointer to event-specific data
  */
 void BTKeyboard::hidh_callback(void *handler_args, esp_event_base_t base, int32_t id,
                                void *event_data) {
+  BTKeyboard            *kb    = (BTKeyboard *)handler_args;
   esp_hidh_event_t       event = (esp_hidh_event_t)id;
   esp_hidh_event_data_t *param = (esp_hidh_event_data_t *)event_data;
 
@@ -1189,34 +1045,62 @@ void BTKeyboard::hidh_callback(void *handler_args, esp_event_base_t base, int32_
           if (bda) {
             ESP_LOGD(TAG, ESP_BD_ADDR_STR " OPEN: %s", ESP_BD_ADDR_HEX(bda),
                      esp_hidh_dev_name_get(param->open.dev));
-            esp_hidh_dev_dump(param->open.dev, stdout);
-            bt_keyboard_->set_connected(true);
+            Device *device = kb->open_device(param->open.dev);
+            if (device != nullptr) {
+              kb->set_connected(true);
+              kb->request_link_timing(kb->index_of(*device));
+            } else {
+              ESP_LOGW(TAG, "All %u device slots in use. Closing the connection.", MAX_DEVICES);
+              esp_hidh_dev_close(param->open.dev);
+            }
           }
         } else {
           ESP_LOGE(TAG, " OPEN failed!");
-          bt_keyboard_->set_connected(false);
+          kb->set_connected(false);
+        }
+        // A failed open that returned no device has nothing to be waited for
+        if (param->open.dev != nullptr) {
+          kb->opens_done_.fetch_add(1);
+          xSemaphoreGive(kb->open_done_);
         }
         break;
       }
     case ESP_HIDH_BATTERY_EVENT:
       {
-        const uint8_t *bda = esp_hidh_dev_bda_get(param->battery.dev);
-        if (bda) {
+        const uint8_t *bda   = esp_hidh_dev_bda_get(param->battery.dev);
+        uint8_t        index = kb->device_table_.find(param->battery.dev);
+        if (bda && (index != DeviceTable<MAX_DEVICES>::NO_DEVICE)) {
           ESP_LOGD(TAG, ESP_BD_ADDR_STR " BATTERY: %d%%", ESP_BD_ADDR_HEX(bda),
                    param->battery.level);
-          bt_keyboard_->set_battery_level(param->battery.level);
+          kb->devices_[index].battery_level.store(param->battery.level,
+                                                  std::memory_order_relaxed);
         }
         break;
       }
     case ESP_HIDH_INPUT_EVENT:
       {
-        const uint8_t *bda = esp_hidh_dev_bda_get(param->input.dev);
-        if (bda) {
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+        kb->input_received_us_ = latency_timestamp();
+#endif
+        const uint8_t *bda   = esp_hidh_dev_bda_get(param->input.dev);
+        uint8_t        index = kb->device_table_.find(param->input.dev);
+        if (bda && (index != DeviceTable<MAX_DEVICES>::NO_DEVICE)) {
           ESP_LOGD(TAG, ESP_BD_ADDR_STR " INPUT: %8s, MAP: %2u, ID: %3u, Len: %d, Data:",
                    ESP_BD_ADDR_HEX(bda), esp_hid_usage_str(param->input.usage),
                    param->input.map_index, param->input.report_id, param->input.length);
           ESP_LOG_BUFFER_HEX_LEVEL(TAG, param->input.data, param->input.length, ESP_LOG_DEBUG);
-          bt_keyboard_->push_key(param->input.data, param->input.length);
+          count(kb->metrics_.devices[index].reports);
+          count(kb->metrics_.devices[index].bytes, param->input.length);
+          if (kb->recording_.load(std::memory_order_relaxed)) {
+            kb->record_report(index, param->input.dev, param->input.data, param->input.length,
+                              param->input.map_index, param->input.report_id);
+          }
+          kb->input_busy_.store(true);
+          if (!kb->replaying_.load()) {
+            kb->push_key(kb->devices_[index], index, param->input.data, param->input.length,
+                         param->input.map_index, param->input.report_id);
+          }
+          kb->input_busy_.store(false, std::memory_order_release);
         }
         break;
       }
@@ -1233,11 +1117,13 @@ void BTKeyboard::hidh_callback(void *handler_args, esp_event_base_t base, int32_
       }
     case ESP_HIDH_CLOSE_EVENT:
       {
-        const uint8_t *bda = esp_hidh_dev_bda_get(param->close.dev);
-        if (bda) {
+        const uint8_t *bda   = esp_hidh_dev_bda_get(param->close.dev);
+        uint8_t        index = kb->device_table_.find(param->close.dev);
+        if (bda && (index != DeviceTable<MAX_DEVICES>::NO_DEVICE)) {
           ESP_LOGD(TAG, ESP_BD_ADDR_STR " CLOSE: %s", ESP_BD_ADDR_HEX(bda),
                    esp_hidh_dev_name_get(param->close.dev));
-          bt_keyboard_->set_connected(false);
+          kb->close_device(param->close.dev);
+          kb->set_connected(false);
         }
         break;
       }
@@ -1248,106 +1134,1213 @@ void BTKeyboard::hidh_callback(void *handler_args, esp_event_base_t base, int32_
 }
 
 /**
- * @brief Pushes keyboard event data to the event queue
- *
- * This method takes raw keyboard event data and enqueues it for processing.
- * If the input size exceeds MAX_KEY_DATA_SIZE, it will be truncated and a
- * warning message will be logged.
+ * @brief Give a device slot to a newly connected device
  *
- * @param keys Pointer to array containing keyboard event data
- * @param size Size of the keyboard event data in bytes
+ * A keyboard that was connected before gets its previous slot back when it is free, so its
+ * events keep the same device index across reconnections. Otherwise, the first free slot is
+ * taken, preferring the ones never used.
  *
- * @note The data is copied into a KeyInfo struct before being enqueued
- * @note No blocking occurs if queue is full (timeout = 0)
+ * @return The slot, or nullptr if all MAX_DEVICES slots are in use
  */
-void BTKeyboard::push_key(uint8_t *keys, uint8_t size) {
-  KeyInfo inf;
-  if (size > MAX_KEY_DATA_SIZE) {
-    ESP_LOGW(TAG, "Keyboard event data size bigger than expected: %d\n.", size);
-    size = MAX_KEY_DATA_SIZE;
+BTKeyboard::Device *BTKeyboard::open_device(esp_hidh_dev_t *dev) {
+  uint8_t        index = device_table_.find(dev);
+  const uint8_t *bda   = esp_hidh_dev_bda_get(dev);
+
+  if (index == DeviceTable<MAX_DEVICES>::NO_DEVICE) {
+    static const esp_bd_addr_t no_bda = {};
+    const uint8_t              none   = DeviceTable<MAX_DEVICES>::NO_DEVICE;
+
+    uint8_t same = none, unused = none, other = none;
+    for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+      if (devices_[i].dev != nullptr) continue;
+      if (memcmp(devices_[i].bda, bda, ESP_BD_ADDR_LEN) == 0) {
+        if (same == none) same = i;
+      } else if (memcmp(devices_[i].bda, no_bda, ESP_BD_ADDR_LEN) == 0) {
+        if (unused == none) unused = i;
+      } else if (other == none) {
+        other = i;
+      }
+    }
+    index = (same != none) ? same : ((unused != none) ? unused : other);
+    if (index == none) return nullptr;
+    device_table_.insert(dev, index);
   }
 
-  // enqueue
-  inf.size = size;
-  memcpy(&inf.keys, keys, size);
+  Device &device    = devices_[index];
+  bool     recovered = (device.lost_us != 0) && (memcmp(device.bda, bda, ESP_BD_ADDR_LEN) == 0);
+  device.dev        = dev;
+  memcpy(device.bda, bda, ESP_BD_ADDR_LEN);
+  device.transport = esp_hidh_dev_transport_get(dev);
+  device.key_engine.clear();
+  compile_decode_plan(device);
+  device.battery_level = -1;
+  device.interval_us   = 0;
+  device.latency       = 0;
+  device.timeout_ms    = 0;
+  device.link_requests = 0;
+  device.sniff         = false;
+
+  // The timing the keyboard connected with, changes come as GAP events. Bluedroid gives no way
+  // to read the poll interval of a BT Classic link: it stays unknown until a QoS request.
+  esp_gap_conn_params_t params;
+  if ((device.transport == ESP_HID_TRANSPORT_BLE) &&
+      (esp_ble_get_current_conn_params(device.bda, &params) == ESP_OK)) {
+    device.interval_us = params.interval * 1250;
+    device.latency     = params.latency;
+    device.timeout_ms  = params.timeout * 10;
+  }
+  device.connected.store(true, std::memory_order_release);
+
+  if (recovered) {
+    uint32_t recovery_ms = (uint32_t)((esp_timer_get_time() - device.lost_us) / 1000);
+    reconnect_stats_.last_recovery_ms = recovery_ms;
+    reconnect_stats_.total_recovery_ms += recovery_ms;
+    if (recovery_ms > reconnect_stats_.max_recovery_ms) {
+      reconnect_stats_.max_recovery_ms = recovery_ms;
+    }
+    reconnect_stats_.recoveries++;
+    count(metrics_.reconnects);
+  }
+  device.lost_us = 0;
+  count(metrics_.connections);
+
+  // While recording, the report maps of the keyboard are captured with its first report
+  if (recording_.load()) {
+    xSemaphoreTake(record_lock_, portMAX_DELAY);
+    size_t held = recorder_.memory_size();
+    recorder_.forget_maps(index);
+    account_heap((ptrdiff_t)recorder_.memory_size() - (ptrdiff_t)held);
+    xSemaphoreGive(record_lock_);
+  }
 
-  xQueueSendToBack(event_queue_, &inf, 0);
+  ESP_LOGI(TAG, ESP_BD_ADDR_STR " is device %u", ESP_BD_ADDR_HEX(bda), index);
+  cache_device(index, dev);
+  return &device;
 }
 
 /**
- * @brief Waits for and processes keyboard input to return an ASCII character.
- *
- * This method handles keyboard input processing including:
- * - Key repeat functionality
- * - Modifier keys (Shift, Ctrl)
- * - Caps Lock toggle
- * - Character translation using shift translation dictionary
- *
- * @param forever If true, waits indefinitely for input. If false, returns immediately if no input
- *                is available and last character was 0, otherwise waits for repeat period.
- *
- * @return ASCII character based on the keyboard input and current modifier state.
- *         Returns:
- *         - Control characters (1-26) when Ctrl is pressed with letters
- *         - Shifted or unshifted characters based on Shift and Caps Lock states
- *         - Last character on key repeat
- *         - 0 if no valid character could be generated
+ * @brief Remember the keyboard connected in a slot, for reconnect_cached_devices()
  *
- * @note The method manages internal repeat timing and caps lock state.
+ * The BLE address type comes from the last scan, or from the previous record of the keyboard
+ * when it was reconnected without a scan. NVS is only written when the record changes.
  */
-char BTKeyboard::wait_for_ascii_char(bool forever) {
-  KeyInfo inf;
-
-  while (true) {
-    if (!wait_for_low_event(inf,
-                            (last_ch_ == 0) ? (forever ? portMAX_DELAY : 0) : repeat_period_)) {
-      repeat_period_ = pdMS_TO_TICKS(120);
-      return last_ch_;
+void BTKeyboard::cache_device(uint8_t index, esp_hidh_dev_t *dev) {
+  CachedDevice cached = {};
+  memcpy(cached.bda, esp_hidh_dev_bda_get(dev), ESP_BD_ADDR_LEN);
+  cached.transport = esp_hidh_dev_transport_get(dev);
+  cached.addr_type = BLE_ADDR_TYPE_PUBLIC;
+
+  if (cached.transport == ESP_HID_TRANSPORT_BLE) {
+    const ScanResult   *found  = scan_store_.find(cached.bda, ESP_HID_TRANSPORT_BLE);
+    const CachedDevice *before = device_cache_.find(cached.bda);
+    if (found != nullptr) {
+      cached.addr_type = found->ble.addr_type;
+    } else if (before != nullptr) {
+      cached.addr_type = before->addr_type;
     }
+  }
+
+  const char *name = esp_hidh_dev_name_get(dev);
+  if (name != nullptr) strncpy(cached.name, name, CachedDevice::NAME_SIZE - 1);
+
+  esp_err_t ret = device_cache_.store(index, cached);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "Unable to save device %u in NVS: %s", index, esp_err_to_name(ret));
+  }
+}
+
+bool BTKeyboard::reconnect_cached_devices() {
+  xSemaphoreTake(connect_lock_, portMAX_DELAY);
+  opens_done_.store(0);
+  xSemaphoreTake(open_done_, 0);
+
+  uint8_t opened = 0;
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    const CachedDevice &cached = device_cache_.get(i);
+    if (cached.empty() || devices_[i].connected.load(std::memory_order_acquire)) continue;
+
+    ESP_LOGI(TAG, "Reconnecting " ESP_BD_ADDR_STR " (%s)", ESP_BD_ADDR_HEX(cached.bda),
+             cached.name);
+    esp_bd_addr_t bda;
+    memcpy(bda, cached.bda, ESP_BD_ADDR_LEN);
+    if (esp_hidh_dev_open(bda, (esp_hid_transport_t)cached.transport, cached.addr_type)) opened++;
+  }
+
+  // The connection is only known to the component once its OPEN event is handled
+  TickType_t start = xTaskGetTickCount();
+  TickType_t limit = pdMS_TO_TICKS(OPEN_TIMEOUT_MS);
+  while (opens_done_.load() < opened) {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if ((elapsed >= limit) || (xSemaphoreTake(open_done_, limit - elapsed) != pdTRUE)) break;
+  }
+  xSemaphoreGive(connect_lock_);
+  return is_connected();
+}
+
+bool BTKeyboard::start_auto_reconnect(const ReconnectPolicy &policy) {
+  xSemaphoreTake(connect_lock_, portMAX_DELAY);
+  reconnect_policy_ = policy;
+  if (reconnect_policy_.backoff_factor < 1) reconnect_policy_.backoff_factor = 1;
+  if (reconnect_policy_.max_delay_ms < reconnect_policy_.initial_delay_ms) {
+    reconnect_policy_.max_delay_ms = reconnect_policy_.initial_delay_ms;
+  }
+  xSemaphoreGive(connect_lock_);
 
-    int k = -1;
-    for (int i = 0; i < MAX_KEY_DATA_SIZE; i++) {
-      if ((k < 0) && key_avail_[i]) k = i;
-      key_avail_[i] = inf.keys[i] == 0;
+  if (reconnect_task_ == nullptr) {
+    if (xTaskCreate(reconnect_task, "bt_reconnect", 4096, this, 2, &reconnect_task_) != pdPASS) {
+      ESP_LOGE(TAG, "Unable to create the reconnection task!");
+      reconnect_task_ = nullptr;
+      return false;
     }
+  }
+  reconnect_enabled_ = true;
+  xTaskNotifyGive(reconnect_task_);
+  return true;
+}
+
+void BTKeyboard::stop_auto_reconnect() {
+  reconnect_enabled_ = false;
+  if (reconnect_task_ != nullptr) xTaskNotifyGive(reconnect_task_);
+}
+
+ReconnectStats BTKeyboard::get_reconnect_stats() const {
+  uint32_t recoveries = reconnect_stats_.recoveries;
+  return ReconnectStats{
+      .disconnections   = reconnect_stats_.disconnections,
+      .scans            = reconnect_stats_.scans,
+      .attempts         = reconnect_stats_.attempts,
+      .recoveries       = recoveries,
+      .last_recovery_ms = reconnect_stats_.last_recovery_ms,
+      .max_recovery_ms  = reconnect_stats_.max_recovery_ms,
+      .mean_recovery_ms = recoveries ? reconnect_stats_.total_recovery_ms / recoveries : 0};
+}
+
+void BTKeyboard::reset_reconnect_stats() {
+  reconnect_stats_.disconnections    = 0;
+  reconnect_stats_.scans             = 0;
+  reconnect_stats_.attempts          = 0;
+  reconnect_stats_.recoveries        = 0;
+  reconnect_stats_.last_recovery_ms  = 0;
+  reconnect_stats_.max_recovery_ms   = 0;
+  reconnect_stats_.total_recovery_ms = 0;
+}
+
+/**
+ * @brief Reconnection supervisor
+ *
+ * Sleeps until a keyboard disconnects (close_device() notifies it), then makes attempts spaced
+ * by a growing delay for as long as a known keyboard is missing. A new disconnection restarts
+ * the delay from its initial value. Runs for the life of the application.
+ */
+void BTKeyboard::reconnect_task(void *arg) {
+  BTKeyboard *kb = (BTKeyboard *)arg;
+  uint32_t    delay_ms;
+
+  while (true) {
+    xSemaphoreTake(kb->connect_lock_, portMAX_DELAY);
+    ReconnectPolicy policy = kb->reconnect_policy_;
+    xSemaphoreGive(kb->connect_lock_);
+    delay_ms = policy.initial_delay_ms;
 
-    if (k < 0) {
+    if (!kb->reconnect_enabled_ || !kb->has_lost_devices()) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
       continue;
     }
 
-    char ch = inf.keys[k];
+    while (kb->reconnect_enabled_ && kb->has_lost_devices()) {
+      if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(delay_ms)) > 0) break; // Start over
+      if (!kb->reconnect_enabled_) break;
 
-    if (ch >= 4) {
-      if ((uint8_t)inf.modifier & CTRL_MASK) {
-        if (ch < (3 + 26)) {
-          repeat_period_  = pdMS_TO_TICKS(500);
-          return last_ch_ = (ch - 3);
-        }
-      } else if (ch <= 0x52) {
-        // ESP_LOGD(TAG, "Scan code: %d", ch);
-        if (ch == KEY_CAPS_LOCK) caps_lock_ = !caps_lock_;
-        if ((uint8_t)inf.modifier & SHIFT_MASK) {
-          if (caps_lock_) {
-            repeat_period_  = pdMS_TO_TICKS(500);
-            return last_ch_ = shift_trans_dict_[(ch - 4) << 1];
-          } else {
-            repeat_period_  = pdMS_TO_TICKS(500);
-            return last_ch_ = shift_trans_dict_[((ch - 4) << 1) + 1];
-          }
-        } else {
-          if (caps_lock_) {
-            repeat_period_  = pdMS_TO_TICKS(500);
-            return last_ch_ = shift_trans_dict_[((ch - 4) << 1) + 1];
-          } else {
-            repeat_period_  = pdMS_TO_TICKS(500);
-            return last_ch_ = shift_trans_dict_[(ch - 4) << 1];
-          }
-        }
-      }
+      kb->reconnect_lost_devices(policy.scan_seconds);
+      delay_ms = (delay_ms > policy.max_delay_ms / policy.backoff_factor)
+                     ? policy.max_delay_ms
+                     : delay_ms * policy.backoff_factor;
     }
+  }
+}
 
-    last_ch_ = 0;
+// Scan filter of the reconnection supervisor. The supervisor holds connect_lock_.
+bool BTKeyboard::is_lost_device(const ScanResult &result) {
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    const CachedDevice &cached = bt_keyboard_->device_cache_.get(i);
+    if (!cached.empty() && (cached.transport == result.transport) &&
+        !bt_keyboard_->devices_[i].connected.load(std::memory_order_acquire) &&
+        (memcmp(cached.bda, result.bda, ESP_BD_ADDR_LEN) == 0)) {
+      return true;
+    }
   }
+  return false;
+}
+
+bool BTKeyboard::has_lost_devices() const {
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    if (!device_cache_.get(i).empty() && !devices_[i].connected.load(std::memory_order_acquire)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief One attempt of the reconnection supervisor
+ *
+ * Missing BT Classic keyboards are paged directly: once bonded, they are not discoverable.
+ * Missing BLE keyboards are looked for by a BLE scan stopped as soon as one of them advertises,
+ * then the ones seen are connected.
+ */
+void BTKeyboard::reconnect_lost_devices(uint8_t scan_seconds) {
+  xSemaphoreTake(connect_lock_, portMAX_DELAY);
+
+  bool ble_lost = false;
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    const CachedDevice &cached = device_cache_.get(i);
+    if (cached.empty() || devices_[i].connected.load(std::memory_order_acquire)) continue;
+    if (cached.transport != ESP_HID_TRANSPORT_BT) {
+      ble_lost = true;
+      continue;
+    }
+    esp_bd_addr_t bda;
+    memcpy(bda, cached.bda, ESP_BD_ADDR_LEN);
+    reconnect_stats_.attempts++;
+    esp_hidh_dev_open(bda, ESP_HID_TRANSPORT_BT, cached.addr_type);
+  }
+
+  if (ble_lost) {
+    reconnect_stats_.scans++;
+    esp_hid_scan(scan_seconds, is_lost_device, false);
+    for (ScanResult &r : scan_store_) {
+      if (!is_lost_device(r)) continue;
+      ESP_LOGI(TAG, "Reconnecting " ESP_BD_ADDR_STR, ESP_BD_ADDR_HEX(r.bda));
+      reconnect_stats_.attempts++;
+      esp_hidh_dev_open(r.bda, ESP_HID_TRANSPORT_BLE, r.ble.addr_type);
+    }
+  }
+
+  xSemaphoreGive(connect_lock_);
+}
+
+/**
+ * @brief Free the slot of a device that disconnected
+ *
+ * The keys it still held are released first, so consumers see their UP events. The
+ * reconnection supervisor, if started, is woken up.
+ */
+void BTKeyboard::close_device(esp_hidh_dev_t *dev) {
+  uint8_t index = device_table_.find(dev);
+  if (index == DeviceTable<MAX_DEVICES>::NO_DEVICE) return;
+
+  Device &device = devices_[index];
+  release_keys(device, index);
+  device.connected.store(false, std::memory_order_release);
+  device.dev     = nullptr;
+  device.lost_us = esp_timer_get_time();
+  device_table_.erase(dev);
+
+  reconnect_stats_.disconnections++;
+  count(metrics_.disconnections);
+  if (reconnect_task_ != nullptr) xTaskNotifyGive(reconnect_task_);
+}
+
+BTKeyboard::Metrics BTKeyboard::get_metrics() const {
+  constexpr auto relaxed = std::memory_order_relaxed;
+  Metrics        metrics;
+
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    const DeviceCounters &counters = metrics_.devices[i];
+    metrics.devices[i] = DeviceMetrics{.reports       = counters.reports.load(relaxed),
+                                       .bytes         = counters.bytes.load(relaxed),
+                                       .truncated     = counters.truncated.load(relaxed),
+                                       .decode_errors = counters.decode_errors.load(relaxed),
+                                       .battery_level = devices_[i].battery_level.load(relaxed)};
+  }
+  metrics.events_dropped  = metrics_.events_dropped.load(relaxed);
+  metrics.reports_dropped = metrics_.reports_dropped.load(relaxed);
+  metrics.connections     = metrics_.connections.load(relaxed);
+  metrics.disconnections  = metrics_.disconnections.load(relaxed);
+  metrics.reconnects      = metrics_.reconnects.load(relaxed);
+  metrics.scans           = metrics_.scans.load(relaxed);
+  metrics.last_scan_ms    = metrics_.last_scan_ms.load(relaxed);
+  metrics.advertisements  = metrics_.advertisements.load(relaxed);
+  metrics.last_rssi       = metrics_.last_rssi.load(relaxed);
+  metrics.heap_bytes      = metrics_.heap_bytes.load(relaxed);
+  metrics.heap_peak_bytes = metrics_.heap_peak_bytes.load(relaxed);
+  return metrics;
+}
+
+void BTKeyboard::reset_metrics() {
+  constexpr auto relaxed = std::memory_order_relaxed;
+
+  for (DeviceCounters &counters : metrics_.devices) {
+    counters.reports.store(0, relaxed);
+    counters.bytes.store(0, relaxed);
+    counters.truncated.store(0, relaxed);
+    counters.decode_errors.store(0, relaxed);
+  }
+  metrics_.events_dropped.store(0, relaxed);
+  metrics_.reports_dropped.store(0, relaxed);
+  metrics_.connections.store(0, relaxed);
+  metrics_.disconnections.store(0, relaxed);
+  metrics_.reconnects.store(0, relaxed);
+  metrics_.scans.store(0, relaxed);
+  metrics_.advertisements.store(0, relaxed);
+  metrics_.heap_peak_bytes.store(metrics_.heap_bytes.load(relaxed), relaxed);
+}
+
+/**
+ * @brief Account for a buffer of the component allocated (positive) or freed (negative)
+ *
+ * The peak follows the heap in use, whatever task allocates.
+ */
+void BTKeyboard::account_heap(ptrdiff_t bytes) {
+  uint32_t used = metrics_.heap_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  uint32_t peak = metrics_.heap_peak_bytes.load(std::memory_order_relaxed);
+  while ((used > peak) && !metrics_.heap_peak_bytes.compare_exchange_weak(
+                              peak, used, std::memory_order_relaxed)) {}
+}
+
+int8_t BTKeyboard::get_battery_level() const {
+  for (const Device &device : devices_) {
+    if (device.connected.load(std::memory_order_acquire)) return device.battery_level;
+  }
+  return -1;
+}
+
+uint8_t BTKeyboard::get_connected_count() const {
+  uint8_t count = 0;
+  for (const Device &device : devices_) {
+    if (device.connected.load(std::memory_order_acquire)) count++;
+  }
+  return count;
+}
+
+BTKeyboard::DeviceStatus BTKeyboard::get_device_status(uint8_t device) const {
+  DeviceStatus status = {.connected = false, .battery_level = -1, .bda = {}, .link = {}};
+  if (device >= MAX_DEVICES) return status;
+
+  const Device &d      = devices_[device];
+  status.connected     = d.connected.load(std::memory_order_acquire);
+  status.battery_level = d.battery_level;
+  memcpy(status.bda, d.bda, ESP_BD_ADDR_LEN);
+
+  status.link = {.interval_us = d.interval_us,
+                 .latency     = d.latency,
+                 .timeout_ms  = d.timeout_ms,
+                 .requests    = d.link_requests,
+                 .sniff       = d.sniff,
+                 .in_policy   = timing_in_policy(d.transport, d.interval_us,
+                                                 get_latency_policy(device))};
+  return status;
+}
+
+void BTKeyboard::set_latency_policy(const LatencyPolicy &policy, uint8_t device) {
+  LatencyPolicy checked = policy;
+  if (checked.min_interval != 0) {
+    if (checked.min_interval < 6) checked.min_interval = 6;
+    if (checked.min_interval > 3200) checked.min_interval = 3200;
+    if (checked.max_interval < checked.min_interval) checked.max_interval = checked.min_interval;
+    if (checked.max_interval > 3200) checked.max_interval = 3200;
+
+    // The supervision timeout must exceed (1 + latency) * interval * 2, and be 32 s at most
+    uint32_t max_latency = (3200 * 4 - 1) / checked.max_interval - 1;
+    if (checked.latency > max_latency) checked.latency = max_latency;
+    if (checked.latency > 499) checked.latency = 499;
+    uint32_t min_timeout = (1 + checked.latency) * checked.max_interval / 4 + 1;
+    if (checked.timeout < min_timeout) checked.timeout = min_timeout;
+    if (checked.timeout < 10) checked.timeout = 10;
+    if (checked.timeout > 3200) checked.timeout = 3200;
+  }
+
+  if (link_lock_ != nullptr) xSemaphoreTake(link_lock_, portMAX_DELAY);
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    if ((device == ALL_DEVICES) || (device == i)) latency_policy_[i] = checked;
+  }
+  if (link_lock_ != nullptr) xSemaphoreGive(link_lock_);
+
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    if ((device == ALL_DEVICES) || (device == i)) {
+      devices_[i].link_requests = 0;
+      request_link_timing(i);
+    }
+  }
+}
+
+LatencyPolicy BTKeyboard::get_latency_policy(uint8_t device) const {
+  if (device >= MAX_DEVICES) return LATENCY_POLICY_KEYBOARD;
+
+  if (link_lock_ != nullptr) xSemaphoreTake(link_lock_, portMAX_DELAY);
+  LatencyPolicy policy = latency_policy_[device];
+  if (link_lock_ != nullptr) xSemaphoreGive(link_lock_);
+  return policy;
+}
+
+/// Slot of the connected keyboard with that address, or DeviceTable::NO_DEVICE
+uint8_t BTKeyboard::find_connected(const uint8_t *bda) const {
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    if (devices_[i].connected.load(std::memory_order_acquire) &&
+        (memcmp(devices_[i].bda, bda, ESP_BD_ADDR_LEN) == 0)) {
+      return i;
+    }
+  }
+  return DeviceTable<MAX_DEVICES>::NO_DEVICE;
+}
+
+/// True if the interval in effect is the one the policy asks for, or if it asks for nothing.
+/// An interval still unknown (0) is never in policy.
+bool BTKeyboard::timing_in_policy(esp_hid_transport_t transport, uint32_t interval_us,
+                                  const LatencyPolicy &policy) {
+  if (interval_us == 0) return false;
+  if (transport == ESP_HID_TRANSPORT_BLE) {
+    return (policy.min_interval == 0) || ((interval_us >= policy.min_interval * 1250U) &&
+                                          (interval_us <= policy.max_interval * 1250U));
+  }
+  return (policy.poll_slots == 0) || (interval_us <= policy.poll_slots * 625U);
+}
+
+/**
+ * @brief Ask the keyboard of a slot for the radio timing of its latency policy
+ *
+ * Returns at once: the outcome comes as a GAP event (ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT or
+ * ESP_BT_GAP_QOS_CMPL_EVT) in the Bluetooth stack task.
+ */
+void BTKeyboard::request_link_timing(uint8_t index) {
+  Device &device = devices_[index];
+  if (!device.connected.load(std::memory_order_acquire)) return;
+
+  LatencyPolicy policy = get_latency_policy(index);
+  esp_err_t     ret;
+  if (device.transport == ESP_HID_TRANSPORT_BLE) {
+    if (policy.min_interval == 0) return;
+    esp_ble_conn_update_params_t params = {};
+    memcpy(params.bda, device.bda, ESP_BD_ADDR_LEN);
+    params.min_int = policy.min_interval;
+    params.max_int = policy.max_interval;
+    params.latency = policy.latency;
+    params.timeout = policy.timeout;
+    device.link_requests++;
+    ret = esp_ble_gap_update_conn_params(&params);
+  } else {
+    if (policy.poll_slots == 0) return;
+    device.link_requests++;
+    ret = esp_bt_gap_set_qos(device.bda, policy.poll_slots);
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "Link timing request of device %u failed: %s", index, esp_err_to_name(ret));
+  }
+}
+
+/**
+ * @brief Check the timing a keyboard settled on against its latency policy, in the Bluetooth
+ *        stack task
+ *
+ * A keyboard refusing the request, or counter-proposing its own timing later on, is asked
+ * again until it made max_retries refusals; its timing is kept after that.
+ */
+void BTKeyboard::link_timing_updated(uint8_t index, bool success) {
+  Device       &device = devices_[index];
+  LatencyPolicy policy = get_latency_policy(index);
+
+  if (success && timing_in_policy(device.transport, device.interval_us, policy)) return;
+  if ((device.transport == ESP_HID_TRANSPORT_BLE) ? (policy.min_interval == 0)
+                                                  : (policy.poll_slots == 0)) {
+    return;
+  }
+  if (device.link_requests > policy.max_retries) {
+    ESP_LOGV(TAG, "Device %u keeps an interval of %" PRIu32 " us", index,
+             device.interval_us.load());
+    return;
+  }
+  request_link_timing(index);
+}
+
+/**
+ * @brief Compile the decode plan of a newly connected device
+ *
+ * Every report map of the device is parsed once, here, so that push_key() only has to run the
+ * resulting plan. If no keyboard report is found, the plan stays empty and reports are
+ * assumed to follow the boot keyboard layout.
+ *
+ * @param device The slot of the device that just connected
+ */
+void BTKeyboard::compile_decode_plan(Device &device) {
+  size_t                    num_maps    = 0;
+  esp_hid_raw_report_map_t *maps        = nullptr;
+  DecodePlan               &decode_plan = device.decode_plan;
+
+  decode_plan.clear();
+  if ((esp_hidh_dev_report_maps_get(device.dev, &num_maps, &maps) != ESP_OK) ||
+      (maps == nullptr)) {
+    ESP_LOGW(TAG, "Unable to retrieve the report maps. Assuming a boot keyboard.");
+    return;
+  }
+
+  for (size_t i = 0; i < num_maps; i++) {
+    if (!ReportDecoder::compile(maps[i].data, maps[i].len, i, decode_plan)) {
+      ESP_LOGW(TAG, "Report map %d only partially decoded.", (int)i);
+    }
+  }
+
+  for (uint8_t i = 0; i < decode_plan.count; i++) {
+    const KeyboardReportLayout &layout = decode_plan.reports[i];
+    ESP_LOGI(TAG,
+             "Keyboard report: map %u, id %u, modifiers @%u, array @%u (%u x %u bits), "
+             "bitmap @%u (%u keys)",
+             layout.map_index, layout.report_id, layout.modifier_offset, layout.array_offset,
+             layout.array_count, layout.array_size, layout.bitmap_offset, layout.bitmap_count);
+  }
+  if (decode_plan.count == 0) {
+    ESP_LOGW(TAG, "No keyboard report found in the report maps. Assuming a boot keyboard.");
+  }
+}
+
+/**
+ * @brief Turns a keyboard input report into key events
+ *
+ * The report is decoded into the set of keys down, following the plan compiled when the
+ * device connected, and compared with the previous set: each key pressed or released
+ * produces a 4-byte KeyEvent in the event ring. Modifier keys produce events too. A report
+ * signalling ErrorRollOver (too many keys down) only updates the modifiers. Without a plan
+ * (unparsable report map), the report is expected to follow the boot keyboard layout. It runs
+ * on the esp_hidh event task, the single producer of the rings, or on the task of a replay
+ * while the esp_hidh event task stays out of it. If the input size exceeds
+ * ReportPool::MAX_REPORT_SIZE, a warning message will be logged.
+ *
+ * @param device The decoding state of the keyboard that sent the report
+ * @param index The device index its events are tagged with
+ * @param keys Pointer to array containing keyboard event data
+ * @param size Size of the keyboard event data in bytes
+ * @param map_index Report map the report belongs to
+ * @param report_id Report ID the data was received with
+ *
+ * @note Never blocks and never allocates. When the ring is full, the selected OverflowPolicy
+ *       applies and the loss is accounted for in the queue statistics.
+ */
+void BTKeyboard::push_key(Device &device, uint8_t index, const uint8_t *keys, size_t size,
+                          uint8_t map_index, uint8_t report_id) {
+  // Counted in the metrics, logged only for the first one since the last reset_metrics()
+  if ((size > ReportPool::MAX_REPORT_SIZE) &&
+      (metrics_.devices[index].truncated.fetch_add(1, std::memory_order_relaxed) == 0)) {
+    ESP_LOGW(TAG, "Device %u sends reports of %u bytes, truncated to %u.", index, (unsigned)size,
+             (unsigned)ReportPool::MAX_REPORT_SIZE);
+  }
+
+  // With a plan, only the reports it describes carry keys
+  const KeyboardReportLayout *layout = device.decode_plan.find(map_index, report_id);
+  if ((layout == nullptr) && (device.decode_plan.count > 0)) return;
+
+  KeyboardReportLayout boot_layout;
+  if (layout == nullptr) {
+    boot_layout = ReportDecoder::boot_layout(size);
+    layout      = &boot_layout;
+  }
+
+  if (report_queue_depth_ > 0) push_report(device, index, *layout, keys, size, report_id);
+
+  KeyBitmap state;
+  bool      complete = ReportDecoder::decode_keys(*layout, keys, size, state);
+  if (!complete) count(metrics_.devices[index].decode_errors);
+
+  device.key_engine.update(state, !complete, [this, index](KeyEvent event) {
+    event.device = index;
+    push_event(event);
+  });
+}
+
+/**
+ * @brief Release every key still down on a keyboard
+ *
+ * Called when the device disconnects, so that consumers see the release of the keys that were
+ * held at that time.
+ */
+void BTKeyboard::release_keys(Device &device, uint8_t index) {
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+  input_received_us_ = latency_timestamp();
+#endif
+  device.key_engine.update(KeyBitmap(), false, [this, index](KeyEvent event) {
+    event.device = index;
+    push_event(event);
+  });
+}
+
+/**
+ * @brief Pushes a key event to the event ring buffer and arms or cancels the key repeat
+ *
+ * A key press starts the repeat timer with the delay of its KeyClass, replacing the key
+ * repeated so far, whatever keyboard it comes from. The release of the repeated key on the same
+ * keyboard cancels it. Modifiers do not affect the repeat: repeated events carry the modifiers
+ * of the last event pushed at the time they are generated.
+ *
+ * The repeat timer does not push to the ring: it posts its events next to it (see
+ * SpscRing::post()), so that the input path stays the single producer and never waits for it.
+ * A repeat not taken yet by the application is withdrawn before the event replacing or
+ * cancelling it is pushed, so that it never comes after it.
+ */
+void BTKeyboard::push_event(const KeyEvent &event) {
+  uint32_t received_us = 0;
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+  received_us = input_received_us_;
+#endif
+
+  RepeatKey key = repeat_key_.load(std::memory_order_relaxed);
+  repeat_modifiers_.store(event.modifiers, std::memory_order_relaxed);
+
+  if ((event.kind == KeyEvent::Kind::DOWN) && !event.is_modifier()) {
+    KeyRepeatTiming timing = key_repeat_[(uint8_t)key_class(event.usage)];
+    bool            repeat = timing.period_ms > 0;
+    if (repeat) {
+      uint32_t first_us = (uint32_t)esp_timer_get_time() + (uint32_t)timing.delay_ms * 1000;
+      repeat_first_us_.store(first_us, std::memory_order_relaxed);
+      repeat_period_ms_.store(timing.period_ms, std::memory_order_relaxed);
+    }
+    set_repeat_key(RepeatKey{.usage  = repeat ? event.usage : (uint8_t)0,
+                             .device = event.device,
+                             .armed  = (uint16_t)(key.armed + 1)});
+    enqueue_event(event, received_us);
+    esp_timer_stop(repeat_timer_);
+    // The callback re-arms the timer until it sees the new key: stop it again if it did
+    while (repeat && (esp_timer_start_once(repeat_timer_, (uint64_t)timing.delay_ms * 1000) ==
+                      ESP_ERR_INVALID_STATE)) {
+      esp_timer_stop(repeat_timer_);
+    }
+  } else if ((event.kind == KeyEvent::Kind::UP) && (key.usage != 0) &&
+             (event.usage == key.usage) && (event.device == key.device)) {
+    set_repeat_key(RepeatKey{.usage = 0, .device = 0, .armed = (uint16_t)(key.armed + 1)});
+    enqueue_event(event, received_us);
+    esp_timer_stop(repeat_timer_);
+  } else {
+    enqueue_event(event, received_us);
+  }
+}
+
+/**
+ * @brief Publishes the key to repeat from now on, 0 for none, and withdraws the repeat of the
+ *        previous one if the application did not take it yet
+ *
+ * The key is published first: a repeat being posted meanwhile either sees it and gives up, or
+ * is withdrawn.
+ */
+void BTKeyboard::set_repeat_key(const RepeatKey &key) {
+  repeat_key_.store(key, std::memory_order_seq_cst);
+  event_ring_.cancel_post();
+}
+
+/**
+ * @brief Posts a REPEAT event of the held key and re-arms the timer for the next one
+ *
+ * Runs on the esp_timer task, without waiting for the input path: the key is read from
+ * repeat_key_. The first expiry for a key pressed is recognized by its `armed` count. An
+ * expiry of the previous key seeing the new one before its time is stale and ignored: the
+ * input path has started the timer for the new key. The next expiry is computed from the
+ * previous due time, so the callback latency does not accumulate into the period.
+ */
+void BTKeyboard::repeat_timer_callback(void *arg) {
+  BTKeyboard *kb  = (BTKeyboard *)arg;
+  RepeatKey   key = kb->repeat_key_.load(std::memory_order_seq_cst);
+  if (key.usage == 0) return;
+
+  int64_t now_us = esp_timer_get_time();
+  if (key.armed != kb->repeat_served_) {
+    int32_t late_us = (int32_t)((uint32_t)now_us -
+                                kb->repeat_first_us_.load(std::memory_order_relaxed));
+    if (late_us < 0) return;
+    kb->repeat_served_ = key.armed;
+    kb->repeat_due_us_ = now_us - late_us;
+  }
+
+  KeyEvent event = {.usage     = key.usage,
+                    .modifiers = kb->repeat_modifiers_.load(std::memory_order_relaxed),
+                    .kind      = KeyEvent::Kind::REPEAT,
+                    .device    = key.device};
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+  event.received_us = latency_timestamp();
+  event.queued_us   = event.received_us;
+#endif
+  if (kb->call_key_handler(event)) {
+    kb->event_ring_.post([kb, key, &event](KeyEvent &slot) {
+      // Released or replaced while claiming the slot
+      if (kb->repeat_key_.load(std::memory_order_seq_cst) != key) return false;
+      slot = event;
+      return true;
+    });
+  }
+
+  kb->repeat_due_us_ += (int64_t)kb->repeat_period_ms_.load(std::memory_order_relaxed) * 1000;
+  if (kb->repeat_due_us_ < now_us) kb->repeat_due_us_ = now_us; // Late: skip, don't burst
+  esp_timer_start_once(kb->repeat_timer_, kb->repeat_due_us_ - now_us);
+}
+
+/**
+ * @brief Hands a key event to the key handler, if any, and pushes it to the event ring buffer
+ *        unless the handler takes the events alone. The event is timestamped when latency
+ *        statistics are enabled.
+ */
+void BTKeyboard::enqueue_event(const KeyEvent &event, uint32_t received_us) {
+  KeyEvent displaced;
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+  KeyEvent stamped    = event;
+  stamped.received_us = received_us;
+  stamped.queued_us   = latency_timestamp();
+  latency_[(uint8_t)LatencyStage::DECODE].record(stamped.queued_us - stamped.received_us);
+  if (!call_key_handler(stamped)) return;
+  if (event_ring_.push(stamped, displaced) != SpscRing<KeyEvent>::PushResult::STORED) {
+    count(metrics_.events_dropped);
+  }
+#else
+  (void)received_us;
+  if (!call_key_handler(event)) return;
+  if (event_ring_.push(event, displaced) != SpscRing<KeyEvent>::PushResult::STORED) {
+    count(metrics_.events_dropped);
+  }
+#endif
+}
+
+/**
+ * @brief Gives an event to the key handler, if one is set
+ *
+ * The call is counted in the slot of the handler used, for set_key_handler() to wait for it.
+ *
+ * @return true if the event must be queued as well
+ */
+bool BTKeyboard::call_key_handler(const KeyEvent &event) {
+  uint8_t index;
+  while (true) {
+    index = key_handler_index_.load(std::memory_order_seq_cst);
+    key_handler_calls_[index].fetch_add(1, std::memory_order_seq_cst);
+    if (key_handler_index_.load(std::memory_order_seq_cst) == index) break;
+    key_handler_calls_[index].fetch_sub(1, std::memory_order_release); // Switched meanwhile
+  }
+
+  const KeyHandlerSlot &slot  = key_handlers_[index];
+  bool                  queue = (slot.handler == nullptr) || slot.queue_too;
+  if (slot.handler != nullptr) (*slot.handler)(event, slot.context);
+
+  key_handler_calls_[index].fetch_sub(1, std::memory_order_release);
+  return queue;
+}
+
+/**
+ * @brief Select the handler receiving the key events directly
+ *
+ * The new handler goes in the slot not in use, which is then selected. Waiting for the calls
+ * still using the previous slot ensures that the previous handler is never called with the
+ * new context, and is not called anymore once this returns. The tasks calling the handler
+ * never wait.
+ */
+void BTKeyboard::set_key_handler(KeyHandler *handler, void *context, bool queue_too) {
+  if (handler_lock_ != nullptr) xSemaphoreTake(handler_lock_, portMAX_DELAY);
+
+  uint8_t previous      = key_handler_index_.load(std::memory_order_relaxed);
+  uint8_t next          = previous ^ 1;
+  key_handlers_[next]   = KeyHandlerSlot{handler, context, queue_too};
+  key_handler_index_.store(next, std::memory_order_seq_cst);
+  while (key_handler_calls_[previous].load(std::memory_order_acquire) != 0) vTaskDelay(1);
+
+  if (handler_lock_ != nullptr) xSemaphoreGive(handler_lock_);
+}
+
+/**
+ * @brief Pushes an input report to the report ring buffer
+ *
+ * The report is decoded into a pool buffer in the boot keyboard layout and its buffer index is
+ * enqueued. This is the only copy made on its way to the application. Without a plan, the
+ * report is copied as is.
+ *
+ * @note When no report buffer is free, the report is dropped and counted by
+ *       get_pool_exhausted_count().
+ */
+void BTKeyboard::push_report(const Device &device, uint8_t device_index,
+                             const KeyboardReportLayout &layout, const uint8_t *keys,
+                             size_t size, uint8_t report_id) {
+  ReportPool::Index index = report_pool_.allocate();
+  if (index == ReportPool::NO_REPORT) {
+    count(metrics_.reports_dropped);
+    return;
+  }
+
+  if (device.decode_plan.count > 0) {
+    uint8_t length = ReportDecoder::decode(layout, keys, size, report_pool_.buffer(index),
+                                           ReportPool::MAX_REPORT_SIZE);
+    report_pool_.commit(index, length, report_id, device_index);
+  } else {
+    report_pool_.fill(index, keys, size, report_id, device_index);
+  }
+
+  ReportPool::Index displaced;
+  switch (report_ring_.push(index, displaced)) {
+    case SpscRing<ReportPool::Index>::PushResult::EVICTED:
+      report_pool_.release(displaced);
+      count(metrics_.reports_dropped);
+      break;
+    case SpscRing<ReportPool::Index>::PushResult::REJECTED:
+      report_pool_.release(index);
+      count(metrics_.reports_dropped);
+      break;
+    default:
+      break;
+  }
+}
+
+bool BTKeyboard::wait_for_report(ReportHandle &report, TickType_t duration) {
+  if (report_queue_depth_ == 0) return false;
+
+  ReportPool::Index index;
+  if (!report_ring_.wait_pop(index, duration)) return false;
+  report = report_pool_.adopt(index);
+  return true;
+}
+
+size_t BTKeyboard::drain_events(std::span<KeyEvent> events, TickType_t timeout, size_t min_batch,
+                                TickType_t max_batch_wait) {
+  uint32_t max    = (events.size() < UINT32_MAX) ? events.size() : UINT32_MAX;
+  uint32_t popped = event_ring_.wait_pop_many(events.data(), max, timeout,
+                                              (min_batch < max) ? min_batch : max, max_batch_wait);
+
+  for (uint32_t i = 0; i < popped; i++) record_latency(events[i]);
+  return popped;
+}
+
+bool BTKeyboard::start_recording(size_t size) {
+  if (record_lock_ == nullptr) return false;
+  xSemaphoreTake(record_lock_, portMAX_DELAY);
+  size_t held    = recorder_.memory_size();
+  bool   started = recorder_.start(size);
+  recording_.store(started);
+  account_heap((ptrdiff_t)recorder_.memory_size() - (ptrdiff_t)held);
+  xSemaphoreGive(record_lock_);
+  if (!started) ESP_LOGE(TAG, "Unable to allocate a recording ring of %u bytes!", (unsigned)size);
+  return started;
+}
+
+void BTKeyboard::stop_recording() { recording_.store(false); }
+
+size_t BTKeyboard::get_recording_size() {
+  if (record_lock_ == nullptr) return 0;
+  xSemaphoreTake(record_lock_, portMAX_DELAY);
+  size_t size = recorder_.is_started() ? recorder_.size() : 0;
+  xSemaphoreGive(record_lock_);
+  return size;
+}
+
+size_t BTKeyboard::get_recording(uint8_t *buffer, size_t size) {
+  if (record_lock_ == nullptr) return 0;
+  xSemaphoreTake(record_lock_, portMAX_DELAY);
+  size_t copied = recorder_.is_started() ? recorder_.copy_to(buffer, size) : 0;
+  xSemaphoreGive(record_lock_);
+  return copied;
+}
+
+/**
+ * @brief Append an input report to the recording, in the esp_hidh event task
+ *
+ * The report maps of the device are copied along with its first report, from the esp_hidh
+ * device that cannot go away meanwhile.
+ */
+void BTKeyboard::record_report(uint8_t index, esp_hidh_dev_t *dev, const uint8_t *data,
+                               size_t size, uint8_t map_index, uint8_t report_id) {
+  xSemaphoreTake(record_lock_, portMAX_DELAY);
+  if (!recorder_.has_maps(index)) {
+    size_t                    num_maps = 0;
+    esp_hid_raw_report_map_t *maps     = nullptr;
+    if ((esp_hidh_dev_report_maps_get(dev, &num_maps, &maps) != ESP_OK) || (maps == nullptr)) {
+      num_maps = 0;
+    }
+    size_t held = recorder_.memory_size();
+    recorder_.set_maps(index, maps, num_maps);
+    account_heap((ptrdiff_t)recorder_.memory_size() - (ptrdiff_t)held);
+  }
+  recorder_.record(esp_timer_get_time(), index, map_index, report_id, data, size);
+  xSemaphoreGive(record_lock_);
+}
+
+void BTKeyboard::dump_recording() {
+  size_t                     capacity = get_recording_size();
+  std::unique_ptr<uint8_t[]> recording(new (std::nothrow) uint8_t[capacity ? capacity : 1]);
+  if ((capacity == 0) || (recording == nullptr)) {
+    puts("# No recording");
+    return;
+  }
+
+  // The recording may have grown since its size was taken
+  xSemaphoreTake(record_lock_, portMAX_DELAY);
+  size_t   size         = recorder_.copy_to(recording.get(), capacity);
+  uint32_t report_count = recorder_.report_count();
+  uint32_t dropped      = recorder_.dropped_count();
+  xSemaphoreGive(record_lock_);
+  if (size == 0) {
+    puts("# Recording changed, try again");
+    return;
+  }
+  account_heap(capacity);
+
+  char          line[72];
+  TextFormatter out(line, sizeof(line));
+  out.append("# BTKeyboard recording: %u bytes, %" PRIu32 " reports, %" PRIu32 " dropped",
+             (unsigned)size, report_count, dropped);
+  puts(out.c_str());
+  for (size_t offset = 0; offset < size; offset += 32) {
+    out.clear();
+    for (size_t i = offset; (i < offset + 32) && (i < size); i++) out.append("%02x", recording[i]);
+    puts(out.c_str());
+  }
+  account_heap(-(ptrdiff_t)capacity);
+}
+
+bool BTKeyboard::replay_recording(const uint8_t *recording, size_t size, uint16_t speed) {
+  RecordingReader reader(recording, size);
+  if (!reader.valid()) {
+    ESP_LOGE(TAG, "Not a recording of format version %u", RecordingFormat::FORMAT_VERSION);
+    return false;
+  }
+
+  // Decoding state of the recorded keyboards, apart from the connected ones
+  std::unique_ptr<Device[]> devices(new (std::nothrow) Device[MAX_DEVICES]);
+  if (devices == nullptr) return false;
+  account_heap(MAX_DEVICES * sizeof(Device));
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+    devices[i].decode_plan.clear();
+    devices[i].key_engine.clear();
+  }
+
+  // Keep the esp_hidh event task out of push_key() until the end of the replay
+  replaying_.store(true);
+  while (input_busy_.load()) vTaskDelay(1);
+
+  RecordedEntry entry;
+  bool          first    = true;
+  int64_t       start_us = esp_timer_get_time();
+  uint64_t      due_us   = 0; // Since start_us, at the original speed
+  while (reader.next(entry)) {
+    if (entry.device >= MAX_DEVICES) continue;
+    Device &device = devices[entry.device];
+
+    if (entry.kind == RecordedEntry::Kind::REPORT_MAP) {
+      ReportDecoder::compile(entry.data, entry.length, entry.map_index, device.decode_plan);
+      continue;
+    }
+
+    if (!first) due_us += entry.delta_us;
+    first = false;
+    if (speed > 0) {
+      // Sleep the whole ticks, which vTaskDelay() may shorten by one, then spin up to the due
+      // time, for REPLAY_SPIN_US at most so that lower priority tasks still run: with ticks
+      // longer than that, a report may go up to one tick early
+      int64_t due  = start_us + (int64_t)(due_us / speed);
+      int64_t wait = due - esp_timer_get_time();
+      if (wait >= (int64_t)portTICK_PERIOD_MS * 1000) {
+        vTaskDelay((TickType_t)(wait / 1000 / portTICK_PERIOD_MS));
+      }
+      int64_t spin_end = esp_timer_get_time() + REPLAY_SPIN_US;
+      if (spin_end < due) due = spin_end;
+      while (esp_timer_get_time() < due) {}
+    }
+    push_key(device, entry.device, entry.data, entry.length, entry.map_index, entry.report_id);
+  }
+
+  for (uint8_t i = 0; i < MAX_DEVICES; i++) release_keys(devices[i], i);
+  replaying_.store(false);
+  account_heap(-(ptrdiff_t)(MAX_DEVICES * sizeof(Device)));
+  return reader.complete();
+}
+
+/**
+ * @brief Wait for the next keyboard report and copy it into a KeyInfo structure
+ *
+ * Kept for applications written against the original queue-based interface. The report is
+ * copied once more into `inf`; wait_for_report() avoids that copy.
+ *
+ * @param inf Receives the report. `modifier` is the report's first byte.
+ * @param duration Maximum time to wait, in ticks
+ *
+ * @note Needs a report_queue_depth given to the constructor.
+ *
+ * @return false on timeout, or if the delivery of reports is disabled
+ */
+bool BTKeyboard::wait_for_low_event(KeyInfo &inf, TickType_t duration) {
+  ReportHandle report;
+  if (!wait_for_report(report, duration)) return false;
+
+  inf.size     = report.size();
+  inf.modifier = (KeyModifier)((report.size() > 0) ? report[0] : 0);
+  inf.device   = report.device();
+  memcpy(inf.keys, report.data(), report.size());
+  return true;
+}
+
+/**
+ * @brief Waits for the next key press or repeat producing something, and translates it
+ *
+ * Releases, modifiers and keys without a translation in the current modifier state are skipped.
+ * The Caps Lock state is toggled when Caps Lock is pressed.
+ *
+ * @param event Receives the key event
+ * @param code Receives the keymap code of the key. 0 for the Compose key.
+ * @param forever If false, returns false as soon as no event is available
+ *
+ * @return false on timeout
+ */
+bool BTKeyboard::next_key_code(KeyEvent &event, uint8_t &code, bool forever) {
+  while (event_ring_.wait_pop(event, forever ? portMAX_DELAY : 0)) {
+    record_latency(event);
+    if (event.kind == KeyEvent::Kind::UP) continue;
+
+    if ((compose_key_ != 0) && (event.usage == compose_key_)) {
+      if (event.kind == KeyEvent::Kind::REPEAT) continue;
+      code = 0;
+      return true;
+    }
+    if (event.is_modifier()) continue;
+
+    code = keymap_->translate(event.usage, event.modifiers, caps_lock_);
+
+    if ((event.usage == KEY_CAPS_LOCK) && (event.kind == KeyEvent::Kind::DOWN)) {
+      caps_lock_ = !caps_lock_;
+    }
+    if (code != 0) return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Waits for and processes keyboard input to return an ASCII character.
+ *
+ * This method handles keyboard input processing including:
+ * - Repeated keys, generated by the typematic repeat timer (see set_key_repeat())
+ * - Modifier keys (Shift, Ctrl)
+ * - Caps Lock toggle
+ * - Character translation using the selected keymap, one table load per key
+ * - Several keys pressed in the same report, returned in turn by successive calls
+ *
+ * @param forever If true, waits indefinitely for input. If false, returns immediately if no input
+ *                is available.
+ *
+ * @return ASCII character based on the keyboard input and current modifier state.
+ *         Returns:
+ *         - Control characters (1-26) when Ctrl is pressed with letters
+ *         - Shifted or unshifted characters based on Shift and Caps Lock states
+ *         - AltGr characters on layouts that use it
+ *         - The spacing character of dead keys
+ *         - 0 if no valid character could be generated
+ *
+ * @note The method manages the caps lock state.
+ */
+char BTKeyboard::wait_for_ascii_char(bool forever) {
+  KeyEvent event;
+  uint8_t  code;
+
+  while (next_key_code(event, code, forever)) {
+    if (Keymap::is_dead(code)) return Keymap::spacing(code);
+    if (code != 0) return code;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Waits for the next character or named key, with dead keys and Compose sequences
+ *
+ * A dead key is combined with the next character through a single table lookup (COMPOSE_LATIN).
+ * When they do not combine, the spacing character of the dead key is returned, then the
+ * character on the next call. A named key (function, navigation...) or a control character
+ * cancels a pending dead key. Repeats of dead keys are ignored. Nothing is allocated.
+ *
+ * @param forever If true, waits indefinitely for input. If false, returns immediately if no input
+ *                is available.
+ *
+ * @return The character (TextInput::to_utf8() encodes it), the named key, or an empty
+ *         TextInput when no input is available.
+ */
+TextInput BTKeyboard::wait_for_codepoint(bool forever) {
+  TextInput out[2];
+  KeyEvent  event;
+  uint8_t   code;
+
+  if (!pending_text_.empty()) {
+    out[0]        = pending_text_;
+    pending_text_ = {0, NamedKey::NONE};
+    return out[0];
+  }
+
+  while (next_key_code(event, code, forever)) {
+    if (code == 0) {
+      composer_.compose();
+      continue;
+    }
+    if ((event.kind == KeyEvent::Kind::REPEAT) && Keymap::is_dead(code)) continue;
+
+    uint8_t count = composer_.feed(code, out);
+    if (count == 2) pending_text_ = out[1];
+    if (count > 0) return out[0];
+  }
+
+  return {0, NamedKey::NONE};
+}
+
+/**
+ * @brief Takes the characters typed so far into the line, without waiting
+ *
+ * @return true once Enter is typed
+ */
+bool BTKeyboard::NextLine::ready() {
+  TextInput input;
+
+  while (!(input = kb.get_codepoint()).empty()) {
+    char32_t c = input.codepoint;
+    if (c == '\r') return true;
+
+    if (c == '\b') {
+      // Remove the last character with its UTF-8 continuation bytes
+      while ((length > 0) && ((buffer[--length] & 0xC0) == 0x80)) {}
+      if (size > 0) buffer[length] = 0;
+    } else if (c >= ' ') {
+      char    utf8[4];
+      uint8_t count = input.to_utf8(utf8);
+      if ((c != 0x7F) && (length + count < size)) {
+        memcpy(buffer + length, utf8, count);
+        length += count;
+        buffer[length] = 0;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Print the devices found by the last scan, one per line
+ *
+ * For each device, it shows:
+ * - Transport type (BLE or BT Classic)
+ * - Device address
+ * - RSSI signal strength
+ * - HID usage type
+ * - For BLE: appearance value and address type
+ * - For BT Classic: Class of Device (COD) information and service UUID
+ * - Device name (if available)
+ *
+ * The formatting is done in the calling task, never in the Bluetooth stack callbacks, into a
+ * line buffer on its stack: nothing is allocated.
+ */
+void BTKeyboard::show_scan_results() {
+  visit_scan_results([](const ScanResult &r) {
+    char          line[192];
+    TextFormatter out(line, sizeof(line));
+
+    out.append("  %s", (r.transport == ESP_HID_TRANSPORT_BLE) ? "BLE: " : "BT: ")
+        .bda(r.bda)
+        .append(", RSSI: %d, USAGE: %s", r.rssi, esp_hid_usage_str(r.usage));
+    if (r.transport == ESP_HID_TRANSPORT_BLE) {
+      out.append(", APPEARANCE: 0x%04x, ADDR_TYPE: '%s'", r.ble.appearance,
+                 ble_addr_type_str(r.ble.addr_type));
+    }
+    if (r.transport == ESP_HID_TRANSPORT_BT) {
+      out.append(", COD: %s[", esp_hid_cod_major_str(r.bt.cod.major))
+          .cod_minor(r.bt.cod.minor)
+          .append("] srv 0x%03x, ", (unsigned)r.bt.cod.service)
+          .uuid(r.bt.uuid);
+    }
+    if (!r.name.empty()) out.append(", NAME: %.*s", (int)r.name.size(), r.name.data());
+
+    puts(out.c_str());
+  });
 }
 
 /**
@@ -1386,10 +2379,13 @@ void BTKeyboard::show_bonded_devices(void) {
  * method returns without performing any removal.
  *
  * The removal process uses the ESP32's Bluetooth API to remove each device's
- * bonding information from the persistent storage.
+ * bonding information from the persistent storage. The keyboards remembered for
+ * reconnect_cached_devices() are forgotten too.
  */
 void BTKeyboard::remove_all_bonded_devices() {
 
+  device_cache_.clear();
+
   auto [dev_list, dev_count] = retrieve_bonded_devices();
 
   if (dev_count == 0) {
@@ -22,10 +22,14 @@
 
 #pragma once
 
-#include <forward_list>
+#include <atomic>
 #include <memory>
-#include <string>
+#include <span>
+#include <type_traits>
 
+#include "co_executor.hpp"
+#include "device_cache.hpp"
+#include "device_table.hpp"
 #include "esp_bt.h"
 #include "esp_bt_defs.h"
 #include "esp_bt_main.h"
@@ -37,12 +41,22 @@
 #include "esp_hidh.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
-
-std::ostream &operator<<(std::ostream &os, const esp_bd_addr_t &addr);
-std::ostream &operator<<(std::ostream &os, const esp_bt_uuid_t &uuid);
+#include "key_event.hpp"
+#include "key_repeat.hpp"
+#include "keymap.hpp"
+#include "latency_policy.hpp"
+#include "latency_stats.hpp"
+#include "reconnect_policy.hpp"
+#include "report_decoder.hpp"
+#include "report_pool.hpp"
+#include "report_recording.hpp"
+#include "scan_store.hpp"
+#include "spsc_ring.hpp"
+#include "text_input.hpp"
 
 /**
  * @brief Bluetooth Keyboard class for handling HID keyboard devices
@@ -51,7 +65,9 @@ std::ostream &operator<<(std::ostream &os, const esp_bt_uuid_t &uuid);
  * It supports both classic Bluetooth and BLE (Bluetooth Low Energy) connections.
  *
  * Features:
- * - Device scanning and connection
+ * - Device scanning and connection, up to MAX_DEVICES keyboards at once
+ * - Fast reconnection of known keyboards on boot, and optional background reconnection with
+ *   backoff after a connection loss
  * - Key event handling
  * - Pairing management
  * - Battery level monitoring
@@ -63,15 +79,27 @@ std::ostream &operator<<(std::ostream &os, const esp_bt_uuid_t &uuid);
  * Key components:
  * - Key modifiers handling (Ctrl, Shift, Alt, Meta)
  * - Callback support for pairing and connection events
- * - Queue-based event system for key inputs
+ * - Key press/release events (4-byte KeyEvent records) computed from a 256-bit key state
+ *   per keyboard, merged in one stream tagged with the device index
+ * - Typematic repeat driven by a one-shot timer, with a timing per key class
+ * - Unicode character output with dead keys and Compose sequences
+ * - Lock-free ring buffers for key inputs, with a selectable overflow policy and drop counters
+ * - Buffers sized at compile time and held in the object with BTKeyboardT, taking no heap
+ * - Optional zero-copy delivery of input reports up to 64 bytes through pooled,
+ *   reference-counted handles
+ * - Keyboard reports decoded through a plan compiled from the device report map
+ * - Optional per-stage input latency histograms
+ * - Recording of the raw input reports into a RAM ring, and their replay
+ * - Runtime metrics (reports, drops, links, scans, heap) readable without a lock
  * - Support for both BT and BLE scan results
  *
  * Configuration dependent features:
  * - CONFIG_BT_HID_HOST_ENABLED: Classic Bluetooth HID support
  * - CONFIG_BT_BLE_ENABLED: BLE HID support
+ * - CONFIG_BT_KEYBOARD_LATENCY_STATS: input latency timestamps and histograms
  *
  * @see KeyModifier for supported modifier keys
- * @see KeyInfo for key event data structure
+ * @see KeyEvent for key event data structure
  */
 class BTKeyboard {
 public:
@@ -79,6 +107,12 @@ public:
   typedef void GotConnectionHandler();
   typedef void LostConnectionHandler();
 
+  /// Scan result filter given to devices_scan(). Called from the Bluetooth stack task.
+  typedef bool ScanMatch(const ScanResult &result);
+
+  /// Key event handler given to set_key_handler(). Called from the input path, see there.
+  typedef void KeyHandler(const KeyEvent &event, void *context);
+
   const uint8_t KEY_CAPS_LOCK = 0x39;
 
   enum class KeyModifier : uint8_t {
@@ -97,28 +131,488 @@ public:
   const uint8_t ALT_MASK   = ((uint8_t)KeyModifier::L_ALT) | ((uint8_t)KeyModifier::R_ALT);
   const uint8_t META_MASK  = ((uint8_t)KeyModifier::L_META) | ((uint8_t)KeyModifier::R_META);
 
-  static const uint8_t MAX_KEY_DATA_SIZE = 20;
+  static const uint8_t MAX_KEY_DATA_SIZE = ReportPool::MAX_REPORT_SIZE;
   struct KeyInfo {
     uint8_t     size;
     uint8_t     keys[MAX_KEY_DATA_SIZE];
     KeyModifier modifier;
+    uint8_t     device;
+  };
+
+  /// Keyboards that can be connected at the same time (bt_max_acl_conn of the controller)
+  static const uint8_t MAX_DEVICES = 3;
+
+  /// All the device slots, for set_latency_policy()
+  static const uint8_t ALL_DEVICES = 0xFF;
+
+  /// Connection state of a device slot, see get_device_status()
+  struct DeviceStatus {
+    bool          connected;
+    int8_t        battery_level; ///< -1 until the device reported it
+    esp_bd_addr_t bda;           ///< Last keyboard connected in the slot, zeros if none
+    LinkTiming    link;          ///< Radio timing of the last connection of the slot
+  };
+
+  /// Input counters of a device slot, see get_metrics()
+  struct DeviceMetrics {
+    uint32_t reports;       ///< Input reports received
+    uint32_t bytes;         ///< Bytes of the reports received
+    uint32_t truncated;     ///< Reports longer than ReportPool::MAX_REPORT_SIZE
+    uint32_t decode_errors; ///< Reports the keyboard flagged as in error (ErrorRollOver)
+    int8_t   battery_level; ///< -1 until the device reported it
+  };
+
+  /// Runtime counters of the component, see get_metrics()
+  struct Metrics {
+    DeviceMetrics devices[MAX_DEVICES];
+    uint32_t      events_dropped;  ///< Key events lost by the full event queue
+    uint32_t      reports_dropped; ///< Reports lost by the full report queue or pool
+    uint32_t      connections;
+    uint32_t      disconnections;
+    uint32_t      reconnects;     ///< Keyboards back in their slot after a disconnection
+    uint32_t      scans;          ///< Scans run, by devices_scan() or the supervisor
+    uint32_t      last_scan_ms;   ///< Duration of the last scan
+    uint32_t      advertisements; ///< BLE advertisements and BT inquiry results processed
+    int8_t        last_rssi;      ///< Of the last advertisement or inquiry result, 0 if none
+    uint32_t      heap_bytes;     ///< Heap held by the buffers of the component
+    uint32_t      heap_peak_bytes;
   };
 
-  BTKeyboard() : num_bt_scan_results_(0), num_ble_scan_results_(0), caps_lock_(false) {}
+  static const uint16_t DEFAULT_QUEUE_DEPTH = 32;
+  static const uint16_t MAX_QUEUE_DEPTH     = 4096;
+
+  /// Report buffers that the application can hold through ReportHandle copies at any time,
+  /// besides the one being processed. Beyond that, incoming reports are dropped.
+  static const uint16_t HELD_REPORTS = 8;
+
+  typedef SpscRing<KeyEvent>::Stats QueueStats;
+
+  /**
+   * @param queue_depth Number of key events that can wait for the consumer. Rounded up to the
+   *                    next power of two, up to MAX_QUEUE_DEPTH.
+   * @param report_queue_depth Number of input reports that can wait for wait_for_report() or
+   *                           wait_for_low_event(). 0 (the default) disables the delivery of
+   *                           reports, and the memory it needs.
+   */
+  BTKeyboard(uint16_t queue_depth = DEFAULT_QUEUE_DEPTH, uint16_t report_queue_depth = 0)
+      : scan_match_(nullptr), scan_stopped_(false), connect_lock_(nullptr),
+        reconnect_task_(nullptr), reconnect_enabled_(false),
+        reconnect_policy_(DEFAULT_RECONNECT_POLICY), link_lock_(nullptr),
+        queue_depth_(queue_depth), report_queue_depth_(report_queue_depth),
+        handler_lock_(nullptr), repeat_timer_(nullptr), repeat_served_(0), repeat_due_us_(0),
+        caps_lock_(false), keymap_(&KEYMAP_US), pending_text_{0, NamedKey::NONE},
+        compose_key_(0), record_lock_(nullptr) {
+    for (uint8_t i = 0; i < (uint8_t)KeyClass::NONE; i++) key_repeat_[i] = DEFAULT_KEY_REPEAT;
+    key_repeat_[(uint8_t)KeyClass::NONE] = KeyRepeatTiming{.delay_ms = 0, .period_ms = 0};
+  }
 
   bool setup(PairingHandler        *pairing_handler         = nullptr,
              GotConnectionHandler  *got_connection_handler  = nullptr,
              LostConnectionHandler *lost_connection_handler = nullptr);
-  void devices_scan(int seconds_wait_time = 5);
+  void devices_scan(int seconds_wait_time = 5, ScanMatch *match = nullptr);
+
+  /// The default devices_scan() filter: BLE keyboard appearance, or BT peripheral of the
+  /// keyboard minor class
+  static bool is_keyboard(const ScanResult &result);
+
+  /**
+   * @brief Call `visitor(const ScanResult &)` for each HID device found by the last scan
+   *
+   * The last scan may be a devices_scan() or a background scan of the reconnection
+   * supervisor. Results are given in arrival order; their names are only valid during the
+   * call. Scans wait for the visit to end: the visitor must not call devices_scan() nor
+   * reconnect_cached_devices().
+   */
+  template <typename Visitor> void visit_scan_results(Visitor visitor) {
+    xSemaphoreTake(connect_lock_, portMAX_DELAY);
+    for (const ScanResult &result : scan_store_) visitor(result);
+    xSemaphoreGive(connect_lock_);
+  }
+
+  /// Print the devices found by the last scan, from the calling task
+  void show_scan_results();
+
+  /**
+   * @brief Reconnect the keyboards connected before the last reboot, without a scan
+   *
+   * The last keyboard connected in each device slot is kept in NVS. Each one not connected yet
+   * is opened directly, in slot order, which takes a fraction of the time of a discovery scan
+   * for a bonded keyboard that is awake. The call then waits, up to OPEN_TIMEOUT_MS, for the
+   * esp_hidh event task to report the outcome of each open: a BLE open blocks until connected,
+   * a BT Classic one returns at once.
+   *
+   * @return true if at least one keyboard is connected on return. The application calls
+   *         devices_scan() otherwise.
+   */
+  bool reconnect_cached_devices();
+
+  /**
+   * @brief Bring back the keyboards that disconnect, from a background task
+   *
+   * The keyboards remembered for reconnect_cached_devices() that are not connected are tried
+   * again and again, following `policy`: after a disconnection, the supervisor waits, then runs
+   * a short BLE scan for the missing BLE keyboards and connects the ones seen, and pages the
+   * missing BT Classic keyboards. The delay grows after each attempt that leaves a keyboard
+   * missing, and restarts from its initial value on the next disconnection. The task sleeps
+   * while all known keyboards are connected.
+   *
+   * Can be called again to change the policy. devices_scan() and reconnect_cached_devices()
+   * wait for an attempt in progress to end.
+   *
+   * @return false if the task could not be created
+   */
+  bool start_auto_reconnect(const ReconnectPolicy &policy = DEFAULT_RECONNECT_POLICY);
+
+  /// Stop the reconnection attempts, after the one in progress if any
+  void stop_auto_reconnect();
+
+  /// Counters of the reconnection supervisor since setup (or last reset). Disconnections and
+  /// recoveries are counted even when it is stopped.
+  ReconnectStats get_reconnect_stats() const;
+  void           reset_reconnect_stats();
+
+  /**
+   * @brief Snapshot of the runtime counters, since setup (or last reset)
+   *
+   * Lock-free: a few relaxed loads, cheap enough to poll every second from any task. The
+   * counters are read one by one, so a snapshot taken under input may mix values a report
+   * apart. Replayed reports are not received, but their decoding is counted.
+   */
+  Metrics get_metrics() const;
+
+  /// Restart the counters from 0. The battery levels, last RSSI and scan duration, and the heap
+  /// in use are kept; the heap peak restarts from the heap in use.
+  void reset_metrics();
+
+  /// Battery level of the first keyboard connected, -1 if unknown
+  int8_t get_battery_level() const;
+
+  /// true if at least one keyboard is connected
+  inline bool is_connected() const { return get_connected_count() > 0; }
+
+  uint8_t get_connected_count() const;
+
+  /**
+   * @brief State of a device slot
+   *
+   * A keyboard keeps its slot, and thus the `device` index of its events, for as long as it is
+   * connected. A keyboard reconnecting gets its previous slot back if it is still free.
+   *
+   * @param device 0 to MAX_DEVICES - 1
+   */
+  DeviceStatus get_device_status(uint8_t device) const;
+
+  /**
+   * @brief Select the radio timing requested from the keyboards of a device slot
+   *
+   * The timing is requested each time a keyboard connects in the slot, and at once from the
+   * keyboard connected if any. DeviceStatus::link tells the timing in effect. See
+   * LatencyPolicy for the presets and how keyboards refusing a request are handled.
+   *
+   * @param policy LATENCY_POLICY_KEYBOARD (the default) requests nothing
+   * @param device 0 to MAX_DEVICES - 1, or ALL_DEVICES
+   */
+  void          set_latency_policy(const LatencyPolicy &policy, uint8_t device = ALL_DEVICES);
+  LatencyPolicy get_latency_policy(uint8_t device) const;
+
+  /**
+   * @brief Retrieve the next key press, repeat or release, of any keyboard
+   *
+   * @return false on timeout
+   */
+  inline bool wait_for_key_event(KeyEvent &event, TickType_t duration = portMAX_DELAY) {
+    if (!event_ring_.wait_pop(event, duration)) return false;
+    record_latency(event);
+    return true;
+  }
+
+  /**
+   * @brief Retrieve all the key events ready, in one call
+   *
+   * Waits up to `timeout` for a first event. With a `min_batch` above 1, then waits up to
+   * `max_batch_wait` more for that many events to be queued, without waking up for each one:
+   * a consumer trades that bounded latency for fewer wakeups under heavy input.
+   *
+   * @param events Receives the events, oldest first
+   * @param timeout Maximum time to wait for a first event, in ticks
+   * @param min_batch Number of events worth waiting for, capped to the span and queue sizes
+   * @param max_batch_wait Maximum additional time to wait for min_batch events, in ticks
+   *
+   * @return Number of events retrieved, 0 on timeout
+   */
+  size_t drain_events(std::span<KeyEvent> events, TickType_t timeout = portMAX_DELAY,
+                      size_t min_batch = 1, TickType_t max_batch_wait = 0);
+
+  bool wait_for_low_event(KeyInfo &inf, TickType_t duration = portMAX_DELAY);
+
+  /**
+   * @brief Retrieve the next keyboard input report without copying it
+   *
+   * Reports are in the boot keyboard layout (modifier byte, reserved byte, key usages) whatever
+   * the device report map describes. ReportHandle::device() tells which keyboard sent it.
+   * Reports that carry no key are not delivered. The report stays in its pool buffer until
+   * `report` and all its copies are reset or destroyed. Keeping more than HELD_REPORTS reports
+   * alive starves the pool.
+   *
+   * @note Needs a report_queue_depth given to the constructor.
+   *
+   * @return false on timeout, or if the delivery of reports is disabled
+   */
+  bool wait_for_report(ReportHandle &report, TickType_t duration = portMAX_DELAY);
+
+  /**
+   * @brief Select what happens to key events and reports arriving while their queue is full
+   *
+   * Can be changed at any time. The default is OverflowPolicy::DROP_OLDEST, so the most recent
+   * keyboard state is never lost.
+   *
+   * @note Dropping key events may hide the release of a key from the application. The key
+   *       repeat is not affected: it is tracked before the events are queued.
+   */
+  inline void set_overflow_policy(OverflowPolicy policy) {
+    event_ring_.set_policy(policy);
+    report_ring_.set_policy(policy);
+  }
+
+  /**
+   * @brief Receive the key events as soon as they are decoded, without the event queue
+   *
+   * The handler is called directly by the task that produces each event: the esp_hidh event
+   * task for presses and releases, right after the report is decoded, and the esp_timer task
+   * for repeats. Neither task waits for the other: a repeat may be handed over while the
+   * handler runs for a press or release, and the last repeat of a key may overlap its release.
+   * A handler keeping state between calls must allow for it. As there is no scheduler hop, the
+   * time from the report to the handler is the decoding time alone.
+   *
+   * The handler runs in the Bluetooth input path and holds the next reports (or repeats) back
+   * for as long as it runs. It must return within a few tens of microseconds and never block:
+   * no waiting on a semaphore, queue or mutex, no delay, no printf or ESP_LOG (the console
+   * output blocks), no heap allocation, and no call to any BTKeyboard method. Longer work is
+   * handed over to an application task, through a task notification for example. `event` is
+   * only valid during the call.
+   *
+   * While a handler is set, the events are not queued unless `queue_too` is true:
+   * wait_for_key_event(), drain_events(), wait_for_ascii_char() and wait_for_codepoint()
+   * receive nothing. Reports (wait_for_report()) are not affected.
+   *
+   * Can be called at any time, including to change the handler or its context. Returns once
+   * the calls of the previous handler in progress are over: it is not called anymore after.
+   *
+   * @param handler nullptr to go back to queueing the events
+   * @param context Given back to the handler with each event
+   * @param queue_too Also queue the events
+   */
+  void set_key_handler(KeyHandler *handler, void *context = nullptr, bool queue_too = false);
+
+  /// Waiter of next_key()
+  struct NextKey : CoWaiter {
+    BTKeyboard &kb;
+    KeyEvent    event;
+
+    NextKey(BTKeyboard &kb) : kb(kb) {}
+    bool ready() override {
+      if (!kb.event_ring_.pop(event)) return false;
+      kb.record_latency(event);
+      return true;
+    }
+    void     watch(TaskHandle_t task) { kb.event_ring_.watch(task); }
+    KeyEvent result() const { return event; }
+  };
+
+  /// Waiter of connected() and disconnected()
+  struct ConnectionState : CoWaiter {
+    BTKeyboard &kb;
+    bool        connected;
+
+    ConnectionState(BTKeyboard &kb, bool connected) : kb(kb), connected(connected) {}
+    bool ready() override { return kb.is_connected() == connected; }
+    void watch(TaskHandle_t task) { kb.state_waiter_.store(task); }
+  };
+
+  /// Waiter of next_line()
+  struct NextLine : CoWaiter {
+    BTKeyboard &kb;
+    char       *buffer;
+    size_t      size;
+    size_t      length;
+
+    NextLine(BTKeyboard &kb, char *buffer, size_t size)
+        : kb(kb), buffer(buffer), size(size), length(0) {
+      if (size > 0) buffer[0] = 0;
+    }
+    bool   ready() override;
+    void   watch(TaskHandle_t task) { kb.event_ring_.watch(task); }
+    size_t result() const { return length; }
+  };
+
+  /**
+   * @brief `co_await next_key()` in a CoTask: the next key press, repeat or release, of any
+   *        keyboard
+   *
+   * The coroutine equivalent of wait_for_key_event(): the CoExecutor task sleeps until an
+   * event is queued, running the other coroutines meanwhile. With several coroutines waiting
+   * for keys, each event goes to one of them.
+   */
+  inline CoAwait<NextKey> next_key() { return CoAwait<NextKey>(*this); }
+
+  /// `co_await connected()` in a CoTask: resumes once at least one keyboard is connected
+  inline CoAwait<ConnectionState> connected() { return CoAwait<ConnectionState>(*this, true); }
+
+  /// `co_await disconnected()` in a CoTask: resumes once no keyboard is connected
+  inline CoAwait<ConnectionState> disconnected() {
+    return CoAwait<ConnectionState>(*this, false);
+  }
+
+  /**
+   * @brief `co_await next_line(buffer, size)` in a CoTask: a line of text typed on the
+   *        keyboards, ended by Enter
+   *
+   * Characters come from wait_for_codepoint() (keymap, dead keys, Compose) and are stored in
+   * UTF-8. Backspace removes the last character. Named keys and other control characters are
+   * ignored, as are the characters that would not fit. The key events are taken from the
+   * queue read by next_key() too.
+   *
+   * @param buffer Receives the line without the Enter, NUL terminated. Must stay valid until
+   *               the co_await ends.
+   * @param size Size of buffer
+   * @return The length of the line, in bytes
+   */
+  inline CoAwait<NextLine> next_line(char *buffer, size_t size) {
+    return CoAwait<NextLine>(*this, buffer, size);
+  }
+
+  /// Number of queued, rejected, evicted and coalesced key events since setup (or last reset).
+  inline QueueStats get_queue_stats() const { return event_ring_.get_stats(); }
+
+  /// Same as get_queue_stats() for the input reports queue.
+  inline SpscRing<ReportPool::Index>::Stats get_report_queue_stats() const {
+    return report_ring_.get_stats();
+  }
+
+  inline void reset_queue_stats() {
+    event_ring_.reset_stats();
+    report_ring_.reset_stats();
+    report_pool_.reset_exhausted_count();
+  }
+
+  /// Number of reports dropped because all report buffers were in use.
+  inline uint32_t get_pool_exhausted_count() const { return report_pool_.get_exhausted_count(); }
+
+  /**
+   * @brief Select the typematic repeat timing of a class of keys
+   *
+   * While the last key pressed is held, KeyEvent::Kind::REPEAT events are queued after
+   * `timing.delay_ms`, then every `timing.period_ms`. Can be changed at any time, and applies
+   * from the next key press. KeyClass::NONE keys never repeat.
+   *
+   * @param timing A period_ms of 0 disables the repeat of the class
+   */
+  inline void set_key_repeat(KeyClass key_class, KeyRepeatTiming timing) {
+    if (key_class < KeyClass::NONE) key_repeat_[(uint8_t)key_class] = timing;
+  }
+  /// Repeat timing of a class of keys, disabled (period_ms 0) for KeyClass::NONE and above
+  inline KeyRepeatTiming get_key_repeat(KeyClass key_class) const {
+    if (key_class >= KeyClass::COUNT) return KeyRepeatTiming{.delay_ms = 0, .period_ms = 0};
+    return key_repeat_[(uint8_t)key_class];
+  }
+
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+  /// Stages of the input path whose latency is measured, for each key event
+  enum class LatencyStage : uint8_t {
+    DECODE, ///< esp_hidh callback entry to the event pushed to the ring (logging, decoding)
+    QUEUE,  ///< Event pushed to the ring to its retrieval by the application
+    TOTAL,  ///< esp_hidh callback entry to the retrieval of the event by the application
+    COUNT
+  };
 
-  inline uint8_t get_battery_level() { return battery_level_; }
-  inline bool    is_connected() { return connected_; }
-  inline bool    wait_for_low_event(KeyInfo &inf, TickType_t duration = portMAX_DELAY) {
-    return xQueueReceive(event_queue_, &inf, duration);
+  /// Latency histogram of a stage since setup (or last reset). Never blocks.
+  inline LatencyHistogram::Snapshot get_latency_stats(LatencyStage stage) const {
+    return latency_[(uint8_t)stage].snapshot();
+  }
+  inline void reset_latency_stats() {
+    for (auto &histogram : latency_) histogram.reset();
   }
+#endif
+
+  /// Default size of the recording ring, about 600 boot keyboard reports
+  static const size_t DEFAULT_RECORDING_SIZE = 8192;
+
+  /**
+   * @brief Record the raw input reports of all the keyboards, to reproduce an issue later on
+   *
+   * From now on, each ESP_HIDH_INPUT_EVENT report is appended to a ring of `size` bytes,
+   * allocated here, with its reception time, device index, map index and report ID (see
+   * RecordingFormat). Once full, the oldest reports are dropped. The report maps of each
+   * keyboard are captured with its first report. Recording again restarts from scratch.
+   *
+   * @return false if the ring could not be allocated
+   */
+  bool start_recording(size_t size = DEFAULT_RECORDING_SIZE);
+
+  /// Stop appending reports. The recording is kept until the next start_recording().
+  void stop_recording();
+
+  /// Size of the recording, for get_recording()
+  size_t get_recording_size();
+
+  /**
+   * @brief Copy the recording: report maps, then the reports, oldest first
+   *
+   * @return Bytes copied, 0 if there is no recording or `size` is below get_recording_size()
+   */
+  size_t get_recording(uint8_t *buffer, size_t size);
+
+  /**
+   * @brief Print the recording in hexadecimal, from the calling task
+   *
+   * A comment line gives the number of reports kept and dropped, followed by lines of 32
+   * bytes. The output, saved to a file, is read back by the host benchmarks, and by `xxd -r -p`
+   * once the comment line is removed.
+   */
+  void dump_recording();
+
+  /**
+   * @brief Feed a recording back to the decoder, on the calling task, as the keyboards sent it
+   *
+   * The reports go through the same decoding as the live ones, with the report maps of the
+   * recording, and produce their key events, repeats and reports tagged with the recorded
+   * device index. The decoding state is the replay's own: the keys still down at the end are
+   * released. Live input reports are ignored until the replay returns. The reports are spaced
+   * by sleeping, then by a busy wait of at most 1 ms: with a tick period longer than that, they
+   * may come up to one tick early.
+   *
+   * @param recording As given by get_recording(), or loaded from a dump_recording() output
+   * @param speed 1 for the original timing, N to replay N times faster, 0 for no delay at all
+   *
+   * @return false if the recording is not in the RecordingFormat, or ends with a truncated
+   *         report. The reports before it are replayed.
+   */
+  bool replay_recording(const uint8_t *recording, size_t size, uint16_t speed = 1);
+
+  /**
+   * @brief Select the layout used by wait_for_ascii_char()
+   *
+   * @param keymap KEYMAP_US (default), KEYMAP_AZERTY, KEYMAP_QWERTZ, KEYMAP_DVORAK or a
+   *               Keymap generated by the application with make_keymap()
+   */
+  inline void set_keymap(const Keymap &keymap) { keymap_ = &keymap; }
 
   char        wait_for_ascii_char(bool forever = true);
   inline char get_ascii_char() { return wait_for_ascii_char(false); }
+
+  TextInput        wait_for_codepoint(bool forever = true);
+  inline TextInput get_codepoint() { return wait_for_codepoint(false); }
+
+  /**
+   * @brief Select the key starting Compose sequences in wait_for_codepoint()
+   *
+   * The Compose key followed by ` ' ^ ~ or " acts as the matching dead key, so Compose ' e
+   * produces é on any layout.
+   *
+   * @param usage HID Keyboard usage of the key, for example 0x65 (Application) or 0xE7 (Right
+   *              GUI). 0 (the default) disables Compose sequences.
+   */
+  inline void set_compose_key(uint8_t usage) { compose_key_ = usage; }
   void        show_bonded_devices();
   void        remove_all_bonded_devices();
 
@@ -144,53 +638,188 @@ private:
 
   static SemaphoreHandle_t bt_hidh_cb_semaphore_;
   static SemaphoreHandle_t ble_hidh_cb_semaphore_;
+  static StaticSemaphore_t bt_hidh_cb_semaphore_buffer_;
+  static StaticSemaphore_t ble_hidh_cb_semaphore_buffer_;
+
+  // Scan results kept per scan, whatever the number of advertisers around
+  static const uint16_t MAX_SCAN_RESULTS = 64;
+  static const uint16_t SCAN_NAMES_SIZE  = 2048;
+
+  // Longest wait of reconnect_cached_devices() for the outcome of its opens. A BT Classic page
+  // of a keyboard that does not answer fails after 5.12 s.
+  static const uint32_t OPEN_TIMEOUT_MS = 6000;
+
+  // Longest busy wait of replay_recording() ahead of a report, in microseconds
+  static const int64_t REPLAY_SPIN_US = 1000;
+
+  ScanStore  scan_store_;
+  ScanMatch *scan_match_;   // Filter of the running scan, nullptr to wait for its end
+  bool       scan_stopped_; // The filter matched: the BLE scan and BT inquiry were stopped
+
+  // Decoding state of a connected keyboard. Only touched by the esp_hidh event task, except
+  // for the atomics read by get_device_status().
+  struct Device {
+    esp_hidh_dev_t     *dev{nullptr}; // nullptr while the slot is free
+    DecodePlan          decode_plan;
+    KeyEventEngine      key_engine;
+    esp_bd_addr_t       bda{};
+    int64_t             lost_us{0}; // esp_timer time of the disconnection, 0 if none
+    esp_hid_transport_t transport{ESP_HID_TRANSPORT_BLE};
+    std::atomic<bool>   connected{false};
+    std::atomic<int8_t> battery_level{-1};
+
+    // Link timing, updated by the Bluetooth stack task (GAP events)
+    std::atomic<uint32_t> interval_us{0};
+    std::atomic<uint16_t> latency{0};
+    std::atomic<uint16_t> timeout_ms{0};
+    std::atomic<uint8_t>  link_requests{0};
+    std::atomic<bool>     sniff{false};
+  };
+
+  Device                   devices_[MAX_DEVICES];
+  DeviceTable<MAX_DEVICES> device_table_; // esp_hidh_dev_t * to index in devices_
+  DeviceCache<MAX_DEVICES> device_cache_; // Last keyboard of each slot, in NVS
+
+  // Serializes scans and connection attempts: devices_scan(), reconnect_cached_devices() and
+  // the reconnection supervisor. Also guards reconnect_policy_.
+  SemaphoreHandle_t connect_lock_;
+  TaskHandle_t      reconnect_task_; // Created once by start_auto_reconnect(), never deleted
+  std::atomic<bool> reconnect_enabled_;
+  ReconnectPolicy   reconnect_policy_;
+
+  // OPEN events of a device handled by the esp_hidh event task, each one also giving
+  // open_done_: reconnect_cached_devices() waits for those of its opens
+  std::atomic<uint8_t> opens_done_{0};
+  SemaphoreHandle_t    open_done_{nullptr};
+
+  struct {
+    std::atomic<uint32_t> disconnections{0};
+    std::atomic<uint32_t> scans{0};
+    std::atomic<uint32_t> attempts{0};
+    std::atomic<uint32_t> recoveries{0};
+    std::atomic<uint32_t> last_recovery_ms{0};
+    std::atomic<uint32_t> max_recovery_ms{0};
+    std::atomic<uint32_t> total_recovery_ms{0};
+  } reconnect_stats_;
+
+  // Counters of get_metrics(), with relaxed ordering: they order nothing else
+  struct DeviceCounters {
+    std::atomic<uint32_t> reports{0};
+    std::atomic<uint32_t> bytes{0};
+    std::atomic<uint32_t> truncated{0};
+    std::atomic<uint32_t> decode_errors{0};
+  };
 
-  struct esp_hid_scan_result_t {
-    esp_bd_addr_t       bda;
-    std::string         name;
-    int8_t              rssi;
-    esp_hid_usage_t     usage;
-    esp_hid_transport_t transport; // BT, BLE or USB
-
-    union {
-      struct {
-        esp_bt_cod_t  cod;
-        esp_bt_uuid_t uuid;
-      } bt;
-      struct {
-        esp_ble_addr_type_t addr_type;
-        uint16_t            appearance;
-      } ble;
-    };
+  struct {
+    DeviceCounters        devices[MAX_DEVICES];
+    std::atomic<uint32_t> events_dropped{0};
+    std::atomic<uint32_t> reports_dropped{0};
+    std::atomic<uint32_t> connections{0};
+    std::atomic<uint32_t> disconnections{0};
+    std::atomic<uint32_t> reconnects{0};
+    std::atomic<uint32_t> scans{0};
+    std::atomic<uint32_t> last_scan_ms{0};
+    std::atomic<uint32_t> advertisements{0};
+    std::atomic<int8_t>   last_rssi{0};
+    std::atomic<uint32_t> heap_bytes{0};
+    std::atomic<uint32_t> heap_peak_bytes{0};
+  } metrics_;
+
+  // Guards latency_policy_, read by the esp_hidh event task and the Bluetooth stack task
+  SemaphoreHandle_t link_lock_;
+  LatencyPolicy     latency_policy_[MAX_DEVICES] = {};
+
+  uint16_t                    queue_depth_;
+  std::unique_ptr<KeyEvent[]> event_storage_;
+  SpscRing<KeyEvent>          event_ring_;
+
+  uint16_t                             report_queue_depth_;
+  ReportPool                           report_pool_;
+  std::unique_ptr<ReportPool::Index[]> report_storage_;
+  SpscRing<ReportPool::Index>          report_ring_;
+
+  // The key handler is called by the esp_hidh event task and the repeat timer, without a
+  // lock: each call counts itself in key_handler_calls_ for the slot of key_handlers_ it uses,
+  // and set_key_handler() fills the other slot, switches to it and waits for the calls of the
+  // previous one to end
+  struct KeyHandlerSlot {
+    KeyHandler *handler;
+    void       *context;
+    bool        queue_too;
   };
+  SemaphoreHandle_t    handler_lock_; // Serializes set_key_handler() calls
+  KeyHandlerSlot       key_handlers_[2] = {};
+  std::atomic<uint8_t> key_handler_index_{0};
+  std::atomic<uint8_t> key_handler_calls_[2] = {};
+
+  // Key being repeated, usage 0 if none. Written by the input path only, with a new `armed`
+  // count each time, so that the repeat timer tells a stale expiry from a current one.
+  struct RepeatKey {
+    uint8_t  usage;
+    uint8_t  device;
+    uint16_t armed;
+
+    bool operator==(const RepeatKey &) const = default;
+  };
+
+  // Input path side of the repeat, read by the repeat timer
+  std::atomic<RepeatKey> repeat_key_{RepeatKey{}};
+  std::atomic<uint32_t>  repeat_first_us_{0};  // esp_timer time of the first repeat, low bits
+  std::atomic<uint16_t>  repeat_period_ms_{0};
+  std::atomic<uint8_t>   repeat_modifiers_{0}; // Modifiers of the last event pushed
 
-  typedef std::forward_list<std::unique_ptr<esp_hid_scan_result_t>> ScanResult;
+  // Repeat timer side, only touched by its callback
+  esp_timer_handle_t repeat_timer_;
+  uint16_t           repeat_served_; // `armed` count of the key repeated
+  int64_t            repeat_due_us_; // esp_timer time of the pending expiry
 
-  ScanResult bt_scan_results_;
-  ScanResult ble_scan_results_;
+  std::atomic<KeyRepeatTiming> key_repeat_[(uint8_t)KeyClass::COUNT];
 
-  size_t num_bt_scan_results_;
-  size_t num_ble_scan_results_;
+  bool caps_lock_;
 
-  QueueHandle_t event_queue_;
-  int8_t        battery_level_;
-  bool          key_avail_[MAX_KEY_DATA_SIZE];
-  char          last_ch_;
-  TickType_t    repeat_period_;
-  bool          caps_lock_;
+  std::atomic<TaskHandle_t> state_waiter_{nullptr}; // CoExecutor waiting for connected()
+
+  const Keymap *keymap_;
+  TextComposer  composer_;
+  TextInput     pending_text_; // Second input of the last composition, returned next
+  uint8_t       compose_key_;
+
+  // Guards recorder_, fed by the esp_hidh event task while recording_ is set
+  SemaphoreHandle_t record_lock_;
+  std::atomic<bool> recording_{false};
+  ReportRecorder    recorder_;
+
+  // A replay runs on the task of the application, alone: the esp_hidh event task stops
+  // decoding while replaying_ is set, and the replay waits for input_busy_ to clear first
+  std::atomic<bool> replaying_{false};
+  std::atomic<bool> input_busy_{false};
+
+  // Memory of the mutexes and semaphore above, so that they take nothing from the heap
+  StaticSemaphore_t connect_lock_buffer_;
+  StaticSemaphore_t open_done_buffer_;
+  StaticSemaphore_t link_lock_buffer_;
+  StaticSemaphore_t handler_lock_buffer_;
+  StaticSemaphore_t record_lock_buffer_;
+
+  // The rings, pool and scan store were given their memory by BTKeyboardT
+  bool static_storage_{false};
+
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+  uint32_t         input_received_us_; // Entry in hidh_callback() of the report being decoded
+  LatencyHistogram latency_[(uint8_t)LatencyStage::COUNT];
+#endif
 
-  static const char *gap_bt_prop_type_names_[];
   static const char *ble_gap_evt_names_[];
   static const char *bt_gap_evt_names_[];
   static const char *ble_addr_type_names_[];
 
-  static const char shift_trans_dict_[];
+
+  template <uint16_t QueueDepth, uint16_t ReportQueueDepth> friend class BTKeyboardT;
 
   static BTKeyboard            *bt_keyboard_;
   static PairingHandler        *pairing_handler_;
   static GotConnectionHandler  *got_connection_handler_;
   static LostConnectionHandler *lost_connection_handler_;
-  static bool                   connected_;
 
   static void hidh_callback(void *handler_args, esp_event_base_t base, int32_t id,
                             void *event_data);
@@ -208,23 +837,22 @@ private:
   void handle_bt_device_result(esp_bt_gap_cb_param_t *param);
   void handle_ble_device_result(esp_ble_gap_cb_param_t *param);
 
-  esp_hid_scan_result_t *find_scan_result(esp_bd_addr_t bda, ScanResult &results);
-
   void add_bt_scan_result(esp_bd_addr_t bda, esp_bt_cod_t *cod, esp_bt_uuid_t *uuid, uint8_t *name,
                           uint8_t name_len, int rssi);
 
   void add_ble_scan_result(esp_bd_addr_t bda, esp_ble_addr_type_t addr_type, uint16_t appearance,
                            uint8_t *name, uint8_t name_len, int rssi);
 
-  void print_uuid(esp_bt_uuid_t *uuid);
-
+  bool      allocate_buffers();
   esp_err_t start_ble_scan(uint32_t seconds);
   esp_err_t start_bt_scan(uint32_t seconds);
-  esp_err_t esp_hid_scan(uint32_t seconds, size_t *num_results, ScanResult &results);
+  esp_err_t esp_hid_scan(uint32_t seconds, ScanMatch *match, bool with_bt = true);
+  void      check_scan_match(const ScanResult *result);
 
-  inline void set_battery_level(uint8_t level) { battery_level_ = level; }
   inline void set_connected(bool connected) {
-    connected_ = connected;
+    TaskHandle_t waiter = state_waiter_.load();
+    if (waiter != nullptr) xTaskNotifyGive(waiter);
+
     if (connected) {
       if (got_connection_handler_ != nullptr) {
         (*got_connection_handler_)();
@@ -234,5 +862,94 @@ private:
     }
   }
 
-  void push_key(uint8_t *keys, uint8_t size);
+  inline void record_latency(const KeyEvent &event) {
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+    uint32_t now = latency_timestamp();
+    latency_[(uint8_t)LatencyStage::QUEUE].record(now - event.queued_us);
+    latency_[(uint8_t)LatencyStage::TOTAL].record(now - event.received_us);
+#endif
+  }
+
+  static void repeat_timer_callback(void *arg);
+
+  bool next_key_code(KeyEvent &event, uint8_t &code, bool forever);
+  Device *open_device(esp_hidh_dev_t *dev);
+  void    close_device(esp_hidh_dev_t *dev);
+  void    cache_device(uint8_t index, esp_hidh_dev_t *dev);
+
+  static void reconnect_task(void *arg);
+  static bool is_lost_device(const ScanResult &result);
+  bool        has_lost_devices() const;
+  void        reconnect_lost_devices(uint8_t scan_seconds);
+  uint8_t     find_connected(const uint8_t *bda) const;
+  void        request_link_timing(uint8_t index);
+  void        link_timing_updated(uint8_t index, bool success);
+  static bool timing_in_policy(esp_hid_transport_t transport, uint32_t interval_us,
+                               const LatencyPolicy &policy);
+  void    compile_decode_plan(Device &device);
+  void    push_event(const KeyEvent &event);
+  void    enqueue_event(const KeyEvent &event, uint32_t received_us);
+  bool    call_key_handler(const KeyEvent &event);
+  void    set_repeat_key(const RepeatKey &key);
+  void    push_key(Device &device, uint8_t index, const uint8_t *keys, size_t size,
+                   uint8_t map_index, uint8_t report_id);
+  void    release_keys(Device &device, uint8_t index);
+  void    push_report(const Device &device, uint8_t device_index,
+                      const KeyboardReportLayout &layout, const uint8_t *keys, size_t size,
+                      uint8_t report_id);
+  void    record_report(uint8_t index, esp_hidh_dev_t *dev, const uint8_t *data, size_t size,
+                        uint8_t map_index, uint8_t report_id);
+
+  inline uint8_t index_of(const Device &device) const { return &device - devices_; }
+
+  static inline void count(std::atomic<uint32_t> &counter, uint32_t amount = 1) {
+    counter.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  void account_heap(ptrdiff_t bytes);
+};
+
+/**
+ * @brief BTKeyboard whose buffers are sized at compile time and held in the object
+ *
+ * The key event ring, the report pool and ring and the scan store are members instead of being
+ * allocated by setup(): defined as a global or static object, the memory of the component is
+ * known at link time and setup() takes nothing from the heap for it. The Bluetooth stack,
+ * esp_timer, the reconnection task, the recording and the coroutine frames still use the heap.
+ *
+ * @tparam QueueDepth Key events that can wait for the consumer, a power of two
+ * @tparam ReportQueueDepth Input reports that can wait for wait_for_report(), a power of two.
+ *                          0 (the default) disables the delivery of reports and its memory.
+ */
+template <uint16_t QueueDepth = BTKeyboard::DEFAULT_QUEUE_DEPTH, uint16_t ReportQueueDepth = 0>
+class BTKeyboardT : public BTKeyboard {
+  static_assert((QueueDepth > 0) && ((QueueDepth & (QueueDepth - 1)) == 0) &&
+                    (QueueDepth <= MAX_QUEUE_DEPTH),
+                "QueueDepth must be a power of two up to MAX_QUEUE_DEPTH");
+  static_assert(((ReportQueueDepth & (ReportQueueDepth - 1)) == 0) &&
+                    (ReportQueueDepth <= MAX_QUEUE_DEPTH),
+                "ReportQueueDepth must be 0 or a power of two up to MAX_QUEUE_DEPTH");
+
+public:
+  BTKeyboardT() : BTKeyboard(QueueDepth, ReportQueueDepth) {
+    event_ring_.init(events_, QueueDepth);
+    scan_store_.init(scan_storage_);
+    if constexpr (ReportQueueDepth > 0) {
+      report_pool_.init(reports_.pool);
+      report_ring_.init(reports_.ring, ReportQueueDepth);
+    }
+    static_storage_ = true;
+  }
+
+private:
+  // Ring entries, the coalescing slot, the report being filled and the ones held by the app
+  struct ReportStorage {
+    ReportPool::Storage<ReportQueueDepth + 2 + HELD_REPORTS> pool;
+    ReportPool::Index                                        ring[ReportQueueDepth];
+  };
+  struct NoReportStorage {};
+
+  KeyEvent                                              events_[QueueDepth];
+  ScanStore::Storage<MAX_SCAN_RESULTS, SCAN_NAMES_SIZE> scan_storage_;
+  std::conditional_t<(ReportQueueDepth > 0), ReportStorage, NoReportStorage> reports_;
 };
@@ -0,0 +1,192 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <cstdlib>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+class CoExecutor;
+
+/**
+ * @brief Something a coroutine waits for, checked by its CoExecutor
+ *
+ * The source of the event must give a task notification to the executor task (see
+ * CoExecutor::task()) when it may have become ready: the executor sleeps in between.
+ */
+struct CoWaiter {
+  /// Called on the executor task. True when the coroutine can be resumed.
+  virtual bool ready() = 0;
+
+  /// Ticks until ready() must be checked again without a notification, portMAX_DELAY if none
+  virtual TickType_t ticks_left() const { return portMAX_DELAY; }
+};
+
+/**
+ * @brief A coroutine run by a CoExecutor
+ *
+ * A function returning CoTask and using co_await is a coroutine. Calling it allocates its frame
+ * (its locals and the state of the awaits) on the heap and returns a CoTask that does not run
+ * until given to CoExecutor::spawn(). CoTasks can't be awaited: a coroutine starts others with
+ * spawn().
+ */
+class CoTask {
+public:
+  struct promise_type {
+    CoExecutor *executor = nullptr;
+    CoWaiter   *waiting  = nullptr; // What the suspended coroutine waits for
+
+    CoTask              get_return_object() { return CoTask(Handle::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; } // Destroyed by the executor
+    void                return_void() {}
+    void                unhandled_exception() { abort(); }
+  };
+
+  typedef std::coroutine_handle<promise_type> Handle;
+
+  CoTask(CoTask &&other) : handle_(other.handle_) { other.handle_ = nullptr; }
+  CoTask(const CoTask &)            = delete;
+  CoTask &operator=(const CoTask &) = delete;
+  ~CoTask() {
+    if (handle_) handle_.destroy();
+  }
+
+private:
+  friend class CoExecutor;
+
+  Handle handle_;
+
+  explicit CoTask(Handle handle) : handle_(handle) {}
+};
+
+/**
+ * @brief Awaitable suspending a CoTask until `Waiter::ready()`
+ *
+ * `Waiter` derives from CoWaiter. It may also define `void watch(TaskHandle_t executor)`,
+ * called before the coroutine is suspended, to register the executor task with the source of
+ * the event, and `result()`, the value of the co_await expression.
+ */
+template <typename Waiter> struct CoAwait : Waiter {
+  using Waiter::Waiter;
+
+  bool await_ready() { return this->ready(); }
+  void await_suspend(CoTask::Handle handle);
+  auto await_resume() {
+    if constexpr (requires(Waiter w) { w.result(); }) {
+      return this->result();
+    }
+  }
+};
+
+/**
+ * @brief Runs many coroutines on a single FreeRTOS task
+ *
+ * Each coroutine runs until it awaits something not ready, then the next one runs. When none
+ * can run, the task sleeps on its notification value until a source of event notifies it or a
+ * sleep() ends. A coroutine waiting costs its frame, typically a few tens to a few hundreds of
+ * bytes, instead of the stack of a task of its own.
+ *
+ * Not thread-safe: spawn() and run() are called from the executor task, or spawn() before
+ * run().
+ */
+class CoExecutor {
+public:
+  static constexpr uint8_t MAX_TASKS = 16; ///< Coroutines alive at the same time
+
+  /**
+   * @brief Hand a coroutine over to the executor, which runs it from the next turn of run()
+   *
+   * @return false if MAX_TASKS coroutines are already alive. The coroutine is then destroyed
+   *         without having run.
+   */
+  bool spawn(CoTask &&task) {
+    for (CoTask::Handle &slot : tasks_) {
+      if (!slot) {
+        slot                    = task.handle_;
+        task.handle_            = nullptr;
+        slot.promise().executor = this;
+        slot.promise().waiting  = nullptr;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Run the coroutines until all of them returned
+   *
+   * @param idle_ticks Maximum time to sleep while no coroutine can run. portMAX_DELAY (the
+   *                   default) relies on the notifications alone.
+   */
+  void run(TickType_t idle_ticks = portMAX_DELAY) {
+    task_ = xTaskGetCurrentTaskHandle();
+
+    while (true) {
+      bool       alive       = false;
+      bool       resumed     = false;
+      TickType_t sleep_ticks = idle_ticks;
+
+      for (CoTask::Handle &slot : tasks_) {
+        if (!slot) continue;
+
+        CoWaiter *waiting = slot.promise().waiting;
+        if ((waiting == nullptr) || waiting->ready()) {
+          slot.promise().waiting = nullptr;
+          slot.resume();
+          resumed = true;
+          if (slot.done()) {
+            slot.destroy();
+            slot = nullptr;
+            continue;
+          }
+          waiting = slot.promise().waiting;
+        }
+        alive = true;
+        if (waiting != nullptr) {
+          TickType_t left = waiting->ticks_left();
+          if (left < sleep_ticks) sleep_ticks = left;
+        }
+      }
+
+      if (!alive) break;
+      // A coroutine resumed may have made another one ready: check them all again first
+      if (!resumed) ulTaskNotifyTake(pdTRUE, sleep_ticks);
+    }
+  }
+
+  /// The task running run(), to be notified by the sources of events. nullptr before run().
+  inline TaskHandle_t task() const { return task_; }
+
+  /// Waiter of sleep()
+  struct Sleep : CoWaiter {
+    TickType_t start;
+    TickType_t ticks;
+
+    Sleep(TickType_t ticks) : start(xTaskGetTickCount()), ticks(ticks) {}
+    bool       ready() override { return (xTaskGetTickCount() - start) >= ticks; }
+    TickType_t ticks_left() const override {
+      TickType_t elapsed = xTaskGetTickCount() - start;
+      return (elapsed >= ticks) ? 0 : ticks - elapsed;
+    }
+  };
+
+  /// `co_await CoExecutor::sleep(ticks)` resumes the coroutine after `ticks`
+  static inline CoAwait<Sleep> sleep(TickType_t ticks) { return CoAwait<Sleep>(ticks); }
+
+private:
+  CoTask::Handle tasks_[MAX_TASKS] = {};
+  TaskHandle_t   task_             = nullptr;
+};
+
+template <typename Waiter> void CoAwait<Waiter>::await_suspend(CoTask::Handle handle) {
+  if constexpr (requires(Waiter w) { w.watch(TaskHandle_t{}); }) {
+    this->watch(handle.promise().executor->task());
+  }
+  handle.promise().waiting = this;
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "esp_bt_defs.h"
+#include "esp_gap_ble_api.h"
+#include "esp_hid_common.h"
+#include "nvs.h"
+
+/// What esp_hidh_dev_open() needs to reach a keyboard again, without a scan
+struct CachedDevice {
+  static constexpr uint8_t NAME_SIZE = 32;
+
+  esp_bd_addr_t bda;
+  uint8_t       transport;       ///< esp_hid_transport_t
+  uint8_t       addr_type;       ///< esp_ble_addr_type_t, BLE only
+  char          name[NAME_SIZE]; ///< NUL terminated, possibly truncated
+
+  inline bool empty() const {
+    for (uint8_t byte : bda) {
+      if (byte != 0) return false;
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Keyboards last connected in each device slot, kept in NVS across reboots
+ *
+ * One blob per slot. The records are read once by load() and then served from RAM; store()
+ * only writes to flash when a record changes, so a keyboard coming back to its usual slot
+ * costs no flash wear. NVS must have been initialized by the application (nvs_flash_init()).
+ * Not thread-safe: load() runs at setup, the other methods in the esp_hidh event task.
+ *
+ * @tparam SLOTS Number of device slots, up to 99
+ */
+template <uint8_t SLOTS> class DeviceCache {
+public:
+  /**
+   * @brief Read all the records from NVS. Missing or malformed records are left empty.
+   *
+   * @return false if the NVS namespace could not be opened (nothing was ever stored or NVS
+   *         is not initialized)
+   */
+  bool load() {
+    memset(devices_, 0, sizeof(devices_));
+
+    nvs_handle_t handle;
+    if (nvs_open(NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return false;
+
+    for (uint8_t slot = 0; slot < SLOTS; slot++) {
+      char   key[8];
+      size_t length = sizeof(CachedDevice);
+      key_of(slot, key);
+      if ((nvs_get_blob(handle, key, &devices_[slot], &length) != ESP_OK) ||
+          (length != sizeof(CachedDevice))) {
+        memset(&devices_[slot], 0, sizeof(CachedDevice));
+      }
+      devices_[slot].name[CachedDevice::NAME_SIZE - 1] = 0;
+    }
+    nvs_close(handle);
+    return true;
+  }
+
+  /**
+   * @brief Record the keyboard connected in a slot. Nothing is written if it did not change.
+   *
+   * @return The NVS error, if any
+   */
+  esp_err_t store(uint8_t slot, const CachedDevice &device) {
+    if (slot >= SLOTS) return ESP_ERR_INVALID_ARG;
+    if (memcmp(&devices_[slot], &device, sizeof(CachedDevice)) == 0) return ESP_OK;
+
+    devices_[slot] = device;
+
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open(NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    char key[8];
+    key_of(slot, key);
+    ret = nvs_set_blob(handle, key, &device, sizeof(CachedDevice));
+    if (ret == ESP_OK) ret = nvs_commit(handle);
+    nvs_close(handle);
+    return ret;
+  }
+
+  /// Forget all the records, in RAM and NVS
+  esp_err_t clear() {
+    memset(devices_, 0, sizeof(devices_));
+
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open(NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+    ret = nvs_erase_all(handle);
+    if (ret == ESP_OK) ret = nvs_commit(handle);
+    nvs_close(handle);
+    return ret;
+  }
+
+  inline const CachedDevice &get(uint8_t slot) const { return devices_[slot]; }
+
+  /// The record of a keyboard, nullptr if none
+  const CachedDevice *find(const esp_bd_addr_t bda) const {
+    for (const CachedDevice &device : devices_) {
+      if (!device.empty() && (memcmp(device.bda, bda, sizeof(esp_bd_addr_t)) == 0)) {
+        return &device;
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  static constexpr char const *NAMESPACE = "bt_keyboard";
+
+  static_assert((SLOTS > 0) && (SLOTS < 100), "DeviceCache slots must be 1 to 99");
+
+  CachedDevice devices_[SLOTS] = {};
+
+  static inline void key_of(uint8_t slot, char *key) { snprintf(key, 8, "slot%u", slot); }
+};
@@ -0,0 +1,94 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Fixed-capacity map from an opaque device handle to a device slot index
+ *
+ * Open addressing with linear probing over twice as many buckets as slots, so a lookup is a
+ * hash of the pointer followed by one or two probes. Never allocates. Not thread-safe: the
+ * esp_hidh event task is the only one to use it.
+ *
+ * @tparam CAPACITY Maximum number of devices, below 128
+ */
+template <uint8_t CAPACITY> class DeviceTable {
+public:
+  static constexpr uint8_t NO_DEVICE = 0xFF;
+
+  /// Slot index of a device, or NO_DEVICE
+  uint8_t find(const void *handle) const {
+    if (handle == nullptr) return NO_DEVICE;
+    for (uint8_t i = hash(handle);; i = (i + 1) & MASK) {
+      if (buckets_[i].handle == handle) return buckets_[i].index;
+      if (buckets_[i].handle == nullptr) return NO_DEVICE;
+    }
+  }
+
+  /**
+   * @brief Associate a device with a slot index
+   *
+   * @return false if the table already holds CAPACITY devices
+   */
+  bool insert(const void *handle, uint8_t index) {
+    uint8_t i = hash(handle);
+    while ((buckets_[i].handle != nullptr) && (buckets_[i].handle != handle)) {
+      i = (i + 1) & MASK;
+    }
+    if ((buckets_[i].handle == nullptr) && (count_ == CAPACITY)) return false;
+    if (buckets_[i].handle == nullptr) count_++;
+    buckets_[i] = {handle, index};
+    return true;
+  }
+
+  /// Forget a device. The entries following it in its probe sequence are moved back.
+  void erase(const void *handle) {
+    uint8_t i = hash(handle);
+    while (buckets_[i].handle != handle) {
+      if (buckets_[i].handle == nullptr) return;
+      i = (i + 1) & MASK;
+    }
+
+    for (uint8_t j = (i + 1) & MASK; buckets_[j].handle != nullptr; j = (j + 1) & MASK) {
+      uint8_t home = hash(buckets_[j].handle);
+      // Move the entry into the hole unless its home lies cyclically in (i, j]
+      if (((j - home) & MASK) >= ((j - i) & MASK)) {
+        buckets_[i] = buckets_[j];
+        i           = j;
+      }
+    }
+    buckets_[i] = {nullptr, NO_DEVICE};
+    count_--;
+  }
+
+  inline uint8_t size() const { return count_; }
+
+private:
+  // Up to 256 buckets: the count needs 16 bits, the bucket indices still fit 8
+  static constexpr uint16_t bucket_count() {
+    uint16_t count = 1;
+    while (count < 2 * CAPACITY) count <<= 1;
+    return count;
+  }
+
+  static constexpr uint8_t MASK = bucket_count() - 1;
+
+  static_assert((CAPACITY > 0) && (CAPACITY < 128), "DeviceTable capacity must be 1 to 127");
+
+  // Fibonacci hashing of the pointer. Allocations are aligned, so the low bits carry little.
+  static inline uint8_t hash(const void *handle) {
+    uint32_t value = (uint32_t)((uintptr_t)handle >> 3);
+    return (uint8_t)((value * 2654435769U) >> 24) & MASK;
+  }
+
+  struct Bucket {
+    const void *handle;
+    uint8_t     index;
+  };
+
+  Bucket  buckets_[bucket_count()] = {};
+  uint8_t count_                   = 0;
+};
@@ -0,0 +1,140 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief One bit per HID Keyboard usage (0x00 - 0xFF)
+ *
+ * Set bits are walked with count-trailing-zeros on machine words (32-bit on the ESP32, 64-bit on
+ * hosts), and press/release edges between two states are found by XOR-ing them a word at a
+ * time. The cost is a handful of word operations plus one step per key that is set or changed,
+ * instead of one step per byte or per usage.
+ */
+class KeyBitmap {
+public:
+  typedef std::conditional_t<sizeof(void *) >= 8, uint64_t, uint32_t> Word;
+
+  static constexpr uint16_t BITS      = 256;
+  static constexpr uint8_t  WORD_BITS = sizeof(Word) * 8;
+  static constexpr uint8_t  WORDS     = BITS / WORD_BITS;
+
+  inline void clear() { memset(words_, 0, sizeof(words_)); }
+
+  inline bool test(uint8_t usage) const {
+    return (words_[usage / WORD_BITS] >> (usage % WORD_BITS)) & 1;
+  }
+  inline void set(uint8_t usage) { words_[usage / WORD_BITS] |= (Word)1 << (usage % WORD_BITS); }
+  inline void reset(uint8_t usage) {
+    words_[usage / WORD_BITS] &= ~((Word)1 << (usage % WORD_BITS));
+  }
+
+  /// Usages 8 * index to 8 * index + 7, lowest usage in bit 0
+  inline uint8_t get_byte(uint8_t index) const {
+    return words_[index * 8 / WORD_BITS] >> (index * 8 % WORD_BITS);
+  }
+  inline void set_byte(uint8_t index, uint8_t value) {
+    Word   &word  = words_[index * 8 / WORD_BITS];
+    uint8_t shift = index * 8 % WORD_BITS;
+    word          = (word & ~((Word)0xFF << shift)) | ((Word)value << shift);
+  }
+
+  inline bool any() const {
+    Word bits = 0;
+    for (uint8_t i = 0; i < WORDS; i++) bits |= words_[i];
+    return bits != 0;
+  }
+
+  /// Lowest usage set, or -1 if none
+  inline int first() const {
+    for (uint8_t i = 0; i < WORDS; i++) {
+      if (words_[i] != 0) return (i * WORD_BITS) + ctz(words_[i]);
+    }
+    return -1;
+  }
+
+  inline bool operator==(const KeyBitmap &other) const {
+    return memcmp(words_, other.words_, sizeof(words_)) == 0;
+  }
+  inline bool operator!=(const KeyBitmap &other) const { return !(*this == other); }
+
+  /**
+   * @brief OR a bitmap field of a HID report into the set
+   *
+   * Bit i of the field (starting at `bit_offset` in `data`) is usage `usage_min + i`. Bits
+   * beyond usage 0xFF are ignored. The field is read 32 bits at a time.
+   */
+  void load(const uint8_t *data, uint16_t bit_offset, uint16_t count, uint8_t usage_min) {
+    if (count > BITS - usage_min) count = BITS - usage_min;
+
+    for (uint16_t i = 0; i < count; i += 32) {
+      uint8_t  size  = (count - i < 32) ? (count - i) : 32;
+      uint64_t chunk = read_bits(data, bit_offset + i, size);
+      if (chunk == 0) continue;
+
+      uint16_t dst   = usage_min + i;
+      uint8_t  shift = dst % WORD_BITS;
+      words_[dst / WORD_BITS] |= (Word)(chunk << shift);
+      if ((shift + size > WORD_BITS) && (dst / WORD_BITS + 1 < WORDS)) {
+        words_[dst / WORD_BITS + 1] |= (Word)(chunk >> (WORD_BITS - shift));
+      }
+    }
+  }
+
+  /// Call f(usage) for every usage set, in increasing order
+  template <typename F> void for_each(F f) const {
+    for (uint8_t i = 0; i < WORDS; i++) {
+      for (Word bits = words_[i]; bits != 0; bits &= bits - 1) {
+        f((uint8_t)(i * WORD_BITS + ctz(bits)));
+      }
+    }
+  }
+
+  /**
+   * @brief Call f(usage, pressed) for every usage that differs between two states
+   *
+   * Presses and releases are reported in increasing usage order.
+   */
+  template <typename F> static void diff(const KeyBitmap &before, const KeyBitmap &after, F f) {
+    for (uint8_t i = 0; i < WORDS; i++) {
+      for (Word changed = before.words_[i] ^ after.words_[i]; changed != 0;
+           changed &= changed - 1) {
+        uint8_t bit = ctz(changed);
+        f((uint8_t)(i * WORD_BITS + bit), (bool)((after.words_[i] >> bit) & 1));
+      }
+    }
+  }
+
+  /// Usages set in `after` but not in `before`
+  static KeyBitmap pressed(const KeyBitmap &before, const KeyBitmap &after) {
+    KeyBitmap result;
+    for (uint8_t i = 0; i < WORDS; i++) result.words_[i] = after.words_[i] & ~before.words_[i];
+    return result;
+  }
+
+private:
+  Word words_[WORDS] = {};
+
+  static inline uint8_t ctz(Word bits) {
+    if constexpr (sizeof(Word) == 8) {
+      return __builtin_ctzll(bits);
+    } else {
+      return __builtin_ctz(bits);
+    }
+  }
+
+  /// `size` (up to 32) bits at `bit_offset`, reading only the bytes they span
+  static inline uint64_t read_bits(const uint8_t *data, uint32_t bit_offset, uint8_t size) {
+    const uint8_t *p     = data + (bit_offset >> 3);
+    uint8_t        shift = bit_offset & 7;
+    uint8_t        bytes = (shift + size + 7) >> 3;
+    uint64_t       value = 0;
+    memcpy(&value, p, bytes); // Little endian on both the ESP32 and the supported hosts
+    return (value >> shift) & ((size == 32) ? 0xFFFFFFFFULL : ((1ULL << size) - 1));
+  }
+};
@@ -0,0 +1,86 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstdint>
+
+#include "key_bitmap.hpp"
+#include "sdkconfig.h"
+
+/**
+ * @brief A key going down, repeating or up
+ *
+ * Modifier keys produce events too, with their usages 0xE0 (Left Control) to 0xE7 (Right GUI).
+ * REPEAT events are generated by the typematic repeat timer while the last key pressed is held.
+ * With several keyboards connected, events of all of them are merged in one stream and
+ * `device` tells them apart.
+ * With CONFIG_BT_KEYBOARD_LATENCY_STATS, the event also carries the time it went through each
+ * stage of the input path, and grows to 12 bytes.
+ */
+struct KeyEvent {
+  enum class Kind : uint8_t { DOWN, UP, REPEAT };
+
+  static constexpr uint8_t FIRST_MODIFIER_USAGE = 0xE0;
+
+  uint8_t usage;     ///< HID Keyboard usage (page 0x07)
+  uint8_t modifiers; ///< Modifier byte (boot report layout) once the event is applied
+  Kind    kind;
+  uint8_t device;    ///< Keyboard the event comes from, 0 to BTKeyboard::MAX_DEVICES - 1
+#if CONFIG_BT_KEYBOARD_LATENCY_STATS
+  uint32_t received_us = 0; ///< latency_timestamp() when the report reached the esp_hidh callback
+  uint32_t queued_us   = 0; ///< latency_timestamp() when the event was pushed to the ring
+#endif
+
+  inline bool is_modifier() const { return usage >= FIRST_MODIFIER_USAGE; }
+};
+
+#if !CONFIG_BT_KEYBOARD_LATENCY_STATS
+static_assert(sizeof(KeyEvent) == 4, "KeyEvent must stay a 4-byte record");
+#endif
+
+/**
+ * @brief Turns successive key states of a keyboard into KeyEvent edges
+ *
+ * The state is a 256-bit set of the keys down, modifiers included as usages 0xE0 - 0xE7. Each
+ * new state is XOR-ed with the previous one a word at a time, and only the changed keys produce
+ * an event.
+ */
+class KeyEventEngine {
+public:
+  inline void    clear() { state_.clear(); }
+  inline uint8_t modifiers() const { return state_.get_byte(MODIFIER_BYTE); }
+  inline const KeyBitmap &state() const { return state_; }
+
+  /**
+   * @brief Apply a new key state
+   *
+   * @param keys Keys down in the last report, modifiers included
+   * @param rollover The report signalled ErrorRollOver (too many keys down): only the modifiers
+   *                 of `keys` are meaningful, the other keys keep their previous state
+   * @param emit Called with each KeyEvent, releases and presses in increasing usage order. The
+   *             events are not tagged: `device` is 0.
+   */
+  template <typename F> void update(KeyBitmap keys, bool rollover, F emit) {
+    if (rollover) {
+      uint8_t modifiers = keys.get_byte(MODIFIER_BYTE);
+      keys              = state_;
+      keys.set_byte(MODIFIER_BYTE, modifiers);
+    }
+
+    uint8_t modifiers = keys.get_byte(MODIFIER_BYTE);
+    KeyBitmap::diff(state_, keys, [&](uint8_t usage, bool pressed) {
+      emit(KeyEvent{.usage     = usage,
+                    .modifiers = modifiers,
+                    .kind      = pressed ? KeyEvent::Kind::DOWN : KeyEvent::Kind::UP,
+                    .device    = 0});
+    });
+    state_ = keys;
+  }
+
+private:
+  static constexpr uint8_t MODIFIER_BYTE = KeyEvent::FIRST_MODIFIER_USAGE / 8;
+
+  KeyBitmap state_;
+};
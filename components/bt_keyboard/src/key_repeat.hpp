@@ -0,0 +1,56 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Families of keys sharing the same typematic repeat timing
+ *
+ * - CHARACTER:  Letters, digits, punctuation and keypad characters
+ * - EDITING:    Enter, Backspace, Tab, Space and Delete
+ * - NAVIGATION: Arrows, Home, End, PageUp and PageDown
+ * - NONE:       Keys that never repeat: modifiers, locks, Escape, function keys...
+ */
+enum class KeyClass : uint8_t { CHARACTER, EDITING, NAVIGATION, NONE, COUNT };
+
+/// Time a key must be held before it repeats, then time between repeats. A period of 0
+/// disables the repeat.
+struct KeyRepeatTiming {
+  uint16_t delay_ms;
+  uint16_t period_ms;
+};
+
+static constexpr KeyRepeatTiming DEFAULT_KEY_REPEAT = {.delay_ms = 500, .period_ms = 120};
+
+/// Repeat class of a HID Keyboard usage (page 0x07)
+constexpr KeyClass key_class(uint8_t usage) {
+  switch (usage) {
+    case 0x28: // Enter
+    case 0x2A: // Backspace
+    case 0x2B: // Tab
+    case 0x2C: // Space
+    case 0x4C: // Delete
+    case 0x58: // Keypad Enter
+      return KeyClass::EDITING;
+    case 0x4A: // Home
+    case 0x4B: // PageUp
+    case 0x4D: // End
+    case 0x4E: // PageDown
+    case 0x4F: // Right arrow
+    case 0x50: // Left arrow
+    case 0x51: // Down arrow
+    case 0x52: // Up arrow
+      return KeyClass::NAVIGATION;
+    default:
+      break;
+  }
+
+  if ((usage >= 0x04) && (usage <= 0x27)) return KeyClass::CHARACTER; // Letters and digits
+  if ((usage >= 0x2D) && (usage <= 0x38)) return KeyClass::CHARACTER; // Punctuation
+  if ((usage >= 0x54) && (usage <= 0x64)) return KeyClass::CHARACTER; // Keypad, non-US '\'
+  if (usage == 0x67) return KeyClass::CHARACTER;                      // Keypad '='
+  return KeyClass::NONE;
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Keyboard layout descriptions. The translation planes are generated from them at compile
+// time by make_keymap() (see keymap.hpp) and end up in flash as read-only data.
+
+#include "keymap.hpp"
+
+// clang-format off
+
+// Keys producing the same character on every layout
+static constexpr KeyDef common_keys[] = {
+  {0x28, '\r'  }, {0x29, '\033'}, {0x2A, '\b'  }, {0x2B, '\t'  }, {0x2C, ' '   },
+  {0x39, 0x80  },                                                     // CAPS LOCK
+  {0x3A, 0x81  }, {0x3B, 0x82  }, {0x3C, 0x83  }, {0x3D, 0x84  },     // F1 .. F4
+  {0x3E, 0x85  }, {0x3F, 0x86  }, {0x40, 0x87  }, {0x41, 0x88  },     // F5 .. F8
+  {0x42, 0x89  }, {0x43, 0x8A  }, {0x44, 0x8B  }, {0x45, 0x8C  },     // F9 .. F12
+  {0x46, 0x8D  }, {0x47, 0x8E  }, {0x48, 0x8F  },                     // PrtScr ScrollLock Pause
+  {0x49, 0x90  }, {0x4A, 0x91  }, {0x4B, 0x92  }, {0x4C, 0x7F  },     // Insert Home PageUp Delete
+  {0x4D, 0x93  }, {0x4E, 0x94  },                                     // End PageDown
+  {0x4F, 0x95  }, {0x50, 0x96  }, {0x51, 0x97  }, {0x52, 0x98  },     // Right Left Down Up
+  {0x53, 0x99  },                                                     // NumLock
+  {0x54, '/'   }, {0x55, '*'   }, {0x56, '-'   }, {0x57, '+'   },     // Keypad
+  {0x58, '\r'  }, {0x59, '1'   }, {0x5A, '2'   }, {0x5B, '3'   },
+  {0x5C, '4'   }, {0x5D, '5'   }, {0x5E, '6'   }, {0x5F, '7'   },
+  {0x60, '8'   }, {0x61, '9'   }, {0x62, '0'   }, {0x63, '.'   },
+  {0x65, 0x9A  },                                                     // Application (Menu)
+  {0x67, '='   }, {0x85, ','   }, {0x86, '='   },                     // Keypad
+  {0xB6, '('   }, {0xB7, ')'   }, {0xB8, '{'   }, {0xB9, '}'   },
+  {0xBA, '\t'  }, {0xBB, '\b'  },
+};
+
+static constexpr KeyDef us_keys[] = {
+  {0x04, 'a', 'A'}, {0x05, 'b', 'B'}, {0x06, 'c', 'C'}, {0x07, 'd', 'D'}, {0x08, 'e', 'E'},
+  {0x09, 'f', 'F'}, {0x0A, 'g', 'G'}, {0x0B, 'h', 'H'}, {0x0C, 'i', 'I'}, {0x0D, 'j', 'J'},
+  {0x0E, 'k', 'K'}, {0x0F, 'l', 'L'}, {0x10, 'm', 'M'}, {0x11, 'n', 'N'}, {0x12, 'o', 'O'},
+  {0x13, 'p', 'P'}, {0x14, 'q', 'Q'}, {0x15, 'r', 'R'}, {0x16, 's', 'S'}, {0x17, 't', 'T'},
+  {0x18, 'u', 'U'}, {0x19, 'v', 'V'}, {0x1A, 'w', 'W'}, {0x1B, 'x', 'X'}, {0x1C, 'y', 'Y'},
+  {0x1D, 'z', 'Z'},
+  {0x1E, '1', '!'}, {0x1F, '2', '@'}, {0x20, '3', '#'}, {0x21, '4', '$'}, {0x22, '5', '%'},
+  {0x23, '6', '^'}, {0x24, '7', '&'}, {0x25, '8', '*'}, {0x26, '9', '('}, {0x27, '0', ')'},
+  {0x2D, '-', '_'}, {0x2E, '=', '+'}, {0x2F, '[', '{'}, {0x30, ']', '}'}, {0x31, '\\', '|'},
+  {0x32, '\\', '|'}, {0x33, ';', ':'}, {0x34, '\'', '"'}, {0x35, '`', '~'}, {0x36, ',', '<'},
+  {0x37, '.', '>'}, {0x38, '/', '?'}, {0x64, '\\', '|'},
+};
+
+// French. 0xA3: pound, 0xA7: section, 0xB0: degree, 0xB2: superscript two,
+// 0xB5: micro, 0xE0: a grave, 0xE7: c cedilla, 0xE8: e grave, 0xE9: e acute, 0xF9: u grave
+static constexpr KeyDef azerty_keys[] = {
+  {0x04, 'q', 'Q'}, {0x05, 'b', 'B'}, {0x06, 'c', 'C'}, {0x07, 'd', 'D'},
+  {0x08, 'e', 'E', EURO_SIGN},
+  {0x09, 'f', 'F'}, {0x0A, 'g', 'G'}, {0x0B, 'h', 'H'}, {0x0C, 'i', 'I'}, {0x0D, 'j', 'J'},
+  {0x0E, 'k', 'K'}, {0x0F, 'l', 'L'}, {0x10, ',', '?'}, {0x11, 'n', 'N'}, {0x12, 'o', 'O'},
+  {0x13, 'p', 'P'}, {0x14, 'a', 'A'}, {0x15, 'r', 'R'}, {0x16, 's', 'S'}, {0x17, 't', 'T'},
+  {0x18, 'u', 'U'}, {0x19, 'v', 'V'}, {0x1A, 'z', 'Z'}, {0x1B, 'x', 'X'}, {0x1C, 'y', 'Y'},
+  {0x1D, 'w', 'W'},
+  {0x1E, '&',  '1'}, {0x1F, 0xE9, '2', DEAD_TILDE}, {0x20, '"',  '3', '#'},
+  {0x21, '\'', '4', '{'}, {0x22, '(',  '5', '['}, {0x23, '-',  '6', '|'},
+  {0x24, 0xE8, '7', DEAD_GRAVE}, {0x25, '_', '8', '\\'}, {0x26, 0xE7, '9', '^'},
+  {0x27, 0xE0, '0', '@'},
+  {0x2D, ')',  0xB0, ']'}, {0x2E, '=', '+', '}'}, {0x2F, DEAD_CIRCUMFLEX, DEAD_DIAERESIS},
+  {0x30, '$',  0xA3},       // AltGr: currency sign, not in the code space
+  {0x31, '*',  0xB5}, {0x32, '*', 0xB5}, {0x33, 'm', 'M'}, {0x34, 0xF9, '%'}, {0x35, 0xB2},
+  {0x36, ';',  '.'}, {0x37, ':', '/'}, {0x38, '!', 0xA7}, {0x64, '<', '>'},
+};
+
+// German. 0xA7: section, 0xB0: degree, 0xB2 / 0xB3: superscript two / three, 0xB5: micro,
+// 0xC4 / 0xE4: A / a diaeresis, 0xD6 / 0xF6: O / o diaeresis, 0xDC / 0xFC: U / u diaeresis,
+// 0xDF: sharp s
+static constexpr KeyDef qwertz_keys[] = {
+  {0x04, 'a', 'A'}, {0x05, 'b', 'B'}, {0x06, 'c', 'C'}, {0x07, 'd', 'D'},
+  {0x08, 'e', 'E', EURO_SIGN},
+  {0x09, 'f', 'F'}, {0x0A, 'g', 'G'}, {0x0B, 'h', 'H'}, {0x0C, 'i', 'I'}, {0x0D, 'j', 'J'},
+  {0x0E, 'k', 'K'}, {0x0F, 'l', 'L'}, {0x10, 'm', 'M', 0xB5}, {0x11, 'n', 'N'},
+  {0x12, 'o', 'O'}, {0x13, 'p', 'P'}, {0x14, 'q', 'Q', '@'}, {0x15, 'r', 'R'}, {0x16, 's', 'S'},
+  {0x17, 't', 'T'}, {0x18, 'u', 'U'}, {0x19, 'v', 'V'}, {0x1A, 'w', 'W'}, {0x1B, 'x', 'X'},
+  {0x1C, 'z', 'Z'}, {0x1D, 'y', 'Y'},
+  {0x1E, '1', '!'}, {0x1F, '2', '"', 0xB2}, {0x20, '3', 0xA7, 0xB3}, {0x21, '4', '$'},
+  {0x22, '5', '%'}, {0x23, '6', '&'}, {0x24, '7', '/', '{'}, {0x25, '8', '(', '['},
+  {0x26, '9', ')', ']'}, {0x27, '0', '=', '}'},
+  {0x2D, 0xDF, '?', '\\'}, {0x2E, DEAD_ACUTE, DEAD_GRAVE}, {0x2F, 0xFC, 0xDC},
+  {0x30, '+', '*', '~'},
+  {0x31, '#', '\''}, {0x32, '#', '\''}, {0x33, 0xF6, 0xD6}, {0x34, 0xE4, 0xC4},
+  {0x35, DEAD_CIRCUMFLEX, 0xB0}, {0x36, ',', ';'}, {0x37, '.', ':'}, {0x38, '-', '_'},
+  {0x64, '<', '>', '|'},
+};
+
+static constexpr KeyDef dvorak_keys[] = {
+  {0x04, 'a', 'A'}, {0x05, 'x', 'X'}, {0x06, 'j', 'J'}, {0x07, 'e', 'E'}, {0x08, '.', '>'},
+  {0x09, 'u', 'U'}, {0x0A, 'i', 'I'}, {0x0B, 'd', 'D'}, {0x0C, 'c', 'C'}, {0x0D, 'h', 'H'},
+  {0x0E, 't', 'T'}, {0x0F, 'n', 'N'}, {0x10, 'm', 'M'}, {0x11, 'b', 'B'}, {0x12, 'r', 'R'},
+  {0x13, 'l', 'L'}, {0x14, '\'', '"'}, {0x15, 'p', 'P'}, {0x16, 'o', 'O'}, {0x17, 'y', 'Y'},
+  {0x18, 'g', 'G'}, {0x19, 'k', 'K'}, {0x1A, ',', '<'}, {0x1B, 'q', 'Q'}, {0x1C, 'f', 'F'},
+  {0x1D, ';', ':'},
+  {0x1E, '1', '!'}, {0x1F, '2', '@'}, {0x20, '3', '#'}, {0x21, '4', '$'}, {0x22, '5', '%'},
+  {0x23, '6', '^'}, {0x24, '7', '&'}, {0x25, '8', '*'}, {0x26, '9', '('}, {0x27, '0', ')'},
+  {0x2D, '[', '{'}, {0x2E, ']', '}'}, {0x2F, '/', '?'}, {0x30, '=', '+'}, {0x31, '\\', '|'},
+  {0x32, '\\', '|'}, {0x33, 's', 'S'}, {0x34, '-', '_'}, {0x35, '`', '~'}, {0x36, 'w', 'W'},
+  {0x37, 'v', 'V'}, {0x38, 'z', 'Z'}, {0x64, '\\', '|'},
+};
+
+// clang-format on
+
+constexpr Keymap KEYMAP_US     = make_keymap(common_keys, us_keys, false);
+constexpr Keymap KEYMAP_AZERTY = make_keymap(common_keys, azerty_keys, true);
+constexpr Keymap KEYMAP_QWERTZ = make_keymap(common_keys, qwertz_keys, true);
+constexpr Keymap KEYMAP_DVORAK = make_keymap(common_keys, dvorak_keys, false);
+
+// A few spot checks, evaluated by the compiler
+static_assert(KEYMAP_US.translate(0x04, 0x00, false) == 'a');
+static_assert(KEYMAP_US.translate(0x04, 0x02, false) == 'A');
+static_assert(KEYMAP_US.translate(0x04, 0x00, true) == 'A');
+static_assert(KEYMAP_US.translate(0x04, 0x20, true) == 'a');
+static_assert(KEYMAP_US.translate(0x1E, 0x00, true) == '1');
+static_assert(KEYMAP_US.translate(0x06, 0x01, false) == 0x03);
+static_assert(KEYMAP_US.translate(0x28, 0x10, false) == '\r');
+static_assert(KEYMAP_US.translate(0x59, 0x00, false) == '1');
+static_assert(KEYMAP_AZERTY.translate(0x14, 0x00, false) == 'a');
+static_assert(KEYMAP_AZERTY.translate(0x27, 0x40, false) == '@');
+static_assert(KEYMAP_AZERTY.translate(0x28, 0x40, false) == '\r');
+static_assert(KEYMAP_AZERTY.translate(0x08, 0x40, false) == EURO_SIGN);
+static_assert(KEYMAP_QWERTZ.translate(0x08, 0x40, true) == EURO_SIGN);
+static_assert(KEYMAP_QWERTZ.translate(0x2F, 0x00, true) == 0xDC);
+static_assert(KEYMAP_QWERTZ.translate(0x2D, 0x00, true) == 0xDF);
+static_assert(KEYMAP_QWERTZ.translate(0x2E, 0x02, false) == DEAD_GRAVE);
+static_assert(KEYMAP_AZERTY.translate(0x2F, 0x00, true) == DEAD_CIRCUMFLEX);
+static_assert(KEYMAP_AZERTY.translate(0x2F, 0x01, false) == 0);
+static_assert(KEYMAP_DVORAK.translate(0x08, 0x02, false) == '>');
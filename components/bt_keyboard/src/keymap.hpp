@@ -0,0 +1,127 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Codes of the dead keys, between the special keys and Latin-1
+enum : uint8_t { DEAD_GRAVE = 0x9B, DEAD_ACUTE, DEAD_CIRCUMFLEX, DEAD_TILDE, DEAD_DIAERESIS };
+
+/// Code of the euro sign, which Latin-1 lacks: 0xA4 as in ISO 8859-15, instead of the currency
+/// sign
+static constexpr uint8_t EURO_SIGN = 0xA4;
+
+/**
+ * @brief Compile-time generated HID Keyboard usage page translation tables
+ *
+ * A layout is described declaratively as a list of KeyDef entries (usage, plain, shift and
+ * AltGr characters). make_keymap() expands it at compile time into dense 256-entry planes, one
+ * per modifier state, so that translating a key is a single table load whatever the modifiers:
+ *
+ *     character = planes[select[modifier state]][usage]
+ *
+ * Characters are 8-bit: ASCII, the special key codes listed in README.md (0x80 - 0x9A), the
+ * dead key codes (0x9B - 0x9F) and Latin-1 (0xA0 - 0xFF, EURO_SIGN at 0xA4) for non-English
+ * layouts. 0 means the key produces nothing in that state.
+ */
+struct KeyDef {
+  uint8_t usage;
+  uint8_t plain;
+  uint8_t shift = 0; ///< 0: same as plain
+  uint8_t altgr = 0; ///< 0: nothing
+};
+
+struct Keymap {
+  enum Plane : uint8_t { PLAIN, SHIFT, CAPS, CAPS_SHIFT, CTRL, ALTGR, PLANE_COUNT };
+
+  static constexpr uint8_t MOD_CTRL  = 0x11; // Left and right
+  static constexpr uint8_t MOD_SHIFT = 0x22;
+  static constexpr uint8_t MOD_ALTGR = 0x40; // Right Alt
+
+  static constexpr uint8_t FIRST_DEAD = DEAD_GRAVE;
+  static constexpr uint8_t DEAD_COUNT = 5;
+
+  static constexpr bool is_dead(uint8_t code) {
+    return (code >= FIRST_DEAD) && (code < FIRST_DEAD + DEAD_COUNT);
+  }
+
+  /// Character a dead key produces on its own: ` ´ ^ ~ ¨ (Latin-1)
+  static constexpr uint8_t spacing(uint8_t dead) {
+    constexpr uint8_t chars[DEAD_COUNT] = {'`', 0xB4, '^', '~', 0xA8};
+    return chars[dead - FIRST_DEAD];
+  }
+
+  uint8_t planes[PLANE_COUNT][256];
+  uint8_t select[16]; ///< Plane for each ctrl|altgr|caps|shift combination
+
+  /**
+   * @brief Character produced by a key
+   *
+   * @param usage HID Keyboard usage (page 0x07)
+   * @param modifier Modifier byte of the boot keyboard report
+   * @param caps_lock Caps Lock state
+   */
+  constexpr uint8_t translate(uint8_t usage, uint8_t modifier, bool caps_lock) const {
+    uint8_t state = ((modifier & MOD_SHIFT) != 0) | (caps_lock << 1) |
+                    (((modifier & MOD_ALTGR) != 0) << 2) | (((modifier & MOD_CTRL) != 0) << 3);
+    return planes[select[state]][usage];
+  }
+};
+
+/**
+ * @brief Expand layout descriptions into a Keymap
+ *
+ * `common` holds the layout independent keys (Enter, function keys, navigation, keypad, ...),
+ * `layout` the printable ones. Caps Lock applies to a key when its shifted character is the
+ * upper case of its plain one (a-z and Latin-1 letters). The Ctrl plane maps letters to the
+ * 0x01 - 0x1A control codes and keeps non-printable keys as in the plain plane.
+ *
+ * @param altgr true when the layout uses the right Alt key as AltGr. Otherwise right Alt is
+ *              ignored like the other Alt and Meta keys.
+ */
+template <size_t C, size_t L>
+constexpr Keymap make_keymap(const KeyDef (&common)[C], const KeyDef (&layout)[L], bool altgr) {
+  Keymap map{};
+
+  auto add = [&map](const KeyDef &def, bool keep_on_altgr) {
+    uint8_t plain     = def.plain;
+    uint8_t shift     = (def.shift == 0) ? plain : def.shift;
+    bool    lowercase = ((plain >= 'a') && (plain <= 'z')) ||
+                     ((plain >= 0xE0) && (plain <= 0xFE) && (plain != 0xF7));
+    bool    caps      = lowercase && (shift == plain - 0x20);
+    bool    printable = ((plain >= 0x20) && (plain < 0x7F)) || (plain >= Keymap::FIRST_DEAD);
+
+    map.planes[Keymap::PLAIN][def.usage]      = plain;
+    map.planes[Keymap::SHIFT][def.usage]      = shift;
+    map.planes[Keymap::CAPS][def.usage]       = caps ? shift : plain;
+    map.planes[Keymap::CAPS_SHIFT][def.usage] = caps ? plain : shift;
+    map.planes[Keymap::ALTGR][def.usage]      = keep_on_altgr ? plain : def.altgr;
+    map.planes[Keymap::CTRL][def.usage] =
+        ((plain >= 'a') && (plain <= 'z')) ? (plain - 'a' + 1) : (printable ? 0 : plain);
+  };
+
+  for (const KeyDef &def : common) add(def, true);
+  for (const KeyDef &def : layout) add(def, false);
+
+  for (uint8_t state = 0; state < 16; state++) {
+    bool shift    = state & 1;
+    bool caps     = state & 2;
+    bool alt_gr   = altgr && (state & 4);
+    bool ctrl     = state & 8;
+    uint8_t plane = caps ? (shift ? Keymap::CAPS_SHIFT : Keymap::CAPS)
+                         : (shift ? Keymap::SHIFT : Keymap::PLAIN);
+    if (alt_gr) plane = Keymap::ALTGR;
+    if (ctrl) plane = Keymap::CTRL;
+    map.select[state] = plane;
+  }
+
+  return map;
+}
+
+extern const Keymap KEYMAP_US;     ///< US QWERTY (default)
+extern const Keymap KEYMAP_AZERTY; ///< French AZERTY
+extern const Keymap KEYMAP_QWERTZ; ///< German QWERTZ
+extern const Keymap KEYMAP_DVORAK; ///< US Dvorak
@@ -0,0 +1,72 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Radio timing requested from a keyboard once connected, trading input latency for its
+ *        battery life
+ *
+ * A key press waits in the keyboard for its next exchange with the host: up to one BLE
+ * connection interval, or one BT Classic poll interval. After ESP_HIDH_OPEN_EVENT, a BLE
+ * keyboard is asked for a connection interval between min_interval and max_interval. When it
+ * refuses, or settles on another interval later on (keyboards counter-propose their own
+ * parameters), the request is made again, up to max_retries times; its choice is kept after
+ * that. A BT Classic keyboard is asked for a poll interval of poll_slots. It still enters sniff
+ * mode on its own when idle, which the stack does not let the host control: a key press
+ * then waits up to one sniff interval.
+ *
+ * The peripheral latency lets a BLE keyboard skip that many connection events while it has
+ * nothing to send. It saves the keyboard battery without delaying key presses, which are sent
+ * at the next connection event: only what the host sends (LED state) waits longer.
+ */
+struct LatencyPolicy {
+  uint16_t min_interval; ///< BLE connection interval, 1.25 ms units, 6 (7.5 ms) or more. 0
+                         ///< leaves the interval to the keyboard.
+  uint16_t max_interval; ///< BLE connection interval, 1.25 ms units, up to 3200 (4 s)
+  uint16_t latency;      ///< BLE peripheral latency, in connection events, up to 499
+  uint16_t timeout;      ///< BLE supervision timeout, 10 ms units. Raised if too short for the
+                         ///< interval and latency.
+  uint16_t poll_slots;   ///< BT Classic poll interval, 625 us slots. 0 leaves it to the keyboard.
+  uint8_t  max_retries;  ///< BLE requests made again when the keyboard settles outside the range
+};
+
+/// Request nothing: the keyboard keeps the timing it asked for (the default)
+static constexpr LatencyPolicy LATENCY_POLICY_KEYBOARD = {};
+
+/// 7.5 to 10 ms connection interval, 5 ms poll interval: gaming, music, foot pedals
+static constexpr LatencyPolicy LATENCY_POLICY_LOW = {.min_interval = 6,
+                                                     .max_interval = 8,
+                                                     .latency      = 0,
+                                                     .timeout      = 200,
+                                                     .poll_slots   = 8,
+                                                     .max_retries  = 3};
+
+/// 15 to 30 ms connection interval, 15 ms poll interval: typing
+static constexpr LatencyPolicy LATENCY_POLICY_BALANCED = {.min_interval = 12,
+                                                          .max_interval = 24,
+                                                          .latency      = 4,
+                                                          .timeout      = 400,
+                                                          .poll_slots   = 24,
+                                                          .max_retries  = 2};
+
+/// 45 to 75 ms connection interval, 50 ms poll interval: keyboards on small batteries
+static constexpr LatencyPolicy LATENCY_POLICY_BATTERY = {.min_interval = 36,
+                                                         .max_interval = 60,
+                                                         .latency      = 10,
+                                                         .timeout      = 600,
+                                                         .poll_slots   = 80,
+                                                         .max_retries  = 1};
+
+/// Radio timing in effect on the link of a keyboard, see BTKeyboard::get_device_status()
+struct LinkTiming {
+  uint32_t interval_us; ///< BLE connection interval or BT Classic poll interval, 0 until known
+  uint16_t latency;     ///< BLE peripheral latency, in connection events
+  uint16_t timeout_ms;  ///< BLE supervision timeout
+  uint8_t  requests;    ///< Timing requests made since the connection
+  bool     sniff;       ///< BT Classic link in sniff mode
+  bool     in_policy;   ///< interval_us is known and within the latency policy of the slot
+};
@@ -0,0 +1,93 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "esp_timer.h"
+
+/**
+ * @brief Fixed-bucket histogram of latencies in microseconds
+ *
+ * Buckets are log-linear: 0 to 3 us have their own bucket, then every power of two is split in
+ * four buckets, up to about one second. The percentiles are thus within 25% of the real value.
+ * Counters are relaxed atomics: record() never blocks nor allocates and can run concurrently
+ * with snapshot() and reset() on another task.
+ */
+class LatencyHistogram {
+public:
+  static constexpr uint8_t BUCKETS = 80;
+
+  struct Snapshot {
+    uint32_t counts[BUCKETS];
+    uint32_t count;  ///< Number of samples
+    uint32_t max_us; ///< Longest sample
+
+    /**
+     * @brief Latency below which a fraction of the samples fall
+     *
+     * @param fraction 0.5 for the median, 0.99 for the 99th percentile...
+     * @return Upper bound of the bucket holding that sample, capped to max_us. 0 if no sample.
+     */
+    uint32_t percentile(float fraction) const {
+      uint32_t rank = (uint32_t)(fraction * count + 0.5f);
+      if (rank == 0) rank = 1;
+
+      uint32_t seen = 0;
+      for (uint8_t i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+          uint32_t upper = (i == BUCKETS - 1) ? max_us : lower_bound(i + 1) - 1;
+          return (upper < max_us) ? upper : max_us;
+        }
+      }
+      return max_us;
+    }
+  };
+
+  inline void record(uint32_t us) {
+    counts_[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+    uint32_t max = max_us_.load(std::memory_order_relaxed);
+    while ((us > max) && !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+  }
+
+  Snapshot snapshot() const {
+    Snapshot result;
+    result.count = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+      result.counts[i] = counts_[i].load(std::memory_order_relaxed);
+      result.count += result.counts[i];
+    }
+    result.max_us = max_us_.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  void reset() {
+    for (uint8_t i = 0; i < BUCKETS; i++) counts_[i].store(0, std::memory_order_relaxed);
+    max_us_.store(0, std::memory_order_relaxed);
+  }
+
+  /// Smallest latency counted in a bucket
+  static constexpr uint32_t lower_bound(uint8_t index) {
+    if (index < 4) return index;
+    return (uint32_t)(4 + (index & 3)) << ((index >> 2) - 1);
+  }
+
+  static inline uint8_t bucket(uint32_t us) {
+    if (us < 4) return us;
+    uint8_t msb   = 31 - __builtin_clz(us);
+    uint8_t index = ((msb - 1) << 2) | ((us >> (msb - 2)) & 3);
+    return (index < BUCKETS) ? index : BUCKETS - 1;
+  }
+
+private:
+  std::atomic<uint32_t> counts_[BUCKETS] = {};
+  std::atomic<uint32_t> max_us_{0};
+};
+
+/// Low 32 bits of the esp_timer clock: enough for latencies up to an hour
+inline uint32_t latency_timestamp() { return (uint32_t)esp_timer_get_time(); }
@@ -0,0 +1,36 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Pace of the attempts made to get lost keyboards back
+ *
+ * The first attempt follows a disconnection by initial_delay_ms. The delay is multiplied by
+ * backoff_factor after each attempt that leaves a keyboard missing, up to max_delay_ms. BLE
+ * keyboards are looked for by a BLE scan of scan_seconds before being connected, so the radio
+ * is busy for at most scan_seconds out of each delay; BT Classic keyboards are paged directly.
+ */
+struct ReconnectPolicy {
+  uint32_t initial_delay_ms;
+  uint32_t max_delay_ms;
+  uint8_t  backoff_factor;
+  uint8_t  scan_seconds;
+};
+
+static constexpr ReconnectPolicy DEFAULT_RECONNECT_POLICY = {
+    .initial_delay_ms = 500, .max_delay_ms = 30000, .backoff_factor = 2, .scan_seconds = 1};
+
+/// Counters of the reconnection supervisor, see BTKeyboard::get_reconnect_stats()
+struct ReconnectStats {
+  uint32_t disconnections;   ///< Keyboards lost
+  uint32_t scans;            ///< Background BLE scans run
+  uint32_t attempts;         ///< Connections opened by the supervisor
+  uint32_t recoveries;       ///< Keyboards back after a disconnection, whoever reconnected them
+  uint32_t last_recovery_ms; ///< Disconnection to connection time of the last recovery
+  uint32_t max_recovery_ms;
+  uint32_t mean_recovery_ms;
+};
@@ -0,0 +1,331 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "report_decoder.hpp"
+
+#include <cstring>
+
+#include "esp_log.h"
+
+// HID short item tags (HID 1.11, section 6.2.2), with the size bits masked out
+static constexpr uint8_t ITEM_INPUT          = 0x80;
+static constexpr uint8_t ITEM_USAGE_PAGE     = 0x04;
+static constexpr uint8_t ITEM_LOGICAL_MIN    = 0x14;
+static constexpr uint8_t ITEM_LOGICAL_MAX    = 0x24;
+static constexpr uint8_t ITEM_REPORT_SIZE    = 0x74;
+static constexpr uint8_t ITEM_REPORT_ID      = 0x84;
+static constexpr uint8_t ITEM_REPORT_COUNT   = 0x94;
+static constexpr uint8_t ITEM_PUSH           = 0xA4;
+static constexpr uint8_t ITEM_POP            = 0xB4;
+static constexpr uint8_t ITEM_USAGE          = 0x08;
+static constexpr uint8_t ITEM_USAGE_MIN      = 0x18;
+static constexpr uint8_t ITEM_LONG           = 0xFE;
+
+static constexpr uint16_t USAGE_PAGE_KEYBOARD   = 0x07;
+static constexpr uint8_t  USAGE_ERROR_ROLL_OVER = 0x01;
+static constexpr uint8_t  USAGE_ERROR_UNDEFINED = 0x03;
+static constexpr uint8_t  USAGE_LEFT_CTRL       = 0xE0;
+
+static constexpr uint8_t INPUT_CONSTANT = 0x01;
+static constexpr uint8_t INPUT_VARIABLE = 0x02;
+
+/**
+ * @brief Add the keyboard input reports described by a report map to a decode plan
+ *
+ * The report map is walked once, keeping the global items state (with Push/Pop support) and
+ * the first local usage of the next main item. For each Input main item on the keyboard usage
+ * page, the bit offset reached so far in its report is recorded as:
+ * - the modifier field, for 1-bit variables starting at usage 0xE0 (Left Control)
+ * - a key bitmap, for other 1-bit variables
+ * - a key array, for arrays
+ *
+ * Bit offsets are tracked separately for each report ID, as items of different reports may be
+ * interleaved.
+ *
+ * @param map Report map, as retrieved by esp_hidh_dev_report_maps_get()
+ * @param length Report map size in bytes
+ * @param map_index Index of the map for the device, as reported in ESP_HIDH_INPUT_EVENT
+ * @param plan Plan to add the keyboard reports to
+ *
+ * @return false if the report map is malformed or describes more keyboard reports than
+ *         DecodePlan::MAX_REPORTS
+ */
+bool ReportDecoder::compile(const uint8_t *map, size_t length, uint8_t map_index,
+                            DecodePlan &plan) {
+  struct Globals {
+    uint16_t usage_page;
+    int32_t  logical_min;
+    int32_t  logical_max;
+    uint8_t  report_size;
+    uint8_t  report_id;
+    uint16_t report_count;
+  };
+
+  static constexpr uint8_t MAX_STACK   = 4;
+  static constexpr uint8_t MAX_OFFSETS = 16;
+
+  Globals  globals     = {};
+  Globals  stack[MAX_STACK];
+  uint8_t  stack_depth = 0;
+  uint32_t usage_min   = 0; // First local usage, with its page in the high 16 bits
+  bool     usage_given = false;
+
+  struct {
+    uint8_t  report_id;
+    uint32_t bits;
+  } offsets[MAX_OFFSETS];
+  uint8_t offset_count = 0;
+
+  size_t pos = 0;
+  while (pos < length) {
+    uint8_t prefix = map[pos++];
+
+    if (prefix == ITEM_LONG) {
+      if (pos + 2 > length) break;
+      pos += 2 + map[pos];
+      continue;
+    }
+
+    uint8_t size = prefix & 0x03;
+    if (size == 3) size = 4;
+    if (pos + size > length) {
+      ESP_LOGW(TAG, "Report map %u truncated at offset %u.", map_index, (unsigned)pos);
+      return false;
+    }
+
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++) value |= (uint32_t)map[pos + i] << (8 * i);
+    int32_t svalue = value;
+    if ((size > 0) && (size < 4) && (value & (1U << (8 * size - 1)))) {
+      svalue = (int32_t)(value | ~((1U << (8 * size)) - 1)); // Sign extension
+    }
+    pos += size;
+
+    switch (prefix & 0xFC) {
+      case ITEM_USAGE_PAGE:
+        globals.usage_page = value;
+        break;
+      case ITEM_LOGICAL_MIN:
+        globals.logical_min = svalue;
+        break;
+      case ITEM_LOGICAL_MAX:
+        // Logical Maximum is unsigned when Logical Minimum is not negative
+        globals.logical_max = (globals.logical_min >= 0) ? (int32_t)value : svalue;
+        break;
+      case ITEM_REPORT_SIZE:
+        globals.report_size = value;
+        break;
+      case ITEM_REPORT_ID:
+        globals.report_id = value;
+        break;
+      case ITEM_REPORT_COUNT:
+        globals.report_count = value;
+        break;
+      case ITEM_PUSH:
+        if (stack_depth < MAX_STACK) stack[stack_depth++] = globals;
+        break;
+      case ITEM_POP:
+        if (stack_depth > 0) globals = stack[--stack_depth];
+        break;
+      case ITEM_USAGE:
+      case ITEM_USAGE_MIN:
+        if (!usage_given) {
+          usage_min   = (size == 4) ? value : value | ((uint32_t)globals.usage_page << 16);
+          usage_given = true;
+        }
+        break;
+      case ITEM_INPUT:
+        {
+          uint8_t i = 0;
+          while ((i < offset_count) && (offsets[i].report_id != globals.report_id)) i++;
+          if (i == offset_count) {
+            if (offset_count == MAX_OFFSETS) return false;
+            offsets[offset_count++] = {globals.report_id, 0};
+          }
+          uint32_t offset = offsets[i].bits;
+          offsets[i].bits += (uint32_t)globals.report_size * globals.report_count;
+
+          uint16_t page = usage_given ? (usage_min >> 16) : globals.usage_page;
+          if ((page != USAGE_PAGE_KEYBOARD) || (value & INPUT_CONSTANT) ||
+              (globals.report_size == 0) || (globals.report_count == 0) ||
+              (offset + (uint32_t)globals.report_size * globals.report_count > 0xFFFF)) {
+            break;
+          }
+
+          KeyboardReportLayout *layout = plan.find(map_index, globals.report_id);
+          if (layout == nullptr) {
+            if (plan.count == DecodePlan::MAX_REPORTS) {
+              ESP_LOGW(TAG, "Too many keyboard reports in report map %u.", map_index);
+              return false;
+            }
+            layout  = &plan.reports[plan.count++];
+            *layout = {.map_index         = map_index,
+                       .report_id         = globals.report_id,
+                       .modifier_offset   = KeyboardReportLayout::NO_FIELD,
+                       .array_offset      = KeyboardReportLayout::NO_FIELD,
+                       .array_count       = 0,
+                       .array_size        = 0,
+                       .array_usage_min   = 0,
+                       .array_logical_min = 0,
+                       .array_logical_max = 0,
+                       .bitmap_offset     = KeyboardReportLayout::NO_FIELD,
+                       .bitmap_count      = 0,
+                       .bitmap_usage_min  = 0};
+          }
+
+          uint8_t first_usage = usage_given ? (usage_min & 0xFF) : 0;
+          if ((value & INPUT_VARIABLE) && (globals.report_size == 1)) {
+            if ((first_usage == USAGE_LEFT_CTRL) && (globals.report_count >= 8)) {
+              layout->modifier_offset = offset;
+            } else if (layout->bitmap_offset == KeyboardReportLayout::NO_FIELD) {
+              layout->bitmap_offset    = offset;
+              layout->bitmap_count     = globals.report_count;
+              layout->bitmap_usage_min = first_usage;
+            }
+          } else if (!(value & INPUT_VARIABLE) && (globals.report_size <= 16) &&
+                     (layout->array_offset == KeyboardReportLayout::NO_FIELD)) {
+            layout->array_offset      = offset;
+            layout->array_count       = (globals.report_count > 255) ? 255 : globals.report_count;
+            layout->array_size        = globals.report_size;
+            layout->array_usage_min   = first_usage;
+            layout->array_logical_min = (globals.logical_min < 0) ? 0 : globals.logical_min;
+            layout->array_logical_max = globals.logical_max;
+          }
+          break;
+        }
+      default:
+        break;
+    }
+
+    // Local items only apply to the next main item
+    if ((prefix & 0x0C) == 0x00) {
+      usage_given = false;
+      usage_min   = 0;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Convert an input report to the boot keyboard layout, following a compiled layout
+ *
+ * The cost only depends on the layout: the modifier byte is extracted, then each key array
+ * entry, then the bitmap, loaded a word at a time into a KeyBitmap whose set bits are walked
+ * with count-trailing-zeros. Modifier usages
+ * found in the array or bitmap are folded into the modifier byte.
+ *
+ * @param layout Compiled layout of the report
+ * @param data Report data, without the report ID
+ * @param length Report data size in bytes
+ * @param out Receives the modifier byte, a zero byte and the usages of the pressed keys
+ * @param out_size Size of out in bytes
+ *
+ * @return Number of bytes written to out
+ */
+uint8_t ReportDecoder::decode(const KeyboardReportLayout &layout, const uint8_t *data,
+                              size_t length, uint8_t *out, uint8_t out_size) {
+  uint32_t bits  = length * 8;
+  uint8_t  count = 2;
+
+  memset(out, 0, out_size);
+
+  if ((layout.modifier_offset != KeyboardReportLayout::NO_FIELD) &&
+      (layout.modifier_offset + 8U <= bits)) {
+    out[0] = get_bits(data, layout.modifier_offset, 8);
+  }
+
+  if ((layout.array_offset != KeyboardReportLayout::NO_FIELD) &&
+      (layout.array_offset + (uint32_t)layout.array_size * layout.array_count <= bits)) {
+    uint16_t offset = layout.array_offset;
+    for (uint8_t i = 0; (i < layout.array_count) && (count < out_size); i++) {
+      uint16_t value = get_bits(data, offset, layout.array_size);
+      offset += layout.array_size;
+      if ((value < layout.array_logical_min) || (value > layout.array_logical_max)) continue;
+      add_usage(layout.array_usage_min + (value - layout.array_logical_min), out, count);
+    }
+  }
+
+  if ((layout.bitmap_offset != KeyboardReportLayout::NO_FIELD) &&
+      (layout.bitmap_offset + (uint32_t)layout.bitmap_count <= bits)) {
+    KeyBitmap keys;
+    keys.load(data, layout.bitmap_offset, layout.bitmap_count, layout.bitmap_usage_min);
+    keys.for_each([&](uint8_t usage) {
+      if (count < out_size) add_usage(usage, out, count);
+    });
+  }
+
+  uint8_t min_size = (out_size < 2 + BOOT_KEY_COUNT) ? out_size : 2 + BOOT_KEY_COUNT;
+  return (count < min_size) ? min_size : count;
+}
+
+/**
+ * @brief Extract the set of keys down from an input report, following a compiled layout
+ *
+ * Same walk as decode(), but the keys are accumulated in a KeyBitmap: the modifier byte is
+ * stored as usages 0xE0 - 0xE7, array entries are set one by one and the bitmap field is OR-ed
+ * in a word at a time.
+ *
+ * @param layout Compiled layout of the report
+ * @param data Report data, without the report ID
+ * @param length Report data size in bytes
+ * @param keys Receives the keys down. Cleared first.
+ *
+ * @return false if an array entry is ErrorRollOver (0x01)
+ */
+bool ReportDecoder::decode_keys(const KeyboardReportLayout &layout, const uint8_t *data,
+                                size_t length, KeyBitmap &keys) {
+  uint32_t bits     = length * 8;
+  bool     complete = true;
+
+  keys.clear();
+
+  if ((layout.modifier_offset != KeyboardReportLayout::NO_FIELD) &&
+      (layout.modifier_offset + 8U <= bits)) {
+    keys.set_byte(USAGE_LEFT_CTRL / 8, get_bits(data, layout.modifier_offset, 8));
+  }
+
+  if ((layout.array_offset != KeyboardReportLayout::NO_FIELD) &&
+      (layout.array_offset + (uint32_t)layout.array_size * layout.array_count <= bits)) {
+    uint16_t offset = layout.array_offset;
+    for (uint8_t i = 0; i < layout.array_count; i++) {
+      uint16_t value = get_bits(data, offset, layout.array_size);
+      offset += layout.array_size;
+      if ((value < layout.array_logical_min) || (value > layout.array_logical_max)) continue;
+      uint16_t usage = layout.array_usage_min + (value - layout.array_logical_min);
+      if (usage == USAGE_ERROR_ROLL_OVER) complete = false;
+      if ((usage > USAGE_ERROR_UNDEFINED) && (usage < 256)) keys.set(usage);
+    }
+  }
+
+  if ((layout.bitmap_offset != KeyboardReportLayout::NO_FIELD) &&
+      (layout.bitmap_offset + (uint32_t)layout.bitmap_count <= bits)) {
+    keys.load(data, layout.bitmap_offset, layout.bitmap_count, layout.bitmap_usage_min);
+    for (uint8_t usage = 0; usage <= USAGE_ERROR_UNDEFINED; usage++) keys.reset(usage);
+  }
+
+  return complete;
+}
+
+/**
+ * @brief Layout of a boot keyboard report of the given size
+ *
+ * @param length Report data size in bytes. Entries past the sixth key are accepted, as sent
+ *               by some keyboards that extend the boot layout.
+ */
+KeyboardReportLayout ReportDecoder::boot_layout(size_t length) {
+  uint8_t count = (length > 2 + 255) ? 255 : ((length > 2) ? length - 2 : 0);
+  return {.map_index         = 0,
+          .report_id         = 0,
+          .modifier_offset   = 0,
+          .array_offset      = 16,
+          .array_count       = count,
+          .array_size        = 8,
+          .array_usage_min   = 0,
+          .array_logical_min = 0,
+          .array_logical_max = 255,
+          .bitmap_offset     = KeyboardReportLayout::NO_FIELD,
+          .bitmap_count      = 0,
+          .bitmap_usage_min  = 0};
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "key_bitmap.hpp"
+
+/**
+ * @brief Where the keyboard fields of one input report are located
+ *
+ * All offsets are in bits from the start of the report data, as delivered by esp_hidh (without
+ * the report ID byte).
+ */
+struct KeyboardReportLayout {
+  static constexpr uint16_t NO_FIELD = 0xFFFF;
+
+  uint8_t  map_index;
+  uint8_t  report_id;       ///< 0 when the report map does not use report IDs
+  uint16_t modifier_offset; ///< 8 modifier bits (usages 0xE0 - 0xE7), or NO_FIELD
+
+  uint16_t array_offset; ///< Key array, or NO_FIELD
+  uint8_t  array_count;
+  uint8_t  array_size;       ///< Bits per entry
+  uint8_t  array_usage_min;  ///< Usage of logical value array_logical_min
+  uint8_t  array_logical_min;
+  uint16_t array_logical_max;
+
+  uint16_t bitmap_offset; ///< One bit per usage (NKRO), or NO_FIELD
+  uint16_t bitmap_count;
+  uint8_t  bitmap_usage_min;
+};
+
+/**
+ * @brief Keyboard input reports of a device, compiled from its report maps
+ *
+ * Built once when the device connects. The hot path only looks up the layout matching the
+ * (map_index, report_id) pair of an input report and runs decode() on it.
+ */
+struct DecodePlan {
+  static constexpr uint8_t MAX_REPORTS = 4;
+
+  uint8_t              count;
+  KeyboardReportLayout reports[MAX_REPORTS];
+
+  inline void clear() { count = 0; }
+
+  /// Layout of the given report, or nullptr when it carries no key
+  inline KeyboardReportLayout *find(uint8_t map_index, uint8_t report_id) {
+    for (uint8_t i = 0; i < count; i++) {
+      if ((reports[i].map_index == map_index) && (reports[i].report_id == report_id)) {
+        return &reports[i];
+      }
+    }
+    return nullptr;
+  }
+  inline const KeyboardReportLayout *find(uint8_t map_index, uint8_t report_id) const {
+    return const_cast<DecodePlan *>(this)->find(map_index, report_id);
+  }
+};
+
+/**
+ * @brief HID report descriptor interpreter
+ */
+class ReportDecoder {
+public:
+  /// Key slots in a decoded report when the device reports fewer (boot keyboard layout)
+  static constexpr uint8_t BOOT_KEY_COUNT = 6;
+
+  /**
+   * @brief Add the keyboard input reports described by a report map to a plan
+   *
+   * Input items on the Keyboard/Keypad usage page (0x07) are recognized as the modifier bits,
+   * a key array or a key bitmap. Reports without any of them are not added to the plan.
+   *
+   * @return false if the report map is malformed or uses more reports than the plan can hold.
+   *         The reports found up to that point are kept.
+   */
+  static bool compile(const uint8_t *map, size_t length, uint8_t map_index, DecodePlan &plan);
+
+  /**
+   * @brief Convert an input report to the boot keyboard layout
+   *
+   * The output is the modifier byte, a reserved zero byte and the usages of the pressed keys
+   * (at least BOOT_KEY_COUNT slots, zero padded). Fields extending past `length` are ignored.
+   *
+   * @param out Receives the converted report
+   * @param out_size Size of out, at least 2 + BOOT_KEY_COUNT
+   * @return Number of bytes written to out
+   */
+  static uint8_t decode(const KeyboardReportLayout &layout, const uint8_t *data, size_t length,
+                        uint8_t *out, uint8_t out_size);
+
+  /**
+   * @brief Extract the set of keys down from an input report
+   *
+   * @param keys Receives the keys down, modifiers included as usages 0xE0 - 0xE7
+   * @return false if the key array reports ErrorRollOver, in which case only the modifiers
+   *         are valid
+   */
+  static bool decode_keys(const KeyboardReportLayout &layout, const uint8_t *data, size_t length,
+                          KeyBitmap &keys);
+
+  /// Layout used for devices without a usable report map: modifier byte, reserved byte and a
+  /// key array filling the rest of the report
+  static KeyboardReportLayout boot_layout(size_t length);
+
+private:
+  static constexpr char const *TAG = "ReportDecoder";
+
+  static inline uint16_t get_bits(const uint8_t *data, uint16_t offset, uint8_t size) {
+    const uint8_t *p     = data + (offset >> 3);
+    uint32_t       value = p[0] | (size + (offset & 7) > 8 ? p[1] << 8 : 0) |
+                     (size + (offset & 7) > 16 ? p[2] << 16 : 0);
+    return (value >> (offset & 7)) & ((1U << size) - 1);
+  }
+
+  static inline void add_usage(uint16_t usage, uint8_t *out, uint8_t &count) {
+    if ((usage >= 0xE0) && (usage <= 0xE7)) {
+      out[0] |= 1 << (usage - 0xE0);
+    } else if ((usage != 0) && (usage < 0xE0)) {
+      out[count++] = usage;
+    }
+  }
+};
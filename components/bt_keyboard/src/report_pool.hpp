@@ -0,0 +1,219 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+class ReportHandle;
+
+/**
+ * @brief Fixed-size pool of HID input report buffers
+ *
+ * All buffers are allocated once by init(), or given as a Storage. Afterwards, allocate() and
+ * release() never touch the heap and never block: a buffer is taken by setting its bit in a
+ * free bitmap with a compare-and-swap, and given back by clearing it once its reference count
+ * drops to zero.
+ *
+ * A report is copied exactly once, from the esp_hidh event into a pool buffer. It then travels
+ * by index through the event ring and reaches the application as a ReportHandle, which keeps a
+ * reference on the buffer for as long as it (or a copy of it) exists.
+ */
+class ReportPool {
+public:
+  static constexpr uint8_t MAX_REPORT_SIZE = 64;
+
+  typedef uint16_t Index;
+
+  static constexpr Index NO_REPORT = 0xFFFF;
+
+  /**
+   * @brief Allocate `count` report buffers
+   *
+   * @return false if count is 0 or too large, or if the allocation failed
+   */
+  bool init(uint16_t count) {
+    if ((count == 0) || (count >= NO_REPORT)) return false;
+
+    uint16_t words = (count + 31) / 32;
+    buffers_heap_  = std::unique_ptr<Buffer[]>(new (std::nothrow) Buffer[count]);
+    in_use_heap_   = std::unique_ptr<std::atomic<uint32_t>[]>(
+        new (std::nothrow) std::atomic<uint32_t>[words]);
+    if ((buffers_heap_ == nullptr) || (in_use_heap_ == nullptr)) return false;
+
+    attach(buffers_heap_.get(), in_use_heap_.get(), count);
+    return true;
+  }
+
+private:
+  struct Buffer {
+    std::atomic<uint16_t> refs{0};
+    uint8_t               size{0};
+    uint8_t               report_id{0};
+    uint8_t               device{0};
+    uint8_t               data[MAX_REPORT_SIZE];
+  };
+
+public:
+  /// Memory of a pool, to be given to init(Storage &) instead of taking it from the heap
+  template <uint16_t Count> struct Storage {
+    static_assert((Count > 0) && (Count < NO_REPORT));
+
+    Buffer                buffers[Count];
+    std::atomic<uint32_t> in_use[(Count + 31) / 32];
+  };
+
+  /// Use `storage`, which must outlive the pool
+  template <uint16_t Count> inline void init(Storage<Count> &storage) {
+    attach(storage.buffers, storage.in_use, Count);
+  }
+
+  inline uint16_t capacity() const { return count_; }
+
+  /**
+   * @brief Take a free buffer, with a reference count of 1
+   *
+   * @return The buffer index, or NO_REPORT if all buffers are in use
+   */
+  Index allocate() {
+    for (uint16_t w = 0; w < words_; w++) {
+      uint32_t bits = in_use_[w].load(std::memory_order_relaxed);
+      while (bits != 0xFFFFFFFFU) {
+        uint32_t bit = __builtin_ctz(~bits);
+        if (in_use_[w].compare_exchange_weak(bits, bits | (1U << bit),
+                                             std::memory_order_acquire)) {
+          Index index = (w * 32) + bit;
+          buffers_[index].refs.store(1, std::memory_order_relaxed);
+          return index;
+        }
+      }
+    }
+    exhausted_.fetch_add(1, std::memory_order_relaxed);
+    return NO_REPORT;
+  }
+
+  /**
+   * @brief Copy a report into a buffer obtained from allocate()
+   *
+   * Reports longer than MAX_REPORT_SIZE are truncated.
+   */
+  inline void fill(Index index, const uint8_t *data, size_t length, uint8_t report_id = 0,
+                   uint8_t device = 0) {
+    Buffer &buffer   = buffers_[index];
+    buffer.size      = (length > MAX_REPORT_SIZE) ? MAX_REPORT_SIZE : length;
+    buffer.report_id = report_id;
+    buffer.device    = device;
+    memcpy(buffer.data, data, buffer.size);
+  }
+
+  /// Direct access to a buffer obtained from allocate(), to build a report in place
+  inline uint8_t *buffer(Index index) { return buffers_[index].data; }
+
+  /// Record the size of a report built in place with buffer()
+  inline void commit(Index index, uint8_t size, uint8_t report_id = 0, uint8_t device = 0) {
+    buffers_[index].size      = size;
+    buffers_[index].report_id = report_id;
+    buffers_[index].device    = device;
+  }
+
+  inline void retain(Index index) {
+    buffers_[index].refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  inline void release(Index index) {
+    if (buffers_[index].refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      in_use_[index / 32].fetch_and(~(1U << (index % 32)), std::memory_order_release);
+    }
+  }
+
+  /// Wrap a reference already owned by the caller (e.g. popped from the ring) into a handle
+  inline ReportHandle adopt(Index index);
+
+  /// Number of reports dropped because every buffer was in use
+  inline uint32_t get_exhausted_count() const {
+    return exhausted_.load(std::memory_order_relaxed);
+  }
+  inline void reset_exhausted_count() { exhausted_.store(0, std::memory_order_relaxed); }
+
+  /// Bytes taken from the heap by init(), 0 with a Storage
+  inline size_t memory_size() const {
+    if (buffers_heap_ == nullptr) return 0;
+    return count_ * sizeof(Buffer) + words_ * sizeof(std::atomic<uint32_t>);
+  }
+
+private:
+  friend class ReportHandle;
+
+  std::unique_ptr<Buffer[]>                buffers_heap_; // Memory allocated by init(), if any
+  std::unique_ptr<std::atomic<uint32_t>[]> in_use_heap_;
+  Buffer                                  *buffers_{nullptr};
+  std::atomic<uint32_t>                   *in_use_{nullptr};
+  uint16_t                                 count_{0};
+  uint16_t                                 words_{0};
+  std::atomic<uint32_t>                    exhausted_{0};
+
+  void attach(Buffer *buffers, std::atomic<uint32_t> *in_use, uint16_t count) {
+    uint16_t words = (count + 31) / 32;
+
+    // Bits past `count` in the last word are permanently marked as used
+    for (uint16_t i = 0; i < words; i++) in_use[i].store(0, std::memory_order_relaxed);
+    if (count & 31) in_use[words - 1].store(~((1U << (count & 31)) - 1));
+
+    buffers_ = buffers;
+    in_use_  = in_use;
+    count_   = count;
+    words_   = words;
+  }
+};
+
+/**
+ * @brief Reference-counted, read-only access to a pooled HID input report
+ *
+ * Copying a handle adds a reference on the same buffer, without copying the report. The buffer
+ * returns to the pool when the last handle referring to it is destroyed or reset. Handles must
+ * not outlive the BTKeyboard instance that produced them.
+ */
+class ReportHandle {
+public:
+  ReportHandle() = default;
+  ReportHandle(const ReportHandle &other) : pool_(other.pool_), index_(other.index_) {
+    if (pool_ != nullptr) pool_->retain(index_);
+  }
+  ReportHandle(ReportHandle &&other) noexcept : pool_(other.pool_), index_(other.index_) {
+    other.pool_ = nullptr;
+  }
+  ReportHandle &operator=(ReportHandle other) noexcept {
+    std::swap(pool_, other.pool_);
+    std::swap(index_, other.index_);
+    return *this;
+  }
+  ~ReportHandle() { reset(); }
+
+  inline void reset() {
+    if (pool_ != nullptr) pool_->release(index_);
+    pool_ = nullptr;
+  }
+
+  inline explicit operator bool() const { return pool_ != nullptr; }
+
+  inline const uint8_t *data() const { return pool_->buffers_[index_].data; }
+  inline uint8_t        size() const { return pool_->buffers_[index_].size; }
+  inline uint8_t        report_id() const { return pool_->buffers_[index_].report_id; }
+  inline uint8_t        device() const { return pool_->buffers_[index_].device; }
+  inline uint8_t        operator[](uint8_t i) const { return pool_->buffers_[index_].data[i]; }
+
+private:
+  friend class ReportPool;
+
+  ReportHandle(ReportPool *pool, ReportPool::Index index) : pool_(pool), index_(index) {}
+
+  ReportPool       *pool_{nullptr};
+  ReportPool::Index index_{0};
+};
+
+inline ReportHandle ReportPool::adopt(Index index) { return ReportHandle(this, index); }
@@ -0,0 +1,218 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "report_recording.hpp"
+
+#include <cstring>
+#include <new>
+
+// LEB128: 7 bits per byte, least significant first, high bit set on all bytes but the last
+static size_t put_varint(uint8_t *out, uint32_t value) {
+  size_t count = 0;
+  while (value >= 0x80) {
+    out[count++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[count++] = (uint8_t)value;
+  return count;
+}
+
+bool ReportRecorder::start(size_t capacity) {
+  release();
+  if (capacity < RecordingFormat::MAX_ENTRY_HEADER) return false;
+  ring_.reset(new (std::nothrow) uint8_t[capacity]);
+  if (ring_ == nullptr) return false;
+  capacity_ = capacity;
+  return true;
+}
+
+void ReportRecorder::release() {
+  ring_.reset();
+  capacity_      = 0;
+  head_          = 0;
+  used_          = 0;
+  last_time_us_  = 0;
+  timed_         = false;
+  report_count_  = 0;
+  dropped_count_ = 0;
+  for (uint8_t i = 0; i < RecordingFormat::MAX_DEVICES; i++) forget_maps(i);
+}
+
+bool ReportRecorder::record(int64_t time_us, uint8_t device, uint8_t map_index,
+                            uint8_t report_id, const uint8_t *data, size_t length) {
+  uint8_t header[RecordingFormat::MAX_ENTRY_HEADER];
+  size_t  header_size = 1;
+
+  if ((ring_ == nullptr) || (device >= RecordingFormat::MAX_DEVICES) || (length > UINT16_MAX)) {
+    return false;
+  }
+
+  int64_t  delta    = timed_ ? time_us - last_time_us_ : 0;
+  uint32_t delta_us = (delta < 0) ? 0 : ((delta > UINT32_MAX) ? UINT32_MAX : (uint32_t)delta);
+  last_time_us_     = time_us;
+  timed_            = true;
+
+  header[0] = device;
+  header_size += put_varint(&header[header_size], delta_us);
+  if (map_index != 0) {
+    header[0] |= RecordingFormat::TAG_MAP_INDEX;
+    header[header_size++] = map_index;
+  }
+  if (report_id != 0) {
+    header[0] |= RecordingFormat::TAG_REPORT_ID;
+    header[header_size++] = report_id;
+  }
+  header_size += put_varint(&header[header_size], length);
+
+  size_t entry_size = header_size + length;
+  if (entry_size > capacity_) {
+    dropped_count_++;
+    return false;
+  }
+  while (capacity_ - used_ < entry_size) drop_oldest();
+
+  for (size_t i = 0; i < entry_size; i++) {
+    ring_[head_] = (i < header_size) ? header[i] : data[i - header_size];
+    head_        = (head_ + 1 == capacity_) ? 0 : head_ + 1;
+  }
+  used_ += entry_size;
+  report_count_++;
+  return true;
+}
+
+// Remove the oldest report of the ring, whose entry starts at offset 0
+void ReportRecorder::drop_oldest() {
+  uint8_t tag    = at(0);
+  size_t  offset = 1;
+  while (at(offset++) & 0x80) {} // Delta
+  if (tag & RecordingFormat::TAG_MAP_INDEX) offset++;
+  if (tag & RecordingFormat::TAG_REPORT_ID) offset++;
+
+  uint32_t length = 0;
+  uint8_t  shift  = 0;
+  uint8_t  byte;
+  do {
+    byte = at(offset++);
+    length |= (uint32_t)(byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+
+  used_ -= offset + length;
+  report_count_--;
+  dropped_count_++;
+}
+
+bool ReportRecorder::set_maps(uint8_t device, const esp_hid_raw_report_map_t *maps,
+                              size_t count) {
+  if (device >= RecordingFormat::MAX_DEVICES) return false;
+  forget_maps(device);
+
+  size_t size = 0;
+  for (size_t i = 0; i < count; i++) size += 5 + maps[i].len;
+  if (size > 0) {
+    maps_[device].reset(new (std::nothrow) uint8_t[size]);
+    if (maps_[device] == nullptr) return false;
+  }
+
+  uint8_t *out = maps_[device].get();
+  for (size_t i = 0; i < count; i++) {
+    *out++ = RecordingFormat::TAG_REPORT_MAP | RecordingFormat::TAG_MAP_INDEX | device;
+    *out++ = (uint8_t)i;
+    out += put_varint(out, maps[i].len);
+    memcpy(out, maps[i].data, maps[i].len);
+    out += maps[i].len;
+  }
+  maps_size_[device]  = out - maps_[device].get();
+  maps_known_[device] = true;
+  return true;
+}
+
+void ReportRecorder::forget_maps(uint8_t device) {
+  if (device >= RecordingFormat::MAX_DEVICES) return;
+  maps_[device].reset();
+  maps_size_[device]  = 0;
+  maps_known_[device] = false;
+}
+
+size_t ReportRecorder::size() const {
+  size_t size = RecordingFormat::HEADER_SIZE + used_;
+  for (size_t maps_size : maps_size_) size += maps_size;
+  return size;
+}
+
+size_t ReportRecorder::copy_to(uint8_t *buffer, size_t size) const {
+  if (size < this->size()) return 0;
+
+  uint8_t *out = buffer;
+  memcpy(out, RecordingFormat::MAGIC, sizeof(RecordingFormat::MAGIC));
+  out[3] = RecordingFormat::FORMAT_VERSION;
+  out += RecordingFormat::HEADER_SIZE;
+
+  for (uint8_t i = 0; i < RecordingFormat::MAX_DEVICES; i++) {
+    if (maps_size_[i] == 0) continue;
+    memcpy(out, maps_[i].get(), maps_size_[i]);
+    out += maps_size_[i];
+  }
+
+  // The reports end at head_ and may wrap around the end of the ring
+  if (used_ > 0) {
+    size_t tail  = (head_ + capacity_ - used_) % capacity_;
+    size_t first = (tail + used_ <= capacity_) ? used_ : capacity_ - tail;
+    memcpy(out, &ring_[tail], first);
+    memcpy(out + first, &ring_[0], used_ - first);
+  }
+  return out + used_ - buffer;
+}
+
+RecordingReader::RecordingReader(const uint8_t *data, size_t size)
+    : data_(data), size_(size), offset_(RecordingFormat::HEADER_SIZE) {
+  valid_ = (data != nullptr) && (size >= RecordingFormat::HEADER_SIZE) &&
+           (memcmp(data, RecordingFormat::MAGIC, sizeof(RecordingFormat::MAGIC)) == 0) &&
+           (data[3] == RecordingFormat::FORMAT_VERSION);
+}
+
+bool RecordingReader::read_varint(uint32_t &value) {
+  value = 0;
+  for (uint8_t shift = 0; (shift < 35) && (offset_ < size_); shift += 7) {
+    uint8_t byte = data_[offset_++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+bool RecordingReader::next(RecordedEntry &entry) {
+  if (!valid_ || (offset_ >= size_)) return false;
+
+  size_t  start = offset_;
+  uint8_t tag   = data_[offset_++];
+  bool    map   = tag & RecordingFormat::TAG_REPORT_MAP;
+
+  entry.kind      = map ? RecordedEntry::Kind::REPORT_MAP : RecordedEntry::Kind::REPORT;
+  entry.device    = tag & RecordingFormat::TAG_DEVICE;
+  entry.map_index = 0;
+  entry.report_id = 0;
+  entry.delta_us  = 0;
+
+  uint32_t length = 0;
+  bool     ok     = map || read_varint(entry.delta_us);
+  if (ok && (tag & RecordingFormat::TAG_MAP_INDEX)) {
+    ok = offset_ < size_;
+    if (ok) entry.map_index = data_[offset_++];
+  }
+  if (ok && (tag & RecordingFormat::TAG_REPORT_ID)) {
+    ok = offset_ < size_;
+    if (ok) entry.report_id = data_[offset_++];
+  }
+  ok = ok && read_varint(length) && (length <= UINT16_MAX) && (length <= size_ - offset_);
+  if (!ok) {
+    offset_ = start;
+    return false;
+  }
+
+  entry.length = length;
+  entry.data   = &data_[offset_];
+  offset_ += length;
+  return true;
+}
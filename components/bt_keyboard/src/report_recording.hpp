@@ -0,0 +1,157 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "esp_hid_common.h"
+
+/**
+ * @brief Binary format of a recording of raw input reports
+ *
+ * A recording starts with the 4 bytes "BKR" and FORMAT_VERSION, followed by entries. Each
+ * entry starts with a tag byte: the device index in its low 4 bits, TAG_MAP_INDEX and
+ * TAG_REPORT_ID when the matching byte follows (their value is 0 otherwise), and TAG_REPORT_MAP
+ * for a report map. Then:
+ *
+ * - report: delta timestamp (LEB128, microseconds since the previous report), [map index],
+ *   [report ID], length (LEB128), data
+ * - report map: map index, length (LEB128), data
+ *
+ * The report maps of a device precede its reports. A boot keyboard report arriving 16 ms to
+ * 2 s after the previous one takes 13 bytes.
+ */
+struct RecordingFormat {
+  static constexpr uint8_t MAGIC[3]       = {'B', 'K', 'R'};
+  static constexpr uint8_t FORMAT_VERSION = 1;
+  static constexpr size_t  HEADER_SIZE    = 4;
+
+  static constexpr uint8_t MAX_DEVICES    = 16;
+  static constexpr uint8_t TAG_DEVICE     = 0x0F;
+  static constexpr uint8_t TAG_MAP_INDEX  = 0x10;
+  static constexpr uint8_t TAG_REPORT_ID  = 0x20;
+  static constexpr uint8_t TAG_REPORT_MAP = 0x80;
+
+  /// Longest entry header: tag, 5-byte delta, map index, report ID, 3-byte length
+  static constexpr size_t MAX_ENTRY_HEADER = 11;
+};
+
+/// Entry of a recording, see RecordingReader::next(). `data` points into the recording.
+struct RecordedEntry {
+  enum class Kind : uint8_t { REPORT, REPORT_MAP };
+
+  Kind           kind;
+  uint8_t        device;
+  uint8_t        map_index;
+  uint8_t        report_id; ///< 0 for a report map, or a report without ID
+  uint32_t       delta_us;  ///< Time since the previous report, 0 for a report map
+  uint16_t       length;
+  const uint8_t *data;
+};
+
+/**
+ * @brief Ring of the latest input reports received, in the RecordingFormat, held in RAM
+ *
+ * The reports are appended as they arrive; once the ring is full, the oldest ones are dropped
+ * to make room. The report maps of each device are kept apart, so that they are never dropped,
+ * and are written ahead of the reports by copy_to(). Not thread-safe.
+ */
+class ReportRecorder {
+public:
+  /// Allocate a ring of `capacity` bytes, dropping the previous recording
+  bool start(size_t capacity);
+
+  /// Free the ring and the report maps
+  void release();
+
+  inline bool is_started() const { return ring_ != nullptr; }
+
+  /**
+   * @brief Append a report
+   *
+   * @param time_us Reception time, esp_timer_get_time()
+   * @return false if the report does not fit in the ring, or the device index is too high
+   */
+  bool record(int64_t time_us, uint8_t device, uint8_t map_index, uint8_t report_id,
+              const uint8_t *data, size_t length);
+
+  /// Keep a copy of the report maps of a device, replacing the previous ones
+  bool set_maps(uint8_t device, const esp_hid_raw_report_map_t *maps, size_t count);
+
+  /// Forget the report maps of a device, when another keyboard takes its slot
+  void forget_maps(uint8_t device);
+
+  inline bool has_maps(uint8_t device) const {
+    return (device < RecordingFormat::MAX_DEVICES) && maps_known_[device];
+  }
+
+  /// Size of the recording given by copy_to()
+  size_t size() const;
+
+  /**
+   * @brief Write the recording: header, report maps, then the reports, oldest first
+   *
+   * The first report keeps the delta from the report dropped before it, if any.
+   *
+   * @return Bytes written, 0 if `size` is below size()
+   */
+  size_t copy_to(uint8_t *buffer, size_t size) const;
+
+  inline uint32_t report_count() const { return report_count_; }
+  inline uint32_t dropped_count() const { return dropped_count_; }
+
+  /// Bytes held: the ring and the report maps
+  inline size_t memory_size() const {
+    size_t size = capacity_;
+    for (size_t maps_size : maps_size_) size += maps_size;
+    return size;
+  }
+
+private:
+  std::unique_ptr<uint8_t[]> ring_;
+  size_t                     capacity_      = 0;
+  size_t                     head_          = 0; // Next byte written
+  size_t                     used_          = 0;
+  int64_t                    last_time_us_  = 0;
+  bool                       timed_         = false; // last_time_us_ is set
+  uint32_t                   report_count_  = 0; // Reports in the ring
+  uint32_t                   dropped_count_ = 0; // Reports dropped since start()
+
+  std::unique_ptr<uint8_t[]> maps_[RecordingFormat::MAX_DEVICES];
+  size_t                     maps_size_[RecordingFormat::MAX_DEVICES]  = {};
+  bool                       maps_known_[RecordingFormat::MAX_DEVICES] = {};
+
+  inline uint8_t at(size_t offset) const {
+    return ring_[(head_ + capacity_ - used_ + offset) % capacity_];
+  }
+  void drop_oldest();
+};
+
+/**
+ * @brief Walks the entries of a recording, checking that each one lies within it
+ */
+class RecordingReader {
+public:
+  RecordingReader(const uint8_t *data, size_t size);
+
+  /// false if the recording does not start with the header of this format version
+  inline bool valid() const { return valid_; }
+
+  /// Next entry, false at the end of the recording or on a truncated entry
+  bool next(RecordedEntry &entry);
+
+  /// true once all the entries were read, false if a truncated one stopped next()
+  inline bool complete() const { return valid_ && (offset_ == size_); }
+
+private:
+  const uint8_t *data_;
+  size_t         size_;
+  size_t         offset_;
+  bool           valid_;
+
+  bool read_varint(uint32_t &value);
+};
@@ -0,0 +1,140 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "scan_store.hpp"
+
+#include <cstring>
+#include <new>
+
+bool ScanStore::init(uint16_t capacity, uint16_t names_size) {
+  if ((capacity == 0) || (capacity > 0x7FFF)) return false;
+
+  uint32_t buckets = bucket_count(capacity);
+  results_heap_    = std::unique_ptr<ScanResult[]>(new (std::nothrow) ScanResult[capacity]);
+  buckets_heap_    = std::unique_ptr<Bucket[]>(new (std::nothrow) Bucket[buckets]);
+  names_heap_      = std::unique_ptr<char[]>(new (std::nothrow) char[names_size ? names_size : 1]);
+  if ((results_heap_ == nullptr) || (buckets_heap_ == nullptr) || (names_heap_ == nullptr)) {
+    return false;
+  }
+
+  attach(results_heap_.get(), capacity, buckets_heap_.get(), buckets, names_heap_.get(),
+         names_size);
+  return true;
+}
+
+void ScanStore::attach(ScanResult *results, uint16_t capacity, Bucket *buckets,
+                       uint32_t bucket_count, char *names, uint16_t names_size) {
+  memset(buckets, 0, bucket_count * sizeof(Bucket));
+  results_    = results;
+  buckets_    = buckets;
+  names_      = names;
+  capacity_   = capacity;
+  mask_       = bucket_count - 1;
+  names_size_ = names_size;
+  generation_ = 1;
+  count_      = 0;
+  names_used_ = 0;
+}
+
+void ScanStore::clear() {
+  count_      = 0;
+  names_used_ = 0;
+  if (++generation_ == 0) {
+    // Once every 65535 scans: stale stamps could match again
+    memset(buckets_, 0, (mask_ + 1) * sizeof(Bucket));
+    generation_ = 1;
+  }
+}
+
+uint16_t ScanStore::bucket_of(const esp_bd_addr_t bda, esp_hid_transport_t transport) const {
+  uint64_t key = (uint64_t)transport << 48;
+  for (uint8_t i = 0; i < ESP_BD_ADDR_LEN; i++) key |= (uint64_t)bda[i] << (8 * i);
+  return (uint16_t)((key * 0x9E3779B97F4A7C15ULL) >> 48) & mask_;
+}
+
+ScanResult *ScanStore::find(const esp_bd_addr_t bda, esp_hid_transport_t transport) {
+  if (capacity_ == 0) return nullptr;
+
+  for (uint16_t b = bucket_of(bda, transport);; b = (b + 1) & mask_) {
+    if (buckets_[b].generation != generation_) return nullptr;
+    ScanResult &result = results_[buckets_[b].index];
+    if ((result.transport == transport) &&
+        (memcmp(result.bda, bda, sizeof(esp_bd_addr_t)) == 0)) {
+      return &result;
+    }
+  }
+}
+
+// Appends a result for a device known not to be in the store
+ScanResult *ScanStore::insert(const esp_bd_addr_t bda, esp_hid_transport_t transport) {
+  if (count_ == capacity_) {
+    dropped_++;
+    return nullptr;
+  }
+
+  uint16_t b = bucket_of(bda, transport);
+  while (buckets_[b].generation == generation_) b = (b + 1) & mask_;
+  buckets_[b] = {.index = count_, .generation = generation_};
+
+  ScanResult &result = results_[count_++];
+  memcpy(result.bda, bda, sizeof(esp_bd_addr_t));
+  result.transport = transport;
+  result.name      = std::string_view();
+  return &result;
+}
+
+std::string_view ScanStore::store_name(const uint8_t *name, uint8_t name_len) {
+  if ((name == nullptr) || (name_len == 0)) return std::string_view();
+  if (names_size_ - names_used_ < name_len) {
+    dropped_names_++;
+    return std::string_view();
+  }
+
+  char *copy = &names_[names_used_];
+  memcpy(copy, name, name_len);
+  names_used_ += name_len;
+  return std::string_view(copy, name_len);
+}
+
+ScanResult *ScanStore::add_ble(const esp_bd_addr_t bda, esp_ble_addr_type_t addr_type,
+                               uint16_t appearance, const uint8_t *name, uint8_t name_len,
+                               int rssi) {
+  if (find(bda, ESP_HID_TRANSPORT_BLE) != nullptr) return nullptr;
+
+  ScanResult *result = insert(bda, ESP_HID_TRANSPORT_BLE);
+  if (result == nullptr) return nullptr;
+
+  result->ble.appearance = appearance;
+  result->ble.addr_type  = addr_type;
+  result->usage          = esp_hid_usage_from_appearance(appearance);
+  result->rssi           = rssi;
+  result->name           = store_name(name, name_len);
+  return result;
+}
+
+ScanResult *ScanStore::add_bt(const esp_bd_addr_t bda, const esp_bt_cod_t &cod,
+                              const esp_bt_uuid_t &uuid, const uint8_t *name, uint8_t name_len,
+                              int rssi) {
+  ScanResult *result = find(bda, ESP_HID_TRANSPORT_BT);
+  if (result != nullptr) {
+    // Some info may come later
+    if (result->name.empty()) result->name = store_name(name, name_len);
+    if ((result->bt.uuid.len == 0) && uuid.len) result->bt.uuid = uuid;
+    if (rssi != 0) result->rssi = rssi;
+    return result;
+  }
+
+  result = insert(bda, ESP_HID_TRANSPORT_BT);
+  if (result == nullptr) return nullptr;
+
+  uint32_t codv;
+  memcpy(&codv, &cod, sizeof(uint32_t));
+
+  result->bt.cod  = cod;
+  result->bt.uuid = uuid;
+  result->usage   = esp_hid_usage_from_cod(codv);
+  result->rssi    = rssi;
+  result->name    = store_name(name, name_len);
+  return result;
+}
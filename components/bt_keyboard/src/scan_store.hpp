@@ -0,0 +1,152 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "esp_bt_defs.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gap_bt_api.h"
+#include "esp_hid_common.h"
+
+/// A HID device found by a BLE scan or a BT inquiry
+struct ScanResult {
+  esp_bd_addr_t       bda;
+  std::string_view    name; ///< Points into the ScanStore name arena, valid until clear()
+  int8_t              rssi;
+  esp_hid_usage_t     usage;
+  esp_hid_transport_t transport; // BT, BLE or USB
+
+  union {
+    struct {
+      esp_bt_cod_t  cod;
+      esp_bt_uuid_t uuid;
+    } bt;
+    struct {
+      esp_ble_addr_type_t addr_type;
+      uint16_t            appearance;
+    } ble;
+  };
+};
+
+/**
+ * @brief Fixed-capacity store of the devices found during a scan
+ *
+ * Results live in an array allocated once by init(), or given as a Storage, indexed by an open
+ * addressing table keyed by address and transport: finding a device costs a hash and a probe
+ * or two, whatever the number of advertisers around. Device names are copied into an arena.
+ * clear() empties everything in O(1) by bumping the generation number the index buckets are
+ * stamped with.
+ *
+ * Results keep their arrival order. Not thread-safe: filled by the Bluetooth stack task while
+ * a scan runs, read by the application once it is over.
+ */
+class ScanStore {
+public:
+  /**
+   * @brief Allocate the results, index and name arena
+   *
+   * @param capacity Maximum number of results per scan, up to 0x7FFF
+   * @param names_size Bytes available for device names per scan
+   * @return false if capacity is 0 or too large, or if the allocation failed
+   */
+  bool init(uint16_t capacity, uint16_t names_size);
+
+private:
+  struct Bucket {
+    uint16_t index;
+    uint16_t generation; // The bucket is empty unless it matches generation_
+  };
+
+  static constexpr uint32_t bucket_count(uint16_t capacity) {
+    uint32_t buckets = 1;
+    while (buckets < 2U * capacity) buckets <<= 1;
+    return buckets;
+  }
+
+public:
+  /// Memory of a store, to be given to init(Storage &) instead of taking it from the heap
+  template <uint16_t Capacity, uint16_t NamesSize> struct Storage {
+    static_assert((Capacity > 0) && (Capacity <= 0x7FFF) && (NamesSize > 0));
+
+    ScanResult results[Capacity];
+    Bucket     buckets[bucket_count(Capacity)];
+    char       names[NamesSize];
+  };
+
+  /// Use `storage`, which must outlive the store
+  template <uint16_t Capacity, uint16_t NamesSize>
+  inline void init(Storage<Capacity, NamesSize> &storage) {
+    attach(storage.results, Capacity, storage.buckets, bucket_count(Capacity), storage.names,
+           NamesSize);
+  }
+
+  /// Forget all results, in O(1)
+  void clear();
+
+  /// The result of a device, nullptr if not found
+  ScanResult *find(const esp_bd_addr_t bda, esp_hid_transport_t transport);
+
+  /**
+   * @brief Record a BLE advertiser. Already known devices are left untouched.
+   *
+   * @return The new result, nullptr if the device is already known or the store is full
+   */
+  ScanResult *add_ble(const esp_bd_addr_t bda, esp_ble_addr_type_t addr_type,
+                      uint16_t appearance, const uint8_t *name, uint8_t name_len, int rssi);
+
+  /**
+   * @brief Record a BT inquiry result. Information missing from a known device (name, UUID)
+   *        and the RSSI are updated.
+   *
+   * @return The result, nullptr if the store is full
+   */
+  ScanResult *add_bt(const esp_bd_addr_t bda, const esp_bt_cod_t &cod, const esp_bt_uuid_t &uuid,
+                     const uint8_t *name, uint8_t name_len, int rssi);
+
+  inline uint16_t size() const { return count_; }
+  inline uint16_t capacity() const { return capacity_; }
+
+  inline ScanResult *begin() { return results_; }
+  inline ScanResult *end() { return results_ + count_; }
+
+  /// Devices ignored because the store was full, and names dropped for lack of arena space,
+  /// since init() (not reset by clear())
+  inline uint32_t get_dropped_count() const { return dropped_; }
+  inline uint32_t get_dropped_names_count() const { return dropped_names_; }
+
+  /// Bytes taken from the heap by init(), 0 with a Storage
+  inline size_t memory_size() const {
+    if (results_heap_ == nullptr) return 0;
+    return capacity_ * sizeof(ScanResult) + (mask_ + 1) * sizeof(Bucket) +
+           (names_size_ ? names_size_ : 1);
+  }
+
+private:
+  static constexpr uint16_t NO_RESULT = 0xFFFF;
+
+  std::unique_ptr<ScanResult[]> results_heap_; // Memory allocated by init(), if any
+  std::unique_ptr<Bucket[]>     buckets_heap_;
+  std::unique_ptr<char[]>       names_heap_;
+  ScanResult                   *results_{nullptr};
+  Bucket                       *buckets_{nullptr};
+  char                         *names_{nullptr};
+  uint16_t                      capacity_{0};
+  uint16_t                      count_{0};
+  uint16_t                      mask_{0};
+  uint16_t                      generation_{1};
+  uint16_t                      names_size_{0};
+  uint16_t                      names_used_{0};
+  uint32_t                      dropped_{0};
+  uint32_t                      dropped_names_{0};
+
+  void             attach(ScanResult *results, uint16_t capacity, Bucket *buckets,
+                          uint32_t bucket_count, char *names, uint16_t names_size);
+  uint16_t         bucket_of(const esp_bd_addr_t bda, esp_hid_transport_t transport) const;
+  ScanResult      *insert(const esp_bd_addr_t bda, esp_hid_transport_t transport);
+  std::string_view store_name(const uint8_t *name, uint8_t name_len);
+};
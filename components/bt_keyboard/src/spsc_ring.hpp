@@ -0,0 +1,475 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @brief What a full ring does with an incoming item
+ *
+ * - DROP_NEWEST: The incoming item is rejected (historical xQueueSend(..., 0) behavior).
+ * - DROP_OLDEST: The oldest queued item is evicted to make room for the incoming one.
+ * - COALESCE:    The incoming item replaces the last one that could not be queued, so the
+ *                consumer always ends up with the latest state once it catches up.
+ */
+enum class OverflowPolicy : uint8_t { DROP_NEWEST, DROP_OLDEST, COALESCE };
+
+/**
+ * @brief Lock-free single-producer / single-consumer ring buffer
+ *
+ * Items are copied in and out of a caller provided, power-of-two sized storage. The producer
+ * never blocks: when the ring is full, the configured OverflowPolicy is applied and the
+ * matching drop counter is incremented. The consumer may block in wait_pop(), in which case it
+ * is woken up through a FreeRTOS task notification sent by push(). Task notifications are
+ * only used for wakeup, never to carry data. A consumer waiting for a batch of items in
+ * wait_pop_many() is only notified once the batch is complete.
+ *
+ * The producer and consumer indexes live on separate cache lines so the two tasks do not
+ * invalidate each other's line on every operation.
+ *
+ * When the DROP_OLDEST policy is active, the producer may advance the consumer index. Both
+ * sides then use a compare-and-swap on the consumer index and a consumer that loses the race
+ * discards the copy it made and retries. As the producer may be overwriting the slot being
+ * copied, slots are only accessed through relaxed atomics: the whole item when the target
+ * supports it lock-free, 32-bit words or bytes otherwise. This is why T must be trivially
+ * copyable.
+ *
+ * A second task with an occasional item to hand over, such as a timer, does not push: it posts
+ * the item in a slot of its own, which the consumer takes once the ring is empty. The producer
+ * can withdraw it with cancel_post(), for instance before pushing an item that must not come
+ * after it.
+ *
+ * @tparam T Item type.
+ */
+template <typename T> class SpscRing {
+  static_assert(std::is_trivially_copyable_v<T>, "SpscRing items must be trivially copyable");
+
+public:
+  enum class PushResult : uint8_t {
+    STORED,   ///< Item queued, nothing lost.
+    EVICTED,  ///< Item queued, `displaced` received an older item that will never be consumed.
+    REJECTED  ///< Item not queued (DROP_NEWEST, or COALESCE slot busy).
+  };
+
+  struct Stats {
+    uint32_t pushed;         ///< Items accepted by push() (including coalesced ones)
+    uint32_t dropped_newest; ///< Incoming items rejected
+    uint32_t dropped_oldest; ///< Queued items evicted by newer ones
+    uint32_t coalesced;      ///< Items overwritten in the coalescing slot
+  };
+
+  static constexpr size_t CACHE_LINE_SIZE = 64; // Covers ESP32 (32) and host (64) lines
+
+  /**
+   * @brief Attach the ring to its storage
+   *
+   * @param storage Array of `capacity` items, must outlive the ring
+   * @param capacity Number of items, must be a power of two
+   * @return false if the capacity is not a power of two
+   */
+  bool init(T *storage, uint32_t capacity) {
+    if ((capacity == 0) || ((capacity & (capacity - 1)) != 0)) return false;
+    slots_ = storage;
+    mask_  = capacity - 1;
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    latest_state_.store(SLOT_EMPTY, std::memory_order_relaxed);
+    posted_state_.store(SLOT_EMPTY, std::memory_order_relaxed);
+    return true;
+  }
+
+  inline void           set_policy(OverflowPolicy policy) { policy_ = policy; }
+  inline OverflowPolicy get_policy() const { return policy_; }
+  inline uint32_t       capacity() const { return mask_ + 1; }
+  inline uint32_t       size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  /// Items ready for the consumer, the coalescing and posted slots included
+  inline uint32_t available() const {
+    return size() + (latest_state_.load(std::memory_order_acquire) == SLOT_FULL) +
+           (posted_state_.load(std::memory_order_acquire) == SLOT_FULL);
+  }
+
+  /**
+   * @brief Producer side: queue a copy of `item`
+   *
+   * @param item Item to queue
+   * @param displaced Receives the item lost because of this push when the result is
+   *                  EVICTED, so the caller can release anything it owns.
+   * @return PushResult
+   */
+  PushResult push(const T &item, T &displaced) {
+    PushResult result = PushResult::STORED;
+    uint32_t   head   = head_.load(std::memory_order_relaxed);
+    uint32_t   tail   = tail_.load(std::memory_order_acquire);
+
+    // Once the coalescing slot is in use, newer items must not overtake it through the ring
+    OverflowPolicy policy     = policy_.load(std::memory_order_relaxed);
+    bool           coalescing = latest_state_.load(std::memory_order_acquire) != SLOT_EMPTY;
+    bool           full       = (head - tail) > mask_;
+
+    if (coalescing || (full && (policy == OverflowPolicy::COALESCE))) {
+      result = coalesce(item, displaced);
+      if (result != PushResult::REJECTED) notify_consumer();
+      return result;
+    }
+
+    if (full) {
+      if (policy == OverflowPolicy::DROP_NEWEST) {
+        dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+        return PushResult::REJECTED;
+      }
+      if (tail_.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+        load_slot(slots_[tail & mask_], displaced);
+        dropped_oldest_.fetch_add(1, std::memory_order_relaxed);
+        result = PushResult::EVICTED;
+      }
+      // Otherwise the consumer just made room
+    }
+
+    store_slot(slots_[head & mask_], item);
+    head_.store(head + 1, std::memory_order_release);
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+
+    notify_consumer();
+    return result;
+  }
+
+  /**
+   * @brief Second producer side: post an item for the consumer, next to the ring
+   *
+   * The item is taken by the consumer once the ring and the coalescing slot are empty, so it
+   * may come after items pushed meanwhile. It replaces an item posted before and not taken yet.
+   *
+   * @param fill Called with the slot once it is claimed, writes the item and returns true, or
+   *             returns false to give up. A check made there cannot race with cancel_post():
+   *             either it sees what the producer did before cancelling, or the item is
+   *             withdrawn.
+   * @return true if the item was posted, false if given up, withdrawn or if the consumer was
+   *         taking the previous item
+   */
+  template <typename Fill> bool post(Fill fill) {
+    uint8_t state = posted_state_.load(std::memory_order_relaxed);
+    do {
+      if ((state == SLOT_BUSY) || (state == SLOT_CANCELLED)) {
+        dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    } while (!posted_state_.compare_exchange_weak(state, SLOT_BUSY, std::memory_order_seq_cst));
+    if (state == SLOT_FULL) coalesced_.fetch_add(1, std::memory_order_relaxed);
+
+    if (!fill(posted_)) {
+      posted_state_.store(SLOT_EMPTY, std::memory_order_release);
+      return false;
+    }
+    state = SLOT_BUSY;
+    if (!posted_state_.compare_exchange_strong(state, SLOT_FULL, std::memory_order_seq_cst)) {
+      posted_state_.store(SLOT_EMPTY, std::memory_order_release); // Withdrawn meanwhile
+      return false;
+    }
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    notify_consumer();
+    return true;
+  }
+
+  /**
+   * @brief Producer side: withdraw the item posted and not taken yet, if any
+   *
+   * An item being posted right now is withdrawn too. One the consumer is taking is not.
+   */
+  void cancel_post() {
+    uint8_t state = posted_state_.load(std::memory_order_seq_cst);
+    while ((state == SLOT_FULL) || (state == SLOT_BUSY)) {
+      uint8_t next = (state == SLOT_FULL) ? SLOT_EMPTY : SLOT_CANCELLED;
+      if (posted_state_.compare_exchange_weak(state, next, std::memory_order_seq_cst)) return;
+    }
+  }
+
+  /**
+   * @brief Consumer side: retrieve the oldest item without blocking
+   *
+   * @return true if an item was retrieved
+   */
+  bool pop(T &item) {
+    while (true) {
+      uint32_t tail = tail_.load(std::memory_order_acquire);
+      while (tail != head_.load(std::memory_order_acquire)) {
+        load_slot(slots_[tail & mask_], item);
+        if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel)) return true;
+        // The producer evicted this item while it was being copied: retry with the new tail
+      }
+
+      // The ring is empty: the coalescing slot, if used, holds the most recent item
+      uint8_t state = SLOT_FULL;
+      if (latest_state_.compare_exchange_strong(state, SLOT_BUSY, std::memory_order_acquire)) {
+        if (tail_.load(std::memory_order_acquire) != head_.load(std::memory_order_acquire)) {
+          // Items queued before the coalesced one showed up in the meantime: they go first
+          latest_state_.store(SLOT_FULL, std::memory_order_release);
+          continue;
+        }
+        item = latest_;
+        latest_state_.store(SLOT_EMPTY, std::memory_order_release);
+        return true;
+      }
+
+      // Then the posted item
+      state = SLOT_FULL;
+      if (!posted_state_.compare_exchange_strong(state, SLOT_BUSY, std::memory_order_seq_cst)) {
+        return false;
+      }
+      if ((size() != 0) || (latest_state_.load(std::memory_order_acquire) == SLOT_FULL)) {
+        // Items showed up in the meantime: they go first, unless the post is withdrawn
+        state = SLOT_BUSY;
+        if (!posted_state_.compare_exchange_strong(state, SLOT_FULL,
+                                                   std::memory_order_release)) {
+          posted_state_.store(SLOT_EMPTY, std::memory_order_release);
+        }
+        continue;
+      }
+      item = posted_;
+      posted_state_.store(SLOT_EMPTY, std::memory_order_release);
+      return true;
+    }
+  }
+
+  /**
+   * @brief Consumer side: retrieve up to `max` of the oldest items without blocking
+   *
+   * The items are copied in one pass and released to the producer with a single update of
+   * the consumer index.
+   *
+   * @return Number of items retrieved
+   */
+  uint32_t pop_many(T *items, uint32_t max) {
+    if (max == 0) return 0;
+
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    while (true) {
+      uint32_t count = head_.load(std::memory_order_acquire) - tail;
+      if (count == 0) return pop(items[0]) ? 1 : 0; // Only the coalescing and posted slots
+      if (count > max) count = max;
+
+      for (uint32_t i = 0; i < count; i++) load_slot(slots_[(tail + i) & mask_], items[i]);
+      if (tail_.compare_exchange_weak(tail, tail + count, std::memory_order_acq_rel)) {
+        return count;
+      }
+      // The producer evicted items while they were being copied: retry with the new tail
+    }
+  }
+
+  /**
+   * @brief Consumer side: retrieve a batch of items
+   *
+   * Waits up to `ticks` for a first item. Then, if fewer than `min_count` items are ready,
+   * waits up to `batch_ticks` more for the batch to fill up, without being woken up by each
+   * item. Whatever is ready is then retrieved, up to `max` items.
+   *
+   * @return Number of items retrieved, 0 on timeout
+   */
+  uint32_t wait_pop_many(T *items, uint32_t max, TickType_t ticks, uint32_t min_count = 1,
+                         TickType_t batch_ticks = 0) {
+    if (!wait_for(1, ticks)) return 0;
+    if (min_count > max) min_count = max;
+    if ((min_count > 1) && (batch_ticks > 0)) wait_for(min_count, batch_ticks);
+    return pop_many(items, max);
+  }
+
+  /**
+   * @brief Consumer side: have `task` notified by each push from now on, until a wait_pop() or
+   *        wait_pop_many() call ends
+   *
+   * For a consumer that sleeps on its task notification for other events as well, and pops
+   * the items without waiting.
+   */
+  inline void watch(TaskHandle_t task) {
+    wake_count_.store(1, std::memory_order_relaxed);
+    waiter_.store(task, std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief Consumer side: retrieve the oldest item, waiting up to `ticks` for one
+   *
+   * The calling task's notification value is used (and cleared) to sleep while the ring is
+   * empty.
+   *
+   * @return true if an item was retrieved, false on timeout
+   */
+  bool wait_pop(T &item, TickType_t ticks) {
+    if (pop(item)) return true;
+    if (ticks == 0) return false;
+
+    TickType_t start = xTaskGetTickCount();
+    waiter_.store(xTaskGetCurrentTaskHandle(), std::memory_order_seq_cst);
+
+    while (true) {
+      // Checked again after publishing the waiter so a concurrent push cannot be missed
+      if (pop(item)) break;
+
+      TickType_t remaining = portMAX_DELAY;
+      if (ticks != portMAX_DELAY) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= ticks) {
+          waiter_.store(nullptr, std::memory_order_relaxed);
+          return false;
+        }
+        remaining = ticks - elapsed;
+      }
+      ulTaskNotifyTake(pdTRUE, remaining);
+    }
+
+    waiter_.store(nullptr, std::memory_order_relaxed);
+    return true;
+  }
+
+  Stats get_stats() const {
+    return {pushed_.load(std::memory_order_relaxed),
+            dropped_newest_.load(std::memory_order_relaxed),
+            dropped_oldest_.load(std::memory_order_relaxed),
+            coalesced_.load(std::memory_order_relaxed)};
+  }
+
+  void reset_stats() {
+    pushed_.store(0, std::memory_order_relaxed);
+    dropped_newest_.store(0, std::memory_order_relaxed);
+    dropped_oldest_.store(0, std::memory_order_relaxed);
+    coalesced_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr uint8_t SLOT_EMPTY = 0;
+  static constexpr uint8_t SLOT_BUSY      = 1; // Being written or read
+  static constexpr uint8_t SLOT_FULL      = 2;
+  static constexpr uint8_t SLOT_CANCELLED = 3; // Posted slot withdrawn while busy
+
+  // Producer owned
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> pushed_{0};
+  std::atomic<uint32_t> dropped_newest_{0};
+  std::atomic<uint32_t> dropped_oldest_{0};
+  std::atomic<uint32_t> coalesced_{0};
+
+  // Consumer owned
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> tail_{0};
+  std::atomic<TaskHandle_t> waiter_{nullptr};
+  std::atomic<uint32_t>     wake_count_{1}; // Items the waiter needs before being notified
+
+  // Shared, read-mostly
+  alignas(CACHE_LINE_SIZE) T *slots_{nullptr};
+  uint32_t                    mask_{0};
+  std::atomic<OverflowPolicy> policy_{OverflowPolicy::DROP_OLDEST};
+
+  // Coalescing slot: holds the newest item while the ring is full. Once used, every newer item
+  // lands here until the consumer drained the ring and took it, which preserves ordering.
+  std::atomic<uint8_t> latest_state_{SLOT_EMPTY};
+  T                    latest_;
+
+  // Posted slot: the item of a second producer, see post()
+  std::atomic<uint8_t> posted_state_{SLOT_EMPTY};
+  T                    posted_;
+
+  // Unit of the slot accesses when T cannot be accessed atomically as a whole
+  using Word = std::conditional_t<(sizeof(T) % sizeof(uint32_t) == 0) &&
+                                      (alignof(T) >= alignof(uint32_t)),
+                                  uint32_t, uint8_t>;
+
+  static constexpr bool   WHOLE_ITEM = std::atomic_ref<T>::is_always_lock_free &&
+                                       (alignof(T) >= std::atomic_ref<T>::required_alignment);
+  static constexpr size_t WORDS      = sizeof(T) / sizeof(Word);
+
+  static inline void store_slot(T &slot, const T &item) {
+    if constexpr (WHOLE_ITEM) {
+      std::atomic_ref<T>(slot).store(item, std::memory_order_relaxed);
+    } else {
+      Word words[WORDS];
+      memcpy(words, &item, sizeof(T));
+      Word *dst = reinterpret_cast<Word *>(&slot);
+      for (size_t i = 0; i < WORDS; i++) {
+        std::atomic_ref<Word>(dst[i]).store(words[i], std::memory_order_relaxed);
+      }
+    }
+  }
+
+  static inline void load_slot(T &slot, T &item) {
+    if constexpr (WHOLE_ITEM) {
+      item = std::atomic_ref<T>(slot).load(std::memory_order_relaxed);
+    } else {
+      Word  words[WORDS];
+      Word *src = reinterpret_cast<Word *>(&slot);
+      for (size_t i = 0; i < WORDS; i++) {
+        words[i] = std::atomic_ref<Word>(src[i]).load(std::memory_order_relaxed);
+      }
+      memcpy(&item, words, sizeof(T));
+    }
+  }
+
+  PushResult coalesce(const T &item, T &displaced) {
+    uint8_t state = latest_state_.load(std::memory_order_acquire);
+    if ((state == SLOT_BUSY) ||
+        !latest_state_.compare_exchange_strong(state, SLOT_BUSY, std::memory_order_acquire)) {
+      // The consumer is taking the slot right now
+      dropped_newest_.fetch_add(1, std::memory_order_relaxed);
+      return PushResult::REJECTED;
+    }
+
+    PushResult result = PushResult::STORED;
+    if (state == SLOT_FULL) {
+      displaced = latest_;
+      coalesced_.fetch_add(1, std::memory_order_relaxed);
+      result = PushResult::EVICTED;
+    }
+    latest_ = item;
+    latest_state_.store(SLOT_FULL, std::memory_order_release);
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    return result;
+  }
+
+  inline void notify_consumer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    TaskHandle_t waiter = waiter_.load(std::memory_order_relaxed);
+    if ((waiter != nullptr) && (available() >= wake_count_.load(std::memory_order_relaxed))) {
+      xTaskNotifyGive(waiter);
+    }
+  }
+
+  /// Consumer side: wait up to `ticks` for `count` items to be ready
+  bool wait_for(uint32_t count, TickType_t ticks) {
+    if (count > capacity()) count = capacity();
+    if (available() >= count) return true;
+    if (ticks == 0) return false;
+
+    TickType_t start = xTaskGetTickCount();
+    bool       ready = false;
+    wake_count_.store(count, std::memory_order_relaxed);
+    waiter_.store(xTaskGetCurrentTaskHandle(), std::memory_order_seq_cst);
+
+    while (true) {
+      // Checked again after publishing the waiter so a concurrent push cannot be missed
+      if (available() >= count) {
+        ready = true;
+        break;
+      }
+
+      TickType_t remaining = portMAX_DELAY;
+      if (ticks != portMAX_DELAY) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= ticks) break;
+        remaining = ticks - elapsed;
+      }
+      ulTaskNotifyTake(pdTRUE, remaining);
+    }
+
+    waiter_.store(nullptr, std::memory_order_relaxed);
+    wake_count_.store(1, std::memory_order_relaxed);
+    return ready;
+  }
+};
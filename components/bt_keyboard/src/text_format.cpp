@@ -0,0 +1,104 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "text_format.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+
+// Low 4 bits of the minor class of a peripheral, as named by esp_hid_cod_minor_print()
+static const char *const cod_minor_types[] = {"GENERIC", "JOYSTICK", "GAMEPAD",    "REMOTE",
+                                              "SENSOR",  "TABLET",   "CARD_READER"};
+
+static constexpr uint8_t COD_MINOR_KEYBOARD = 0x10;
+static constexpr uint8_t COD_MINOR_MOUSE    = 0x20;
+
+TextFormatter::TextFormatter(char *buffer, size_t size)
+    : buffer_(buffer), size_(size), length_(0), truncated_(false) {
+  buffer_[0] = 0;
+}
+
+void TextFormatter::clear() {
+  length_    = 0;
+  truncated_ = false;
+  buffer_[0] = 0;
+}
+
+void TextFormatter::put(char c) {
+  if (length_ + 1 < size_) {
+    buffer_[length_++] = c;
+    buffer_[length_]   = 0;
+  } else {
+    truncated_ = true;
+  }
+}
+
+void TextFormatter::hex(uint32_t value, uint8_t digits) {
+  static const char digit_chars[] = "0123456789abcdef";
+  while (digits > 0) {
+    digits--;
+    put(digit_chars[(value >> (4 * digits)) & 0x0F]);
+  }
+}
+
+TextFormatter &TextFormatter::append(const char *format, ...) {
+  size_t  room = size_ - length_;
+  va_list args;
+  va_start(args, format);
+  int count = vsnprintf(buffer_ + length_, room, format, args);
+  va_end(args);
+
+  if (count < 0) {
+    buffer_[length_] = 0;
+    truncated_       = true;
+  } else if ((size_t)count >= room) {
+    length_    = size_ - 1;
+    truncated_ = true;
+  } else {
+    length_ += count;
+  }
+  return *this;
+}
+
+TextFormatter &TextFormatter::bda(const esp_bd_addr_t addr) {
+  for (int i = 0; i < 6; i++) {
+    if (i > 0) put(':');
+    hex(addr[i], 2);
+  }
+  return *this;
+}
+
+TextFormatter &TextFormatter::uuid(const esp_bt_uuid_t &uuid) {
+  if (uuid.len == ESP_UUID_LEN_16) {
+    append("UUID16: 0x");
+    hex(uuid.uuid.uuid16, 4);
+  } else if (uuid.len == ESP_UUID_LEN_32) {
+    append("UUID32: 0x");
+    hex(uuid.uuid.uuid32, 8);
+  } else if (uuid.len == ESP_UUID_LEN_128) {
+    append("UUID128: ");
+    for (int i = 0; i < 16; i++) {
+      if ((i == 4) || (i == 6) || (i == 8) || (i == 10)) put('-');
+      hex(uuid.uuid.uuid128[i], 2);
+    }
+  }
+  return *this;
+}
+
+TextFormatter &TextFormatter::cod_minor(uint8_t minor) {
+  if (minor & COD_MINOR_KEYBOARD) append("KEYBOARD");
+  if (minor & COD_MINOR_MOUSE) {
+    if (minor & COD_MINOR_KEYBOARD) put('+');
+    append("MOUSE");
+  }
+  if (minor & 0xF0) {
+    if ((minor & 0x0F) == 0) return *this;
+    put('+');
+  }
+  minor &= 0x0F;
+  if (minor < sizeof(cod_minor_types) / sizeof(*cod_minor_types)) {
+    append("%s", cod_minor_types[minor]);
+  }
+  return *this;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_bt_defs.h"
+
+/**
+ * @brief Text formatted into a buffer supplied by the caller, usually on the stack
+ *
+ * Nothing is allocated: text appended past the end of the buffer is dropped, the buffer stays
+ * NUL terminated and truncated() becomes true. The Bluetooth types are formatted as the
+ * ESP-IDF examples show them. The result is written where needed, with puts() or a log macro.
+ *
+ *     char          line[64];
+ *     TextFormatter out(line, sizeof(line));
+ *     out.bda(addr).append(", RSSI: %d", rssi);
+ *     puts(out.c_str());
+ */
+class TextFormatter {
+public:
+  /// `size` must be at least 1, for the terminating NUL
+  TextFormatter(char *buffer, size_t size);
+
+  /// Append printf-style formatted text
+  TextFormatter &append(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  /// Append a Bluetooth address as "xx:xx:xx:xx:xx:xx"
+  TextFormatter &bda(const esp_bd_addr_t addr);
+
+  /**
+   * @brief Append a UUID: "UUID16: 0xxxxx", "UUID32: 0xxxxxxxxx" or
+   *        "UUID128: xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx". Nothing for other lengths.
+   */
+  TextFormatter &uuid(const esp_bt_uuid_t &uuid);
+
+  /// Append the minor class of a HID peripheral, "KEYBOARD+MOUSE" for instance
+  TextFormatter &cod_minor(uint8_t minor);
+
+  /// Forget the text, to reuse the buffer
+  void clear();
+
+  inline const char *c_str() const { return buffer_; }
+  inline size_t      length() const { return length_; }
+  inline bool        truncated() const { return truncated_; }
+
+private:
+  char  *buffer_;
+  size_t size_;
+  size_t length_;
+  bool   truncated_;
+
+  void put(char c);
+  void hex(uint32_t value, uint8_t digits);
+};
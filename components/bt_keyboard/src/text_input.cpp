@@ -0,0 +1,56 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Dead key compositions. The lookup table is generated from this list at compile time by
+// make_compose_table() (see text_input.hpp) and ends up in flash as read-only data.
+
+#include "text_input.hpp"
+
+// clang-format off
+
+static constexpr Composition latin_compositions[] = {
+  {DEAD_GRAVE, 'a', 0xE0}, {DEAD_GRAVE, 'e', 0xE8}, {DEAD_GRAVE, 'i', 0xEC},
+  {DEAD_GRAVE, 'o', 0xF2}, {DEAD_GRAVE, 'u', 0xF9},
+  {DEAD_GRAVE, 'A', 0xC0}, {DEAD_GRAVE, 'E', 0xC8}, {DEAD_GRAVE, 'I', 0xCC},
+  {DEAD_GRAVE, 'O', 0xD2}, {DEAD_GRAVE, 'U', 0xD9},
+
+  {DEAD_ACUTE, 'a', 0xE1}, {DEAD_ACUTE, 'e', 0xE9}, {DEAD_ACUTE, 'i', 0xED},
+  {DEAD_ACUTE, 'o', 0xF3}, {DEAD_ACUTE, 'u', 0xFA}, {DEAD_ACUTE, 'y', 0xFD},
+  {DEAD_ACUTE, 'A', 0xC1}, {DEAD_ACUTE, 'E', 0xC9}, {DEAD_ACUTE, 'I', 0xCD},
+  {DEAD_ACUTE, 'O', 0xD3}, {DEAD_ACUTE, 'U', 0xDA}, {DEAD_ACUTE, 'Y', 0xDD},
+  {DEAD_ACUTE, 'c', 0x107}, {DEAD_ACUTE, 'C', 0x106}, {DEAD_ACUTE, 'n', 0x144},
+  {DEAD_ACUTE, 'N', 0x143}, {DEAD_ACUTE, 's', 0x15B}, {DEAD_ACUTE, 'S', 0x15A},
+  {DEAD_ACUTE, 'z', 0x17A}, {DEAD_ACUTE, 'Z', 0x179},
+
+  {DEAD_CIRCUMFLEX, 'a', 0xE2}, {DEAD_CIRCUMFLEX, 'e', 0xEA}, {DEAD_CIRCUMFLEX, 'i', 0xEE},
+  {DEAD_CIRCUMFLEX, 'o', 0xF4}, {DEAD_CIRCUMFLEX, 'u', 0xFB},
+  {DEAD_CIRCUMFLEX, 'A', 0xC2}, {DEAD_CIRCUMFLEX, 'E', 0xCA}, {DEAD_CIRCUMFLEX, 'I', 0xCE},
+  {DEAD_CIRCUMFLEX, 'O', 0xD4}, {DEAD_CIRCUMFLEX, 'U', 0xDB},
+  {DEAD_CIRCUMFLEX, 'c', 0x109}, {DEAD_CIRCUMFLEX, 'C', 0x108}, {DEAD_CIRCUMFLEX, 'g', 0x11D},
+  {DEAD_CIRCUMFLEX, 'G', 0x11C}, {DEAD_CIRCUMFLEX, 'h', 0x125}, {DEAD_CIRCUMFLEX, 'H', 0x124},
+  {DEAD_CIRCUMFLEX, 'j', 0x135}, {DEAD_CIRCUMFLEX, 'J', 0x134}, {DEAD_CIRCUMFLEX, 's', 0x15D},
+  {DEAD_CIRCUMFLEX, 'S', 0x15C}, {DEAD_CIRCUMFLEX, 'w', 0x175}, {DEAD_CIRCUMFLEX, 'W', 0x174},
+  {DEAD_CIRCUMFLEX, 'y', 0x177}, {DEAD_CIRCUMFLEX, 'Y', 0x176},
+
+  {DEAD_TILDE, 'a', 0xE3}, {DEAD_TILDE, 'o', 0xF5}, {DEAD_TILDE, 'n', 0xF1},
+  {DEAD_TILDE, 'A', 0xC3}, {DEAD_TILDE, 'O', 0xD5}, {DEAD_TILDE, 'N', 0xD1},
+  {DEAD_TILDE, 'i', 0x129}, {DEAD_TILDE, 'I', 0x128}, {DEAD_TILDE, 'u', 0x169},
+  {DEAD_TILDE, 'U', 0x168},
+
+  {DEAD_DIAERESIS, 'a', 0xE4}, {DEAD_DIAERESIS, 'e', 0xEB}, {DEAD_DIAERESIS, 'i', 0xEF},
+  {DEAD_DIAERESIS, 'o', 0xF6}, {DEAD_DIAERESIS, 'u', 0xFC}, {DEAD_DIAERESIS, 'y', 0xFF},
+  {DEAD_DIAERESIS, 'A', 0xC4}, {DEAD_DIAERESIS, 'E', 0xCB}, {DEAD_DIAERESIS, 'I', 0xCF},
+  {DEAD_DIAERESIS, 'O', 0xD6}, {DEAD_DIAERESIS, 'U', 0xDC}, {DEAD_DIAERESIS, 'Y', 0x178},
+};
+
+// clang-format on
+
+constexpr ComposeTable COMPOSE_LATIN = make_compose_table(latin_compositions);
+
+// A few spot checks, evaluated by the compiler
+static_assert(COMPOSE_LATIN.dead[DEAD_CIRCUMFLEX - DEAD_GRAVE]['e'] == 0xEA);
+static_assert(COMPOSE_LATIN.dead[DEAD_DIAERESIS - DEAD_GRAVE]['Y'] == 0x178);
+static_assert(COMPOSE_LATIN.dead[DEAD_ACUTE - DEAD_GRAVE][' '] == 0xB4);
+static_assert(COMPOSE_LATIN.dead[DEAD_GRAVE - DEAD_GRAVE]['x'] == 0);
+static_assert(COMPOSE_LATIN.compose['"'] == DEAD_DIAERESIS);
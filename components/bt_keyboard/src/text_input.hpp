@@ -0,0 +1,221 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "keymap.hpp"
+
+/**
+ * @brief Keys that produce no character
+ *
+ * Values follow the special key codes of the keymaps (0x80 - 0x9A), minus 0x7F.
+ */
+enum class NamedKey : uint8_t {
+  NONE,
+  CAPS_LOCK,
+  F1,
+  F2,
+  F3,
+  F4,
+  F5,
+  F6,
+  F7,
+  F8,
+  F9,
+  F10,
+  F11,
+  F12,
+  PRINT_SCREEN,
+  SCROLL_LOCK,
+  PAUSE,
+  INSERT,
+  HOME,
+  PAGE_UP,
+  END,
+  PAGE_DOWN,
+  RIGHT,
+  LEFT,
+  DOWN,
+  UP,
+  NUM_LOCK,
+  APPLICATION
+};
+
+/**
+ * @brief A character or a named key, as produced by BTKeyboard::wait_for_codepoint()
+ *
+ * Enter, Tab, Backspace, Escape and Delete are the control characters \r, \t, \b, 0x1B and
+ * 0x7F.
+ */
+struct TextInput {
+  char32_t codepoint; ///< Unicode character, 0 for a named key or no input
+  NamedKey key;       ///< NamedKey::NONE for a character
+
+  inline bool empty() const { return (codepoint == 0) && (key == NamedKey::NONE); }
+
+  /**
+   * @brief Encode the character in UTF-8
+   *
+   * @param out Receives up to 4 bytes, not NUL terminated
+   * @return Number of bytes written, 0 for a named key
+   */
+  uint8_t to_utf8(char *out) const {
+    char32_t c = codepoint;
+    if (c < 0x80) {
+      if (c == 0) return 0;
+      out[0] = (char)c;
+      return 1;
+    }
+    if (c < 0x800) {
+      out[0] = (char)(0xC0 | (c >> 6));
+      out[1] = (char)(0x80 | (c & 0x3F));
+      return 2;
+    }
+    if (c < 0x10000) {
+      out[0] = (char)(0xE0 | (c >> 12));
+      out[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+      out[2] = (char)(0x80 | (c & 0x3F));
+      return 3;
+    }
+    out[0] = (char)(0xF0 | (c >> 18));
+    out[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (c & 0x3F));
+    return 4;
+  }
+
+  /// Input of a keymap code (ASCII, special key or Latin-1 with EURO_SIGN), dead keys excluded
+  static constexpr TextInput from_code(uint8_t code) {
+    if ((code >= 0x80) && (code < Keymap::FIRST_DEAD)) return {0, (NamedKey)(code - 0x7F)};
+    if (code == EURO_SIGN) return {U'\u20AC', NamedKey::NONE};
+    return {code, NamedKey::NONE};
+  }
+};
+
+/// A dead key (or Compose sequence) followed by a base character, and the resulting character
+struct Composition {
+  uint8_t  dead; ///< DEAD_GRAVE .. DEAD_DIAERESIS
+  uint8_t  base; ///< ASCII
+  char32_t result;
+};
+
+/**
+ * @brief Dead key and Compose key tables
+ *
+ * `dead[d][base]` is the character produced by dead key `d` followed by the ASCII character
+ * `base`, 0 if they do not combine. `compose[c]` is the dead key selected by the Compose key
+ * followed by the ASCII character `c` (Compose ' is the same as the acute dead key), 0 if none.
+ */
+struct ComposeTable {
+  char16_t dead[Keymap::DEAD_COUNT][128];
+  uint8_t  compose[128];
+};
+
+/**
+ * @brief Expand a list of compositions into a ComposeTable, at compile time
+ *
+ * A dead key followed by a space produces its spacing character. The Compose key followed by
+ * the spacing character of a dead key (` ' ^ ~ ") selects that dead key.
+ */
+template <size_t N> constexpr ComposeTable make_compose_table(const Composition (&list)[N]) {
+  ComposeTable table{};
+
+  for (uint8_t d = 0; d < Keymap::DEAD_COUNT; d++) {
+    table.dead[d][' '] = Keymap::spacing(Keymap::FIRST_DEAD + d);
+  }
+  for (const Composition &c : list) table.dead[c.dead - Keymap::FIRST_DEAD][c.base] = c.result;
+
+  table.compose['`']  = DEAD_GRAVE;
+  table.compose['\''] = DEAD_ACUTE;
+  table.compose['^']  = DEAD_CIRCUMFLEX;
+  table.compose['~']  = DEAD_TILDE;
+  table.compose['"']  = DEAD_DIAERESIS;
+  return table;
+}
+
+extern const ComposeTable COMPOSE_LATIN; ///< Latin-1 and Latin Extended-A accented letters
+
+/**
+ * @brief Dead key and Compose sequence automaton
+ *
+ * Fed with keymap codes, one key at a time. Each transition is a single table lookup and the
+ * output is at most two inputs: the spacing character of a dead key that does not combine with
+ * the next key, followed by that key.
+ */
+class TextComposer {
+public:
+  inline void reset() { state_ = IDLE; }
+
+  /// The Compose key was pressed: the next two characters select a composition
+  inline void compose() { state_ = COMPOSE; }
+
+  /**
+   * @brief Feed the code produced by a key
+   *
+   * @param code Keymap code (translated key)
+   * @param out Receives the resulting inputs
+   * @return Number of inputs written to `out` (0 to 2)
+   */
+  uint8_t feed(uint8_t code, TextInput out[2]) {
+    if (code == 0) return 0;
+
+    if (state_ == COMPOSE) {
+      state_ = (code < 0x80) ? table_->compose[code] : 0;
+      if (state_ != IDLE) return 0;
+      if (Keymap::is_dead(code)) {
+        state_ = code;
+        return 0;
+      }
+      out[0] = TextInput::from_code(code);
+      return 1;
+    }
+
+    if (state_ == IDLE) {
+      if (Keymap::is_dead(code)) {
+        state_ = code;
+        return 0;
+      }
+      out[0] = TextInput::from_code(code);
+      return 1;
+    }
+
+    // A dead key is pending
+    uint8_t dead = state_;
+    state_       = IDLE;
+
+    if (code == dead) { // Twice the same dead key: its spacing character
+      out[0] = TextInput::from_code(Keymap::spacing(dead));
+      return 1;
+    }
+    if (code < 0x80) {
+      char32_t composed = table_->dead[dead - Keymap::FIRST_DEAD][code];
+      if (composed != 0) {
+        out[0] = {composed, NamedKey::NONE};
+        return 1;
+      }
+    }
+    if ((code < 0x20) || ((code >= 0x80) && (code < Keymap::FIRST_DEAD))) {
+      out[0] = TextInput::from_code(code); // Control or named key: the dead key is dropped
+      return 1;
+    }
+
+    out[0] = TextInput::from_code(Keymap::spacing(dead));
+    if (Keymap::is_dead(code)) {
+      state_ = code;
+      return 1;
+    }
+    out[1] = TextInput::from_code(code);
+    return 2;
+  }
+
+private:
+  static constexpr uint8_t IDLE    = 0;
+  static constexpr uint8_t COMPOSE = 1;
+
+  const ComposeTable *table_ = &COMPOSE_LATIN;
+  uint8_t             state_ = IDLE; // IDLE, COMPOSE or the pending dead key code
+};
@@ -0,0 +1,310 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Advertising data parsing benchmark.
+//
+// The payloads of bench/corpus/adv_corpus.txt (BLE advertising data with its
+// scan response, BT Classic EIR records) are parsed by:
+//
+// 1. multi-pass: the lookups previously done by the GAP callbacks of
+//    BTKeyboard, one esp_ble_resolve_adv_data_by_type() call per field of a BLE
+//    advertisement (4), up to 8 esp_bt_gap_resolve_eir_data() calls per EIR
+//    record, each one walking the payload from its start.
+// 2. AdvParser: the single-pass parser, filling all the fields at once.
+//
+// AdvParser must find the same appearance, names, flags and TX power as a
+// lookup of each type, and the HID service wherever it is listed. An
+// advertisement zero-padded to 31 bytes must not hide the name of its scan
+// response.
+//
+// Then the corpus seeds a fuzzing pass: payloads are mutated (bytes flipped,
+// length bytes rewritten, truncated, spliced) and parsed from a heap buffer of
+// their exact size, so that a sanitizer build catches any read past them. The
+// fields found must lie within the payload. The distribution of the parsing
+// times is reported: each byte being read at most once, it stays bounded by the
+// 240 bytes of the longest payload.
+//
+// Options: --corpus=PATH (default: the corpus of the source tree),
+//          --passes=N (default 20000): parses of the whole corpus per parser,
+//          --fuzz=N (default 200000): mutated payloads parsed
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "adv_parser.hpp"
+#include "bench_util.hpp"
+#include "esp_gap_ble_api.h"
+#include "esp_gap_bt_api.h"
+#include "esp_gatt_defs.h"
+
+struct Payload {
+  bool                 eir;
+  std::string          label;
+  std::vector<uint8_t> data;
+};
+
+static volatile uint32_t sink;
+
+static std::vector<Payload> load_corpus(const char *path) {
+  std::vector<Payload> corpus;
+  std::ifstream        file(path);
+  std::string          line, label;
+
+  while (std::getline(file, line)) {
+    if (line.empty()) continue;
+    if (line[0] == '#') {
+      label = line.substr(std::min<size_t>(2, line.size()));
+      continue;
+    }
+    size_t space = line.find(' ');
+    if (space == std::string::npos) continue;
+
+    Payload payload;
+    payload.eir   = (line.compare(0, space, "eir") == 0);
+    payload.label = label;
+    for (size_t i = space + 1; i + 1 < line.size(); i += 2) {
+      payload.data.push_back(strtoul(line.substr(i, 2).c_str(), nullptr, 16));
+    }
+    if (payload.eir) payload.data.resize(ESP_BT_GAP_EIR_DATA_LEN, 0);
+    corpus.push_back(payload);
+  }
+  return corpus;
+}
+
+// 1. What BTKeyboard::handle_ble_device_result() and handle_bt_device_result() used to do
+static uint32_t multi_pass_ble(uint8_t *adv, uint16_t length) {
+  uint8_t  len  = 0;
+  uint32_t hash = 0;
+
+  uint8_t *uuid = esp_ble_resolve_adv_data_by_type(adv, length, ESP_BLE_AD_TYPE_16SRV_CMPL, &len);
+  if ((uuid != nullptr) && len) hash += uuid[0] + (uuid[1] << 8);
+  uint8_t *appearance =
+      esp_ble_resolve_adv_data_by_type(adv, length, ESP_BLE_AD_TYPE_APPEARANCE, &len);
+  if ((appearance != nullptr) && len) hash += appearance[0] + (appearance[1] << 8);
+  uint8_t *name = esp_ble_resolve_adv_data_by_type(adv, length, ESP_BLE_AD_TYPE_NAME_CMPL, &len);
+  if (name == nullptr) {
+    name = esp_ble_resolve_adv_data_by_type(adv, length, ESP_BLE_AD_TYPE_NAME_SHORT, &len);
+  }
+  return hash + len;
+}
+
+static uint32_t multi_pass_eir(uint8_t *eir) {
+  static const esp_bt_eir_type_t uuid_types[] = {
+      ESP_BT_EIR_TYPE_CMPL_16BITS_UUID,  ESP_BT_EIR_TYPE_INCMPL_16BITS_UUID,
+      ESP_BT_EIR_TYPE_CMPL_32BITS_UUID,  ESP_BT_EIR_TYPE_INCMPL_32BITS_UUID,
+      ESP_BT_EIR_TYPE_CMPL_128BITS_UUID, ESP_BT_EIR_TYPE_INCMPL_128BITS_UUID};
+  uint8_t len = 0;
+
+  for (esp_bt_eir_type_t type : uuid_types) {
+    uint8_t *data = esp_bt_gap_resolve_eir_data(eir, type, &len);
+    if (data != nullptr) return data[0] + len;
+  }
+  uint8_t *name = esp_bt_gap_resolve_eir_data(eir, ESP_BT_EIR_TYPE_CMPL_LOCAL_NAME, &len);
+  if (name == nullptr) {
+    name = esp_bt_gap_resolve_eir_data(eir, ESP_BT_EIR_TYPE_SHORT_LOCAL_NAME, &len);
+  }
+  return len;
+}
+
+// Advertising data padded with zeros, as some keyboards send it, then the scan response with
+// the complete name. Parsed as BTKeyboard does, the name must be found.
+static bool padded_advertisement() {
+  static const char    NAME[] = "Padded Keyboard";
+  std::vector<uint8_t> adv    = {0x02, 0x01, 0x06, 0x03, 0x03, 0x12, 0x18, 0x03, 0x19, 0xC1, 0x03};
+  adv.resize(31, 0);
+  adv.push_back(sizeof(NAME));
+  adv.push_back(0x09);
+  adv.insert(adv.end(), NAME, NAME + sizeof(NAME) - 1);
+
+  AdvFields fields;
+  AdvParser::parse(adv.data(), 31, fields);
+  AdvParser::merge(&adv[31], adv.size() - 31, fields);
+  return fields.has_uuid16(ESP_GATT_UUID_HID_SVC) && (fields.appearance == 0x03C1) &&
+         fields.name_complete && (fields.name_len == sizeof(NAME) - 1) &&
+         (memcmp(fields.name, NAME, fields.name_len) == 0);
+}
+
+// 2. AdvParser
+static uint32_t single_pass(const uint8_t *data, size_t length) {
+  AdvFields fields;
+  AdvParser::parse(data, length, fields);
+  return fields.present + fields.appearance + fields.name_len + fields.uuid16_count;
+}
+
+// AdvParser against a lookup of each type. Returns false on a mismatch.
+static bool same_fields(Payload &p, bool &hid_found, bool &hid_missed_before) {
+  uint8_t  *data   = p.data.data();
+  uint16_t  length = p.data.size();
+  AdvFields fields;
+  AdvParser::parse(data, length, fields);
+
+  auto lookup = [&](uint8_t type, uint8_t &len) {
+    return esp_ble_resolve_adv_data_by_type(data, length, (esp_ble_adv_data_type)type, &len);
+  };
+  uint8_t        len  = 0;
+  const uint8_t *name = lookup(ESP_BLE_AD_TYPE_NAME_CMPL, len);
+  if (name == nullptr) name = lookup(ESP_BLE_AD_TYPE_NAME_SHORT, len);
+  bool same = (fields.name_len == len) && ((len == 0) || (memcmp(fields.name, name, len) == 0));
+
+  const uint8_t *appearance = lookup(ESP_BLE_AD_TYPE_APPEARANCE, len);
+  same &= (fields.appearance == ((len >= 2) ? (appearance[0] | (appearance[1] << 8)) : 0));
+  const uint8_t *flags = lookup(ESP_BLE_AD_TYPE_FLAG, len);
+  same &= (fields.flags == (len ? flags[0] : 0));
+  const uint8_t *tx_power = lookup(ESP_BLE_AD_TYPE_TX_PWR, len);
+  same &= (fields.tx_power == (len ? (int8_t)tx_power[0] : 0));
+
+  uint16_t       hid  = p.eir ? 0x1124 : ESP_GATT_UUID_HID_SVC;
+  const uint8_t *uuid = lookup(ESP_BLE_AD_TYPE_16SRV_CMPL, len);
+  bool found_before   = (uuid != nullptr) && (len >= 2) && ((uuid[0] | (uuid[1] << 8)) == hid);
+  hid_found           = fields.has_uuid16(hid);
+  hid_missed_before   = hid_found && !found_before;
+  return same && (hid_found || !found_before);
+}
+
+static double time_parser(std::vector<Payload> &corpus, long passes, bool single) {
+  uint32_t hash  = 0;
+  auto     start = bench::Clock::now();
+  for (long pass = 0; pass < passes; pass++) {
+    for (Payload &p : corpus) {
+      if (single) {
+        hash += single_pass(p.data.data(), p.data.size());
+      } else {
+        hash += p.eir ? multi_pass_eir(p.data.data())
+                      : multi_pass_ble(p.data.data(), p.data.size());
+      }
+    }
+  }
+  sink = hash;
+  return bench::elapsed_us(start, bench::Clock::now()) * 1000.0 / (passes * corpus.size());
+}
+
+static std::vector<uint8_t> mutate(const std::vector<Payload> &corpus, std::mt19937 &rng) {
+  std::vector<uint8_t> data = corpus[rng() % corpus.size()].data;
+  int                  ops  = 1 + rng() % 4;
+
+  for (int op = 0; op < ops; op++) {
+    switch (rng() % 5) {
+      case 0: // Flip a byte
+        if (!data.empty()) data[rng() % data.size()] ^= 1 << (rng() % 8);
+        break;
+      case 1: // Plausible or hostile length byte
+        if (!data.empty()) data[rng() % data.size()] = (rng() % 4) ? rng() % 40 : rng();
+        break;
+      case 2: // Truncate
+        data.resize(rng() % (data.size() + 1));
+        break;
+      case 3: // Splice the tail of another payload
+        {
+          const std::vector<uint8_t> &other = corpus[rng() % corpus.size()].data;
+          size_t                      from  = rng() % (other.size() + 1);
+          data.resize(rng() % (data.size() + 1));
+          data.insert(data.end(), other.begin() + from, other.end());
+          break;
+        }
+      default: // Random bytes
+        {
+          size_t count = rng() % 8;
+          size_t at    = rng() % (data.size() + 1);
+          for (size_t i = 0; i < count; i++) data.insert(data.begin() + at, (uint8_t)rng());
+          break;
+        }
+    }
+  }
+  if (data.size() > ESP_BT_GAP_EIR_DATA_LEN) data.resize(ESP_BT_GAP_EIR_DATA_LEN);
+  return data;
+}
+
+static bool fuzz(const std::vector<Payload> &corpus, long count) {
+  std::mt19937 rng(18);
+  long                malformed = 0;
+  std::vector<double> parse_ns;
+
+  for (long i = 0; i < count; i++) {
+    std::vector<uint8_t> bytes = mutate(corpus, rng);
+    // Exact size heap copy: the sanitizers see any read past the payload
+    uint8_t  *data   = new uint8_t[bytes.size() + (bytes.empty() ? 1 : 0)];
+    size_t    length = bytes.size();
+    AdvFields fields;
+    memcpy(data, bytes.data(), length);
+
+    auto start = bench::Clock::now();
+    for (int repeat = 0; repeat < 8; repeat++) {
+      if (!AdvParser::parse(data, length, fields) && (repeat == 0)) malformed++;
+    }
+    parse_ns.push_back(bench::elapsed_us(start, bench::Clock::now()) * 1000.0 / 8);
+
+    const uint8_t *end = data + length;
+    bool inside = (fields.uuid16_count <= AdvFields::MAX_UUID16) &&
+                  (!fields.has(AdvFields::NAME) ||
+                   ((fields.name > data) && (fields.name + fields.name_len <= end))) &&
+                  (!fields.has(AdvFields::UUID128) ||
+                   ((fields.uuid128 > data) && (fields.uuid128 + 16 <= end)));
+    delete[] data;
+    if (!inside) {
+      fprintf(stderr, "Fuzz payload %ld: field outside of the payload\n", i);
+      return false;
+    }
+  }
+  printf("  %ld mutated payloads, %ld malformed, fields always within the payload: ok\n", count,
+         malformed);
+  std::sort(parse_ns.begin(), parse_ns.end());
+  printf("  parse time: p50 %.0f ns, p99 %.0f ns, p99.99 %.0f ns (max %.0f ns, preemptions "
+         "included)\n",
+         parse_ns[parse_ns.size() / 2], parse_ns[parse_ns.size() * 99 / 100],
+         parse_ns[parse_ns.size() * 9999 / 10000], parse_ns.back());
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *path   = bench::arg_string(argc, argv, "corpus", ADV_CORPUS);
+  long        passes = bench::arg_value(argc, argv, "passes", 20000);
+  long        count  = bench::arg_value(argc, argv, "fuzz", 200000);
+
+  if ((passes < 1) || (count < 1)) {
+    fprintf(stderr, "Invalid --passes or --fuzz value\n");
+    return 1;
+  }
+
+  std::vector<Payload> corpus = load_corpus(path);
+  if (corpus.empty()) {
+    fprintf(stderr, "No payload in %s\n", path);
+    return 1;
+  }
+
+  int same = 0, hid = 0, hid_missed = 0;
+  for (Payload &p : corpus) {
+    bool found, missed;
+    if (same_fields(p, found, missed)) {
+      same++;
+    } else {
+      fprintf(stderr, "Mismatch: %s\n", p.label.c_str());
+    }
+    hid += found;
+    hid_missed += missed;
+  }
+
+  double multi_ns  = time_parser(corpus, passes, false);
+  double single_ns = time_parser(corpus, passes, true);
+
+  printf("\nAdvertising data parsing, %zu payloads, %ld passes\n\n", corpus.size(), passes);
+  printf("  multi-pass resolve_*() lookups   %8.1f ns/payload\n", multi_ns);
+  printf("  AdvParser single pass            %8.1f ns/payload\n", single_ns);
+  printf("  speedup x%.1f, same fields on %d/%zu payloads, HID service found on %d (%d missed "
+         "by the former first UUID check)\n",
+         multi_ns / single_ns, same, corpus.size(), hid, hid_missed);
+  bool padded = padded_advertisement();
+  printf("  zero-padded advertisement, name of the scan response: %s\n",
+         padded ? "found" : "MISSED");
+
+  printf("\nFuzzing, seeded by the corpus\n\n");
+  bool ok = fuzz(corpus, count);
+
+  return (ok && padded && (same == (int)corpus.size())) ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Counting replacement of the global operator new and delete, linked into the
+// benchmarks that report the heap taken by the component or by coroutine
+// frames. All the forms are replaced, plain, array, aligned and nothrow, so
+// that every allocation is counted and freed by the matching function.
+//
+// Kept in its own translation unit: the compiler then never sees a pointer
+// from these functions reaching free(), which -Wmismatched-new-delete flags.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "bench_util.hpp"
+
+static std::atomic<size_t> allocated{0};
+static std::atomic<size_t> allocations{0};
+
+namespace bench {
+
+size_t allocated_bytes() { return allocated.load(std::memory_order_relaxed); }
+size_t allocation_count() { return allocations.load(std::memory_order_relaxed); }
+
+} // namespace bench
+
+static void *counted_alloc(size_t size, size_t alignment) {
+  allocated.fetch_add(size, std::memory_order_relaxed);
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  if (alignment <= alignof(std::max_align_t)) return malloc(size);
+  // aligned_alloc() wants a size multiple of the alignment
+  return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+}
+
+static void *counted_alloc_or_throw(size_t size, size_t alignment) {
+  void *p = counted_alloc(size, alignment);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+static constexpr size_t DEFAULT_ALIGNMENT = alignof(std::max_align_t);
+
+void *operator new(size_t size) { return counted_alloc_or_throw(size, DEFAULT_ALIGNMENT); }
+void *operator new[](size_t size) { return counted_alloc_or_throw(size, DEFAULT_ALIGNMENT); }
+void *operator new(size_t size, std::align_val_t alignment) {
+  return counted_alloc_or_throw(size, (size_t)alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return counted_alloc_or_throw(size, (size_t)alignment);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size, DEFAULT_ALIGNMENT);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size, DEFAULT_ALIGNMENT);
+}
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return counted_alloc(size, (size_t)alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return counted_alloc(size, (size_t)alignment);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { free(p); }
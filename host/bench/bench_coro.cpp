@@ -0,0 +1,224 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Coroutine API benchmark on the simulated stack.
+//
+// 1. Latency: one key press at a time, measured from the moment the report is
+//    handed to the simulated esp_hidh layer to the resumption of a coroutine
+//    awaiting BTKeyboard::next_key() on a CoExecutor, against a thread blocked
+//    in wait_for_key_event().
+// 2. Multiplexing: on a single executor task, one coroutine reads lines typed
+//    on the keyboard with next_line(), one ticks every 10 ms (the other logic
+//    of the application) and one follows the keyboard going away and coming
+//    back with disconnected() and connected(). The lines must come out as
+//    typed, the ticker must keep its pace (80% of its ticks at least) while
+//    lines are typed with pauses in between, and the disconnection must be
+//    seen. The heap taken by the coroutine frames is reported, against the
+//    stacks of one task per activity.
+//
+// Options: --iterations=N (default 2000): key presses of the latency run,
+//          --lines=N (default 20): lines typed in the multiplexing run
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "bt_keyboard.hpp"
+#include "nvs_flash.h"
+#include "sim_stack.hpp"
+
+// FreeRTOS stack of a task printing or logging (ESP-IDF examples use 3 to 4 KB)
+static constexpr size_t TASK_STACK_SIZE = 4096;
+
+static BTKeyboard *bt_keyboard;
+static CoExecutor  executor;
+
+// Press and release a key, waiting for the events to be taken
+static void type_key(esp_hidh_dev_t *dev, uint8_t usage) {
+  std::vector<uint8_t> press   = bench::boot_report(0, usage);
+  std::vector<uint8_t> release = bench::boot_report();
+  sim::input(dev, press.data(), press.size());
+  sim::input(dev, release.data(), release.size());
+  sim::wait_idle();
+}
+
+static uint8_t usage_of(char c) { return (c == ' ') ? 0x2C : 0x04 + (c - 'a'); }
+
+// ----- 1. Latency -----
+
+static std::atomic<long>        events_seen{0};
+static bench::Clock::time_point sent_at;
+static std::vector<double>      coro_samples;
+
+static CoTask key_reader(long presses) {
+  for (long i = 0; i < 2 * presses; i++) {
+    KeyEvent event = co_await bt_keyboard->next_key();
+    if (event.kind == KeyEvent::Kind::DOWN) {
+      coro_samples.push_back(bench::elapsed_us(sent_at, bench::Clock::now()));
+    }
+    events_seen++;
+  }
+}
+
+// Sends `presses` key presses and releases, one at a time
+static void send_presses(esp_hidh_dev_t *dev, long presses) {
+  std::vector<uint8_t> press   = bench::boot_report(0, 0x04);
+  std::vector<uint8_t> release = bench::boot_report();
+  for (long i = 0; i < presses; i++) {
+    long seen = events_seen;
+    sent_at   = bench::Clock::now();
+    sim::input(dev, press.data(), press.size());
+    while (events_seen == seen) std::this_thread::yield();
+    sim::input(dev, release.data(), release.size());
+    while (events_seen == seen + 1) std::this_thread::yield();
+  }
+}
+
+static void bench_latency(esp_hidh_dev_t *dev, long presses) {
+  std::vector<double> thread_samples;
+
+  std::thread consumer([&]() {
+    KeyEvent event;
+    for (long i = 0; i < 2 * presses; i++) {
+      bt_keyboard->wait_for_key_event(event);
+      if (event.kind == KeyEvent::Kind::DOWN) {
+        thread_samples.push_back(bench::elapsed_us(sent_at, bench::Clock::now()));
+      }
+      events_seen++;
+    }
+  });
+  send_presses(dev, presses);
+  consumer.join();
+
+  events_seen = 0;
+  executor.spawn(key_reader(presses));
+  std::thread executor_task([]() { executor.run(); });
+  send_presses(dev, presses);
+  executor_task.join();
+
+  printf("Latency, report -> key event:\n");
+  bench::print_percentiles("wait_for_key_event() task", thread_samples);
+  bench::print_percentiles("co_await next_key()", coro_samples);
+}
+
+// ----- 2. Multiplexing -----
+
+static std::vector<std::string> lines_read;
+static std::atomic<long>        ticks{0};
+static std::atomic<bool>        keyboard_lost{false};
+static std::atomic<bool>        done{false};
+
+static CoTask line_reader(long count) {
+  char buffer[64];
+  co_await bt_keyboard->connected();
+  for (long i = 0; i < count; i++) {
+    size_t length = co_await bt_keyboard->next_line(buffer, sizeof(buffer));
+    lines_read.push_back(std::string(buffer, length));
+  }
+}
+
+static CoTask ticker() {
+  while (!done) {
+    co_await CoExecutor::sleep(10);
+    ticks++;
+  }
+}
+
+static CoTask connection_watcher() {
+  co_await bt_keyboard->connected();
+  co_await bt_keyboard->disconnected();
+  keyboard_lost = true;
+  co_await bt_keyboard->connected();
+}
+
+static bool bench_multiplexing(esp_hidh_dev_t *dev, long count) {
+  static const char *words[] = {"hello world", "bt keyboard", "coroutines", "one task"};
+
+  size_t before = bench::allocated_bytes();
+  executor.spawn(line_reader(count));
+  size_t line_reader_bytes = bench::allocated_bytes() - before;
+  before                   = bench::allocated_bytes();
+  executor.spawn(ticker());
+  size_t ticker_bytes = bench::allocated_bytes() - before;
+  before              = bench::allocated_bytes();
+  executor.spawn(connection_watcher());
+  size_t watcher_bytes = bench::allocated_bytes() - before;
+
+  std::thread executor_task([]() { executor.run(); });
+
+  auto                     start = bench::Clock::now();
+  std::vector<std::string> typed;
+  for (long i = 0; i < count; i++) {
+    std::string line = words[i % 4];
+    line += (char)('a' + i % 26);
+    for (char c : line) type_key(dev, usage_of(c));
+    type_key(dev, 0x2A); // Backspace removes the last letter
+    type_key(dev, 0x28); // Enter
+    typed.push_back(line.substr(0, line.size() - 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Typist pausing
+  }
+  double typing_ms = bench::elapsed_us(start, bench::Clock::now()) / 1000.0;
+
+  sim::disconnect(dev);
+  sim::wait_idle();
+  bool lost = bench::wait_connected(*bt_keyboard, false, 2000);
+  for (int i = 0; (i < 2000) && !keyboard_lost; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  bt_keyboard->reconnect_cached_devices();
+  bool back = bench::wait_connected(*bt_keyboard, true, 2000);
+
+  done = true;
+  executor_task.join();
+  double elapsed_ms = bench::elapsed_us(start, bench::Clock::now()) / 1000.0;
+
+  bool same = (lines_read == typed);
+  printf("Multiplexing, 3 coroutines on one task, %ld lines typed in %.0f ms:\n", count,
+         typing_ms);
+  printf("  lines read: %zu, as typed: %s\n", lines_read.size(), same ? "ok" : "MISMATCH");
+  printf("  ticker: %ld ticks of 10 ms in %.0f ms\n", (long)ticks, elapsed_ms);
+  printf("  disconnection seen: %s, reconnection seen: %s\n",
+         (lost && keyboard_lost) ? "ok" : "NO", back ? "ok" : "NO");
+  printf("  coroutine frames: line reader %zu, ticker %zu, watcher %zu bytes (%zu in all), "
+         "against %zu bytes of stacks for 3 tasks\n",
+         line_reader_bytes, ticker_bytes, watcher_bytes,
+         line_reader_bytes + ticker_bytes + watcher_bytes, 3 * TASK_STACK_SIZE);
+  return same && lost && keyboard_lost && back && (ticks >= elapsed_ms / 10 * 0.8);
+}
+
+int main(int argc, char **argv) {
+  long iterations = bench::arg_value(argc, argv, "iterations", 2000);
+  long lines      = bench::arg_value(argc, argv, "lines", 20);
+
+  if ((iterations < 1) || (lines < 1)) {
+    fprintf(stderr, "Invalid --iterations or --lines value\n");
+    return 1;
+  }
+
+  ESP_ERROR_CHECK(nvs_flash_init());
+
+  sim::set_time_scale(0.01);
+  sim::DeviceScript script;
+  esp_hidh_dev_t   *dev = sim::add_device(script);
+
+  bt_keyboard           = new BTKeyboard();
+  if (!bt_keyboard->setup()) {
+    fprintf(stderr, "setup() failed\n");
+    return 1;
+  }
+
+  bt_keyboard->devices_scan(1);
+  if (!bench::wait_connected(*bt_keyboard, true, 2000)) {
+    fprintf(stderr, "The simulated keyboard did not connect\n");
+    return 1;
+  }
+
+  printf("\nBTKeyboard coroutines benchmark (simulated esp_hidh stack)\n\n");
+  bench_latency(dev, iterations);
+  return bench_multiplexing(dev, lines) ? 0 : 1;
+}
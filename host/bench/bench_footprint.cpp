@@ -0,0 +1,157 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Footprint report of an application using BTKeyboard on the simulated stack.
+//
+// The executable is linked with the static C++ runtime, as a firmware image
+// is, so that what the component pulls from it (iostream and its locales in
+// particular) is counted. Its allocated sections are read from its own ELF
+// file and summed the way `idf.py size` does:
+//
+// - code: executable sections
+// - rodata: other read-only sections (constants, strings, unwind tables)
+// - data: initialized writable sections, in flash and copied to RAM
+// - bss: zeroed sections, RAM only
+//
+// Then setup() is called, a scan finding a BLE keyboard and a BT Classic mouse
+// is made and its results shown: the heap taken by the component at that point
+// is reported, counted by replacing the global operator new. The keyboard types
+// a key, which must come out of the key event and input report queues.
+//
+// The object is a BTKeyboard allocating its queues in setup(), or with
+// --static=1 a BTKeyboardT holding them, for the same depths: 32 key events,
+// 8 reports. The size of the object is what it takes in .bss when defined as a
+// global.
+//
+// On the target, `idf.py size` and `idf.py size-components` give the same
+// split for the firmware image, and main.cpp logs the image size and the free
+// heap after setup().
+//
+// Options: --static=1 (or --static): measure a BTKeyboardT
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "bt_keyboard.hpp"
+#include "nvs_flash.h"
+#include "sim_stack.hpp"
+
+struct ImageSizes {
+  size_t code   = 0;
+  size_t rodata = 0;
+  size_t data   = 0;
+  size_t bss    = 0;
+  bool   iostream; ///< std::ios_base::Init, the static constructor of <iostream>, is linked
+};
+
+static bool read_image_sizes(const char *path, ImageSizes &sizes) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) return false;
+  fseek(file, 0, SEEK_END);
+  std::vector<uint8_t> image(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  bool ok = fread(image.data(), 1, image.size(), file) == image.size();
+  fclose(file);
+  if (!ok || (image.size() < sizeof(Elf64_Ehdr))) return false;
+
+  const Elf64_Ehdr *header = (const Elf64_Ehdr *)image.data();
+  if ((memcmp(header->e_ident, ELFMAG, SELFMAG) != 0) ||
+      (header->e_ident[EI_CLASS] != ELFCLASS64) ||
+      (header->e_shoff + header->e_shnum * sizeof(Elf64_Shdr) > image.size())) {
+    return false;
+  }
+  const Elf64_Shdr *sections = (const Elf64_Shdr *)(image.data() + header->e_shoff);
+
+  sizes.iostream = false;
+  for (int i = 0; i < header->e_shnum; i++) {
+    const Elf64_Shdr &s = sections[i];
+    if (s.sh_flags & SHF_ALLOC) {
+      if (s.sh_type == SHT_NOBITS) sizes.bss += s.sh_size;
+      else if (s.sh_flags & SHF_EXECINSTR) sizes.code += s.sh_size;
+      else if (s.sh_flags & SHF_WRITE) sizes.data += s.sh_size;
+      else sizes.rodata += s.sh_size;
+    }
+    if ((s.sh_type == SHT_SYMTAB) && (s.sh_link < header->e_shnum)) {
+      const Elf64_Shdr &strtab  = sections[s.sh_link];
+      const Elf64_Sym  *symbols = (const Elf64_Sym *)(image.data() + s.sh_offset);
+      const char       *names   = (const char *)(image.data() + strtab.sh_offset);
+      for (size_t j = 0; j < s.sh_size / sizeof(Elf64_Sym); j++) {
+        if (strcmp(names + symbols[j].st_name, "_ZNSt8ios_base4InitC1Ev") == 0) {
+          sizes.iostream = true;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  bool       static_storage = bench::arg_flag(argc, argv, "static");
+  ImageSizes sizes;
+  if (!read_image_sizes("/proc/self/exe", sizes)) {
+    fprintf(stderr, "Unable to read the sections of the executable\n");
+    return 1;
+  }
+
+  ESP_ERROR_CHECK(nvs_flash_init());
+  sim::set_time_scale(0.01);
+  sim::DeviceScript keyboard;
+  esp_hidh_dev_t *keyboard_dev = sim::add_device(keyboard);
+  sim::DeviceScript mouse;
+  mouse.bda       = {0x10, 0x20, 0x30, 0x40, 0x50, 0x61};
+  mouse.name      = "Sim Mouse";
+  mouse.transport = ESP_HID_TRANSPORT_BT;
+  mouse.cod       = 0x002580; // Peripheral, pointing device minor, limited discoverable
+  sim::add_device(mouse);
+
+  BTKeyboard *bt_keyboard;
+  size_t      object_size;
+  if (static_storage) {
+    bt_keyboard = new BTKeyboardT<BTKeyboard::DEFAULT_QUEUE_DEPTH, 8>();
+    object_size = sizeof(BTKeyboardT<BTKeyboard::DEFAULT_QUEUE_DEPTH, 8>);
+  } else {
+    bt_keyboard = new BTKeyboard(BTKeyboard::DEFAULT_QUEUE_DEPTH, 8);
+    object_size = sizeof(BTKeyboard);
+  }
+
+  size_t before       = bench::allocated_bytes();
+  size_t before_count = bench::allocation_count();
+  if (!bt_keyboard->setup()) {
+    fprintf(stderr, "setup() failed\n");
+    return 1;
+  }
+  size_t setup_bytes = bench::allocated_bytes() - before;
+  size_t setup_count = bench::allocation_count() - before_count;
+
+  printf("\nBTKeyboard footprint (simulated esp_hidh stack, static C++ runtime)\n\n");
+  printf("Scan results:\n");
+  bt_keyboard->devices_scan(1);
+  bt_keyboard->show_scan_results();
+  size_t scan_bytes = bench::allocated_bytes() - before - setup_bytes;
+
+  std::vector<uint8_t> key = bench::boot_report(0, 0x04);
+  sim::input(keyboard_dev, key.data(), key.size());
+  KeyEvent     event;
+  ReportHandle report;
+  bool typed = bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000)) &&
+               (event.usage == 0x04) && bt_keyboard->wait_for_report(report, pdMS_TO_TICKS(1000)) &&
+               (report.size() >= 3) && (report.data()[2] == 0x04);
+
+  printf("\nImage: code %zu, rodata %zu, data %zu, bss %zu bytes\n", sizes.code, sizes.rodata,
+         sizes.data, sizes.bss);
+  printf("  flash (code + rodata + data): %zu bytes\n", sizes.code + sizes.rodata + sizes.data);
+  printf("  static RAM (data + bss): %zu bytes\n", sizes.data + sizes.bss);
+  printf("  iostream linked: %s\n", sizes.iostream ? "yes" : "no");
+  printf("%s object: %zu bytes\n", static_storage ? "BTKeyboardT" : "BTKeyboard", object_size);
+  printf("Heap: %zu bytes in %zu allocations by setup() (%" PRIu32 " by the component), %zu more "
+         "by the scan and its display\n",
+         setup_bytes, setup_count, bt_keyboard->get_metrics().heap_bytes, scan_bytes);
+  printf("Key through the event and report queues: %s\n", typed ? "ok" : "NO");
+  return typed ? 0 : 1;
+}
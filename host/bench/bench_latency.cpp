@@ -0,0 +1,516 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// End-to-end input path benchmark on the simulated stack.
+//
+// 1. Latency: one key press at a time, measured from the moment the report is
+//    handed to the simulated esp_hidh layer to the return of
+//    wait_for_ascii_char() in the consumer.
+//    The same is measured for 64-byte NKRO reports decoded through the plan
+//    compiled from the device report map and retrieved without copy through
+//    wait_for_report(), checking the decoded keys. Consumer control reports are
+//    interleaved and must not reach the application.
+//    The per-stage histograms kept by BTKeyboard (CONFIG_BT_KEYBOARD_LATENCY_STATS)
+//    are printed after each run.
+//    Then the key event of each press is taken through wait_for_key_event(),
+//    and through a handler given to set_key_handler(), called on the esp_hidh
+//    event task with no queue in between. The events must not be queued
+//    meanwhile.
+// 2. Typematic repeat: a key held while the repeat timer injects REPEAT events,
+//    measuring the first delay and the period against the configured timing,
+//    and checking that the repeat stops as soon as the key is released.
+// 3. Text: French dead key sequences typed on the AZERTY layout, measured from
+//    the report of the base key to the return of wait_for_codepoint(), checking
+//    the composed characters and their UTF-8 encoding.
+// 4. Throughput: a burst of reports injected back to back while a consumer
+//    task drains wait_for_key_event(), then drain_events() in batches. Each
+//    report presses or releases one key; events that never reach the consumer
+//    are counted as lost.
+// 5. Keyboards: two more keyboards (one BT classic) connect next to the first
+//    one. Reports sent by the three of them in random order must come out of
+//    the merged event stream tagged with the right device index, and a
+//    keyboard disconnecting with a key held must release it in its own name.
+//
+// Options: --iterations=N (default 2000), --burst=N (default 5000),
+//          --consumer-work=US (default 20): simulated application work per event,
+//          --depth=N (default BTKeyboard::DEFAULT_QUEUE_DEPTH): key event ring depth,
+//          --policy=N (default 1): overflow policy, 0 = drop newest, 1 = drop oldest,
+//                                  2 = coalesce,
+//          --batch=N (default 16): events per drain_events() call in the second
+//                                  throughput run
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#include "bench_util.hpp"
+#include "bt_keyboard.hpp"
+#include "nvs_flash.h"
+#include "sim_stack.hpp"
+
+static BTKeyboard *bt_keyboard;
+
+static const char *policy_names[] = {"drop newest", "drop oldest", "coalesce"};
+
+static void print_latency_stats() {
+  static const char *stage_names[] = {"decode", "queue", "total"};
+
+  for (uint8_t i = 0; i < (uint8_t)BTKeyboard::LatencyStage::COUNT; i++) {
+    LatencyHistogram::Snapshot stats =
+        bt_keyboard->get_latency_stats((BTKeyboard::LatencyStage)i);
+    printf("  stage %-22s n=%-7" PRIu32 " p50 %6" PRIu32 "  p90 %6" PRIu32 "  p99 %6" PRIu32
+           "  max %6" PRIu32 " us\n",
+           stage_names[i], stats.count, stats.percentile(0.50f), stats.percentile(0.90f),
+           stats.percentile(0.99f), stats.max_us);
+  }
+  bt_keyboard->reset_latency_stats();
+}
+
+static void bench_latency(esp_hidh_dev_t *dev, long iterations) {
+  std::mt19937         rng(1234);
+  std::vector<double>  samples;
+  long                 errors = 0;
+  std::vector<uint8_t> release = bench::boot_report();
+
+  samples.reserve(iterations);
+
+  for (long i = 0; i < iterations; i++) {
+    uint8_t              usage    = 0x04 + rng() % 26; // a..z
+    std::vector<uint8_t> press    = bench::boot_report(0, usage);
+    char                 expected = 'a' + (usage - 0x04);
+
+    sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+    sim::wait_idle();
+    if (i == 0) bt_keyboard->reset_latency_stats();
+
+    auto start = bench::Clock::now();
+    sim::input(dev, press.data(), press.size(), sim::REPORT_ID_BOOT);
+    char ch  = bt_keyboard->wait_for_ascii_char();
+    auto end = bench::Clock::now();
+
+    if (ch != expected) errors++;
+    samples.push_back(bench::elapsed_us(start, end));
+  }
+
+  sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+  sim::wait_idle();
+
+  printf("Latency, report -> wait_for_ascii_char():\n");
+  bench::print_percentiles("ascii char", samples);
+  print_latency_stats();
+  printf("  decode errors: %ld\n", errors);
+}
+
+// Time of the last key press given to key_probe(), on the task calling it
+struct KeyProbe {
+  std::atomic<bool>        called{false};
+  bench::Clock::time_point at;
+  uint8_t                  usage;
+};
+
+static void key_probe(const KeyEvent &event, void *context) {
+  KeyProbe *probe = (KeyProbe *)context;
+  if (event.kind != KeyEvent::Kind::DOWN) return;
+  probe->at    = bench::Clock::now();
+  probe->usage = event.usage;
+  probe->called.store(true, std::memory_order_release);
+}
+
+static void bench_key_handler(esp_hidh_dev_t *dev, long iterations) {
+  std::mt19937         rng(4321);
+  std::vector<double>  queued, direct;
+  std::vector<uint8_t> release = bench::boot_report();
+  KeyProbe             probe;
+  KeyEvent             event;
+  long                 errors = 0;
+
+  for (long i = 0; i < iterations; i++) {
+    uint8_t              usage = 0x04 + rng() % 26;
+    std::vector<uint8_t> press = bench::boot_report(0, usage);
+
+    sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+    sim::wait_idle();
+    while (bt_keyboard->wait_for_key_event(event, 0)) {}
+
+    auto start = bench::Clock::now();
+    sim::input(dev, press.data(), press.size(), sim::REPORT_ID_BOOT);
+    bt_keyboard->wait_for_key_event(event);
+    queued.push_back(bench::elapsed_us(start, bench::Clock::now()));
+    if (event.usage != usage) errors++;
+  }
+
+  bt_keyboard->set_key_handler(key_probe, &probe);
+  uint32_t pushed = bt_keyboard->get_queue_stats().pushed;
+  for (long i = 0; i < iterations; i++) {
+    uint8_t              usage = 0x04 + rng() % 26;
+    std::vector<uint8_t> press = bench::boot_report(0, usage);
+
+    sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+    sim::wait_idle();
+    probe.called = false;
+
+    auto start = bench::Clock::now();
+    sim::input(dev, press.data(), press.size(), sim::REPORT_ID_BOOT);
+    while (!probe.called.load(std::memory_order_acquire)) std::this_thread::yield();
+    direct.push_back(bench::elapsed_us(start, probe.at));
+    if (probe.usage != usage) errors++;
+  }
+  sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+  sim::wait_idle();
+  bool bypassed = (bt_keyboard->get_queue_stats().pushed == pushed);
+  bt_keyboard->set_key_handler(nullptr);
+
+  printf("Latency, report -> key event:\n");
+  bench::print_percentiles("wait_for_key_event()", queued);
+  bench::print_percentiles("set_key_handler() handler", direct);
+  print_latency_stats();
+  printf("  events queued while the handler was set: %s, decode errors: %ld\n",
+         bypassed ? "none" : "SOME", errors);
+}
+
+static void bench_wide_reports(esp_hidh_dev_t *dev, long iterations) {
+  std::mt19937        rng(5678);
+  std::vector<double> samples;
+  long                errors      = 0;
+  uint8_t             consumer[2] = {0xE9, 0x00}; // Volume up
+  ReportHandle        handle;
+
+  samples.reserve(iterations);
+  while (bt_keyboard->wait_for_report(handle, 0)) {
+  }
+
+  for (long i = 0; i < iterations; i++) {
+    // 1 to 16 distinct keys, in increasing usage order as the decoder reports them
+    std::vector<uint8_t> usages;
+    for (uint8_t usage = 0x04; usage < 0xA5; usage++) {
+      if ((rng() % 10) == 0) usages.push_back(usage);
+      if (usages.size() == 16) break;
+    }
+    if (usages.empty()) usages.push_back(0x04);
+    uint8_t              modifier = rng() & 0xFF;
+    std::vector<uint8_t> report   = bench::nkro_report(modifier, usages);
+
+    sim::input(dev, consumer, sizeof(consumer), sim::REPORT_ID_CONSUMER);
+
+    auto start = bench::Clock::now();
+    sim::input(dev, report.data(), report.size(), sim::REPORT_ID_NKRO);
+    bt_keyboard->wait_for_report(handle);
+    auto end = bench::Clock::now();
+
+    bool ok = (handle.size() >= 2 + usages.size()) && (handle[0] == modifier);
+    for (size_t k = 0; ok && (k < usages.size()); k++) ok = handle[2 + k] == usages[k];
+    if (!ok) errors++;
+    samples.push_back(bench::elapsed_us(start, end));
+  }
+
+  sim::wait_idle();
+  if (bt_keyboard->wait_for_report(handle, 0)) errors++; // A consumer report got through
+  handle.reset();
+
+  printf("Latency, 64-byte NKRO report -> wait_for_report():\n");
+  bench::print_percentiles("nkro report", samples);
+  printf("  decode errors: %ld\n", errors);
+}
+
+static void bench_repeat(esp_hidh_dev_t *dev, long repeats) {
+  const KeyRepeatTiming timing  = {.delay_ms = 100, .period_ms = 20};
+  std::vector<uint8_t>  press   = bench::boot_report(0, 0x04);
+  std::vector<uint8_t>  release = bench::boot_report();
+  std::vector<double>   delays, periods;
+  KeyEvent              event;
+  long                  errors = 0;
+
+  bt_keyboard->set_key_repeat(KeyClass::CHARACTER, timing);
+  sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+  sim::wait_idle();
+  while (bt_keyboard->wait_for_key_event(event, 0)) {
+  }
+
+  sim::input(dev, press.data(), press.size(), sim::REPORT_ID_BOOT);
+  bt_keyboard->wait_for_key_event(event);
+  auto last = bench::Clock::now();
+  if (event.kind != KeyEvent::Kind::DOWN) errors++;
+
+  for (long i = 0; i < repeats; i++) {
+    if (!bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000)) ||
+        (event.kind != KeyEvent::Kind::REPEAT) || (event.usage != 0x04)) {
+      errors++;
+      break;
+    }
+    auto now = bench::Clock::now();
+    ((i == 0) ? delays : periods).push_back(bench::elapsed_us(last, now));
+    last = now;
+  }
+
+  sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+  bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000));
+  if (event.kind != KeyEvent::Kind::UP) errors++;
+  if (bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(3 * timing.period_ms))) errors++;
+
+  bt_keyboard->set_key_repeat(KeyClass::CHARACTER, DEFAULT_KEY_REPEAT);
+
+  printf("Typematic repeat, %u ms delay, %u ms period:\n", timing.delay_ms, timing.period_ms);
+  bench::print_percentiles("first repeat", delays);
+  bench::print_percentiles("repeat period", periods);
+  printf("  errors: %ld\n", errors);
+}
+
+static void bench_text(esp_hidh_dev_t *dev, long iterations) {
+  struct Sequence {
+    uint8_t     dead_modifier, dead, base_modifier, base;
+    char32_t    first, second;
+    const char *utf8;
+  };
+  static const Sequence sequences[] = {
+      {0x00, 0x2F, 0x00, 0x08, 0xEA, 0, "\xC3\xAA"},    // ^ e: e circumflex
+      {0x02, 0x2F, 0x02, 0x08, 0xCB, 0, "\xC3\x8B"},    // Shift ^ E: E diaeresis
+      {0x40, 0x1F, 0x00, 0x11, 0xF1, 0, "\xC3\xB1"},    // AltGr ~ n: n tilde
+      {0x00, 0x2F, 0x00, 0x1B, '^', 'x', "^"},            // ^ x: no composition
+  };
+  std::vector<uint8_t> release = bench::boot_report();
+  std::vector<double>  samples;
+  long                 errors = 0;
+
+  bt_keyboard->set_keymap(KEYMAP_AZERTY);
+  sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+  sim::wait_idle();
+  while (!bt_keyboard->get_codepoint().empty()) {
+  }
+
+  for (long i = 0; i < iterations; i++) {
+    const Sequence      &seq  = sequences[i % (sizeof(sequences) / sizeof(*sequences))];
+    std::vector<uint8_t> dead = bench::boot_report(seq.dead_modifier, seq.dead);
+    std::vector<uint8_t> base = bench::boot_report(seq.base_modifier, seq.base);
+
+    sim::input(dev, dead.data(), dead.size(), sim::REPORT_ID_BOOT);
+    sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+    sim::wait_idle();
+
+    auto start = bench::Clock::now();
+    sim::input(dev, base.data(), base.size(), sim::REPORT_ID_BOOT);
+    TextInput input = bt_keyboard->wait_for_codepoint();
+    auto      end   = bench::Clock::now();
+
+    char    utf8[4];
+    uint8_t length = input.to_utf8(utf8);
+    if ((input.codepoint != seq.first) || (length != strlen(seq.utf8)) ||
+        (memcmp(utf8, seq.utf8, length) != 0)) {
+      errors++;
+    }
+    if ((seq.second != 0) && (bt_keyboard->wait_for_codepoint().codepoint != seq.second)) {
+      errors++;
+    }
+    samples.push_back(bench::elapsed_us(start, end));
+
+    sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+  }
+
+  sim::wait_idle();
+  bt_keyboard->set_keymap(KEYMAP_US);
+
+  printf("Latency, AZERTY dead key sequence -> wait_for_codepoint():\n");
+  bench::print_percentiles("composed char", samples);
+  printf("  errors: %ld\n", errors);
+}
+
+static void bench_throughput(esp_hidh_dev_t *dev, long burst, long consumer_work_us,
+                             long batch) {
+  std::atomic<long>        received{0};
+  std::atomic<long>        wakeups{0};
+  std::atomic<bool>        started{false};
+  bench::Clock::time_point last_rx;
+  KeyEvent                 event;
+  std::vector<uint8_t>     release = bench::boot_report();
+
+  // Release the keys left down by the previous runs before counting events
+  sim::input(dev, release.data(), release.size(), sim::REPORT_ID_BOOT);
+  sim::wait_idle();
+  while (bt_keyboard->wait_for_key_event(event, 0)) {
+  }
+  bt_keyboard->reset_queue_stats();
+  bt_keyboard->reset_latency_stats();
+
+  std::thread consumer([&]() {
+    std::vector<KeyEvent> events(batch > 0 ? batch : 1);
+    size_t                count;
+    started = true;
+    while ((count = (batch > 0) ? bt_keyboard->drain_events(events, pdMS_TO_TICKS(200), batch,
+                                                            pdMS_TO_TICKS(2))
+                                : bt_keyboard->wait_for_key_event(events[0], pdMS_TO_TICKS(200)))) {
+      received += count;
+      wakeups++;
+      last_rx   = bench::Clock::now();
+      auto busy = last_rx + std::chrono::microseconds(consumer_work_us * count);
+      while (bench::Clock::now() < busy) {
+      }
+    }
+  });
+  while (!started) std::this_thread::yield();
+
+  auto start = bench::Clock::now();
+  for (long i = 0; i < burst; i++) {
+    std::vector<uint8_t> report = bench::boot_report(0, (i & 1) ? 0 : 0x04 + (i / 2) % 26);
+    sim::input(dev, report.data(), report.size(), sim::REPORT_ID_BOOT);
+  }
+  sim::wait_idle();
+  auto produced = bench::Clock::now();
+  consumer.join();
+
+  double elapsed = bench::elapsed_us(start, received ? last_rx : produced);
+  if (batch > 0) {
+    printf("Throughput, burst of %ld reports -> drain_events(%ld events, 2 ms max wait), "
+           "%ld us work per event:\n",
+           burst, batch, consumer_work_us);
+  } else {
+    printf("Throughput, burst of %ld reports -> wait_for_key_event(), %ld us work per event:\n",
+           burst, consumer_work_us);
+  }
+  printf("  received %ld, lost %ld (%.1f%%), injection %.1f ms, %.0f events/s delivered\n",
+         received.load(), burst - received.load(), 100.0 * (burst - received.load()) / burst,
+         bench::elapsed_us(start, produced) / 1000.0, received.load() / (elapsed / 1e6));
+  printf("  consumer wakeups: %ld (%.1f events per wakeup)\n", wakeups.load(),
+         wakeups ? (double)received.load() / wakeups.load() : 0.0);
+
+  BTKeyboard::QueueStats stats = bt_keyboard->get_queue_stats();
+  printf("  ring: pushed %" PRIu32 ", dropped newest %" PRIu32 ", dropped oldest %" PRIu32
+         ", coalesced %" PRIu32 "\n",
+         stats.pushed, stats.dropped_newest, stats.dropped_oldest, stats.coalesced);
+  printf("  report pool exhausted: %" PRIu32 "\n", bt_keyboard->get_pool_exhausted_count());
+  print_latency_stats();
+}
+
+static void bench_keyboards(esp_hidh_dev_t *first, long iterations) {
+  sim::DeviceScript ble_script;
+  ble_script.bda  = {0x10, 0x20, 0x30, 0x40, 0x50, 0x61};
+  ble_script.name = "Sim Keyboard 2";
+  sim::DeviceScript bt_script;
+  bt_script.bda       = {0x10, 0x20, 0x30, 0x40, 0x50, 0x62};
+  bt_script.name      = "Sim BT Keyboard";
+  bt_script.transport = ESP_HID_TRANSPORT_BT;
+
+  esp_hidh_dev_t *devs[3] = {first, sim::add_device(ble_script), sim::add_device(bt_script)};
+  uint8_t         ids[3]  = {sim::REPORT_ID_BOOT, 0, 0};
+  uint8_t         tags[3];
+
+  bt_keyboard->devices_scan(1);
+  if (!bench::wait_connected_count(*bt_keyboard, 3, 2000)) {
+    printf("Keyboards: only %u of 3 connected\n", bt_keyboard->get_connected_count());
+    return;
+  }
+  sim::wait_idle();
+
+  // Device indexes are given at connection time: find which one each keyboard got
+  for (uint8_t d = 0; d < 3; d++) {
+    sim::battery(devs[d], 50 + d * 10);
+    for (uint8_t i = 0; i < BTKeyboard::MAX_DEVICES; i++) {
+      BTKeyboard::DeviceStatus status = bt_keyboard->get_device_status(i);
+      if (memcmp(status.bda, esp_hidh_dev_bda_get(devs[d]), ESP_BD_ADDR_LEN) == 0) tags[d] = i;
+    }
+  }
+  sim::wait_idle();
+
+  std::mt19937         rng(9012);
+  std::vector<double>  samples;
+  long                 errors  = 0;
+  std::vector<uint8_t> release = bench::boot_report();
+  KeyEvent             event;
+
+  samples.reserve(iterations);
+  for (long i = 0; i < iterations; i++) {
+    uint8_t              d     = rng() % 3;
+    uint8_t              usage = 0x04 + rng() % 26;
+    std::vector<uint8_t> press = bench::boot_report(0, usage);
+
+    auto start = bench::Clock::now();
+    sim::input(devs[d], press.data(), press.size(), ids[d]);
+    bool received = bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000));
+    auto end      = bench::Clock::now();
+    samples.push_back(bench::elapsed_us(start, end));
+
+    if (!received || (event.device != tags[d]) || (event.usage != usage) ||
+        (event.kind != KeyEvent::Kind::DOWN)) {
+      errors++;
+    }
+
+    sim::input(devs[d], release.data(), release.size(), ids[d]);
+    if (!bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000)) ||
+        (event.device != tags[d]) || (event.kind != KeyEvent::Kind::UP)) {
+      errors++;
+    }
+  }
+
+  printf("Keyboards, 3 connected, report -> tagged wait_for_key_event():\n");
+  bench::print_percentiles("key event", samples);
+  for (uint8_t d = 0; d < 3; d++) {
+    BTKeyboard::DeviceStatus status = bt_keyboard->get_device_status(tags[d]);
+    printf("  device %u: " ESP_BD_ADDR_STR ", %s, battery %d%%\n", tags[d],
+           ESP_BD_ADDR_HEX(status.bda), status.connected ? "connected" : "disconnected",
+           status.battery_level);
+  }
+
+  // A key held while its keyboard goes away is released with the device's tag
+  std::vector<uint8_t> held = bench::boot_report(0, 0x04);
+  sim::input(devs[1], held.data(), held.size(), ids[1]);
+  if (!bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000))) errors++;
+  sim::disconnect(devs[1]);
+  if (!bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000)) ||
+      (event.device != tags[1]) || (event.kind != KeyEvent::Kind::UP) || (event.usage != 0x04)) {
+    errors++;
+  }
+  sim::wait_idle();
+  printf("  after a disconnection: %u connected, device %u %s\n",
+         bt_keyboard->get_connected_count(), tags[1],
+         bt_keyboard->get_device_status(tags[1]).connected ? "connected" : "disconnected");
+  printf("  tagging errors: %ld\n", errors);
+}
+
+int main(int argc, char **argv) {
+  long iterations = bench::arg_value(argc, argv, "iterations", 2000);
+  long burst      = bench::arg_value(argc, argv, "burst", 5000);
+  long work_us    = bench::arg_value(argc, argv, "consumer-work", 20);
+  long depth      = bench::arg_value(argc, argv, "depth", BTKeyboard::DEFAULT_QUEUE_DEPTH);
+  long policy     = bench::arg_value(argc, argv, "policy", 1);
+  long batch      = bench::arg_value(argc, argv, "batch", 16);
+
+  if ((policy < 0) || (policy > 2) || (depth < 1) || (depth > 32768)) {
+    fprintf(stderr, "Invalid --policy or --depth value\n");
+    return 1;
+  }
+
+  ESP_ERROR_CHECK(nvs_flash_init());
+
+  bt_keyboard = new BTKeyboard(depth, depth);
+  bt_keyboard->set_overflow_policy(static_cast<OverflowPolicy>(policy));
+
+  sim::set_time_scale(0.01);
+  sim::DeviceScript script;
+  script.report_map   = sim::composite_keyboard_report_map();
+  esp_hidh_dev_t *dev = sim::add_device(script);
+
+  if (!bt_keyboard->setup()) {
+    fprintf(stderr, "setup() failed\n");
+    return 1;
+  }
+
+  bt_keyboard->devices_scan(1);
+  if (!bench::wait_connected(*bt_keyboard, true, 2000)) {
+    fprintf(stderr, "The simulated keyboard did not connect\n");
+    return 1;
+  }
+
+  printf("\nBTKeyboard host benchmark (simulated esp_hidh stack)\n");
+  printf("Key event ring: depth %ld, %s\n\n", depth, policy_names[policy]);
+  bench_latency(dev, iterations);
+  bench_key_handler(dev, iterations);
+  bench_wide_reports(dev, iterations);
+  bench_repeat(dev, 50);
+  bench_text(dev, iterations);
+  bench_throughput(dev, burst, work_us, 0);
+  bench_throughput(dev, burst, work_us, batch);
+  bench_keyboards(dev, iterations);
+  return 0;
+}
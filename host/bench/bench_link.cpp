@@ -0,0 +1,249 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Latency policy benchmark on the simulated stack, whose keyboards deliver
+// each input report at the next exchange of their link: one BLE connection
+// interval or one BT Classic poll (or sniff) interval apart.
+//
+// 1. A BLE keyboard asking for a 30 ms connection interval types under each
+//    latency policy in turn. The effective interval, as reported by
+//    get_device_status(), and the report to key event latency are given.
+//    LOW must beat BALANCED, which must beat BATTERY.
+// 2. Keyboards pushing back, under LATENCY_POLICY_LOW: one counter-proposing
+//    its own interval twice before giving in, one counter-proposing forever
+//    and one refusing intervals below 15 ms. The first must end within the
+//    policy; the others must keep their own interval after the retries, read
+//    from the link when they connected.
+// 3. A BT Classic keyboard polled every 25 ms is given a 5 ms poll interval,
+//    then enters sniff mode with a 100 ms sniff interval. The latency follows,
+//    and the sniff mode is reported.
+//
+// Times are in simulated milliseconds (wall time divided by the time scale).
+//
+// Options: --presses=N (default 40): key presses per measure
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "bt_keyboard.hpp"
+#include "nvs_flash.h"
+#include "sim_stack.hpp"
+
+static constexpr double TIME_SCALE = 0.1;
+
+static BTKeyboard  *bt_keyboard;
+static std::mt19937 rng(42);
+
+static LinkTiming link_of(esp_hidh_dev_t *dev) {
+  uint8_t slot = bench::slot_of(*bt_keyboard, esp_hidh_dev_bda_get(dev));
+  if (slot == BTKeyboard::MAX_DEVICES) return LinkTiming{};
+  return bt_keyboard->get_device_status(slot).link;
+}
+
+static void print_link(const char *label, const LinkTiming &link) {
+  printf("  %-28s interval %6.2f ms, latency %3u, timeout %5u ms, %u request(s), %s%s\n",
+         label, link.interval_us / 1000.0, link.latency, link.timeout_ms, link.requests,
+         link.in_policy ? "in policy" : "OUT OF POLICY", link.sniff ? ", sniff" : "");
+}
+
+// Report to key event latency of key presses sent at random times, in simulated ms
+static std::vector<double> measure(esp_hidh_dev_t *dev, long presses) {
+  std::vector<double>                     samples;
+  std::uniform_int_distribution<uint32_t> pause_us(0, 50000);
+  std::vector<uint8_t>                    press   = bench::boot_report(0, 0x04);
+  std::vector<uint8_t>                    release = bench::boot_report();
+  KeyEvent                                event;
+
+  for (long i = 0; i < presses; i++) {
+    std::this_thread::sleep_for(std::chrono::microseconds(pause_us(rng)));
+    auto start = bench::Clock::now();
+    sim::input(dev, press.data(), press.size());
+    if (!bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(2000))) break;
+    samples.push_back(bench::elapsed_us(start, bench::Clock::now()) / 1000.0 / TIME_SCALE);
+    sim::input(dev, release.data(), release.size());
+    bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(2000));
+  }
+  return samples;
+}
+
+static double print_ms(const char *label, std::vector<double> &samples) {
+  if (samples.empty()) {
+    printf("  %-28s (no samples)\n", label);
+    return 1e9;
+  }
+  std::sort(samples.begin(), samples.end());
+  double p50 = samples[samples.size() / 2];
+  printf("  %-28s n=%-4zu min %6.2f  p50 %6.2f  p90 %6.2f  max %6.2f ms\n", label,
+         samples.size(), samples.front(), p50, samples[samples.size() * 9 / 10], samples.back());
+  return p50;
+}
+
+// Apply a policy to all slots and wait for the keyboards to settle
+static void apply_policy(const LatencyPolicy &policy) {
+  bt_keyboard->set_latency_policy(policy);
+  sim::wait_idle();
+}
+
+static bool bench_policies(esp_hidh_dev_t *dev, long presses) {
+  struct {
+    const char   *name;
+    LatencyPolicy policy;
+    double        p50;
+  } runs[] = {{"KEYBOARD", LATENCY_POLICY_KEYBOARD, 0},
+              {"BATTERY", LATENCY_POLICY_BATTERY, 0},
+              {"BALANCED", LATENCY_POLICY_BALANCED, 0},
+              {"LOW", LATENCY_POLICY_LOW, 0}};
+
+  bool ok = true;
+  printf("1. BLE keyboard asking for 30 ms, under each policy:\n");
+  for (auto &run : runs) {
+    apply_policy(run.policy);
+    LinkTiming link = link_of(dev);
+    print_link(run.name, link);
+    std::vector<double> samples = measure(dev, presses);
+    run.p50                     = print_ms("  report -> key event", samples);
+    ok &= link.in_policy && (samples.size() == (size_t)presses);
+  }
+  ok &= (runs[3].p50 < runs[2].p50) && (runs[2].p50 < runs[1].p50);
+  return ok;
+}
+
+static bool bench_push_back(esp_hidh_dev_t *twice, esp_hidh_dev_t *always,
+                            esp_hidh_dev_t *refusing) {
+  printf("\n2. Keyboards pushing back, under LOW (%u retries):\n",
+         LATENCY_POLICY_LOW.max_retries);
+  apply_policy(LATENCY_POLICY_LOW);
+
+  sim::set_reachable(twice, true);
+  sim::set_reachable(always, true);
+  bt_keyboard->devices_scan(1);
+  if (!bench::wait_connected_count(*bt_keyboard, 3, 2000)) return false;
+  sim::wait_idle();
+
+  LinkTiming twice_link  = link_of(twice);
+  LinkTiming always_link = link_of(always);
+  print_link("counter-proposes twice", twice_link);
+  print_link("counter-proposes forever", always_link);
+
+  // Out of reach, for the scans and the reconnection supervisor to leave them alone
+  sim::set_reachable(twice, false);
+  sim::set_reachable(always, false);
+  sim::disconnect(twice);
+  sim::disconnect(always);
+  if (!bench::wait_connected_count(*bt_keyboard, 1, 2000)) return false;
+
+  sim::set_reachable(refusing, true);
+  bt_keyboard->devices_scan(1);
+  if (!bench::wait_connected_count(*bt_keyboard, 2, 2000)) return false;
+  sim::wait_idle();
+  LinkTiming refusing_link = link_of(refusing);
+  print_link("refuses below 15 ms", refusing_link);
+
+  sim::set_reachable(refusing, false);
+  sim::disconnect(refusing);
+  if (!bench::wait_connected_count(*bt_keyboard, 1, 2000)) return false;
+
+  uint8_t all_requests = 1 + LATENCY_POLICY_LOW.max_retries;
+  return twice_link.in_policy && (twice_link.requests == 3) && !always_link.in_policy &&
+         (always_link.requests == all_requests) && (always_link.interval_us == 30000) &&
+         !refusing_link.in_policy && (refusing_link.requests == all_requests) &&
+         (refusing_link.interval_us == 50000);
+}
+
+static bool bench_classic(esp_hidh_dev_t *dev, long presses) {
+  printf("\n3. BT Classic keyboard polled every 25 ms:\n");
+  apply_policy(LATENCY_POLICY_KEYBOARD);
+  sim::set_reachable(dev, true);
+  bt_keyboard->devices_scan(1);
+  if (!bench::wait_connected_count(*bt_keyboard, 2, 2000)) return false;
+  sim::wait_idle();
+
+  std::vector<double> samples = measure(dev, presses);
+  print_ms("KEYBOARD", samples);
+
+  apply_policy(LATENCY_POLICY_LOW);
+  LinkTiming low = link_of(dev);
+  print_link("LOW", low);
+  samples        = measure(dev, presses);
+  double low_p50 = print_ms("  report -> key event", samples);
+
+  sim::set_sniff(dev, true);
+  sim::wait_idle();
+  LinkTiming sniff = link_of(dev);
+  print_link("LOW, sniff mode of 100 ms", sniff);
+  samples          = measure(dev, presses);
+  double sniff_p50 = print_ms("  report -> key event", samples);
+
+  sim::set_sniff(dev, false);
+  sim::wait_idle();
+  return low.in_policy && (low.interval_us == 5000) && sniff.sniff && !link_of(dev).sniff &&
+         (low_p50 < sniff_p50);
+}
+
+int main(int argc, char **argv) {
+  long presses = bench::arg_value(argc, argv, "presses", 40);
+  if (presses < 1) {
+    fprintf(stderr, "Invalid --presses value\n");
+    return 1;
+  }
+
+  ESP_ERROR_CHECK(nvs_flash_init());
+  sim::set_time_scale(TIME_SCALE);
+
+  sim::DeviceScript ble;
+  ble.conn_interval        = 24; // 30 ms
+  esp_hidh_dev_t *keyboard = sim::add_device(ble);
+
+  sim::DeviceScript twice = ble;
+  twice.bda               = {0x10, 0x20, 0x30, 0x40, 0x50, 0x61};
+  twice.counter_proposals = 2;
+  twice.reachable           = false;
+  esp_hidh_dev_t *twice_dev = sim::add_device(twice);
+
+  sim::DeviceScript always = twice;
+  always.bda               = {0x10, 0x20, 0x30, 0x40, 0x50, 0x62};
+  always.counter_proposals   = 255;
+  esp_hidh_dev_t *always_dev = sim::add_device(always);
+
+  sim::DeviceScript refusing = twice;
+  refusing.bda                 = {0x10, 0x20, 0x30, 0x40, 0x50, 0x63};
+  refusing.counter_proposals   = 0;
+  refusing.conn_interval       = 40; // 50 ms
+  refusing.min_conn_interval   = 12; // 15 ms
+  esp_hidh_dev_t *refusing_dev = sim::add_device(refusing);
+
+  sim::DeviceScript classic;
+  classic.bda                 = {0x10, 0x20, 0x30, 0x40, 0x50, 0x64};
+  classic.name                = "Sim Classic Keyboard";
+  classic.transport           = ESP_HID_TRANSPORT_BT;
+  classic.poll_slots          = 40;  // 25 ms
+  classic.sniff_slots         = 160; // 100 ms
+  classic.reachable           = false;
+  esp_hidh_dev_t *classic_dev = sim::add_device(classic);
+
+  bt_keyboard = new BTKeyboard();
+  if (!bt_keyboard->setup()) {
+    fprintf(stderr, "setup() failed\n");
+    return 1;
+  }
+  bt_keyboard->devices_scan(1);
+  if (!bench::wait_connected_count(*bt_keyboard, 1, 2000)) {
+    fprintf(stderr, "The simulated keyboard did not connect\n");
+    return 1;
+  }
+
+  printf("\nBTKeyboard latency policy benchmark (simulated esp_hidh stack)\n\n");
+  bool policies   = bench_policies(keyboard, presses);
+  bool push_back  = bench_push_back(twice_dev, always_dev, refusing_dev);
+  bool classic_ok = bench_classic(classic_dev, presses);
+
+  printf("\nPolicies ordered: %s, push back handled: %s, BT Classic: %s\n",
+         policies ? "ok" : "NO", push_back ? "ok" : "NO", classic_ok ? "ok" : "NO");
+  return (policies && push_back && classic_ok) ? 0 : 1;
+}
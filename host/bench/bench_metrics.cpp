@@ -0,0 +1,253 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Runtime metrics benchmark on the simulated stack.
+//
+// 1. A scan connects two keyboards, a BLE boot keyboard and a BT Classic
+//    composite keyboard: the scan, advertisement and connection counters are
+//    checked, with the last RSSI and the heap taken by setup().
+// 2. Without consumer, both keyboards send --reports reports into queues of
+//    8 key events and 4 input reports, with a few oversized reports and
+//    ErrorRollOver ones. The report, byte, truncation and decode error
+//    counters of each keyboard must match what was sent, and the drop counters
+//    the queue statistics. A battery level is reported.
+// 3. The boot keyboard drops its link and is brought back by a scan: one
+//    disconnection, one reconnection.
+// 4. The heap counters follow a recording ring and a replay, then
+//    reset_metrics() clears the counters and keeps the gauges.
+// 5. Cost of get_metrics(), by batches of 1000 calls, idle and while the
+//    keyboards type.
+//
+// Options: --reports=N (default 1000): reports sent by each keyboard in part 2,
+//          --batches=N (default 2000): batches of get_metrics() calls
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "bt_keyboard.hpp"
+#include "nvs_flash.h"
+#include "sim_stack.hpp"
+
+static constexpr double TIME_SCALE = 0.05;
+
+static BTKeyboard *bt_keyboard;
+
+static bool check(const char *label, bool ok) {
+  printf("  %-52s %s\n", label, ok ? "ok" : "NO");
+  return ok;
+}
+
+static void print_metrics(const BTKeyboard::Metrics &m) {
+  for (uint8_t i = 0; i < BTKeyboard::MAX_DEVICES; i++) {
+    const BTKeyboard::DeviceMetrics &d = m.devices[i];
+    printf("    device %u: %" PRIu32 " reports, %" PRIu32 " bytes, %" PRIu32
+           " truncated, %" PRIu32 " decode errors, battery %d\n",
+           i, d.reports, d.bytes, d.truncated, d.decode_errors, d.battery_level);
+  }
+  printf("    dropped: %" PRIu32 " events, %" PRIu32 " reports; links: %" PRIu32 " up, %" PRIu32
+         " down, %" PRIu32 " back\n",
+         m.events_dropped, m.reports_dropped, m.connections, m.disconnections, m.reconnects);
+  printf("    scans: %" PRIu32 ", last %" PRIu32 " ms, %" PRIu32 " advertisements, last RSSI %d\n",
+         m.scans, m.last_scan_ms, m.advertisements, m.last_rssi);
+  printf("    heap: %" PRIu32 " bytes, peak %" PRIu32 "\n", m.heap_bytes, m.heap_peak_bytes);
+}
+
+int main(int argc, char **argv) {
+  long reports = bench::arg_value(argc, argv, "reports", 1000);
+  long batches = bench::arg_value(argc, argv, "batches", 2000);
+  if ((reports < 1) || (batches < 1)) {
+    fprintf(stderr, "Invalid --reports or --batches value\n");
+    return 1;
+  }
+
+  ESP_ERROR_CHECK(nvs_flash_init());
+  sim::set_time_scale(TIME_SCALE);
+
+  sim::DeviceScript boot;
+  boot.rssi                = -48;
+  esp_hidh_dev_t *boot_dev = sim::add_device(boot);
+
+  sim::DeviceScript nkro;
+  nkro.bda                 = {0x10, 0x20, 0x30, 0x40, 0x50, 0x61};
+  nkro.name                = "Sim NKRO Keyboard";
+  nkro.transport           = ESP_HID_TRANSPORT_BT;
+  nkro.report_map          = sim::composite_keyboard_report_map();
+  nkro.rssi                = -71;
+  esp_hidh_dev_t *nkro_dev = sim::add_device(nkro);
+
+  bt_keyboard = new BTKeyboard(8, 4);
+  if (!bt_keyboard->setup()) {
+    fprintf(stderr, "setup() failed\n");
+    return 1;
+  }
+
+  printf("\nBTKeyboard runtime metrics benchmark (simulated esp_hidh stack)\n\n");
+
+  // 1. Scan and connections
+  uint32_t setup_heap = bt_keyboard->get_metrics().heap_bytes;
+  bt_keyboard->devices_scan(1);
+  bool connected = bench::wait_connected_count(*bt_keyboard, 2);
+  sim::wait_idle();
+
+  BTKeyboard::Metrics m = bt_keyboard->get_metrics();
+  printf("1. Scan of 1 s (%.0f ms simulated):\n", 1000 * TIME_SCALE);
+  print_metrics(m);
+  bool ok = check("both keyboards connected", connected && (m.connections == 2));
+  ok &= check("one scan, timed", (m.scans == 1) && (m.last_scan_ms >= 1000 * TIME_SCALE * 0.9));
+  ok &= check("advertisements counted, last RSSI of a keyboard",
+              (m.advertisements >= 2) &&
+                  ((m.last_rssi == boot.rssi) || (m.last_rssi == nkro.rssi)));
+  ok &= check("heap of setup(), no peak above it", (setup_heap > 0) &&
+                                                       (m.heap_bytes == setup_heap) &&
+                                                       (m.heap_peak_bytes == setup_heap));
+
+  uint8_t boot_slot = bench::slot_of(*bt_keyboard, boot.bda.data());
+  uint8_t nkro_slot = bench::slot_of(*bt_keyboard, nkro.bda.data());
+  if ((boot_slot >= BTKeyboard::MAX_DEVICES) || (nkro_slot >= BTKeyboard::MAX_DEVICES)) {
+    fprintf(stderr, "The simulated keyboards have no slot\n");
+    return 1;
+  }
+
+  // 2. Input counters against the queue statistics
+  bt_keyboard->reset_metrics();
+  bt_keyboard->reset_queue_stats();
+
+  uint64_t boot_bytes = 0, nkro_bytes = 0;
+  uint32_t truncated = 0, rollovers = 0;
+  for (long i = 0; i < reports; i++) {
+    uint8_t              usage  = 0x04 + (i / 2) % 26;
+    std::vector<uint8_t> report = bench::boot_report(0, (i & 1) ? 0 : usage);
+    if (i % 100 == 50) {
+      report.resize(ReportPool::MAX_REPORT_SIZE + 8, 0);
+      truncated++;
+    } else if (i % 100 == 75) {
+      memset(&report[2], 0x01, 6); // ErrorRollOver
+      rollovers++;
+    }
+    sim::input(boot_dev, report.data(), report.size());
+    boot_bytes += report.size();
+
+    std::vector<uint8_t> nkro_report = bench::nkro_report(0, {(uint8_t)((i & 1) ? 0 : usage)});
+    sim::input(nkro_dev, nkro_report.data(), nkro_report.size(), sim::REPORT_ID_NKRO);
+    nkro_bytes += nkro_report.size();
+  }
+  sim::battery(boot_dev, 77);
+  sim::wait_idle();
+
+  m = bt_keyboard->get_metrics();
+  BTKeyboard::QueueStats             queue = bt_keyboard->get_queue_stats();
+  SpscRing<ReportPool::Index>::Stats rq    = bt_keyboard->get_report_queue_stats();
+  const BTKeyboard::DeviceMetrics   &bm    = m.devices[boot_slot];
+  const BTKeyboard::DeviceMetrics   &nm    = m.devices[nkro_slot];
+  printf("\n2. %ld reports per keyboard, no consumer:\n", reports);
+  print_metrics(m);
+  ok &= check("reports and bytes of each keyboard",
+              (bm.reports == reports) && (bm.bytes == boot_bytes) && (nm.reports == reports) &&
+                  (nm.bytes == nkro_bytes));
+  ok &= check("truncated and ErrorRollOver reports", (bm.truncated == truncated) &&
+                                                         (bm.decode_errors == rollovers) &&
+                                                         (nm.truncated == 0) &&
+                                                         (nm.decode_errors == 0));
+  ok &= check("key events dropped as counted by the queue",
+              (m.events_dropped > 0) &&
+                  (m.events_dropped == queue.dropped_newest + queue.dropped_oldest));
+  ok &= check("reports dropped as counted by the queue and pool",
+              (m.reports_dropped > 0) &&
+                  (m.reports_dropped == rq.dropped_newest + rq.dropped_oldest +
+                                            bt_keyboard->get_pool_exhausted_count()));
+  ok &= check("battery level", bm.battery_level == 77);
+
+  // 3. Link loss and recovery
+  KeyEvent event;
+  while (bt_keyboard->wait_for_key_event(event, 0)) {}
+  sim::disconnect(boot_dev);
+  bool lost = bench::wait_connected_count(*bt_keyboard, 1);
+  bt_keyboard->devices_scan(1);
+  bool back = bench::wait_connected_count(*bt_keyboard, 2);
+  sim::wait_idle();
+
+  m = bt_keyboard->get_metrics();
+  printf("\n3. Boot keyboard lost, then found by a scan:\n");
+  print_metrics(m);
+  ok &= check("one disconnection, one reconnection", lost && back && (m.disconnections == 1) &&
+                                                         (m.reconnects == 1) &&
+                                                         (m.connections == 1) && (m.scans == 1));
+  ok &= check("battery level unknown after the reconnection",
+              m.devices[boot_slot].battery_level == -1);
+
+  // 4. Heap, and reset
+  printf("\n4. Heap:\n");
+  uint32_t heap = m.heap_bytes;
+  bt_keyboard->start_recording(BTKeyboard::DEFAULT_RECORDING_SIZE);
+  std::vector<uint8_t> key = bench::boot_report(0, 0x04);
+  std::vector<uint8_t> up  = bench::boot_report();
+  sim::input(boot_dev, key.data(), key.size());
+  sim::input(boot_dev, up.data(), up.size());
+  sim::wait_idle();
+  bt_keyboard->stop_recording();
+  uint32_t recording_heap = bt_keyboard->get_metrics().heap_bytes;
+  printf("  recording ring: %" PRIu32 " bytes more\n", recording_heap - heap);
+  ok &= check("recording ring and report map accounted",
+              recording_heap > heap + BTKeyboard::DEFAULT_RECORDING_SIZE);
+
+  std::vector<uint8_t> recording(bt_keyboard->get_recording_size());
+  bt_keyboard->get_recording(recording.data(), recording.size());
+  bt_keyboard->replay_recording(recording.data(), recording.size(), 0);
+  m = bt_keyboard->get_metrics();
+  printf("  replay: peak of %" PRIu32 " bytes more\n", m.heap_peak_bytes - recording_heap);
+  ok &= check("replay decoding state in the peak only",
+              (m.heap_bytes == recording_heap) && (m.heap_peak_bytes > recording_heap));
+
+  bt_keyboard->reset_metrics();
+  m = bt_keyboard->get_metrics();
+  print_metrics(m);
+  bool cleared = (m.events_dropped == 0) && (m.reports_dropped == 0) && (m.connections == 0) &&
+                 (m.disconnections == 0) && (m.reconnects == 0) && (m.scans == 0) &&
+                 (m.advertisements == 0);
+  for (const BTKeyboard::DeviceMetrics &d : m.devices) {
+    cleared &= (d.reports == 0) && (d.bytes == 0) && (d.truncated == 0) && (d.decode_errors == 0);
+  }
+  ok &= check("reset clears the counters", cleared);
+  ok &= check("reset keeps the gauges", (m.heap_bytes == recording_heap) &&
+                                            (m.heap_peak_bytes == recording_heap) &&
+                                            (m.last_rssi != 0) && (m.last_scan_ms > 0));
+
+  // 5. Cost of a snapshot
+  printf("\n5. get_metrics(), %ld batches of 1000 calls:\n", batches);
+  std::vector<double> samples;
+  volatile uint32_t   sink = 0; // Keeps the snapshots
+  auto                poll = [&](const char *label) {
+    samples.clear();
+    for (long b = 0; b < batches; b++) {
+      auto start = bench::Clock::now();
+      for (int i = 0; i < 1000; i++) sink = bt_keyboard->get_metrics().devices[0].reports;
+      samples.push_back(bench::elapsed_us(start, bench::Clock::now()));
+    }
+    bench::print_percentiles(label, samples);
+    printf("  %.1f ns per snapshot (p50)\n", samples[samples.size() / 2]);
+  };
+  poll("idle");
+
+  std::atomic<bool> typing{true};
+  std::thread       typist([&]() {
+    for (uint8_t i = 0; typing.load(); i++) {
+      std::vector<uint8_t> report = bench::boot_report(0, (i & 1) ? 0 : 0x04 + (i / 2) % 26);
+      sim::input(boot_dev, report.data(), report.size());
+      while (bt_keyboard->wait_for_key_event(event, 0)) {}
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  poll("while typing");
+  typing.store(false);
+  typist.join();
+  sim::wait_idle();
+
+  printf("\nMetrics: %s\n", ok ? "ok" : "NO");
+  return ok ? 0 : 1;
+}
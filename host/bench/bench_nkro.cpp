@@ -0,0 +1,146 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// NKRO bitmap decoding micro-benchmark. No simulated stack involved.
+//
+// A stream of 120-bit key bitmap reports (usages 0x00 - 0x77, one key pressed
+// or released per report with up to 6 keys down, as when typing fast) is
+// decoded into press/release edges by:
+//
+// 1. byte loop: the decoding previously done on the way to wait_for_ascii_char().
+//    The bitmap is turned into a key list one byte and one bit at a time, then
+//    every slot of the list is checked against the key_avail_[] positions of
+//    the previous report.
+// 2. word XOR: KeyBitmap::load() of the bitmap field, then KeyBitmap::diff()
+//    against the previous state, walking changed bits with count-trailing-zeros.
+//
+// The byte loop is positional: it reports keys that merely moved in the list
+// as pressed again and misses presses landing on a slot that was in use, so
+// its press count can differ. Only the presses found by the word XOR path are
+// checked, against a bit-by-bit reference.
+//
+// Options: --reports=N (default 1000000)
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "key_bitmap.hpp"
+
+static constexpr uint16_t BITMAP_BITS = 120;
+static constexpr uint8_t  LIST_SIZE   = 64;
+
+static std::vector<std::vector<uint8_t>> make_reports(long count) {
+  std::mt19937                      rng(42);
+  std::vector<uint8_t>              bitmap(BITMAP_BITS / 8, 0);
+  std::vector<uint8_t>              down;
+  std::vector<std::vector<uint8_t>> reports;
+
+  reports.reserve(count);
+  for (long i = 0; i < count; i++) {
+    if (down.empty() || ((down.size() < 6) && (rng() & 1))) {
+      uint8_t usage = 0x04 + rng() % (BITMAP_BITS - 0x04);
+      if (bitmap[usage / 8] & (1 << (usage % 8))) continue;
+      down.push_back(usage);
+      bitmap[usage / 8] |= 1 << (usage % 8);
+    } else {
+      size_t k = rng() % down.size();
+      bitmap[down[k] / 8] &= ~(1 << (down[k] % 8));
+      down.erase(down.begin() + k);
+    }
+    reports.push_back(bitmap);
+  }
+  return reports;
+}
+
+// 1. Byte loop
+static long decode_byte_loop(const std::vector<std::vector<uint8_t>> &reports) {
+  bool key_avail[LIST_SIZE];
+  long presses = 0;
+
+  for (bool &avail : key_avail) avail = true;
+
+  for (const std::vector<uint8_t> &report : reports) {
+    uint8_t list[LIST_SIZE] = {};
+    uint8_t count           = 0;
+    for (uint16_t i = 0; i < BITMAP_BITS; i += 8) {
+      uint8_t byte = report[i / 8];
+      for (uint8_t bit = 0; bit < 8; bit++) {
+        if ((byte & (1 << bit)) && (count < LIST_SIZE)) list[count++] = i + bit;
+      }
+    }
+    for (int i = 0; i < LIST_SIZE; i++) {
+      if (key_avail[i] && (list[i] != 0)) presses++;
+      key_avail[i] = list[i] == 0;
+    }
+  }
+  return presses;
+}
+
+// 2. Word XOR
+static long decode_word_xor(const std::vector<std::vector<uint8_t>> &reports,
+                            std::vector<uint8_t> *pressed_log) {
+  KeyBitmap previous;
+  long      presses = 0;
+
+  for (const std::vector<uint8_t> &report : reports) {
+    KeyBitmap current;
+    current.load(report.data(), 0, BITMAP_BITS, 0);
+    KeyBitmap::diff(previous, current, [&](uint8_t usage, bool pressed) {
+      if (pressed) {
+        presses++;
+        if (pressed_log != nullptr) pressed_log->push_back(usage);
+      }
+    });
+    previous = current;
+  }
+  return presses;
+}
+
+static long check_word_xor(const std::vector<std::vector<uint8_t>> &reports) {
+  std::vector<uint8_t> log;
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> previous(BITMAP_BITS / 8, 0);
+
+  decode_word_xor(reports, &log);
+  for (const std::vector<uint8_t> &report : reports) {
+    for (uint16_t usage = 0; usage < BITMAP_BITS; usage++) {
+      bool before = previous[usage / 8] & (1 << (usage % 8));
+      bool after  = report[usage / 8] & (1 << (usage % 8));
+      if (after && !before) expected.push_back(usage);
+    }
+    previous = report;
+  }
+  return (log == expected) ? 0 : 1;
+}
+
+template <typename F> static double time_ns_per_report(long count, F f, long &result) {
+  auto start = bench::Clock::now();
+  result     = f();
+  auto end   = bench::Clock::now();
+  return bench::elapsed_us(start, end) * 1000.0 / count;
+}
+
+int main(int argc, char **argv) {
+  long count   = bench::arg_value(argc, argv, "reports", 1000000);
+  auto reports = make_reports(count);
+  long byte_presses, word_presses;
+
+  count = reports.size(); // Presses of a key already down are skipped
+
+  double byte_ns =
+      time_ns_per_report(count, [&]() { return decode_byte_loop(reports); }, byte_presses);
+  double word_ns = time_ns_per_report(
+      count, [&]() { return decode_word_xor(reports, nullptr); }, word_presses);
+
+  printf("\nNKRO bitmap decoding, %ld reports of %u bits\n\n", count, BITMAP_BITS);
+  printf("  %-34s %8.1f ns/report  (%ld presses found)\n", "byte loop + key_avail_[] scan",
+         byte_ns, byte_presses);
+  printf("  %-34s %8.1f ns/report  (%ld presses found)\n", "KeyBitmap word XOR + ctz", word_ns,
+         word_presses);
+  printf("  speedup x%.1f, word XOR check against bit-by-bit reference: %s\n", byte_ns / word_ns,
+         check_word_xor(reports) == 0 ? "ok" : "MISMATCH");
+  return 0;
+}
@@ -0,0 +1,205 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Reconnection benchmark on the simulated stack.
+//
+// A BLE keyboard connects once through devices_scan(), which records it in
+// NVS. It then drops its link repeatedly and is brought back in turn by:
+//
+// 1. scan: devices_scan(), a full discovery scan of --scan seconds (BLE scan
+//    and BT inquiry at the same time), then the connection.
+// 2. first match: devices_scan() with the is_keyboard() filter, which stops
+//    the scan as soon as the keyboard advertises, then connects it.
+// 3. cached: reconnect_cached_devices(), the fast path taken on boot: the
+//    connection is opened directly from the NVS record. It must return true,
+//    and false once the keyboard is out of reach.
+//
+// Each run is measured from the call to the return of wait_for_key_event()
+// for a key pressed as soon as the keyboard is connected. Times are given in
+// simulated milliseconds (wall time divided by the time scale). The NVS record
+// must match the keyboard, and must have been written only once.
+//
+// Then, with the reconnection supervisor started (start_auto_reconnect(), its
+// delays scaled like the simulated stack), the keyboard repeatedly drops its
+// link and sleeps for a random time up to --sleep-ms: it can't be seen nor
+// connected meanwhile. The supervisor counters and recovery times are given,
+// with the share of time the radio spent scanning.
+//
+// Options: --rounds=N (default 10), --scan=S (default 5): scan duration in seconds,
+//          --connect-ms=N (default 300): simulated connection time of the keyboard,
+//          --sleep-ms=N (default 20000): longest keyboard sleep
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "bt_keyboard.hpp"
+#include "nvs_flash.h"
+#include "sim_stack.hpp"
+
+static constexpr double TIME_SCALE = 0.01;
+
+static BTKeyboard *bt_keyboard;
+
+static void print_ms(const char *label, std::vector<double> &samples) {
+  std::sort(samples.begin(), samples.end());
+  printf("  %-28s min %8.0f  p50 %8.0f  max %8.0f ms\n", label, samples.front(),
+         samples[samples.size() / 2], samples.back());
+}
+
+// Time from the start of `connect` to the first key event, in simulated ms. -1 on failure.
+template <typename Connect> static double time_to_first_key(esp_hidh_dev_t *dev, Connect connect) {
+  KeyEvent event;
+  auto     start = bench::Clock::now();
+
+  connect();
+  if (!bench::wait_connected(*bt_keyboard, true, 2000)) return -1;
+
+  std::vector<uint8_t> press = bench::boot_report(0, 0x04); // 'a'
+  sim::input(dev, press.data(), press.size());
+  if (!bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000))) return -1;
+  double elapsed = bench::elapsed_us(start, bench::Clock::now()) / 1000.0 / TIME_SCALE;
+
+  std::vector<uint8_t> release = bench::boot_report();
+  sim::input(dev, release.data(), release.size());
+  bt_keyboard->wait_for_key_event(event, pdMS_TO_TICKS(1000));
+
+  sim::disconnect(dev);
+  sim::wait_idle();
+  if (!bench::wait_connected(*bt_keyboard, false, 2000)) return -1;
+  return (event.usage == 0x04) ? elapsed : -1;
+}
+
+// The keyboard drops its link and sleeps, `rounds` times, while the supervisor brings it back
+static bool bench_auto_reconnect(esp_hidh_dev_t *dev, long rounds, long sleep_ms) {
+  ReconnectPolicy policy = DEFAULT_RECONNECT_POLICY;
+  policy.initial_delay_ms *= TIME_SCALE;
+  policy.max_delay_ms *= TIME_SCALE;
+  // The keyboard left disconnected by the previous runs comes back first
+  if (!bt_keyboard->start_auto_reconnect(policy)) return false;
+  if (!bench::wait_connected(*bt_keyboard, true, 2000)) return false;
+  bt_keyboard->reset_reconnect_stats();
+
+  std::mt19937 rng(5);
+  auto         start = bench::Clock::now();
+  for (long i = 0; i < rounds; i++) {
+    uint32_t sleep = rng() % (sleep_ms + 1);
+    sim::disconnect(dev);
+    sim::set_reachable(dev, false);
+    std::this_thread::sleep_for(std::chrono::microseconds((long)(sleep * 1000 * TIME_SCALE)));
+    sim::set_reachable(dev, true);
+
+    // Longest wait: the delay may have reached its maximum, then a scan and a connection
+    int timeout_ms = 2 * (policy.max_delay_ms + 1000 * TIME_SCALE * 2) + 1000;
+    if (!bench::wait_connected(*bt_keyboard, true, timeout_ms)) {
+      fprintf(stderr, "Auto-reconnect round %ld: the keyboard did not come back\n", i);
+      return false;
+    }
+  }
+  double elapsed_ms = bench::elapsed_us(start, bench::Clock::now()) / 1000.0 / TIME_SCALE;
+  bt_keyboard->stop_auto_reconnect();
+
+  ReconnectStats stats = bt_keyboard->get_reconnect_stats();
+  printf("\nAuto-reconnect, default policy (%" PRIu32 " ms doubling up to %" PRIu32
+         " ms, %u s scans), sleeps up to %ld ms\n\n",
+         DEFAULT_RECONNECT_POLICY.initial_delay_ms, DEFAULT_RECONNECT_POLICY.max_delay_ms,
+         DEFAULT_RECONNECT_POLICY.scan_seconds, sleep_ms);
+  printf("  disconnections %" PRIu32 ", recoveries %" PRIu32 ", scans %" PRIu32
+         ", connection attempts %" PRIu32 "\n",
+         stats.disconnections, stats.recoveries, stats.scans, stats.attempts);
+  printf("  recovery time: mean %.0f ms, max %.0f ms\n", stats.mean_recovery_ms / TIME_SCALE,
+         stats.max_recovery_ms / TIME_SCALE);
+  printf("  radio scanning %.1f%% of the time\n",
+         100.0 * stats.scans * policy.scan_seconds * 1000 / elapsed_ms);
+  return (stats.recoveries == (uint32_t)rounds) && (stats.disconnections == (uint32_t)rounds);
+}
+
+int main(int argc, char **argv) {
+  long rounds     = bench::arg_value(argc, argv, "rounds", 10);
+  long scan       = bench::arg_value(argc, argv, "scan", 5);
+  long connect_ms = bench::arg_value(argc, argv, "connect-ms", 300);
+  long sleep_ms   = bench::arg_value(argc, argv, "sleep-ms", 20000);
+
+  if ((rounds < 1) || (scan < 1) || (connect_ms < 0) || (sleep_ms < 0)) {
+    fprintf(stderr, "Invalid --rounds, --scan, --connect-ms or --sleep-ms value\n");
+    return 1;
+  }
+
+  ESP_ERROR_CHECK(nvs_flash_init());
+
+  sim::set_time_scale(TIME_SCALE);
+  sim::DeviceScript script;
+  script.addr_type        = BLE_ADDR_TYPE_RANDOM;
+  script.connect_delay_ms = connect_ms;
+  esp_hidh_dev_t *dev     = sim::add_device(script);
+
+  bt_keyboard             = new BTKeyboard();
+  if (!bt_keyboard->setup()) {
+    fprintf(stderr, "setup() failed\n");
+    return 1;
+  }
+
+  // First boot: nothing cached yet, the keyboard is found by a scan
+  if (bt_keyboard->reconnect_cached_devices()) {
+    fprintf(stderr, "reconnect_cached_devices() connected with an empty cache\n");
+    return 1;
+  }
+  uint32_t writes_before = sim::nvs_write_count();
+  double   first         = time_to_first_key(dev, [&]() { bt_keyboard->devices_scan(scan); });
+  if (first < 0) {
+    fprintf(stderr, "The simulated keyboard did not connect\n");
+    return 1;
+  }
+
+  std::vector<double> scan_ms, match_ms, cached_ms;
+  bool                returned = true; // reconnect_cached_devices() saw each connection
+  for (long i = 0; i < rounds; i++) {
+    double scanned = time_to_first_key(dev, [&]() { bt_keyboard->devices_scan(scan); });
+    double matched = time_to_first_key(
+        dev, [&]() { bt_keyboard->devices_scan(scan, BTKeyboard::is_keyboard); });
+    double cached =
+        time_to_first_key(dev, [&]() { returned &= bt_keyboard->reconnect_cached_devices(); });
+    if ((scanned < 0) || (matched < 0) || (cached < 0)) {
+      fprintf(stderr, "Round %ld: the simulated keyboard did not reconnect\n", i);
+      return 1;
+    }
+    scan_ms.push_back(scanned);
+    match_ms.push_back(matched);
+    cached_ms.push_back(cached);
+  }
+  uint32_t writes = sim::nvs_write_count() - writes_before;
+
+  sim::disconnect(dev);
+  sim::set_reachable(dev, false);
+  bool unreachable = bench::wait_connected(*bt_keyboard, false) &&
+                     !bt_keyboard->reconnect_cached_devices();
+  sim::set_reachable(dev, true);
+
+  // What the next boot would load
+  DeviceCache<BTKeyboard::MAX_DEVICES> cache;
+  cache.load();
+  const CachedDevice &record = cache.get(0);
+  bool                same   = (memcmp(record.bda, script.bda.data(), ESP_BD_ADDR_LEN) == 0) &&
+                (record.transport == ESP_HID_TRANSPORT_BLE) &&
+                (record.addr_type == BLE_ADDR_TYPE_RANDOM) && (script.name == record.name);
+
+  printf("\nReconnection, %lds scan, %ldms connection, %ld rounds (simulated time)\n\n", scan,
+         connect_ms, rounds);
+  printf("  Time to the first key event, first boot (scan): %.0f ms\n", first);
+  print_ms("devices_scan()", scan_ms);
+  print_ms("devices_scan(is_keyboard)", match_ms);
+  print_ms("reconnect_cached_devices()", cached_ms);
+  printf("  NVS record: %s, %u write(s) for %ld connections\n", same ? "ok" : "MISMATCH",
+         (unsigned)writes, 3 * rounds + 1);
+  printf("  reconnect_cached_devices() result: %s\n",
+         (returned && unreachable) ? "ok" : "WRONG");
+  if (!same || (writes != 1) || !returned || !unreachable) return 1;
+
+  return bench_auto_reconnect(dev, rounds, sleep_ms) ? 0 : 1;
+}
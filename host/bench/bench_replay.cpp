@@ -0,0 +1,282 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Record and replay benchmark on the simulated stack.
+//
+// 1. Two keyboards type with rollover, at human speed, while their input
+//    reports are recorded: a BLE boot keyboard and a BT Classic composite
+//    keyboard sending NKRO reports (report ID 2). The key events delivered
+//    live are kept. The recording is read back: number of reports, bytes per
+//    report.
+// 2. The recording is replayed as fast as possible, 10 times faster and at its
+//    original speed. Each replay must give back the live key events, in order
+//    and with their device index, and take the recorded time divided by the
+//    speed.
+// 3. A recorded corpus is replayed without delay --passes times, through a key
+//    handler counting the events: the decoding cost of each report, on a
+//    fixed input. The corpus of the source tree was saved from part 1.
+//
+// Key repeat is disabled: the replays then produce the same events whatever
+// the speed.
+//
+// Options: --corpus=PATH (default: the corpus of the source tree),
+//          --save=PATH: save the recording of part 1, in the dump_recording()
+//          format, for use as a corpus,
+//          --passes=N (default 2000): replays of the corpus
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "bt_keyboard.hpp"
+#include "nvs_flash.h"
+#include "sim_stack.hpp"
+
+static BTKeyboard  *bt_keyboard;
+static std::mt19937 rng(42);
+
+struct Events {
+  std::vector<KeyEvent> list;
+  uint64_t              count = 0;
+};
+
+static void collect_event(const KeyEvent &event, void *context) {
+  Events *events = (Events *)context;
+  if (events->list.size() < events->list.capacity()) events->list.push_back(event);
+  events->count++;
+}
+
+static bool same_events(const std::vector<KeyEvent> &a, const std::vector<KeyEvent> &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if ((a[i].usage != b[i].usage) || (a[i].modifiers != b[i].modifiers) ||
+        (a[i].kind != b[i].kind) || (a[i].device != b[i].device)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Same text layout as BTKeyboard::dump_recording()
+static bool save_recording(const char *path, const std::vector<uint8_t> &recording) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) return false;
+  fprintf(file, "# BTKeyboard recording: %zu bytes, saved by bench_replay\n", recording.size());
+  for (size_t offset = 0; offset < recording.size(); offset += 32) {
+    for (size_t i = offset; (i < offset + 32) && (i < recording.size()); i++) {
+      fprintf(file, "%02x", recording[i]);
+    }
+    fprintf(file, "\n");
+  }
+  return fclose(file) == 0;
+}
+
+static std::vector<uint8_t> load_recording(const char *path) {
+  std::vector<uint8_t> recording;
+  std::ifstream        file(path);
+  std::string          line;
+  while (std::getline(file, line)) {
+    if (line.empty() || (line[0] == '#')) continue;
+    for (size_t i = 0; i + 1 < line.size(); i += 2) {
+      recording.push_back(strtoul(line.substr(i, 2).c_str(), nullptr, 16));
+    }
+  }
+  return recording;
+}
+
+struct RecordingSummary {
+  uint32_t maps        = 0;
+  uint32_t reports     = 0;
+  size_t   report_size = 0; // Bytes of the report entries, headers included
+  uint64_t duration_us = 0; // From the first report to the last
+};
+
+static RecordingSummary summarize(const std::vector<uint8_t> &recording) {
+  RecordingSummary summary;
+  RecordingReader  reader(recording.data(), recording.size());
+  RecordedEntry    entry;
+  size_t           offset = RecordingFormat::HEADER_SIZE;
+  while (reader.next(entry)) {
+    size_t end = entry.data + entry.length - recording.data();
+    if (entry.kind == RecordedEntry::Kind::REPORT_MAP) {
+      summary.maps++;
+    } else {
+      if (summary.reports > 0) summary.duration_us += entry.delta_us;
+      summary.reports++;
+      summary.report_size += end - offset;
+    }
+    offset = end;
+  }
+  return summary;
+}
+
+// Type a text on both keyboards at once, a few keys down at a time on each
+static uint32_t type_text(esp_hidh_dev_t *boot, esp_hidh_dev_t *nkro, const char *text) {
+  std::uniform_int_distribution<int> pause_us(2000, 25000);
+  std::uniform_int_distribution<int> coin(0, 3);
+  std::vector<uint8_t>               down[2];
+  uint32_t                           reports = 0;
+  size_t                             next[2] = {0, 0};
+  size_t                             length  = strlen(text);
+
+  auto send = [&](int k) {
+    uint8_t modifier = (down[k].size() > 2) ? 0x02 : 0x00; // Shift on busy rollovers
+    if (k == 0) {
+      std::vector<uint8_t> report = bench::boot_report(modifier);
+      for (size_t i = 0; i < down[0].size(); i++) report[2 + i] = down[0][i];
+      sim::input(boot, report.data(), report.size());
+    } else {
+      std::vector<uint8_t> report = bench::nkro_report(modifier, down[1]);
+      sim::input(nkro, report.data(), report.size(), sim::REPORT_ID_NKRO);
+    }
+    reports++;
+  };
+
+  while ((next[0] < length) || (next[1] < length) || !down[0].empty() || !down[1].empty()) {
+    int  k     = coin(rng) & 1;
+    bool press = (next[k] < length) && ((down[k].size() < 2) || (coin(rng) == 0)) &&
+                 (down[k].size() < 6);
+    if (press) {
+      char    c     = text[next[k]++];
+      uint8_t usage = (c == ' ') ? 0x2C : 0x04 + (c - 'a');
+      if (std::find(down[k].begin(), down[k].end(), usage) != down[k].end()) continue;
+      down[k].push_back(usage);
+    } else if (!down[k].empty()) {
+      down[k].erase(down[k].begin());
+    } else {
+      continue;
+    }
+    send(k);
+    std::this_thread::sleep_for(std::chrono::microseconds(pause_us(rng)));
+  }
+  return reports;
+}
+
+static bool replay(const std::vector<uint8_t> &recording, uint16_t speed,
+                   const RecordingSummary &summary, const std::vector<KeyEvent> &live,
+                   Events &events) {
+  events.list.clear();
+  events.count = 0;
+  auto start   = bench::Clock::now();
+  bool ok      = bt_keyboard->replay_recording(recording.data(), recording.size(), speed);
+  double ms    = bench::elapsed_us(start, bench::Clock::now()) / 1000.0;
+
+  bool   same    = ok && same_events(events.list, live);
+  double wanted  = (speed == 0) ? 0 : summary.duration_us / 1000.0 / speed;
+  bool   on_time = (speed == 0) || ((ms >= wanted) && (ms < wanted * 1.05 + 5));
+  char   label[32];
+  snprintf(label, sizeof(label), speed ? "x%u" : "no delay", speed);
+  printf("  %-10s %8.1f ms (due %8.1f ms), %zu events: %s%s\n", label, ms, wanted,
+         events.list.size(), same ? "same as live" : "DIFFERENT",
+         on_time ? "" : ", OFF TIME");
+  return same && on_time;
+}
+
+int main(int argc, char **argv) {
+  const char *corpus_path = bench::arg_string(argc, argv, "corpus", REPLAY_CORPUS);
+  const char *save_path   = bench::arg_string(argc, argv, "save", nullptr);
+  long        passes      = bench::arg_value(argc, argv, "passes", 2000);
+  if (passes < 1) {
+    fprintf(stderr, "Invalid --passes value\n");
+    return 1;
+  }
+
+  ESP_ERROR_CHECK(nvs_flash_init());
+  sim::set_time_scale(0.05);
+
+  sim::DeviceScript boot;
+  esp_hidh_dev_t   *boot_dev = sim::add_device(boot);
+
+  sim::DeviceScript nkro;
+  nkro.bda                 = {0x10, 0x20, 0x30, 0x40, 0x50, 0x61};
+  nkro.name                = "Sim NKRO Keyboard";
+  nkro.transport           = ESP_HID_TRANSPORT_BT;
+  nkro.report_map          = sim::composite_keyboard_report_map();
+  esp_hidh_dev_t *nkro_dev = sim::add_device(nkro);
+
+  bt_keyboard = new BTKeyboard();
+  if (!bt_keyboard->setup()) {
+    fprintf(stderr, "setup() failed\n");
+    return 1;
+  }
+  bt_keyboard->devices_scan(1);
+  for (int i = 0; (i < 2000) && (bt_keyboard->get_connected_count() != 2); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (bt_keyboard->get_connected_count() != 2) {
+    fprintf(stderr, "The simulated keyboards did not connect\n");
+    return 1;
+  }
+  for (uint8_t i = 0; i < (uint8_t)KeyClass::NONE; i++) {
+    bt_keyboard->set_key_repeat((KeyClass)i, KeyRepeatTiming{.delay_ms = 0, .period_ms = 0});
+  }
+
+  Events events;
+  events.list.reserve(4096);
+  bt_keyboard->set_key_handler(collect_event, &events);
+
+  printf("\nBTKeyboard record and replay benchmark (simulated esp_hidh stack)\n\n");
+
+  // 1. Live typing, recorded
+  bt_keyboard->start_recording();
+  uint32_t sent = type_text(boot_dev, nkro_dev, "the quick brown fox jumps over the lazy dog");
+  sim::wait_idle();
+  bt_keyboard->stop_recording();
+  std::vector<KeyEvent> live = events.list;
+
+  std::vector<uint8_t> recording(bt_keyboard->get_recording_size());
+  bool copied = bt_keyboard->get_recording(recording.data(), recording.size()) ==
+                recording.size();
+  RecordingSummary summary = summarize(recording);
+  printf("1. Recording of %" PRIu32 " reports sent: %zu bytes, %" PRIu32 " report maps, %" PRIu32
+         " reports of %.1f bytes on average, %.1f ms\n",
+         sent, recording.size(), summary.maps, summary.reports,
+         summary.reports ? (double)summary.report_size / summary.reports : 0.0,
+         summary.duration_us / 1000.0);
+  bool recorded = copied && (summary.maps == 2) && (summary.reports == sent) && !live.empty();
+  if (save_path != nullptr) {
+    if (!save_recording(save_path, recording)) {
+      fprintf(stderr, "Unable to save the recording to %s\n", save_path);
+      return 1;
+    }
+    printf("  saved to %s\n", save_path);
+  }
+
+  // 2. Replays against the live events
+  printf("\n2. Replays of the %zu live key events:\n", live.size());
+  bool replayed = recorded;
+  for (uint16_t speed : {0, 10, 1}) replayed &= replay(recording, speed, summary, live, events);
+
+  // 3. Decoding cost on a recorded corpus
+  std::vector<uint8_t> corpus         = load_recording(corpus_path);
+  RecordingSummary     corpus_summary = summarize(corpus);
+  printf("\n3. Corpus %s: %" PRIu32 " reports, %zu bytes\n", corpus_path, corpus_summary.reports,
+         corpus.size());
+  bool                bench_ok = corpus_summary.reports > 0;
+  std::vector<double> samples;
+  events.list.clear();
+  for (long pass = 0; bench_ok && (pass < passes); pass++) {
+    events.count = 0;
+    auto start   = bench::Clock::now();
+    bench_ok     = bt_keyboard->replay_recording(corpus.data(), corpus.size(), 0);
+    samples.push_back(bench::elapsed_us(start, bench::Clock::now()));
+  }
+  if (bench_ok) {
+    bench::print_percentiles("replay of the corpus", samples);
+    printf("  %.0f ns per report (p50), %" PRIu64 " key events per replay\n",
+           samples[samples.size() / 2] * 1000.0 / corpus_summary.reports, events.count);
+  }
+
+  bt_keyboard->set_key_handler(nullptr);
+  printf("\nRecording: %s, replays: %s, corpus: %s\n", recorded ? "ok" : "NO",
+         replayed ? "ok" : "NO", bench_ok ? "ok" : "NO");
+  return (recorded && replayed && bench_ok) ? 0 : 1;
+}
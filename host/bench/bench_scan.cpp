@@ -0,0 +1,227 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Scan result store benchmark.
+//
+// 1000 synthetic HID advertisers (800 BLE, 200 BT classic, names of 8 to 24
+// characters) each report 5 times per scan, in random order, as a busy office
+// does during a 5 second scan. Every report is recorded by:
+//
+// 1. forward list: the store previously used by BTKeyboard. Each report is
+//    looked up with a linear memcmp() walk, and each new device allocates a
+//    list node, its result and a std::string name.
+// 2. ScanStore: the open addressing table keyed by address and transport,
+//    with names copied into a per-scan arena reset in O(1).
+//
+// Heap allocations are counted by bench_alloc.cpp, replacing the global
+// operator new. Both stores must end each scan with the same devices and names.
+//
+// Then, HID mice (80% BLE, 20% BT classic) are scanned for by BTKeyboard
+// through the simulated stack. The time spent in the GAP callbacks for each
+// scan result is reported: the stack task can do nothing else meanwhile.
+//
+// Options: --advertisers=N (default 1000), --reports=N (default 5): reports per
+//          advertiser and scan, --scans=N (default 20),
+//          --stack-advertisers=N (default 60): mice around during the scans
+//          through the simulated stack
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <forward_list>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "bt_keyboard.hpp"
+#include "scan_store.hpp"
+#include "sim_stack.hpp"
+
+struct Advertiser {
+  esp_bd_addr_t       bda;
+  esp_hid_transport_t transport;
+  std::string         name;
+  uint16_t            appearance;
+  esp_bt_cod_t        cod;
+};
+
+static std::vector<Advertiser> make_advertisers(long count) {
+  std::mt19937            rng(77);
+  std::vector<Advertiser> advertisers(count);
+
+  for (long i = 0; i < count; i++) {
+    Advertiser &a = advertisers[i];
+    for (uint8_t &byte : a.bda) byte = rng();
+    a.bda[5]      = i; // Unique addresses
+    a.bda[4]      = i >> 8;
+    a.transport   = ((i % 5) == 4) ? ESP_HID_TRANSPORT_BT : ESP_HID_TRANSPORT_BLE;
+    a.appearance  = (i % 3) ? ESP_BLE_APPEARANCE_HID_MOUSE : ESP_BLE_APPEARANCE_HID_KEYBOARD;
+    uint32_t codv = 0x002540;
+    memcpy(&a.cod, &codv, sizeof(codv));
+    a.name = "Device " + std::to_string(i);
+    a.name.resize(8 + rng() % 17, '*');
+  }
+  return advertisers;
+}
+
+// 1. Forward list, as previously done by BTKeyboard::add_ble_scan_result() and
+//    BTKeyboard::add_bt_scan_result()
+struct ListResult {
+  esp_bd_addr_t       bda;
+  std::string         name;
+  int8_t              rssi;
+  esp_hid_usage_t     usage;
+  esp_hid_transport_t transport;
+  esp_bt_cod_t        cod;
+  uint16_t            appearance;
+};
+
+typedef std::forward_list<std::unique_ptr<ListResult>> ListStore;
+
+static ListResult *list_find(const esp_bd_addr_t bda, ListStore &results) {
+  for (auto &res : results) {
+    if (memcmp(bda, res->bda, sizeof(esp_bd_addr_t)) == 0) return res.get();
+  }
+  return nullptr;
+}
+
+static void list_add(const Advertiser &a, int rssi, ListStore &ble, ListStore &bt) {
+  ListStore &results = (a.transport == ESP_HID_TRANSPORT_BLE) ? ble : bt;
+  ListResult *r      = list_find(a.bda, results);
+  if (r != nullptr) {
+    if (a.transport == ESP_HID_TRANSPORT_BT) r->rssi = rssi;
+    return;
+  }
+
+  auto res = std::make_unique<ListResult>();
+  memcpy(res->bda, a.bda, sizeof(esp_bd_addr_t));
+  res->transport  = a.transport;
+  res->appearance = a.appearance;
+  res->cod        = a.cod;
+  res->rssi       = rssi;
+  res->name.assign(a.name.data(), a.name.size());
+  results.push_front(std::move(res));
+}
+
+// 2. ScanStore
+static void store_add(const Advertiser &a, int rssi, ScanStore &store) {
+  if (a.transport == ESP_HID_TRANSPORT_BLE) {
+    store.add_ble(a.bda, BLE_ADDR_TYPE_PUBLIC, a.appearance, (const uint8_t *)a.name.data(),
+                  a.name.size(), rssi);
+  } else {
+    esp_bt_uuid_t uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = 0x1124}};
+    store.add_bt(a.bda, a.cod, uuid, (const uint8_t *)a.name.data(), a.name.size(), rssi);
+  }
+}
+
+static bool same_results(ListStore &ble, ListStore &bt, ScanStore &store) {
+  size_t count = 0;
+  for (ListStore *list : {&ble, &bt}) {
+    for (auto &res : *list) {
+      ScanResult *r = store.find(res->bda, res->transport);
+      if ((r == nullptr) || (r->name != res->name)) return false;
+      count++;
+    }
+  }
+  return count == store.size();
+}
+
+// Scans through the simulated stack, with `count` HID mice around: nothing gets connected
+static bool bench_callbacks(long count, long scans) {
+  std::mt19937 rng(11);
+
+  sim::set_time_scale(0.01);
+  for (long i = 0; i < count; i++) {
+    sim::DeviceScript script;
+    script.bda          = {0x20, 0x30, 0x40, 0x50, (uint8_t)(i >> 8), (uint8_t)i};
+    script.name         = "Mouse " + std::to_string(i);
+    script.transport    = ((i % 5) == 4) ? ESP_HID_TRANSPORT_BT : ESP_HID_TRANSPORT_BLE;
+    script.appearance   = ESP_BLE_APPEARANCE_HID_MOUSE;
+    script.cod          = 0x002580; // Peripheral, pointing device minor
+    script.adv_delay_ms = 50 + rng() % 900;
+    sim::add_device(script);
+  }
+
+  BTKeyboard *bt_keyboard = new BTKeyboard();
+  if (!bt_keyboard->setup()) return false;
+
+  sim::reset_callback_stats();
+  for (long i = 0; i < scans; i++) bt_keyboard->devices_scan(1);
+
+  sim::CallbackStats stats = sim::callback_stats(sim::Callback::SCAN_RESULT);
+  printf("\nGAP callbacks, %ld mice around, %ld scans through the simulated stack\n\n", count,
+         scans);
+  printf("  scan result callback  n=%-6" PRIu32 " mean %8.2f us  max %8.2f us\n", stats.count,
+         stats.mean_us, stats.max_us);
+  return stats.count == (uint32_t)(count * scans);
+}
+
+int main(int argc, char **argv) {
+  long advertisers_count = bench::arg_value(argc, argv, "advertisers", 1000);
+  long reports_per       = bench::arg_value(argc, argv, "reports", 5);
+  long scans             = bench::arg_value(argc, argv, "scans", 20);
+  long stack_advertisers = bench::arg_value(argc, argv, "stack-advertisers", 60);
+
+  if ((advertisers_count < 1) || (advertisers_count > 0x7FFF) || (stack_advertisers < 1) ||
+      (stack_advertisers > 0x7FFF)) {
+    fprintf(stderr, "Invalid --advertisers or --stack-advertisers value\n");
+    return 1;
+  }
+
+  std::vector<Advertiser> advertisers = make_advertisers(advertisers_count);
+  std::vector<uint32_t>   order;
+  std::mt19937            rng(99);
+
+  for (long i = 0; i < advertisers_count * reports_per; i++) {
+    order.push_back(i % advertisers_count);
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+
+  ScanStore store;
+  if (!store.init(advertisers_count, advertisers_count * 24)) {
+    fprintf(stderr, "ScanStore::init() failed\n");
+    return 1;
+  }
+
+  ListStore ble, bt;
+  double    list_us = 0, store_us = 0;
+  long      list_allocs = 0, store_allocs = 0;
+  bool      same        = true;
+
+  for (long scan = 0; scan < scans; scan++) {
+    ble.clear();
+    bt.clear();
+    long before = (long)bench::allocation_count();
+    auto start  = bench::Clock::now();
+    for (uint32_t i : order) list_add(advertisers[i], -40 - (int)(i % 50), ble, bt);
+    list_us += bench::elapsed_us(start, bench::Clock::now());
+    list_allocs += (long)bench::allocation_count() - before;
+
+    before = (long)bench::allocation_count();
+    start  = bench::Clock::now();
+    store.clear();
+    for (uint32_t i : order) store_add(advertisers[i], -40 - (int)(i % 50), store);
+    store_us += bench::elapsed_us(start, bench::Clock::now());
+    store_allocs += (long)bench::allocation_count() - before;
+
+    same = same && same_results(ble, bt, store);
+  }
+
+  long reports = order.size();
+  printf("\nScan results store, %ld advertisers x %ld reports per scan, %ld scans\n\n",
+         advertisers_count, reports_per, scans);
+  printf("  %-34s %8.1f ns/report  %8.2f ms/scan  %6ld allocations/scan\n",
+         "forward list + linear memcmp()", list_us * 1000.0 / (reports * scans),
+         list_us / 1000.0 / scans, list_allocs / scans);
+  printf("  %-34s %8.1f ns/report  %8.2f ms/scan  %6ld allocations/scan\n",
+         "ScanStore hash index + arena", store_us * 1000.0 / (reports * scans),
+         store_us / 1000.0 / scans, store_allocs / scans);
+  printf("  speedup x%.1f, %u results, same devices and names: %s\n", list_us / store_us,
+         store.size(), same ? "ok" : "MISMATCH");
+
+  return bench_callbacks(stack_advertisers, 5) ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Small helpers shared by the host benchmarks: timing, percentile reports,
+// HID report construction, connection waits and heap counting.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bt_keyboard.hpp"
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsed_us(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::micro>(to - from).count();
+}
+
+/**
+ * @brief Prints min / p50 / p90 / p99 / p99.9 / max of a set of samples
+ *
+ * @param label Row label
+ * @param samples Samples in microseconds. The vector is sorted in place.
+ */
+inline void print_percentiles(const char *label, std::vector<double> &samples) {
+  if (samples.empty()) {
+    printf("  %-28s (no samples)\n", label);
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double q) {
+    size_t idx = (size_t)(q * (samples.size() - 1) + 0.5);
+    return samples[std::min(idx, samples.size() - 1)];
+  };
+  printf("  %-28s n=%-7zu min %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f us\n",
+         label, samples.size(), samples.front(), at(0.50), at(0.90), at(0.99), at(0.999),
+         samples.back());
+}
+
+/// Boot protocol keyboard report: modifier, reserved, six key usages.
+inline std::vector<uint8_t> boot_report(uint8_t modifier = 0, uint8_t key = 0) {
+  return {modifier, 0, key, 0, 0, 0, 0, 0};
+}
+
+/// sim::REPORT_ID_NKRO report: modifier byte, bitmap of usages 0x00 - 0xDF, padding.
+inline std::vector<uint8_t> nkro_report(uint8_t modifier, const std::vector<uint8_t> &usages) {
+  std::vector<uint8_t> report(64, 0);
+  report[0] = modifier;
+  for (uint8_t usage : usages) {
+    if (usage < 0xE0) report[1 + usage / 8] |= 1 << (usage % 8);
+  }
+  return report;
+}
+
+/// Waits up to timeout_ms for `count` keyboards to be connected.
+inline bool wait_connected_count(const BTKeyboard &keyboard, uint8_t count,
+                                 int timeout_ms = 2000) {
+  for (int i = 0; i < timeout_ms; i++) {
+    if (keyboard.get_connected_count() == count) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return keyboard.get_connected_count() == count;
+}
+
+/// Waits up to timeout_ms for at least one keyboard to be connected, or none.
+inline bool wait_connected(const BTKeyboard &keyboard, bool connected, int timeout_ms = 2000) {
+  for (int i = 0; i < timeout_ms; i++) {
+    if (keyboard.is_connected() == connected) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return keyboard.is_connected() == connected;
+}
+
+/// Device slot of the connected keyboard of address `bda`, or BTKeyboard::MAX_DEVICES.
+inline uint8_t slot_of(const BTKeyboard &keyboard, const uint8_t *bda) {
+  for (uint8_t i = 0; i < BTKeyboard::MAX_DEVICES; i++) {
+    BTKeyboard::DeviceStatus status = keyboard.get_device_status(i);
+    if (status.connected && (memcmp(status.bda, bda, ESP_BD_ADDR_LEN) == 0)) return i;
+  }
+  return BTKeyboard::MAX_DEVICES;
+}
+
+/// Returns the value of "--name=value" from argv, or the fallback.
+inline long arg_value(int argc, char **argv, const char *name, long fallback) {
+  std::string prefix = std::string("--") + name + "=";
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+      return strtol(argv[i] + prefix.size(), nullptr, 0);
+    }
+  }
+  return fallback;
+}
+
+/// True if argv holds "--name" alone, or "--name=value" with a value other than 0.
+inline bool arg_flag(int argc, char **argv, const char *name) {
+  std::string flag = std::string("--") + name;
+  for (int i = 1; i < argc; i++) {
+    if (flag == argv[i]) return true;
+  }
+  return arg_value(argc, argv, name, 0) != 0;
+}
+
+/// Returns the value of "--name=value" from argv, or the fallback.
+inline const char *arg_string(int argc, char **argv, const char *name, const char *fallback) {
+  std::string prefix = std::string("--") + name + "=";
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) return argv[i] + prefix.size();
+  }
+  return fallback;
+}
+
+/// Bytes requested from the global operator new so far. Needs bench_alloc.cpp linked in.
+size_t allocated_bytes();
+
+/// Calls to the global operator new so far. Needs bench_alloc.cpp linked in.
+size_t allocation_count();
+
+} // namespace bench
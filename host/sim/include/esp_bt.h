@@ -0,0 +1,31 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_bt.h header (controller API).
+
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+typedef enum {
+  ESP_BT_MODE_IDLE       = 0x00,
+  ESP_BT_MODE_BLE        = 0x01,
+  ESP_BT_MODE_CLASSIC_BT = 0x02,
+  ESP_BT_MODE_BTDM       = 0x03,
+} esp_bt_mode_t;
+
+typedef struct {
+  uint8_t mode;
+  uint8_t bt_max_acl_conn;
+  uint8_t bt_max_sync_conn;
+} esp_bt_controller_config_t;
+
+#define BT_CONTROLLER_INIT_CONFIG_DEFAULT()                                                        \
+  { .mode = ESP_BT_MODE_BTDM, .bt_max_acl_conn = 2, .bt_max_sync_conn = 0 }
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg);
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode);
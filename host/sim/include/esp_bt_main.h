@@ -0,0 +1,12 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_bt_main.h header.
+
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t esp_bluedroid_init(void);
+esp_err_t esp_bluedroid_enable(void);
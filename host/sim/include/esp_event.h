@@ -0,0 +1,18 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_event.h header.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef const char *esp_event_base_t;
+
+typedef void (*esp_event_handler_t)(void *event_handler_arg, esp_event_base_t event_base,
+                                    int32_t event_id, void *event_data);
+
+#define ESP_EVENT_ANY_ID -1
@@ -0,0 +1,238 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_gap_ble_api.h header.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+#define ESP_BLE_ADV_DATA_LEN_MAX        31
+#define ESP_BLE_SCAN_RSP_DATA_LEN_MAX   31
+
+#define ESP_BLE_APPEARANCE_HID_KEYBOARD 0x03C1
+#define ESP_BLE_APPEARANCE_HID_MOUSE    0x03C2
+
+typedef enum {
+  ESP_BLE_AD_TYPE_FLAG                     = 0x01,
+  ESP_BLE_AD_TYPE_16SRV_PART               = 0x02,
+  ESP_BLE_AD_TYPE_16SRV_CMPL               = 0x03,
+  ESP_BLE_AD_TYPE_32SRV_PART               = 0x04,
+  ESP_BLE_AD_TYPE_32SRV_CMPL               = 0x05,
+  ESP_BLE_AD_TYPE_128SRV_PART              = 0x06,
+  ESP_BLE_AD_TYPE_128SRV_CMPL              = 0x07,
+  ESP_BLE_AD_TYPE_NAME_SHORT               = 0x08,
+  ESP_BLE_AD_TYPE_NAME_CMPL                = 0x09,
+  ESP_BLE_AD_TYPE_TX_PWR                   = 0x0A,
+  ESP_BLE_AD_TYPE_DEV_CLASS                = 0x0D,
+  ESP_BLE_AD_TYPE_SERVICE_DATA             = 0x16,
+  ESP_BLE_AD_TYPE_APPEARANCE               = 0x19,
+  ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE    = 0xFF,
+} esp_ble_adv_data_type;
+
+typedef enum {
+  ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT = 0,
+  ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT,
+  ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT,
+  ESP_GAP_BLE_SCAN_RESULT_EVT,
+  ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT,
+  ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT,
+  ESP_GAP_BLE_ADV_START_COMPLETE_EVT,
+  ESP_GAP_BLE_SCAN_START_COMPLETE_EVT,
+  ESP_GAP_BLE_AUTH_CMPL_EVT,
+  ESP_GAP_BLE_KEY_EVT,
+  ESP_GAP_BLE_SEC_REQ_EVT,
+  ESP_GAP_BLE_PASSKEY_NOTIF_EVT,
+  ESP_GAP_BLE_PASSKEY_REQ_EVT,
+  ESP_GAP_BLE_OOB_REQ_EVT,
+  ESP_GAP_BLE_LOCAL_IR_EVT,
+  ESP_GAP_BLE_LOCAL_ER_EVT,
+  ESP_GAP_BLE_NC_REQ_EVT,
+  ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT,
+  ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT,
+  ESP_GAP_BLE_SET_STATIC_RAND_ADDR_EVT,
+  ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT,
+  ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT,
+  ESP_GAP_BLE_SET_LOCAL_PRIVACY_COMPLETE_EVT,
+  ESP_GAP_BLE_REMOVE_BOND_DEV_COMPLETE_EVT,
+  ESP_GAP_BLE_CLEAR_BOND_DEV_COMPLETE_EVT,
+  ESP_GAP_BLE_GET_BOND_DEV_COMPLETE_EVT,
+  ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT,
+  ESP_GAP_BLE_UPDATE_WHITELIST_COMPLETE_EVT,
+  ESP_GAP_BLE_EVT_MAX,
+} esp_gap_ble_cb_event_t;
+
+typedef enum {
+  ESP_GAP_SEARCH_INQ_RES_EVT = 0,
+  ESP_GAP_SEARCH_INQ_CMPL_EVT,
+  ESP_GAP_SEARCH_DISC_RES_EVT,
+  ESP_GAP_SEARCH_DISC_BLE_RES_EVT,
+  ESP_GAP_SEARCH_DISC_CMPL_EVT,
+  ESP_GAP_SEARCH_DI_DISC_CMPL_EVT,
+  ESP_GAP_SEARCH_SEARCH_CANCEL_CMPL_EVT,
+  ESP_GAP_SEARCH_INQ_DISCARD_NUM_EVT,
+} esp_gap_search_evt_t;
+
+typedef enum {
+  ESP_BLE_EVT_CONN_ADV     = 0x00,
+  ESP_BLE_EVT_CONN_DIR_ADV = 0x01,
+  ESP_BLE_EVT_DISC_ADV     = 0x02,
+  ESP_BLE_EVT_NON_CONN_ADV = 0x03,
+  ESP_BLE_EVT_SCAN_RSP     = 0x04,
+} esp_ble_evt_type_t;
+
+typedef enum {
+  BLE_SCAN_TYPE_PASSIVE = 0x0,
+  BLE_SCAN_TYPE_ACTIVE  = 0x1,
+} esp_ble_scan_type_t;
+
+typedef enum {
+  BLE_SCAN_FILTER_ALLOW_ALL = 0x0,
+  BLE_SCAN_FILTER_ALLOW_ONLY_WLST,
+  BLE_SCAN_FILTER_ALLOW_UND_RPA_DIR,
+  BLE_SCAN_FILTER_ALLOW_WLIST_RPA_DIR,
+} esp_ble_scan_filter_t;
+
+typedef enum {
+  BLE_SCAN_DUPLICATE_DISABLE = 0x0,
+  BLE_SCAN_DUPLICATE_ENABLE  = 0x1,
+} esp_ble_scan_duplicate_t;
+
+typedef struct {
+  esp_ble_scan_type_t      scan_type;
+  esp_ble_addr_type_t      own_addr_type;
+  esp_ble_scan_filter_t    scan_filter_policy;
+  uint16_t                 scan_interval;
+  uint16_t                 scan_window;
+  esp_ble_scan_duplicate_t scan_duplicate;
+} esp_ble_scan_params_t;
+
+typedef struct {
+  esp_bd_addr_t bda;
+  uint16_t      min_int;
+  uint16_t      max_int;
+  uint16_t      latency;
+  uint16_t      timeout;
+} esp_ble_conn_update_params_t;
+
+typedef struct {
+  uint16_t interval;
+  uint16_t latency;
+  uint16_t timeout;
+} esp_gap_conn_params_t;
+
+typedef uint8_t esp_ble_key_type_t;
+
+#define ESP_LE_KEY_NONE  0
+#define ESP_LE_KEY_PENC  (1 << 0)
+#define ESP_LE_KEY_PID   (1 << 1)
+#define ESP_LE_KEY_PCSRK (1 << 2)
+#define ESP_LE_KEY_PLK   (1 << 3)
+#define ESP_LE_KEY_LLK   (ESP_LE_KEY_PLK << 4)
+#define ESP_LE_KEY_LENC  (ESP_LE_KEY_PENC << 4)
+#define ESP_LE_KEY_LID   (ESP_LE_KEY_PID << 4)
+#define ESP_LE_KEY_LCSRK (ESP_LE_KEY_PCSRK << 4)
+
+typedef struct {
+  esp_bt_octet16_t irk;
+} esp_ble_bond_key_info_t;
+
+typedef struct {
+  esp_bd_addr_t           bd_addr;
+  esp_ble_bond_key_info_t bond_key;
+  esp_ble_addr_type_t     bd_addr_type;
+} esp_ble_bond_dev_t;
+
+typedef struct {
+  esp_bd_addr_t bd_addr;
+  uint32_t      passkey;
+} esp_ble_sec_key_notif_t;
+
+typedef struct {
+  esp_bd_addr_t bd_addr;
+} esp_ble_sec_req_t;
+
+typedef struct {
+  esp_bd_addr_t      bd_addr;
+  esp_ble_key_type_t key_type;
+} esp_ble_key_t;
+
+typedef struct {
+  esp_bd_addr_t       bd_addr;
+  bool                key_present;
+  uint8_t             key_type;
+  bool                success;
+  uint8_t             fail_reason;
+  esp_ble_addr_type_t addr_type;
+  esp_bt_dev_type_t   dev_type;
+} esp_ble_auth_cmpl_t;
+
+typedef union {
+  esp_ble_sec_key_notif_t key_notif;
+  esp_ble_sec_req_t       ble_req;
+  esp_ble_key_t           ble_key;
+  esp_ble_auth_cmpl_t     auth_cmpl;
+} esp_ble_sec_t;
+
+typedef union {
+  struct ble_scan_result_evt_param {
+    esp_gap_search_evt_t search_evt;
+    esp_bd_addr_t        bda;
+    esp_bt_dev_type_t    dev_type;
+    esp_ble_addr_type_t  ble_addr_type;
+    esp_ble_evt_type_t   ble_evt_type;
+    int                  rssi;
+    uint8_t              ble_adv[ESP_BLE_ADV_DATA_LEN_MAX + ESP_BLE_SCAN_RSP_DATA_LEN_MAX];
+    int                  flag;
+    int                  num_resps;
+    uint8_t              adv_data_len;
+    uint8_t              scan_rsp_len;
+    uint32_t             num_dis;
+  } scan_rst;
+
+  struct ble_scan_param_cmpl_evt_param {
+    esp_bt_status_t status;
+  } scan_param_cmpl;
+
+  struct ble_scan_start_cmpl_evt_param {
+    esp_bt_status_t status;
+  } scan_start_cmpl;
+
+  struct ble_scan_stop_cmpl_evt_param {
+    esp_bt_status_t status;
+  } scan_stop_cmpl;
+
+  esp_ble_sec_t ble_security;
+
+  struct ble_update_conn_params_evt_param {
+    esp_bt_status_t status;
+    esp_bd_addr_t   bda;
+    uint16_t        min_int;
+    uint16_t        max_int;
+    uint16_t        latency;
+    uint16_t        conn_int;
+    uint16_t        timeout;
+  } update_conn_params;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback);
+esp_err_t esp_ble_gap_set_scan_params(esp_ble_scan_params_t *scan_params);
+esp_err_t esp_ble_gap_start_scanning(uint32_t duration);
+esp_err_t esp_ble_gap_stop_scanning(void);
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params);
+esp_err_t esp_ble_get_current_conn_params(esp_bd_addr_t          bd_addr,
+                                          esp_gap_conn_params_t *conn_params);
+uint8_t  *esp_ble_resolve_adv_data_by_type(uint8_t *adv_data, uint16_t adv_data_len,
+                                           esp_ble_adv_data_type type, uint8_t *length);
+esp_err_t esp_ble_gap_security_rsp(esp_bd_addr_t bd_addr, bool accept);
+esp_err_t esp_ble_confirm_reply(esp_bd_addr_t bd_addr, bool accept);
+int       esp_ble_get_bond_device_num(void);
+esp_err_t esp_ble_get_bond_device_list(int *dev_num, esp_ble_bond_dev_t *dev_list);
+esp_err_t esp_ble_remove_bond_device(esp_bd_addr_t bd_addr);
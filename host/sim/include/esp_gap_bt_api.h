@@ -0,0 +1,193 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_gap_bt_api.h header (Classic
+// Bluetooth GAP).
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+typedef struct {
+  uint32_t reserved_2 : 2;
+  uint32_t minor : 6;
+  uint32_t major : 5;
+  uint32_t service : 11;
+  uint32_t reserved_8 : 8;
+} esp_bt_cod_t;
+
+typedef enum {
+  ESP_BT_COD_MAJOR_DEV_MISC          = 0,
+  ESP_BT_COD_MAJOR_DEV_COMPUTER      = 1,
+  ESP_BT_COD_MAJOR_DEV_PHONE         = 2,
+  ESP_BT_COD_MAJOR_DEV_LAN_NAP       = 3,
+  ESP_BT_COD_MAJOR_DEV_AV            = 4,
+  ESP_BT_COD_MAJOR_DEV_PERIPHERAL    = 5,
+  ESP_BT_COD_MAJOR_DEV_IMAGING       = 6,
+  ESP_BT_COD_MAJOR_DEV_WEARABLE      = 7,
+  ESP_BT_COD_MAJOR_DEV_TOY           = 8,
+  ESP_BT_COD_MAJOR_DEV_HEALTH        = 9,
+  ESP_BT_COD_MAJOR_DEV_UNCATEGORIZED = 31,
+} esp_bt_cod_major_dev_t;
+
+typedef enum {
+  ESP_BT_GAP_DEV_PROP_BDNAME = 1,
+  ESP_BT_GAP_DEV_PROP_COD,
+  ESP_BT_GAP_DEV_PROP_RSSI,
+  ESP_BT_GAP_DEV_PROP_EIR,
+} esp_bt_gap_dev_prop_type_t;
+
+typedef struct {
+  esp_bt_gap_dev_prop_type_t type;
+  int                        len;
+  void                      *val;
+} esp_bt_gap_dev_prop_t;
+
+#define ESP_BT_GAP_EIR_DATA_LEN 240
+
+typedef enum {
+  ESP_BT_EIR_TYPE_FLAGS               = 0x01,
+  ESP_BT_EIR_TYPE_INCMPL_16BITS_UUID  = 0x02,
+  ESP_BT_EIR_TYPE_CMPL_16BITS_UUID    = 0x03,
+  ESP_BT_EIR_TYPE_INCMPL_32BITS_UUID  = 0x04,
+  ESP_BT_EIR_TYPE_CMPL_32BITS_UUID    = 0x05,
+  ESP_BT_EIR_TYPE_INCMPL_128BITS_UUID = 0x06,
+  ESP_BT_EIR_TYPE_CMPL_128BITS_UUID   = 0x07,
+  ESP_BT_EIR_TYPE_SHORT_LOCAL_NAME    = 0x08,
+  ESP_BT_EIR_TYPE_CMPL_LOCAL_NAME     = 0x09,
+  ESP_BT_EIR_TYPE_TX_POWER_LEVEL      = 0x0a,
+  ESP_BT_EIR_TYPE_URL                 = 0x24,
+  ESP_BT_EIR_TYPE_MANU_SPECIFIC       = 0xff,
+} esp_bt_eir_type_t;
+
+typedef enum {
+  ESP_BT_GAP_DISCOVERY_STOPPED,
+  ESP_BT_GAP_DISCOVERY_STARTED,
+} esp_bt_gap_discovery_state_t;
+
+typedef enum {
+  ESP_BT_GAP_DISC_RES_EVT = 0,
+  ESP_BT_GAP_DISC_STATE_CHANGED_EVT,
+  ESP_BT_GAP_RMT_SRVCS_EVT,
+  ESP_BT_GAP_RMT_SRVC_REC_EVT,
+  ESP_BT_GAP_AUTH_CMPL_EVT,
+  ESP_BT_GAP_PIN_REQ_EVT,
+  ESP_BT_GAP_CFM_REQ_EVT,
+  ESP_BT_GAP_KEY_NOTIF_EVT,
+  ESP_BT_GAP_KEY_REQ_EVT,
+  ESP_BT_GAP_READ_RSSI_DELTA_EVT,
+  ESP_BT_GAP_CONFIG_EIR_DATA_EVT,
+  ESP_BT_GAP_SET_AFH_CHANNELS_EVT,
+  ESP_BT_GAP_READ_REMOTE_NAME_EVT,
+  ESP_BT_GAP_MODE_CHG_EVT,
+  ESP_BT_GAP_REMOVE_BOND_DEV_COMPLETE_EVT,
+  ESP_BT_GAP_QOS_CMPL_EVT,
+  ESP_BT_GAP_ACL_CONN_CMPL_STAT_EVT,
+  ESP_BT_GAP_ACL_DISCONN_CMPL_STAT_EVT,
+  ESP_BT_GAP_EVT_MAX,
+} esp_bt_gap_cb_event_t;
+
+typedef enum {
+  ESP_BT_INQ_MODE_GENERAL_INQUIRY,
+  ESP_BT_INQ_MODE_LIMITED_INQUIRY,
+} esp_bt_inq_mode_t;
+
+typedef enum {
+  ESP_BT_NON_CONNECTABLE,
+  ESP_BT_CONNECTABLE,
+} esp_bt_connection_mode_t;
+
+typedef enum {
+  ESP_BT_NON_DISCOVERABLE,
+  ESP_BT_LIMITED_DISCOVERABLE,
+  ESP_BT_GENERAL_DISCOVERABLE,
+} esp_bt_discovery_mode_t;
+
+typedef enum {
+  ESP_BT_SP_IOCAP_MODE = 0,
+} esp_bt_sp_param_t;
+
+typedef uint8_t esp_bt_io_cap_t;
+
+#define ESP_BT_IO_CAP_OUT    0
+#define ESP_BT_IO_CAP_IO     1
+#define ESP_BT_IO_CAP_IN     2
+#define ESP_BT_IO_CAP_NONE   3
+
+typedef enum {
+  ESP_BT_PIN_TYPE_VARIABLE = 0,
+  ESP_BT_PIN_TYPE_FIXED    = 1,
+} esp_bt_pin_type_t;
+
+#define ESP_BT_PIN_CODE_LEN 16
+typedef uint8_t esp_bt_pin_code_t[ESP_BT_PIN_CODE_LEN];
+
+typedef enum {
+  ESP_BT_PM_MD_ACTIVE = 0,
+  ESP_BT_PM_MD_HOLD,
+  ESP_BT_PM_MD_SNIFF,
+  ESP_BT_PM_MD_PARK,
+} esp_bt_pm_mode_t;
+
+typedef union {
+  struct disc_res_param {
+    esp_bd_addr_t          bda;
+    int                    num_prop;
+    esp_bt_gap_dev_prop_t *prop;
+  } disc_res;
+
+  struct disc_state_changed_param {
+    esp_bt_gap_discovery_state_t state;
+  } disc_st_chg;
+
+  struct cfm_req_param {
+    esp_bd_addr_t bda;
+    uint32_t      num_val;
+  } cfm_req;
+
+  struct key_notif_param {
+    esp_bd_addr_t bda;
+    uint32_t      passkey;
+  } key_notif;
+
+  struct key_req_param {
+    esp_bd_addr_t bda;
+  } key_req;
+
+  struct pin_req_param {
+    esp_bd_addr_t bda;
+    bool          min_16_digit;
+  } pin_req;
+
+  struct mode_chg_param {
+    esp_bd_addr_t    bda;
+    esp_bt_pm_mode_t mode;
+  } mode_chg;
+
+  struct qos_cmpl_param {
+    esp_bt_status_t stat;
+    esp_bd_addr_t   bda;
+    uint32_t        t_poll;
+  } qos_cmpl;
+} esp_bt_gap_cb_param_t;
+
+typedef void (*esp_bt_gap_cb_t)(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *param);
+
+esp_err_t esp_bt_gap_register_callback(esp_bt_gap_cb_t callback);
+esp_err_t esp_bt_gap_set_scan_mode(esp_bt_connection_mode_t c_mode,
+                                   esp_bt_discovery_mode_t  d_mode);
+esp_err_t esp_bt_gap_start_discovery(esp_bt_inq_mode_t mode, uint8_t inq_len, uint8_t num_rsps);
+esp_err_t esp_bt_gap_cancel_discovery(void);
+uint8_t  *esp_bt_gap_resolve_eir_data(uint8_t *eir, esp_bt_eir_type_t type, uint8_t *length);
+esp_err_t esp_bt_gap_set_security_param(esp_bt_sp_param_t param_type, void *value, uint8_t len);
+esp_err_t esp_bt_gap_ssp_confirm_reply(esp_bd_addr_t bd_addr, bool accept);
+esp_err_t esp_bt_gap_set_pin(esp_bt_pin_type_t pin_type, uint8_t pin_code_len,
+                             esp_bt_pin_code_t pin_code);
+esp_err_t esp_bt_gap_pin_reply(esp_bd_addr_t bd_addr, bool accept, uint8_t pin_code_len,
+                               esp_bt_pin_code_t pin_code);
+esp_err_t esp_bt_gap_set_qos(esp_bd_addr_t remote_bda, uint32_t t_poll);
@@ -0,0 +1,13 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_gatt_defs.h header.
+
+#pragma once
+
+#include <stdint.h>
+
+#define ESP_GATT_UUID_HID_SVC 0x1812
+
+typedef uint8_t esp_gatt_if_t;
@@ -0,0 +1,46 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_hid_common.h header.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_err.h"
+
+typedef enum {
+  ESP_HID_TRANSPORT_BT,
+  ESP_HID_TRANSPORT_BLE,
+  ESP_HID_TRANSPORT_USB,
+  ESP_HID_TRANSPORT_MAX
+} esp_hid_transport_t;
+
+typedef enum {
+  ESP_HID_USAGE_GENERIC  = 0,
+  ESP_HID_USAGE_KEYBOARD = 1,
+  ESP_HID_USAGE_MOUSE    = 2,
+  ESP_HID_USAGE_JOYSTICK = 4,
+  ESP_HID_USAGE_GAMEPAD  = 8,
+  ESP_HID_USAGE_TABLET   = 16,
+  ESP_HID_USAGE_CCONTROL = 32,
+  ESP_HID_USAGE_VENDOR   = 64
+} esp_hid_usage_t;
+
+typedef enum {
+  ESP_HID_COD_MIN_KEYBOARD = 0x10,
+  ESP_HID_COD_MIN_MOUSE    = 0x20,
+} esp_hid_cod_min_t;
+
+typedef struct {
+  const uint8_t *data;
+  uint16_t       len;
+} esp_hid_raw_report_map_t;
+
+const char     *esp_hid_usage_str(esp_hid_usage_t usage);
+const char     *esp_hid_cod_major_str(uint8_t cod_major);
+void            esp_hid_cod_minor_print(uint8_t cod_min, FILE *fp);
+esp_hid_usage_t esp_hid_usage_from_appearance(uint16_t appearance);
+esp_hid_usage_t esp_hid_usage_from_cod(uint32_t cod);
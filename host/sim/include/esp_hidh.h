@@ -0,0 +1,108 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_hidh.h header. Events are
+// delivered by the simulated stack on its own event task, as esp_hidh does.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_bt_defs.h"
+#include "esp_event.h"
+#include "esp_gatt_defs.h"
+#include "esp_hid_common.h"
+
+typedef struct esp_hidh_dev_s esp_hidh_dev_t;
+
+extern esp_event_base_t const ESP_HIDH_EVENTS;
+
+typedef enum {
+  ESP_HIDH_ANY_EVENT   = ESP_EVENT_ANY_ID,
+  ESP_HIDH_OPEN_EVENT  = 0,
+  ESP_HIDH_BATTERY_EVENT,
+  ESP_HIDH_INPUT_EVENT,
+  ESP_HIDH_FEATURE_EVENT,
+  ESP_HIDH_CLOSE_EVENT,
+  ESP_HIDH_START_EVENT,
+  ESP_HIDH_STOP_EVENT,
+  ESP_HIDH_MAX_EVENT,
+} esp_hidh_event_t;
+
+typedef union {
+  struct {
+    esp_err_t status;
+  } start;
+
+  struct {
+    esp_err_t status;
+  } stop;
+
+  struct {
+    esp_hidh_dev_t *dev;
+    esp_err_t       status;
+  } open;
+
+  struct {
+    esp_hidh_dev_t *dev;
+    int             reason;
+    esp_err_t       status;
+  } close;
+
+  struct {
+    esp_hidh_dev_t *dev;
+    uint8_t         level;
+    esp_err_t       status;
+  } battery;
+
+  struct {
+    esp_hidh_dev_t *dev;
+    esp_hid_usage_t usage;
+    uint16_t        report_id;
+    uint16_t        length;
+    uint8_t        *data;
+    uint8_t         map_index;
+  } input;
+
+  struct {
+    esp_hidh_dev_t *dev;
+    esp_hid_usage_t usage;
+    uint16_t        report_id;
+    uint16_t        length;
+    uint8_t        *data;
+    uint8_t         map_index;
+    esp_err_t       status;
+  } feature;
+} esp_hidh_event_data_t;
+
+typedef struct {
+  esp_event_handler_t callback;
+  uint16_t            event_stack_size;
+  void               *callback_arg;
+} esp_hidh_config_t;
+
+esp_err_t       esp_hidh_init(const esp_hidh_config_t *config);
+esp_err_t       esp_hidh_deinit(void);
+esp_hidh_dev_t *esp_hidh_dev_open(esp_bd_addr_t bda, esp_hid_transport_t transport,
+                                  uint8_t remote_addr_type);
+esp_err_t       esp_hidh_dev_close(esp_hidh_dev_t *dev);
+void            esp_hidh_dev_dump(esp_hidh_dev_t *dev, FILE *fp);
+const uint8_t  *esp_hidh_dev_bda_get(esp_hidh_dev_t *dev);
+const char     *esp_hidh_dev_name_get(esp_hidh_dev_t *dev);
+esp_hid_transport_t esp_hidh_dev_transport_get(esp_hidh_dev_t *dev);
+esp_err_t       esp_hidh_dev_report_maps_get(esp_hidh_dev_t *dev, size_t *num_maps,
+                                             esp_hid_raw_report_map_t **maps);
+
+// GATT client glue (esp_hidh_gattc.h / esp_gattc_api.h on target)
+
+typedef int   esp_gattc_cb_event_t;
+typedef void *esp_ble_gattc_cb_param_ptr_t;
+typedef void (*esp_gattc_cb_t)(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                               esp_ble_gattc_cb_param_ptr_t param);
+
+void      esp_hidh_gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                       esp_ble_gattc_cb_param_ptr_t param);
+esp_err_t esp_ble_gattc_register_callback(esp_gattc_cb_t callback);
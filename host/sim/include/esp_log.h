@@ -0,0 +1,44 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_log.h header. As on target,
+// messages above LOG_LOCAL_LEVEL are compiled out.
+
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+#ifndef LOG_LOCAL_LEVEL
+  #define LOG_LOCAL_LEVEL ESP_LOG_INFO
+#endif
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...);
+void esp_log_buffer_hex_internal(const char *tag, const void *buffer, uint16_t buff_len,
+                                 esp_log_level_t level);
+
+#define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...)                                               \
+  do {                                                                                             \
+    if (LOG_LOCAL_LEVEL >= level) esp_log_write(level, tag, format, ##__VA_ARGS__);                \
+  } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#define ESP_LOG_BUFFER_HEX_LEVEL(tag, buffer, buff_len, level)                                     \
+  do {                                                                                             \
+    if (LOG_LOCAL_LEVEL >= level) esp_log_buffer_hex_internal(tag, buffer, buff_len, level);       \
+  } while (0)
@@ -0,0 +1,14 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF esp_system.h header.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
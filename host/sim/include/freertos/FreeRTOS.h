@@ -0,0 +1,46 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF FreeRTOS.h header. Tasks are mapped
+// onto host threads and the tick period is one millisecond.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+typedef uint32_t     TickType_t;
+typedef int          BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ    1000
+#define configMAX_PRIORITIES  25
+#define portMAX_DELAY         ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS    ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)     ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+#define pdFALSE               ((BaseType_t)0)
+#define pdTRUE                ((BaseType_t)1)
+#define pdFAIL                pdFALSE
+#define pdPASS                pdTRUE
+#define errQUEUE_EMPTY        ((BaseType_t)0)
+#define errQUEUE_FULL         ((BaseType_t)0)
+
+typedef struct {
+  volatile int owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)      vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)  vPortExitCritical(mux)
+#define taskENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define taskEXIT_CRITICAL(mux)      vPortExitCritical(mux)
@@ -0,0 +1,26 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF freertos/queue.h header.
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct QueueDefinition *QueueHandle_t;
+
+/// Memory of a queue created by xQueueCreateStatic(), large enough for the host queue object
+typedef struct {
+  alignas(16) uint8_t opaque[256];
+} StaticQueue_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t queue_length, UBaseType_t item_size);
+QueueHandle_t xQueueCreateStatic(UBaseType_t queue_length, UBaseType_t item_size,
+                                 uint8_t *storage, StaticQueue_t *buffer);
+void          vQueueDelete(QueueHandle_t queue);
+BaseType_t    xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait);
+BaseType_t    xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#define xQueueSend(queue, item, ticks) xQueueSendToBack(queue, item, ticks)
@@ -0,0 +1,26 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF freertos/semphr.h header. As in
+// FreeRTOS, a binary semaphore is a queue of length one with no payload.
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+/// A binary semaphore created given, held by `buffer` if not NULL. Priority inheritance is
+/// not simulated.
+SemaphoreHandle_t sim_semaphore_create_mutex(StaticSemaphore_t *buffer);
+
+#define xSemaphoreCreateBinary()               xQueueCreate(1, 0)
+#define xSemaphoreCreateBinaryStatic(buffer)   xQueueCreateStatic(1, 0, NULL, buffer)
+#define xSemaphoreCreateMutex()                sim_semaphore_create_mutex(NULL)
+#define xSemaphoreCreateMutexStatic(buffer)    sim_semaphore_create_mutex(buffer)
+#define xSemaphoreTake(semaphore, ticks)       xQueueReceive(semaphore, NULL, ticks)
+#define xSemaphoreGive(semaphore)              xQueueSendToBack(semaphore, NULL, 0)
+#define vSemaphoreDelete(semaphore)            vQueueDelete(semaphore)
@@ -0,0 +1,28 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF freertos/task.h header.
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskIDLE_PRIORITY ((UBaseType_t)0U)
+#define tskNO_AFFINITY   ((BaseType_t)0x7FFFFFFF)
+
+BaseType_t   xTaskCreate(TaskFunction_t task_code, const char *name, uint32_t stack_depth,
+                         void *parameters, UBaseType_t priority, TaskHandle_t *created_task);
+BaseType_t   xTaskCreatePinnedToCore(TaskFunction_t task_code, const char *name,
+                                     uint32_t stack_depth, void *parameters, UBaseType_t priority,
+                                     TaskHandle_t *created_task, BaseType_t core_id);
+void         vTaskDelete(TaskHandle_t task);
+void         vTaskDelay(TickType_t ticks);
+TickType_t   xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+BaseType_t   xTaskNotifyGive(TaskHandle_t task);
+uint32_t     ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait);
@@ -0,0 +1,13 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the ESP-IDF nvs_flash.h header.
+
+#pragma once
+
+#include "esp_err.h"
+#include "nvs.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
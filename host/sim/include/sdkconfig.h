@@ -0,0 +1,18 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host simulation stand-in for the generated sdkconfig.h. Mirrors the options
+// set in sdkconfig.defaults that the bt_keyboard component depends on, and
+// enables the component options exercised by the benchmarks.
+
+#pragma once
+
+#define CONFIG_BT_ENABLED           1
+#define CONFIG_BT_BLUEDROID_ENABLED 1
+#define CONFIG_BT_CLASSIC_ENABLED   1
+#define CONFIG_BT_BLE_ENABLED       1
+#define CONFIG_BT_HID_ENABLED       1
+#define CONFIG_BT_HID_HOST_ENABLED  1
+
+#define CONFIG_BT_KEYBOARD_LATENCY_STATS 1
@@ -0,0 +1,107 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Scripting interface of the simulated Bluedroid / esp_hidh stack used by the
+// host build. Devices are described once with a DeviceScript, then show up in
+// BLE scans or BT inquiries, accept esp_hidh_dev_open() and can be driven to
+// send input reports, battery levels or link losses. All esp_hidh events are
+// delivered on a dedicated event task, and GAP events on a "btc" task, the
+// same way the real stack does on target.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esp_gap_ble_api.h"
+#include "esp_hid_common.h"
+#include "esp_hidh.h"
+
+namespace sim {
+
+struct DeviceScript {
+  std::array<uint8_t, 6> bda{0x10, 0x20, 0x30, 0x40, 0x50, 0x60};
+  std::string            name{"Sim Keyboard"};
+  esp_hid_transport_t    transport{ESP_HID_TRANSPORT_BLE};
+  esp_ble_addr_type_t    addr_type{BLE_ADDR_TYPE_PUBLIC};
+  uint16_t               appearance{ESP_BLE_APPEARANCE_HID_KEYBOARD};
+  uint32_t               cod{0x002540}; // Peripheral, keyboard minor, limited discoverable
+  bool                   hid_service{true};
+  int8_t                 rssi{-50};
+  std::vector<uint8_t>   report_map{};   // Empty: boot keyboard descriptor
+  uint32_t               adv_delay_ms{100};
+  uint32_t               connect_delay_ms{20};
+  bool                   reachable{true};
+
+  // Link timing. While the connection (BLE) or poll (BT Classic) interval is 0, it is not
+  // simulated: input reports are delivered at once. Otherwise, each report waits for the next
+  // exchange of the link, one interval apart.
+  uint16_t conn_interval{0};     // BLE connection interval at connection, 1.25 ms units
+  uint16_t conn_timeout{400};    // BLE supervision timeout at connection, 10 ms units
+  uint16_t min_conn_interval{6}; // Shortest BLE connection interval the keyboard accepts
+  uint8_t  counter_proposals{0}; // Updates the keyboard answers by going back to conn_interval
+  uint16_t poll_slots{0};        // BT Classic poll interval at connection, 625 us slots
+  uint16_t sniff_slots{0};       // BT Classic sniff interval, in effect while set_sniff() is on
+};
+
+/// Multiplier applied to every simulated delay (scan windows, advertising and
+/// connection delays). Benchmarks usually shrink time with values below 1.
+void set_time_scale(double scale);
+
+esp_hidh_dev_t *add_device(const DeviceScript &script);
+void            set_reachable(esp_hidh_dev_t *dev, bool reachable);
+bool            is_open(esp_hidh_dev_t *dev);
+
+/// Queue an ESP_HIDH_INPUT_EVENT for the device. The data is copied.
+void input(esp_hidh_dev_t *dev, const uint8_t *data, size_t length, uint16_t report_id = 0,
+           uint8_t map_index = 0);
+void battery(esp_hidh_dev_t *dev, uint8_t level);
+
+/// Simulates a link loss initiated by the device (ESP_HIDH_CLOSE_EVENT).
+void disconnect(esp_hidh_dev_t *dev);
+
+/// BT Classic keyboard entering or leaving sniff mode on its own (ESP_BT_GAP_MODE_CHG_EVT).
+void set_sniff(esp_hidh_dev_t *dev, bool sniff);
+
+/// Interval between the exchanges of the link in effect, in microseconds, 0 if not simulated
+uint32_t link_interval_us(esp_hidh_dev_t *dev);
+
+/// Application callbacks whose duration is measured
+enum class Callback {
+  SCAN_RESULT, ///< BLE advertisement or BT inquiry result, in the btc task
+  OPEN,        ///< ESP_HIDH_OPEN_EVENT, in the esp_hidh event task
+  COUNT
+};
+
+struct CallbackStats {
+  uint32_t count;
+  double   mean_us;
+  double   max_us;
+};
+
+/// Time spent in the application callbacks since the start of the process (or last reset).
+/// The stack tasks can't process anything else meanwhile.
+CallbackStats callback_stats(Callback kind);
+void          reset_callback_stats();
+
+/// Number of nvs_set_blob() calls since the start of the process, to check flash wear.
+uint32_t nvs_write_count();
+
+/// Blocks until both the event task and the btc task have no pending work.
+void wait_idle();
+
+const std::vector<uint8_t> &boot_keyboard_report_map();
+
+/// Report IDs of composite_keyboard_report_map()
+constexpr uint8_t REPORT_ID_BOOT     = 1; ///< Boot keyboard layout, 8 bytes
+constexpr uint8_t REPORT_ID_NKRO     = 2; ///< Modifiers + bitmap of usages 0x00 - 0xDF, 64 bytes
+constexpr uint8_t REPORT_ID_CONSUMER = 3; ///< One 16-bit consumer control usage
+
+/// Keyboard with boot, NKRO and consumer control reports, as found on recent BLE keyboards
+const std::vector<uint8_t> &composite_keyboard_report_map();
+
+} // namespace sim
@@ -0,0 +1,330 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Host stand-ins for the small ESP-IDF services used by the component:
+// logging, error names, heap queries, esp_timer, NVS, controller bring-up and
+// the esp_hid_common helpers.
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_err.h"
+#include "esp_gap_ble_api.h"
+#include "esp_hid_common.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "nvs_flash.h"
+#include "sim_internal.hpp"
+#include "sim_stack.hpp"
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void          *arg;
+  std::mutex     mutex;
+  bool           active{false};
+  uint64_t       generation{0}; // Invalidates the pending expiry when stopped or restarted
+};
+
+namespace {
+
+std::atomic<esp_log_level_t> runtime_log_level{ESP_LOG_WARN};
+
+struct Nvs {
+  std::mutex                                           mutex;
+  bool                                                 initialized{false};
+  std::map<std::string, std::vector<uint8_t>>          entries; // "namespace/key"
+  std::map<nvs_handle_t, std::pair<std::string, bool>> handles; // Namespace, writable
+  nvs_handle_t                                         next_handle{1};
+  uint32_t                                             writes{0};
+};
+
+Nvs &nvs() {
+  static Nvs *instance = new Nvs;
+  return *instance;
+}
+
+const char level_letter[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+
+} // namespace
+
+// ----- Logging -----
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) { runtime_log_level = level; }
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+  if (level > runtime_log_level) return;
+
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "%c (%" PRIu32 ") %s: ", level_letter[level], (uint32_t)xTaskGetTickCount(),
+          tag);
+  vfprintf(stderr, format, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+void esp_log_buffer_hex_internal(const char *tag, const void *buffer, uint16_t buff_len,
+                                 esp_log_level_t level) {
+  if (level > runtime_log_level) return;
+
+  const uint8_t *bytes = static_cast<const uint8_t *>(buffer);
+  fprintf(stderr, "%c %s: ", level_letter[level], tag);
+  for (uint16_t i = 0; i < buff_len; i++) {
+    fprintf(stderr, "%02x ", bytes[i]);
+  }
+  fputc('\n', stderr);
+}
+
+// ----- Errors and system -----
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK:
+      return "ESP_OK";
+    case ESP_FAIL:
+      return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+      return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+      return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+      return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+      return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+      return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_INITIALIZED:
+      return "ESP_ERR_NVS_NOT_INITIALIZED";
+    case ESP_ERR_NVS_NOT_FOUND:
+      return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_INVALID_HANDLE:
+      return "ESP_ERR_NVS_INVALID_HANDLE";
+    case ESP_ERR_NVS_INVALID_LENGTH:
+      return "ESP_ERR_NVS_INVALID_LENGTH";
+    default:
+      return "UNKNOWN ERROR";
+  }
+}
+
+// The host has no meaningful heap figure; report a fixed ESP32-like value.
+uint32_t esp_get_free_heap_size(void) { return 200 * 1024; }
+uint32_t esp_get_minimum_free_heap_size(void) { return 200 * 1024; }
+
+// ----- esp_timer -----
+
+int64_t esp_timer_get_time(void) {
+  static const auto origin = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                               origin)
+      .count();
+}
+
+static sim::Worker &timer_task() {
+  static sim::Worker *worker = new sim::Worker("esp_timer");
+  return *worker;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args,
+                           esp_timer_handle_t            *out_handle) {
+  if ((create_args == nullptr) || (create_args->callback == nullptr) || (out_handle == nullptr)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *out_handle             = new esp_timer;
+  (*out_handle)->callback = create_args->callback;
+  (*out_handle)->arg      = create_args->arg;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->active = true;
+    generation    = ++timer->generation;
+  }
+
+  timer_task().post(
+      [timer, generation]() {
+        {
+          std::lock_guard<std::mutex> lock(timer->mutex);
+          if (!timer->active || (timer->generation != generation)) return;
+          timer->active = false;
+        }
+        timer->callback(timer->arg);
+      },
+      std::chrono::microseconds(timeout_us));
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  std::lock_guard<std::mutex> lock(timer->mutex);
+  if (!timer->active) return ESP_ERR_INVALID_STATE;
+  timer->active = false;
+  timer->generation++;
+  return ESP_OK;
+}
+
+// Pending expiries hold the timer pointer: the handle is never freed on the host.
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  esp_timer_stop(timer);
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+  std::lock_guard<std::mutex> lock(timer->mutex);
+  return timer->active;
+}
+
+// ----- NVS -----
+
+esp_err_t nvs_flash_init(void) {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  nvs().initialized = true;
+  return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  nvs().entries.clear();
+  return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode,
+                   nvs_handle_t *out_handle) {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  if (!nvs().initialized) return ESP_ERR_NVS_NOT_INITIALIZED;
+  *out_handle                = nvs().next_handle++;
+  nvs().handles[*out_handle] = {namespace_name, open_mode == NVS_READWRITE};
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  auto                        h = nvs().handles.find(handle);
+  if (h == nvs().handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+  auto entry = nvs().entries.find(h->second.first + "/" + key);
+  if (entry == nvs().entries.end()) return ESP_ERR_NVS_NOT_FOUND;
+  if (out_value == nullptr) {
+    *length = entry->second.size();
+    return ESP_OK;
+  }
+  if (*length < entry->second.size()) return ESP_ERR_NVS_INVALID_LENGTH;
+  memcpy(out_value, entry->second.data(), entry->second.size());
+  *length = entry->second.size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  auto                        h = nvs().handles.find(handle);
+  if ((h == nvs().handles.end()) || !h->second.second) return ESP_ERR_NVS_INVALID_HANDLE;
+  const uint8_t *bytes                       = (const uint8_t *)value;
+  nvs().entries[h->second.first + "/" + key] = std::vector<uint8_t>(bytes, bytes + length);
+  nvs().writes++;
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  auto                        h = nvs().handles.find(handle);
+  if ((h == nvs().handles.end()) || !h->second.second) return ESP_ERR_NVS_INVALID_HANDLE;
+  return (nvs().entries.erase(h->second.first + "/" + key) > 0) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  auto                        h = nvs().handles.find(handle);
+  if ((h == nvs().handles.end()) || !h->second.second) return ESP_ERR_NVS_INVALID_HANDLE;
+  std::string prefix = h->second.first + "/";
+  for (auto it = nvs().entries.begin(); it != nvs().entries.end();) {
+    it = (it->first.compare(0, prefix.size(), prefix) == 0) ? nvs().entries.erase(it) : ++it;
+  }
+  return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) { return ESP_OK; }
+
+void nvs_close(nvs_handle_t handle) {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  nvs().handles.erase(handle);
+}
+
+uint32_t sim::nvs_write_count() {
+  std::lock_guard<std::mutex> lock(nvs().mutex);
+  return nvs().writes;
+}
+
+// ----- Controller and Bluedroid -----
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg) { return ESP_OK; }
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode) { return ESP_OK; }
+esp_err_t esp_bluedroid_init(void) { return ESP_OK; }
+esp_err_t esp_bluedroid_enable(void) { return ESP_OK; }
+
+// ----- esp_hid_common -----
+
+const char *esp_hid_usage_str(esp_hid_usage_t usage) {
+  switch (usage) {
+    case ESP_HID_USAGE_GENERIC:
+      return "GENERIC";
+    case ESP_HID_USAGE_KEYBOARD:
+      return "KEYBOARD";
+    case ESP_HID_USAGE_MOUSE:
+      return "MOUSE";
+    case ESP_HID_USAGE_JOYSTICK:
+      return "JOYSTICK";
+    case ESP_HID_USAGE_GAMEPAD:
+      return "GAMEPAD";
+    case ESP_HID_USAGE_TABLET:
+      return "TABLET";
+    case ESP_HID_USAGE_CCONTROL:
+      return "CCONTROL";
+    case ESP_HID_USAGE_VENDOR:
+      return "VENDOR";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+const char *esp_hid_cod_major_str(uint8_t cod_major) {
+  static const char *names[] = {"MISC",    "COMPUTER", "PHONE", "LAN_NAP", "AV",
+                                "PERIPHERAL", "IMAGING", "WEARABLE", "TOY", "HEALTH"};
+  if (cod_major < sizeof(names) / sizeof(*names)) return names[cod_major];
+  return "UNCATEGORIZED";
+}
+
+void esp_hid_cod_minor_print(uint8_t cod_min, FILE *fp) {
+  if (cod_min & ESP_HID_COD_MIN_KEYBOARD) fputs("KEYBOARD", fp);
+  if (cod_min & ESP_HID_COD_MIN_MOUSE) {
+    if (cod_min & ESP_HID_COD_MIN_KEYBOARD) fputc('+', fp);
+    fputs("MOUSE", fp);
+  }
+}
+
+esp_hid_usage_t esp_hid_usage_from_appearance(uint16_t appearance) {
+  if (appearance == ESP_BLE_APPEARANCE_HID_KEYBOARD) return ESP_HID_USAGE_KEYBOARD;
+  if (appearance == ESP_BLE_APPEARANCE_HID_MOUSE) return ESP_HID_USAGE_MOUSE;
+  return ESP_HID_USAGE_GENERIC;
+}
+
+esp_hid_usage_t esp_hid_usage_from_cod(uint32_t cod) {
+  uint8_t minor = (cod >> 2) & 0x3F;
+  if (minor & ESP_HID_COD_MIN_KEYBOARD) return ESP_HID_USAGE_KEYBOARD;
+  if (minor & ESP_HID_COD_MIN_MOUSE) return ESP_HID_USAGE_MOUSE;
+  return ESP_HID_USAGE_GENERIC;
+}
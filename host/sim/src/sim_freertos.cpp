@@ -0,0 +1,231 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// FreeRTOS stand-in for the host build: tasks are host threads, queues and
+// semaphores are mutex/condition variable pairs, and one tick is one
+// millisecond of steady clock time.
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sim_internal.hpp"
+
+struct tskTaskControlBlock {
+  std::string             name;
+  std::mutex              mutex;
+  std::condition_variable cv;
+  uint32_t                notify_value{0};
+};
+
+struct QueueDefinition {
+  std::mutex              mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  UBaseType_t             length;
+  UBaseType_t             item_size;
+  UBaseType_t             head{0};
+  UBaseType_t             count{0};
+  std::vector<uint8_t>    storage;
+  uint8_t                *items{nullptr}; // storage, or the one given to xQueueCreateStatic()
+  bool                    is_static{false};
+};
+
+static_assert(sizeof(QueueDefinition) <= sizeof(StaticQueue_t), "StaticQueue_t too small");
+static_assert(alignof(QueueDefinition) <= alignof(StaticQueue_t), "StaticQueue_t misaligned");
+
+namespace {
+
+thread_local tskTaskControlBlock *current_task = nullptr;
+
+const sim::Clock::time_point &epoch() {
+  static const sim::Clock::time_point start = sim::Clock::now();
+  return start;
+}
+
+// Waits on the condition variable until pred() holds or the tick timeout expires.
+template <typename Pred>
+bool wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks,
+                Pred pred) {
+  sim::Clock::time_point deadline;
+  if (!sim::deadline_for(ticks, deadline)) {
+    cv.wait(lock, pred);
+    return true;
+  }
+  return cv.wait_until(lock, deadline, pred);
+}
+
+} // namespace
+
+namespace sim {
+
+TaskHandle_t attach_current_thread(const char *name) {
+  current_task       = new tskTaskControlBlock;
+  current_task->name = name;
+  return current_task;
+}
+
+bool deadline_for(TickType_t ticks, Clock::time_point &deadline) {
+  if (ticks == portMAX_DELAY) return false;
+  deadline = Clock::now() + std::chrono::milliseconds(ticks);
+  return true;
+}
+
+} // namespace sim
+
+// ----- Critical sections -----
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+  while (__atomic_exchange_n(&mux->owner, 1, __ATOMIC_ACQUIRE) != 0) {
+    std::this_thread::yield();
+  }
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) { __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE); }
+
+// ----- Tasks -----
+
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char *name, uint32_t stack_depth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *created_task) {
+  auto *tcb = new tskTaskControlBlock;
+  tcb->name = name;
+  if (created_task != nullptr) *created_task = tcb;
+
+  std::thread([tcb, task_code, parameters]() {
+    current_task = tcb;
+    task_code(parameters);
+  }).detach();
+
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code, const char *name,
+                                   uint32_t stack_depth, void *parameters, UBaseType_t priority,
+                                   TaskHandle_t *created_task, BaseType_t core_id) {
+  return xTaskCreate(task_code, name, stack_depth, parameters, priority, created_task);
+}
+
+// A simulated task ends when its function returns; deleting another task is not supported.
+void vTaskDelete(TaskHandle_t task) {}
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(sim::Clock::now() -
+                                                                           epoch())
+      .count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  if (current_task == nullptr) sim::attach_current_thread("host");
+  return current_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notify_value++;
+  }
+  task->cv.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait) {
+  TaskHandle_t                 self = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(self->mutex);
+
+  wait_until(self->cv, lock, ticks_to_wait, [self] { return self->notify_value != 0; });
+
+  uint32_t value = self->notify_value;
+  if (value != 0) {
+    if (clear_count_on_exit) {
+      self->notify_value = 0;
+    } else {
+      self->notify_value--;
+    }
+  }
+  return value;
+}
+
+// ----- Queues -----
+
+QueueHandle_t xQueueCreate(UBaseType_t queue_length, UBaseType_t item_size) {
+  auto *queue      = new QueueDefinition;
+  queue->length    = queue_length;
+  queue->item_size = item_size;
+  queue->storage.resize(queue_length * item_size);
+  queue->items     = queue->storage.data();
+  return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t queue_length, UBaseType_t item_size,
+                                 uint8_t *storage, StaticQueue_t *buffer) {
+  if ((buffer == nullptr) || ((item_size != 0) && (storage == nullptr))) return nullptr;
+  auto *queue      = new (buffer->opaque) QueueDefinition;
+  queue->length    = queue_length;
+  queue->item_size = item_size;
+  queue->items     = storage;
+  queue->is_static = true;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+  if (queue->is_static) queue->~QueueDefinition();
+  else delete queue;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+
+  if (!wait_until(queue->not_full, lock, ticks_to_wait,
+                  [queue] { return queue->count < queue->length; })) {
+    return errQUEUE_FULL;
+  }
+
+  if (queue->item_size != 0) {
+    UBaseType_t slot = (queue->head + queue->count) % queue->length;
+    memcpy(&queue->items[slot * queue->item_size], item, queue->item_size);
+  }
+  queue->count++;
+  lock.unlock();
+  queue->not_empty.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+
+  if (!wait_until(queue->not_empty, lock, ticks_to_wait, [queue] { return queue->count != 0; })) {
+    return errQUEUE_EMPTY;
+  }
+
+  if (queue->item_size != 0) {
+    memcpy(buffer, &queue->items[queue->head * queue->item_size], queue->item_size);
+  }
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  lock.unlock();
+  queue->not_full.notify_one();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->count;
+}
+
+// ----- Semaphores -----
+
+SemaphoreHandle_t sim_semaphore_create_mutex(StaticSemaphore_t *buffer) {
+  SemaphoreHandle_t mutex = (buffer != nullptr) ? xQueueCreateStatic(1, 0, nullptr, buffer)
+                                                : xQueueCreate(1, 0);
+  if (mutex == nullptr) return nullptr;
+  xQueueSendToBack(mutex, nullptr, 0);
+  return mutex;
+}
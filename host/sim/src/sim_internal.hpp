@@ -0,0 +1,54 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Internal helpers shared by the simulation translation units.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "freertos/task.h"
+
+namespace sim {
+
+using Clock = std::chrono::steady_clock;
+
+/// Binds the calling host thread to a new simulated FreeRTOS task.
+TaskHandle_t attach_current_thread(const char *name);
+
+/// Converts a tick count to a host deadline. portMAX_DELAY means no deadline.
+bool deadline_for(TickType_t ticks, Clock::time_point &deadline);
+
+/**
+ * @brief Single thread running posted jobs in due time order
+ *
+ * Used to model the Bluedroid "btc" task and the esp_hidh event task.
+ */
+class Worker {
+public:
+  explicit Worker(const char *name);
+
+  void post(std::function<void()> job, Clock::duration delay = Clock::duration::zero());
+  void wait_idle();
+
+private:
+  std::mutex                                              mutex_;
+  std::condition_variable                                 cv_;
+  std::condition_variable                                 idle_cv_;
+  std::multimap<Clock::time_point, std::function<void()>> jobs_;
+  bool                                                    busy_{false};
+  std::string                                             name_;
+  std::thread                                             thread_;
+
+  void run();
+};
+
+} // namespace sim
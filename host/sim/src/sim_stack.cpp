@@ -0,0 +1,741 @@
+// Copyright (c) 2025 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+//
+// Simulated Bluedroid GAP (BLE scan, BT inquiry) and esp_hidh host layer.
+// Scripted devices advertise during scans, accept connections and deliver
+// input reports through the registered esp_hidh callback.
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "esp_gap_bt_api.h"
+#include "esp_hidh.h"
+#include "sim_internal.hpp"
+#include "sim_stack.hpp"
+
+struct esp_hidh_dev_s {
+  sim::DeviceScript        script;
+  esp_hid_raw_report_map_t map;
+  std::atomic<bool>        open{false};
+
+  // Link timing of the connection, see DeviceScript
+  std::mutex             link_mutex;
+  uint16_t               conn_interval{0};
+  uint16_t               conn_latency{0};
+  uint16_t               conn_timeout{0};
+  uint16_t               poll_slots{0};
+  bool                   sniff{false};
+  uint8_t                counter_proposals{0}; // Left for this connection
+  sim::Clock::time_point link_anchor;          // An exchange of the link took place then
+  sim::Clock::time_point last_delivery;        // Of the last input report, to keep their order
+};
+
+esp_event_base_t const ESP_HIDH_EVENTS = "ESP_HIDH_EVENTS";
+
+namespace {
+
+using std::chrono::milliseconds;
+
+struct Stack {
+  sim::Worker                                  btc{"btc"};
+  sim::Worker                                  hidh{"hidh_evt"};
+  esp_gap_ble_cb_t                             ble_callback{nullptr};
+  esp_bt_gap_cb_t                              bt_callback{nullptr};
+  esp_hidh_config_t                            hidh_config{};
+  std::mutex                                   mutex;
+  std::vector<std::unique_ptr<esp_hidh_dev_s>> devices;
+  std::atomic<uint32_t>                        ble_scan_gen{0};
+  std::atomic<uint32_t>                        bt_scan_gen{0};
+  std::atomic<bool>                            ble_scanning{false};
+  std::atomic<bool>                            bt_scanning{false};
+  std::atomic<double>                          time_scale{1.0};
+  std::mutex                                   dwell_mutex;
+  sim::CallbackStats                           dwell[(int)sim::Callback::COUNT]{};
+};
+
+// Never destroyed: worker threads may still be running at process exit.
+Stack &stack() {
+  static Stack *instance = new Stack;
+  return *instance;
+}
+
+sim::Clock::duration scaled(double ms) {
+  return std::chrono::duration_cast<sim::Clock::duration>(
+      std::chrono::duration<double, std::milli>(ms * stack().time_scale.load()));
+}
+
+// Interval between the exchanges of the link, in microseconds. Needs link_mutex.
+uint32_t link_interval_us(const esp_hidh_dev_s *dev) {
+  if (dev->script.transport == ESP_HID_TRANSPORT_BLE) return dev->conn_interval * 1250;
+  return (dev->sniff ? dev->script.sniff_slots : dev->poll_slots) * 625;
+}
+
+// Restart the link timing, on connection or when the interval changes. Needs link_mutex.
+void restart_link(esp_hidh_dev_s *dev) {
+  dev->link_anchor   = sim::Clock::now();
+  dev->last_delivery = dev->link_anchor;
+}
+
+// Delay of an input report sent now, waiting for the next exchange of the link
+sim::Clock::duration link_delay(esp_hidh_dev_s *dev) {
+  std::lock_guard<std::mutex> lock(dev->link_mutex);
+  uint32_t                    interval_us = link_interval_us(dev);
+  auto                        now         = sim::Clock::now();
+  if (interval_us == 0) return sim::Clock::duration::zero();
+
+  auto interval = scaled(interval_us / 1000.0);
+  auto next     = now + (interval - (now - dev->link_anchor) % interval);
+  if (next < dev->last_delivery) next = dev->last_delivery;
+  dev->last_delivery = next;
+  return next - now;
+}
+
+esp_hidh_dev_s *find_device(const uint8_t *bda) {
+  std::lock_guard<std::mutex> lock(stack().mutex);
+  for (auto &dev : stack().devices) {
+    if (memcmp(dev->script.bda.data(), bda, ESP_BD_ADDR_LEN) == 0) return dev.get();
+  }
+  return nullptr;
+}
+
+std::vector<esp_hidh_dev_s *> devices_of(esp_hid_transport_t transport) {
+  std::lock_guard<std::mutex> lock(stack().mutex);
+  std::vector<esp_hidh_dev_s *> result;
+  for (auto &dev : stack().devices) {
+    if (dev->script.transport == transport) result.push_back(dev.get());
+  }
+  return result;
+}
+
+// Runs an application callback, accounting for the time spent in it
+template <typename Call> void timed_callback(sim::Callback kind, Call call) {
+  auto start = sim::Clock::now();
+  call();
+  double us = std::chrono::duration<double, std::micro>(sim::Clock::now() - start).count();
+
+  std::lock_guard<std::mutex> lock(stack().dwell_mutex);
+  sim::CallbackStats         &stats = stack().dwell[(int)kind];
+  stats.mean_us = (stats.mean_us * stats.count + us) / (stats.count + 1);
+  stats.max_us  = std::max(stats.max_us, us);
+  stats.count++;
+}
+
+void post_hidh_event(esp_hidh_event_t event, const esp_hidh_event_data_t &data,
+                     std::vector<uint8_t>  payload = {},
+                     sim::Clock::duration delay   = sim::Clock::duration::zero()) {
+  stack().hidh.post([event, data, payload = std::move(payload)]() mutable {
+    esp_hidh_event_data_t param = data;
+    if (event == ESP_HIDH_INPUT_EVENT) param.input.data = payload.data();
+    auto &config = stack().hidh_config;
+    if (config.callback == nullptr) return;
+    if (event == ESP_HIDH_OPEN_EVENT) {
+      timed_callback(sim::Callback::OPEN, [&]() {
+        config.callback(config.callback_arg, ESP_HIDH_EVENTS, event, &param);
+      });
+    } else {
+      config.callback(config.callback_arg, ESP_HIDH_EVENTS, event, &param);
+    }
+  }, delay);
+}
+
+void append_tlv(std::vector<uint8_t> &out, uint8_t type, const uint8_t *data, size_t len) {
+  out.push_back((uint8_t)(len + 1));
+  out.push_back(type);
+  out.insert(out.end(), data, data + len);
+}
+
+void post_ble_event(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t &param,
+                    sim::Clock::duration delay = sim::Clock::duration::zero(),
+                    uint32_t generation = 0) {
+  stack().btc.post(
+      [event, p = param, generation]() mutable {
+        if (generation != 0 && generation != stack().ble_scan_gen) return;
+        if (stack().ble_callback == nullptr) return;
+        if (event == ESP_GAP_BLE_SCAN_RESULT_EVT) {
+          timed_callback(sim::Callback::SCAN_RESULT, [&]() { stack().ble_callback(event, &p); });
+        } else {
+          stack().ble_callback(event, &p);
+        }
+      },
+      delay);
+}
+
+void post_bt_event(esp_bt_gap_cb_event_t event, const esp_bt_gap_cb_param_t &param,
+                   sim::Clock::duration delay = sim::Clock::duration::zero(),
+                   uint32_t generation = 0) {
+  stack().btc.post(
+      [event, p = param, generation]() mutable {
+        if (generation != 0 && generation != stack().bt_scan_gen) return;
+        if (stack().bt_callback != nullptr) stack().bt_callback(event, &p);
+      },
+      delay);
+}
+
+// Builds the advertising payload (flags, HID service, appearance) and the scan
+// response (complete name) of a BLE device.
+void build_advertisement(const sim::DeviceScript &script, esp_ble_gap_cb_param_t &param) {
+  std::vector<uint8_t> adv;
+  std::vector<uint8_t> rsp;
+
+  const uint8_t flags = 0x06;
+  append_tlv(adv, ESP_BLE_AD_TYPE_FLAG, &flags, 1);
+  if (script.hid_service) {
+    const uint8_t uuid[] = {0x12, 0x18};
+    append_tlv(adv, ESP_BLE_AD_TYPE_16SRV_CMPL, uuid, sizeof(uuid));
+  }
+  const uint8_t appearance[] = {(uint8_t)(script.appearance & 0xFF),
+                                (uint8_t)(script.appearance >> 8)};
+  append_tlv(adv, ESP_BLE_AD_TYPE_APPEARANCE, appearance, sizeof(appearance));
+
+  size_t name_len = std::min<size_t>(script.name.size(), ESP_BLE_SCAN_RSP_DATA_LEN_MAX - 2);
+  append_tlv(rsp, ESP_BLE_AD_TYPE_NAME_CMPL, (const uint8_t *)script.name.data(), name_len);
+
+  memcpy(param.scan_rst.ble_adv, adv.data(), adv.size());
+  memcpy(param.scan_rst.ble_adv + adv.size(), rsp.data(), rsp.size());
+  param.scan_rst.adv_data_len = adv.size();
+  param.scan_rst.scan_rsp_len = rsp.size();
+}
+
+uint8_t *resolve_tlv(uint8_t *data, size_t data_len, uint8_t type, uint8_t *length) {
+  size_t pos = 0;
+  while (pos + 1 < data_len) {
+    uint8_t len = data[pos];
+    if (len == 0 || pos + 1 + len > data_len) break;
+    if (data[pos + 1] == type) {
+      *length = len - 1;
+      return &data[pos + 2];
+    }
+    pos += len + 1;
+  }
+  *length = 0;
+  return nullptr;
+}
+
+} // namespace
+
+// ----- sim::Worker -----
+
+namespace sim {
+
+Worker::Worker(const char *name) : name_(name) {
+  thread_ = std::thread([this]() {
+    attach_current_thread(name_.c_str());
+    run();
+  });
+  thread_.detach();
+}
+
+void Worker::post(std::function<void()> job, Clock::duration delay) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.emplace(Clock::now() + delay, std::move(job));
+  }
+  cv_.notify_one();
+}
+
+void Worker::wait_idle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+}
+
+void Worker::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (jobs_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+    auto first = jobs_.begin();
+    if (first->first > Clock::now()) {
+      cv_.wait_until(lock, first->first);
+      continue;
+    }
+    auto job = std::move(first->second);
+    jobs_.erase(first);
+    busy_ = true;
+    lock.unlock();
+    job();
+    lock.lock();
+    busy_ = false;
+    if (jobs_.empty()) idle_cv_.notify_all();
+  }
+}
+
+// ----- Scripting interface -----
+
+void set_time_scale(double scale) { stack().time_scale = scale; }
+
+const std::vector<uint8_t> &boot_keyboard_report_map() {
+  static const std::vector<uint8_t> map = {
+      0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25,
+      0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x95, 0x01, 0x75, 0x08, 0x81, 0x01, 0x95, 0x05,
+      0x75, 0x01, 0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02, 0x95, 0x01, 0x75, 0x03, 0x91,
+      0x01, 0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07, 0x19, 0x00, 0x29, 0x65,
+      0x81, 0x00, 0xC0};
+  return map;
+}
+
+const std::vector<uint8_t> &composite_keyboard_report_map() {
+  static const std::vector<uint8_t> map = {
+      // Report 1: boot keyboard
+      0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, REPORT_ID_BOOT, 0x05, 0x07, 0x19, 0xE0, 0x29,
+      0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x95, 0x01, 0x75, 0x08,
+      0x81, 0x01, 0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07, 0x19, 0x00, 0x29,
+      0x65, 0x81, 0x00, 0xC0,
+      // Report 2: modifiers, 224-bit key bitmap, padding up to 64 bytes
+      0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, REPORT_ID_NKRO, 0x05, 0x07, 0x19, 0xE0, 0x29,
+      0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x19, 0x00, 0x29, 0xDF,
+      0x96, 0xE0, 0x00, 0x81, 0x02, 0x75, 0x08, 0x95, 0x23, 0x81, 0x01, 0xC0,
+      // Report 3: consumer control
+      0x05, 0x0C, 0x09, 0x01, 0xA1, 0x01, 0x85, REPORT_ID_CONSUMER, 0x15, 0x00, 0x26, 0xFF,
+      0x03, 0x19, 0x00, 0x2A, 0xFF, 0x03, 0x75, 0x10, 0x95, 0x01, 0x81, 0x00, 0xC0};
+  return map;
+}
+
+esp_hidh_dev_t *add_device(const DeviceScript &script) {
+  auto dev    = std::make_unique<esp_hidh_dev_s>();
+  dev->script = script;
+  if (dev->script.report_map.empty()) dev->script.report_map = boot_keyboard_report_map();
+  dev->map.data = dev->script.report_map.data();
+  dev->map.len  = dev->script.report_map.size();
+
+  std::lock_guard<std::mutex> lock(stack().mutex);
+  stack().devices.push_back(std::move(dev));
+  return stack().devices.back().get();
+}
+
+void set_reachable(esp_hidh_dev_t *dev, bool reachable) { dev->script.reachable = reachable; }
+
+bool is_open(esp_hidh_dev_t *dev) { return dev->open; }
+
+void input(esp_hidh_dev_t *dev, const uint8_t *data, size_t length, uint16_t report_id,
+           uint8_t map_index) {
+  esp_hidh_event_data_t param{};
+  param.input.dev       = dev;
+  param.input.usage     = ESP_HID_USAGE_KEYBOARD;
+  param.input.report_id = report_id;
+  param.input.length    = length;
+  param.input.map_index = map_index;
+  post_hidh_event(ESP_HIDH_INPUT_EVENT, param, std::vector<uint8_t>(data, data + length),
+                  link_delay(dev));
+}
+
+void battery(esp_hidh_dev_t *dev, uint8_t level) {
+  esp_hidh_event_data_t param{};
+  param.battery.dev   = dev;
+  param.battery.level = level;
+  post_hidh_event(ESP_HIDH_BATTERY_EVENT, param);
+}
+
+void disconnect(esp_hidh_dev_t *dev) {
+  if (!dev->open.exchange(false)) return;
+  esp_hidh_event_data_t param{};
+  param.close.dev    = dev;
+  param.close.reason = 0x08; // Connection timeout
+  post_hidh_event(ESP_HIDH_CLOSE_EVENT, param);
+}
+
+void set_sniff(esp_hidh_dev_t *dev, bool sniff) {
+  {
+    std::lock_guard<std::mutex> lock(dev->link_mutex);
+    dev->sniff = sniff;
+    restart_link(dev);
+  }
+  esp_bt_gap_cb_param_t param{};
+  memcpy(param.mode_chg.bda, dev->script.bda.data(), ESP_BD_ADDR_LEN);
+  param.mode_chg.mode = sniff ? ESP_BT_PM_MD_SNIFF : ESP_BT_PM_MD_ACTIVE;
+  post_bt_event(ESP_BT_GAP_MODE_CHG_EVT, param);
+}
+
+uint32_t link_interval_us(esp_hidh_dev_t *dev) {
+  std::lock_guard<std::mutex> lock(dev->link_mutex);
+  return ::link_interval_us(dev);
+}
+
+CallbackStats callback_stats(Callback kind) {
+  std::lock_guard<std::mutex> lock(stack().dwell_mutex);
+  return stack().dwell[(int)kind];
+}
+
+void reset_callback_stats() {
+  std::lock_guard<std::mutex> lock(stack().dwell_mutex);
+  for (CallbackStats &stats : stack().dwell) stats = CallbackStats{};
+}
+
+void wait_idle() {
+  stack().btc.wait_idle();
+  stack().hidh.wait_idle();
+}
+
+} // namespace sim
+
+// ----- BLE GAP -----
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback) {
+  stack().ble_callback = callback;
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_scan_params(esp_ble_scan_params_t *scan_params) {
+  esp_ble_gap_cb_param_t param{};
+  param.scan_param_cmpl.status = ESP_BT_STATUS_SUCCESS;
+  post_ble_event(ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT, param);
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_start_scanning(uint32_t duration) {
+  if (stack().ble_scanning.exchange(true)) return ESP_ERR_INVALID_STATE;
+  uint32_t gen = ++stack().ble_scan_gen;
+
+  esp_ble_gap_cb_param_t param{};
+  param.scan_start_cmpl.status = ESP_BT_STATUS_SUCCESS;
+  post_ble_event(ESP_GAP_BLE_SCAN_START_COMPLETE_EVT, param);
+
+  int count = 0;
+  for (auto *dev : devices_of(ESP_HID_TRANSPORT_BLE)) {
+    if (!dev->script.reachable || dev->open) continue;
+    esp_ble_gap_cb_param_t res{};
+    res.scan_rst.search_evt    = ESP_GAP_SEARCH_INQ_RES_EVT;
+    res.scan_rst.dev_type      = ESP_BT_DEVICE_TYPE_BLE;
+    res.scan_rst.ble_addr_type = dev->script.addr_type;
+    res.scan_rst.ble_evt_type  = ESP_BLE_EVT_CONN_ADV;
+    res.scan_rst.rssi          = dev->script.rssi;
+    memcpy(res.scan_rst.bda, dev->script.bda.data(), ESP_BD_ADDR_LEN);
+    build_advertisement(dev->script, res);
+    post_ble_event(ESP_GAP_BLE_SCAN_RESULT_EVT, res, scaled(dev->script.adv_delay_ms), gen);
+    count++;
+  }
+
+  esp_ble_gap_cb_param_t done{};
+  done.scan_rst.search_evt = ESP_GAP_SEARCH_INQ_CMPL_EVT;
+  done.scan_rst.num_resps  = count;
+  stack().btc.post(
+      [done, gen]() mutable {
+        if (gen != stack().ble_scan_gen) return;
+        stack().ble_scanning = false;
+        if (stack().ble_callback != nullptr) {
+          stack().ble_callback(ESP_GAP_BLE_SCAN_RESULT_EVT, &done);
+        }
+      },
+      scaled(duration * 1000));
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_stop_scanning(void) {
+  if (!stack().ble_scanning.exchange(false)) return ESP_ERR_INVALID_STATE;
+  ++stack().ble_scan_gen;
+  esp_ble_gap_cb_param_t param{};
+  param.scan_stop_cmpl.status = ESP_BT_STATUS_SUCCESS;
+  post_ble_event(ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT, param);
+  return ESP_OK;
+}
+
+// The keyboard takes the shortest interval of the request it accepts, as most do. A request
+// for intervals all below min_conn_interval fails. Then, for as long as it has counter
+// proposals left, it asks to go back to its own interval.
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params) {
+  esp_hidh_dev_s *dev = find_device(params->bda);
+
+  esp_ble_gap_cb_param_t param{};
+  auto                  &update = param.update_conn_params;
+  memcpy(update.bda, params->bda, ESP_BD_ADDR_LEN);
+  update.min_int = params->min_int;
+  update.max_int = params->max_int;
+  update.latency = params->latency;
+  update.timeout = params->timeout;
+
+  if ((dev == nullptr) || !dev->open || (dev->script.transport != ESP_HID_TRANSPORT_BLE)) {
+    update.status = ESP_BT_STATUS_FAIL;
+    post_ble_event(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, param);
+    return ESP_OK;
+  }
+
+  uint16_t chosen = std::max(params->min_int, dev->script.min_conn_interval);
+  double   instant_ms;
+  {
+    // The new interval takes effect a few connection events after the request
+    std::lock_guard<std::mutex> lock(dev->link_mutex);
+    instant_ms = std::max(6 * link_interval_us(dev) / 1000.0, 1.0);
+  }
+
+  stack().btc.post(
+      [dev, param, chosen]() mutable {
+        auto &update  = param.update_conn_params;
+        bool  counter = false;
+        {
+          std::lock_guard<std::mutex> lock(dev->link_mutex);
+          if (!dev->open) return;
+          if (chosen <= update.max_int) {
+            update.status     = ESP_BT_STATUS_SUCCESS;
+            update.conn_int   = chosen;
+            dev->conn_latency = update.latency;
+            dev->conn_timeout = update.timeout;
+            if (dev->conn_interval != chosen) {
+              dev->conn_interval = chosen;
+              restart_link(dev);
+            }
+            counter = (dev->counter_proposals > 0) && (dev->script.conn_interval != 0) &&
+                      (chosen != dev->script.conn_interval);
+            if (counter) dev->counter_proposals--;
+          } else {
+            update.status   = ESP_BT_STATUS_FAIL;
+            update.conn_int = dev->conn_interval;
+          }
+        }
+        if (stack().ble_callback != nullptr) {
+          stack().ble_callback(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &param);
+        }
+        if (!counter) return;
+
+        // The keyboard L2CAP request, accepted by the host stack without asking
+        stack().btc.post(
+            [dev, param]() mutable {
+              auto &update = param.update_conn_params;
+              {
+                std::lock_guard<std::mutex> lock(dev->link_mutex);
+                if (!dev->open) return;
+                dev->conn_interval = dev->script.conn_interval;
+                restart_link(dev);
+                update.min_int  = dev->script.conn_interval;
+                update.max_int  = dev->script.conn_interval;
+                update.conn_int = dev->script.conn_interval;
+              }
+              if (stack().ble_callback != nullptr) {
+                stack().ble_callback(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &param);
+              }
+            },
+            scaled(100));
+      },
+      scaled(instant_ms));
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_get_current_conn_params(esp_bd_addr_t          bd_addr,
+                                          esp_gap_conn_params_t *conn_params) {
+  esp_hidh_dev_s *dev = find_device(bd_addr);
+  if ((dev == nullptr) || !dev->open || (dev->script.transport != ESP_HID_TRANSPORT_BLE)) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  std::lock_guard<std::mutex> lock(dev->link_mutex);
+  conn_params->interval = dev->conn_interval;
+  conn_params->latency  = dev->conn_latency;
+  conn_params->timeout  = dev->conn_timeout;
+  return ESP_OK;
+}
+
+uint8_t *esp_ble_resolve_adv_data_by_type(uint8_t *adv_data, uint16_t adv_data_len,
+                                          esp_ble_adv_data_type type, uint8_t *length) {
+  return resolve_tlv(adv_data, adv_data_len, type, length);
+}
+
+esp_err_t esp_ble_gap_security_rsp(esp_bd_addr_t bd_addr, bool accept) { return ESP_OK; }
+esp_err_t esp_ble_confirm_reply(esp_bd_addr_t bd_addr, bool accept) { return ESP_OK; }
+
+int esp_ble_get_bond_device_num(void) { return 0; }
+
+esp_err_t esp_ble_get_bond_device_list(int *dev_num, esp_ble_bond_dev_t *dev_list) {
+  *dev_num = 0;
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_remove_bond_device(esp_bd_addr_t bd_addr) { return ESP_OK; }
+
+esp_err_t esp_ble_gattc_register_callback(esp_gattc_cb_t callback) { return ESP_OK; }
+
+void esp_hidh_gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                  esp_ble_gattc_cb_param_ptr_t param) {}
+
+// ----- Classic BT GAP -----
+
+esp_err_t esp_bt_gap_register_callback(esp_bt_gap_cb_t callback) {
+  stack().bt_callback = callback;
+  return ESP_OK;
+}
+
+esp_err_t esp_bt_gap_set_scan_mode(esp_bt_connection_mode_t c_mode,
+                                   esp_bt_discovery_mode_t  d_mode) {
+  return ESP_OK;
+}
+
+esp_err_t esp_bt_gap_start_discovery(esp_bt_inq_mode_t mode, uint8_t inq_len, uint8_t num_rsps) {
+  if (stack().bt_scanning.exchange(true)) return ESP_ERR_INVALID_STATE;
+  uint32_t gen = ++stack().bt_scan_gen;
+
+  esp_bt_gap_cb_param_t param{};
+  param.disc_st_chg.state = ESP_BT_GAP_DISCOVERY_STARTED;
+  post_bt_event(ESP_BT_GAP_DISC_STATE_CHANGED_EVT, param);
+
+  for (auto *dev : devices_of(ESP_HID_TRANSPORT_BT)) {
+    if (!dev->script.reachable || dev->open) continue;
+
+    // Property values must outlive the callback: they travel with the job.
+    auto eir  = std::make_shared<std::vector<uint8_t>>();
+    auto cod  = dev->script.cod;
+    auto rssi = dev->script.rssi;
+
+    size_t name_len = std::min<size_t>(dev->script.name.size(), 200);
+    append_tlv(*eir, ESP_BT_EIR_TYPE_CMPL_LOCAL_NAME, (const uint8_t *)dev->script.name.data(),
+               name_len);
+    const uint8_t hid_uuid[] = {0x24, 0x11};
+    append_tlv(*eir, ESP_BT_EIR_TYPE_CMPL_16BITS_UUID, hid_uuid, sizeof(hid_uuid));
+    eir->resize(ESP_BT_GAP_EIR_DATA_LEN, 0);
+
+    std::array<uint8_t, 6> bda = dev->script.bda;
+    stack().btc.post(
+        [eir, cod, rssi, bda, gen]() mutable {
+          if (gen != stack().bt_scan_gen) return;
+          esp_bt_gap_dev_prop_t props[3] = {
+              {ESP_BT_GAP_DEV_PROP_COD, sizeof(cod), &cod},
+              {ESP_BT_GAP_DEV_PROP_RSSI, 1, &rssi},
+              {ESP_BT_GAP_DEV_PROP_EIR, (int)eir->size(), eir->data()},
+          };
+          esp_bt_gap_cb_param_t res{};
+          memcpy(res.disc_res.bda, bda.data(), ESP_BD_ADDR_LEN);
+          res.disc_res.num_prop = 3;
+          res.disc_res.prop     = props;
+          if (stack().bt_callback == nullptr) return;
+          timed_callback(sim::Callback::SCAN_RESULT,
+                         [&]() { stack().bt_callback(ESP_BT_GAP_DISC_RES_EVT, &res); });
+        },
+        scaled(dev->script.adv_delay_ms));
+  }
+
+  stack().btc.post(
+      [gen]() {
+        if (gen != stack().bt_scan_gen) return;
+        stack().bt_scanning = false;
+        esp_bt_gap_cb_param_t done{};
+        done.disc_st_chg.state = ESP_BT_GAP_DISCOVERY_STOPPED;
+        if (stack().bt_callback != nullptr) {
+          stack().bt_callback(ESP_BT_GAP_DISC_STATE_CHANGED_EVT, &done);
+        }
+      },
+      scaled(inq_len * 1280));
+  return ESP_OK;
+}
+
+esp_err_t esp_bt_gap_cancel_discovery(void) {
+  if (!stack().bt_scanning.exchange(false)) return ESP_ERR_INVALID_STATE;
+  ++stack().bt_scan_gen;
+  esp_bt_gap_cb_param_t param{};
+  param.disc_st_chg.state = ESP_BT_GAP_DISCOVERY_STOPPED;
+  post_bt_event(ESP_BT_GAP_DISC_STATE_CHANGED_EVT, param);
+  return ESP_OK;
+}
+
+uint8_t *esp_bt_gap_resolve_eir_data(uint8_t *eir, esp_bt_eir_type_t type, uint8_t *length) {
+  return resolve_tlv(eir, ESP_BT_GAP_EIR_DATA_LEN, type, length);
+}
+
+esp_err_t esp_bt_gap_set_security_param(esp_bt_sp_param_t param_type, void *value, uint8_t len) {
+  return ESP_OK;
+}
+
+esp_err_t esp_bt_gap_ssp_confirm_reply(esp_bd_addr_t bd_addr, bool accept) { return ESP_OK; }
+
+esp_err_t esp_bt_gap_set_pin(esp_bt_pin_type_t pin_type, uint8_t pin_code_len,
+                             esp_bt_pin_code_t pin_code) {
+  return ESP_OK;
+}
+
+esp_err_t esp_bt_gap_pin_reply(esp_bd_addr_t bd_addr, bool accept, uint8_t pin_code_len,
+                               esp_bt_pin_code_t pin_code) {
+  return ESP_OK;
+}
+
+esp_err_t esp_bt_gap_set_qos(esp_bd_addr_t remote_bda, uint32_t t_poll) {
+  esp_hidh_dev_s *dev = find_device(remote_bda);
+
+  esp_bt_gap_cb_param_t param{};
+  memcpy(param.qos_cmpl.bda, remote_bda, ESP_BD_ADDR_LEN);
+  param.qos_cmpl.t_poll = t_poll;
+  if ((dev == nullptr) || !dev->open || (dev->script.transport != ESP_HID_TRANSPORT_BT)) {
+    param.qos_cmpl.stat = ESP_BT_STATUS_FAIL;
+  } else {
+    std::lock_guard<std::mutex> lock(dev->link_mutex);
+    dev->poll_slots     = t_poll;
+    param.qos_cmpl.stat = ESP_BT_STATUS_SUCCESS;
+    restart_link(dev);
+  }
+  post_bt_event(ESP_BT_GAP_QOS_CMPL_EVT, param);
+  return ESP_OK;
+}
+
+// ----- esp_hidh -----
+
+esp_err_t esp_hidh_init(const esp_hidh_config_t *config) {
+  stack().hidh_config = *config;
+  return ESP_OK;
+}
+
+esp_err_t esp_hidh_deinit(void) {
+  stack().hidh_config = {};
+  return ESP_OK;
+}
+
+esp_hidh_dev_t *esp_hidh_dev_open(esp_bd_addr_t bda, esp_hid_transport_t transport,
+                                  uint8_t remote_addr_type) {
+  esp_hidh_dev_s *dev = find_device(bda);
+
+  esp_hidh_event_data_t param{};
+  if (dev == nullptr || !dev->script.reachable || dev->script.transport != transport) {
+    std::this_thread::sleep_for(scaled(dev == nullptr ? 0 : dev->script.connect_delay_ms));
+    param.open.status = ESP_FAIL;
+    post_hidh_event(ESP_HIDH_OPEN_EVENT, param);
+    return nullptr;
+  }
+
+  // As on target, the open call blocks for the duration of the connection.
+  std::this_thread::sleep_for(scaled(dev->script.connect_delay_ms));
+  {
+    std::lock_guard<std::mutex> lock(dev->link_mutex);
+    dev->conn_interval     = dev->script.conn_interval;
+    dev->conn_latency      = 0;
+    dev->conn_timeout      = dev->script.conn_timeout;
+    dev->poll_slots        = dev->script.poll_slots;
+    dev->sniff             = false;
+    dev->counter_proposals = dev->script.counter_proposals;
+    restart_link(dev);
+  }
+  dev->open         = true;
+  param.open.dev    = dev;
+  param.open.status = ESP_OK;
+  post_hidh_event(ESP_HIDH_OPEN_EVENT, param);
+  return dev;
+}
+
+esp_err_t esp_hidh_dev_close(esp_hidh_dev_t *dev) {
+  if (!dev->open.exchange(false)) return ESP_ERR_INVALID_STATE;
+  esp_hidh_event_data_t param{};
+  param.close.dev = dev;
+  post_hidh_event(ESP_HIDH_CLOSE_EVENT, param);
+  return ESP_OK;
+}
+
+void esp_hidh_dev_dump(esp_hidh_dev_t *dev, FILE *fp) {
+  const uint8_t *bda = dev->script.bda.data();
+  fprintf(fp, "Device: %s, BDA: " ESP_BD_ADDR_STR ", Transport: %s, Report map: %u bytes\n",
+          dev->script.name.c_str(), ESP_BD_ADDR_HEX(bda),
+          dev->script.transport == ESP_HID_TRANSPORT_BLE ? "BLE" : "BT", (unsigned)dev->map.len);
+}
+
+const uint8_t *esp_hidh_dev_bda_get(esp_hidh_dev_t *dev) {
+  return dev == nullptr ? nullptr : dev->script.bda.data();
+}
+
+const char *esp_hidh_dev_name_get(esp_hidh_dev_t *dev) { return dev->script.name.c_str(); }
+
+esp_hid_transport_t esp_hidh_dev_transport_get(esp_hidh_dev_t *dev) {
+  return dev->script.transport;
+}
+
+esp_err_t esp_hidh_dev_report_maps_get(esp_hidh_dev_t *dev, size_t *num_maps,
+                                       esp_hid_raw_report_map_t **maps) {
+  *num_maps = 1;
+  *maps     = &dev->map;
+  return ESP_OK;
+}
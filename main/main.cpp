@@ -2,21 +2,26 @@
 //
 // MIT License. Look at file licenses.txt for details.
 
-#include <iostream>
+#include <cinttypes>
+#include <cstdio>
 
 #include "bt_keyboard.hpp"
 #include "esp_err.h"
+#include "esp_image_format.h"
 #include "esp_log.h"
+#include "esp_ota_ops.h"
 #include "esp_system.h"
 #include "nvs_flash.h"
 
 static constexpr char const *TAG = "Main";
 
-BTKeyboard bt_keyboard;
+// Its queues and scan store are in .bss: setup() takes no heap for them
+BTKeyboardT<> bt_keyboard;
 
 void pairing_handler(uint32_t pid) {
-  std::cout << "Please enter the following pairing code, " << std::endl
-            << "followed with ENTER on your keyboard: " << std::dec << pid << std::endl;
+  printf("Please enter the following pairing code, \n"
+         "followed with ENTER on your keyboard: %" PRIu32 "\n",
+         pid);
 }
 
 void keyboard_lost_connection_handler() {
@@ -25,6 +30,43 @@ void keyboard_lost_connection_handler() {
 
 void keyboard_connected_handler() { ESP_LOGI(TAG, "----> Connected to keyboard <----"); }
 
+// Footprint of the build: compare with `idf.py size` and `idf.py size-components`
+void report_footprint(uint32_t heap_before_setup) {
+  const esp_partition_t *partition = esp_ota_get_running_partition();
+  esp_partition_pos_t    position  = {.offset = partition->address, .size = partition->size};
+  esp_image_metadata_t   metadata;
+
+  if (esp_image_get_metadata(&position, &metadata) == ESP_OK) {
+    ESP_LOGI(TAG, "App image: %" PRIu32 " bytes", metadata.image_len);
+  }
+  uint32_t heap = esp_get_free_heap_size();
+  ESP_LOGI(TAG, "Free heap after setup(): %" PRIu32 " bytes (%" PRIu32 " taken by setup())", heap,
+           heap_before_setup - heap);
+}
+
+// Runtime counters of the component, printed with Right Ctrl + F11
+void report_metrics() {
+  BTKeyboard::Metrics metrics = bt_keyboard.get_metrics();
+  for (uint8_t i = 0; i < BTKeyboard::MAX_DEVICES; i++) {
+    const BTKeyboard::DeviceMetrics &device = metrics.devices[i];
+    ESP_LOGI(TAG,
+             "Device %u: %" PRIu32 " reports, %" PRIu32 " bytes, %" PRIu32 " truncated, %" PRIu32
+             " in error, battery %d%%",
+             i, device.reports, device.bytes, device.truncated, device.decode_errors,
+             device.battery_level);
+  }
+  ESP_LOGI(TAG,
+           "Dropped %" PRIu32 " events and %" PRIu32 " reports, %" PRIu32 " connections, %" PRIu32
+           " disconnections, %" PRIu32 " reconnections",
+           metrics.events_dropped, metrics.reports_dropped, metrics.connections,
+           metrics.disconnections, metrics.reconnects);
+  ESP_LOGI(TAG,
+           "%" PRIu32 " scans (last %" PRIu32 " ms), %" PRIu32 " advertisements, last RSSI %d, "
+           "heap %" PRIu32 " bytes (peak %" PRIu32 ")",
+           metrics.scans, metrics.last_scan_ms, metrics.advertisements, metrics.last_rssi,
+           metrics.heap_bytes, metrics.heap_peak_bytes);
+}
+
 extern "C" {
 
 void app_main() {
@@ -41,29 +83,52 @@ void app_main() {
   }
   ESP_ERROR_CHECK(ret);
 
+  // Typing latency in the 15 to 30 ms range, instead of the often longer interval keyboards
+  // pick to save their battery
+  bt_keyboard.set_latency_policy(LATENCY_POLICY_BALANCED);
+
+  uint32_t heap_before_setup = esp_get_free_heap_size();
   if (bt_keyboard.setup(pairing_handler, keyboard_connected_handler,
                         keyboard_lost_connection_handler)) { // Must be called once
-    bt_keyboard.devices_scan(); // Required to discover new keyboards and for pairing
-                                // Default duration is 5 seconds
+    report_footprint(heap_before_setup);
+
+    // Keyboards connected before the reboot are reconnected without a scan. The scan is
+    // required to discover new keyboards and for pairing. It lasts up to 5 seconds, and
+    // stops as soon as a keyboard is found.
+    if (!bt_keyboard.reconnect_cached_devices()) {
+      bt_keyboard.devices_scan(5, BTKeyboard::is_keyboard);
+      bt_keyboard.show_scan_results();
+    }
+    bt_keyboard.start_auto_reconnect(); // Keyboards going to sleep are brought back
+
+    // The last reports received are kept, to be dumped with Right Ctrl + F12 when an issue
+    // shows up, and replayed on the host (see host/bench/bench_replay.cpp)
+    bt_keyboard.start_recording();
     while (true) {
-#if 0 // 0 = scan codes retrieval, 1 = augmented ASCII retrieval
+#if 0 // 0 = key events retrieval, 1 = augmented ASCII retrieval
           uint8_t ch = bt_keyboard.wait_for_ascii_char();
           // uint8_t ch = bt_keyboard.get_ascii_char(); // Without waiting
 
-          if ((ch >= ' ') && (ch < 127)) std::cout << ch << std::flush; 
-          else if (ch > 0) {
-            std::cout << '[' << +ch << ']' << std::flush;
-          }
+          if ((ch >= ' ') && (ch < 127)) putchar(ch);
+          else if (ch > 0) printf("[%u]", ch);
+          fflush(stdout);
 #else
-      BTKeyboard::KeyInfo inf;
+      KeyEvent event;
+
+      bt_keyboard.wait_for_key_event(event);
 
-      bt_keyboard.wait_for_low_event(inf);
+      static constexpr char const *KIND_NAMES[] = {"down", "up", "repeat"};
+      printf("RECEIVED KEYBOARD EVENT: %x %s, modifiers: %x\n", event.usage,
+             KIND_NAMES[(uint8_t)event.kind], event.modifiers);
 
-      std::cout << "RECEIVED KEYBOARD EVENT: ";
-      for (int n = 0; n < inf.size; n++) {
-        std::cout << std::hex << +inf.keys[n] << ", ";
+      if ((event.kind == KeyEvent::Kind::DOWN) && (event.usage == 0x45) &&
+          (event.modifiers & (uint8_t)BTKeyboard::KeyModifier::R_CTRL)) {
+        bt_keyboard.dump_recording();
+      }
+      if ((event.kind == KeyEvent::Kind::DOWN) && (event.usage == 0x44) &&
+          (event.modifiers & (uint8_t)BTKeyboard::KeyModifier::R_CTRL)) {
+        report_metrics();
       }
-      std::cout << std::endl;
 #endif
     }
   }